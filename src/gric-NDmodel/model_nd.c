@@ -17,6 +17,7 @@
 #include <time.h>
 #include <unistd.h>
 #include "shared/cli_colors.h"
+#include "shared/dist_kernels.h"
 #define MAX_CLUSTERS 2000
 
 typedef struct
@@ -27,13 +28,7 @@ typedef struct
 
 double dist_nd(PointND p1, PointND p2)
 {
-    double sum = 0.0;
-    for (int k = 0; k < p1.dim; k++)
-    {
-        double d = p1.coords[k] - p2.coords[k];
-        sum += d * d;
-    }
-    return sqrt(sum);
+    return dist_l2_f64(p1.coords, p2.coords, p1.dim);
 }
 
 double rand_double()
@@ -137,6 +132,7 @@ static void print_help(const char *progname)
 int main(int argc, char *argv[])
 {
     cli_colors_init();
+    dist_kernels_init();
 
     // Check help option early
     for (int i = 1; i < argc; i++)
@@ -62,6 +62,10 @@ void parse_metrics(
     char        *out_clusters,
     char        *out_mem);
 
+/* Run the in-process distance-kernel benchmark (all frame dtypes). */
+int run_distance_benchmark(
+    long npix);
+
 /* Test List Management Prototypes */
 
 /* Load test patterns list from external file. */
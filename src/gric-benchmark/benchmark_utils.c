@@ -102,8 +102,11 @@ void print_help(
            ANSI_COLOR_CYAN, ANSI_COLOR_RESET, ANSI_COLOR_CYAN, ANSI_COLOR_RESET);
     printf("  %s-b, --build%s           Rebuild project before running benchmarks\n",
            ANSI_COLOR_GREEN, ANSI_COLOR_RESET);
-    printf("  %s-entropy%s              Enable Shannon entropy-reduction target selection\n\n",
+    printf("  %s-entropy%s              Enable Shannon entropy-reduction target selection\n",
            ANSI_COLOR_GREEN, ANSI_COLOR_RESET);
+    printf("  %s-distbench%s %s<npix>%s      Measure framedist() calls/s per frame dtype\n",
+           ANSI_COLOR_GREEN, ANSI_COLOR_RESET, ANSI_COLOR_MAGENTA, ANSI_COLOR_RESET);
+    printf("                        (f64, f32, u16, u8) and exit\n\n");
 
     printf("%sEXAMPLES%s\n", ANSI_BOLD_CYAN, ANSI_COLOR_RESET);
     printf("  %s$%s %s%s%s -p 2Dspiral -t mp4\n", ANSI_COLOR_GREY, ANSI_COLOR_RESET,
@@ -0,0 +1,316 @@
+/**
+ * @file dist_bench.c
+ * @brief In-process throughput benchmark of the frame distance kernel.
+ *
+ * Measures framedist() calls per second for each frame storage type
+ * (-dtype f64|f32|u16|u8) on synthetic frames, and checks that the
+ * narrow-type kernels return the same distances as the f64 path. The f64
+ * path is also timed for every distance-kernel ISA the CPU supports, and the
+ * f64/f32 paths are compared against framedist_batch() (one frame vs.
+ * DISTBENCH_BATCH anchors in the dot-product form).
+ *
+ * Main Functions:
+ * - run_distance_benchmark: Runs the benchmark and prints a summary table.
+ */
+#include "benchmark.h"
+#include "framedistance.h"
+#include "frame_dtype.h"
+#include "shared/dist_kernels.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DISTBENCH_NFRAMES 32
+#define DISTBENCH_MIN_SEC 0.25
+#define DISTBENCH_BATCH 8
+
+/**
+ * @brief Monotonic wall clock in seconds.
+ */
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9;
+}
+
+/**
+ * @brief Time framedist() over all frame pairs until DISTBENCH_MIN_SEC elapses.
+ *
+ * @param frames   Array of DISTBENCH_NFRAMES frames.
+ * @param out_rate Output calls per second.
+ * @return Sum of all distances of one full pass (for cross-type checks).
+ */
+static double time_framedist(
+    Frame  *frames,
+    double *out_rate)
+{
+    double checksum = 0.0;
+    for (int ii = 0; ii < DISTBENCH_NFRAMES; ii++)
+    {
+        checksum += framedist(&frames[ii], &frames[(ii + 1) % DISTBENCH_NFRAMES]);
+    }
+
+    long   calls = 0;
+    double sink  = 0.0;
+    double t0    = now_sec();
+    double dt    = 0.0;
+    do
+    {
+        for (int ii = 0; ii < DISTBENCH_NFRAMES; ii++)
+        {
+            for (int jj = ii + 1; jj < DISTBENCH_NFRAMES; jj++)
+            {
+                sink += framedist(&frames[ii], &frames[jj]);
+            }
+        }
+        calls += DISTBENCH_NFRAMES * (DISTBENCH_NFRAMES - 1) / 2;
+        dt = now_sec() - t0;
+    } while (dt < DISTBENCH_MIN_SEC);
+
+    /* Keep the timed loop observable */
+    if (sink < 0.0)
+    {
+        printf("%f\n", sink);
+    }
+
+    *out_rate = (double)calls / dt;
+    return checksum;
+}
+
+/**
+ * @brief Time the f64 path under every ISA the CPU supports.
+ *
+ * Restores the default selection before returning.
+ *
+ * @param frames   Array of DISTBENCH_NFRAMES f64 frames.
+ * @param ref_rate Rate of the default selection (for the speedup column).
+ * @param ref_sum  Checksum of the default selection.
+ * @return 0 if all ISAs agree with the default to 1e-12, 1 otherwise.
+ */
+static int bench_isas(
+    Frame  *frames,
+    double  ref_rate,
+    double  ref_sum)
+{
+    DistIsa active = dist_kernels_isa();
+    int     status = 0;
+
+    for (int isa = DIST_ISA_SCALAR; isa <= DIST_ISA_AVX512; isa++)
+    {
+        if (dist_kernels_set_isa((DistIsa)isa) != 0)
+        {
+            continue;
+        }
+        double rate   = 0.0;
+        double sum    = time_framedist(frames, &rate);
+        double relerr = (ref_sum > 0.0) ? fabs(sum - ref_sum) / ref_sum : 0.0;
+        printf("    f64/%-8s %12.0f %12s %9.2fx %12.2e\n",
+               dist_isa_name((DistIsa)isa), rate, "",
+               (ref_rate > 0.0) ? rate / ref_rate : 0.0, relerr);
+        if (relerr > 1.0e-12)
+        {
+            fprintf(stderr, "ERROR: [%s:%d] %s kernel disagrees with %s\n",
+                    __FILE__, __LINE__, dist_isa_name((DistIsa)isa), dist_isa_name(active));
+            status = 1;
+        }
+    }
+
+    dist_kernels_set_isa(active);
+    return status;
+}
+
+/**
+ * @brief Time framedist_batch() against DISTBENCH_BATCH framedist() calls.
+ *
+ * Frame 0 is compared with anchors 1..DISTBENCH_BATCH. The batched
+ * distances must agree with framedist() to 1e-9 relative error.
+ *
+ * @param frames Array of DISTBENCH_NFRAMES frames (f64 or f32).
+ * @return 0 on agreement, 1 otherwise.
+ */
+static int bench_batch(
+    Frame *frames)
+{
+    Frame  *anchors[DISTBENCH_BATCH];
+    double  nsq[DISTBENCH_BATCH];
+    double  ref[DISTBENCH_BATCH];
+    double  out[DISTBENCH_BATCH];
+    double  maxerr = 0.0;
+
+    for (int ii = 0; ii < DISTBENCH_BATCH; ii++)
+    {
+        anchors[ii] = &frames[ii + 1];
+        nsq[ii]     = frame_norm_sq(anchors[ii]);
+        ref[ii]     = framedist(&frames[0], anchors[ii]);
+    }
+    framedist_batch(&frames[0], anchors, nsq, DISTBENCH_BATCH, 0.0, out);
+    for (int ii = 0; ii < DISTBENCH_BATCH; ii++)
+    {
+        double err = fabs(out[ii] - ref[ii]) / ref[ii];
+        maxerr = (err > maxerr) ? err : maxerr;
+    }
+
+    double rate[2];
+    for (int mode = 0; mode < 2; mode++)
+    {
+        long   calls = 0;
+        double sink  = 0.0;
+        double t0    = now_sec();
+        double dt    = 0.0;
+        do
+        {
+            if (mode == 0)
+            {
+                for (int ii = 0; ii < DISTBENCH_BATCH; ii++)
+                {
+                    sink += framedist(&frames[0], anchors[ii]);
+                }
+            }
+            else
+            {
+                framedist_batch(&frames[0], anchors, nsq, DISTBENCH_BATCH, 0.0, out);
+                sink += out[0];
+            }
+            calls += DISTBENCH_BATCH;
+            dt = now_sec() - t0;
+        } while (dt < DISTBENCH_MIN_SEC);
+        if (sink < 0.0)
+        {
+            printf("%f\n", sink);
+        }
+        rate[mode] = (double)calls / dt;
+    }
+
+    printf("    %s/batch%-3d %12.0f %12s %9.2fx %12.2e\n",
+           frame_dtype_name(frames[0].dtype), DISTBENCH_BATCH, rate[1], "",
+           (rate[0] > 0.0) ? rate[1] / rate[0] : 0.0, maxerr);
+    if (maxerr > 1.0e-9)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] batched %s distances differ from framedist()\n",
+                __FILE__, __LINE__, frame_dtype_name(frames[0].dtype));
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Run the distance-kernel benchmark for all frame storage types.
+ *
+ * Pixel values are integers in [0, 255] so that every storage type
+ * represents the data exactly and all kernels must agree with f64.
+ *
+ * @param npix Number of pixels per frame.
+ * @return 0 on success, 1 if a kernel disagrees with f64 or allocation fails.
+ */
+int run_distance_benchmark(
+    long npix)
+{
+    static const FrameDType dtypes[] =
+    {
+        FRAME_DTYPE_F64, FRAME_DTYPE_F32, FRAME_DTYPE_U16, FRAME_DTYPE_U8
+    };
+    const int ndtypes = (int)(sizeof(dtypes) / sizeof(dtypes[0]));
+
+    if (npix < 1)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] invalid pixel count %ld\n",
+                __FILE__, __LINE__, npix);
+        return 1;
+    }
+
+    double *src = (double *)malloc((size_t)npix * DISTBENCH_NFRAMES * sizeof(double));
+    if (src == NULL)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] allocation failed\n", __FILE__, __LINE__);
+        return 1;
+    }
+    srand(12345);
+    for (long ii = 0; ii < npix * DISTBENCH_NFRAMES; ii++)
+    {
+        src[ii] = (double)(rand() % 256);
+    }
+
+    DistIsa active_isa = dist_kernels_isa();
+    printf("%sDistance kernel benchmark%s  (%ld pixels/frame, %d frames, isa %s)\n",
+           ANSI_BOLD_CYAN, ANSI_COLOR_RESET, npix, DISTBENCH_NFRAMES,
+           dist_isa_name(active_isa));
+    printf("  %-6s %16s %12s %10s %12s\n",
+           "dtype", "calls/s", "GB/s", "vs f64", "max relerr");
+
+    int    status   = 0;
+    double ref_rate = 0.0;
+    double ref_sum  = 0.0;
+    Frame  frames[DISTBENCH_NFRAMES];
+
+    memset(frames, 0, sizeof(frames));
+
+    for (int dd = 0; dd < ndtypes; dd++)
+    {
+        FrameDType dt    = dtypes[dd];
+        size_t     esize = frame_dtype_size(dt);
+        int        ok    = 1;
+
+        for (int ii = 0; ii < DISTBENCH_NFRAMES; ii++)
+        {
+            frames[ii].data   = malloc((size_t)npix * esize);
+            frames[ii].dtype  = dt;
+            frames[ii].width  = npix;
+            frames[ii].height = 1;
+            frames[ii].id     = ii;
+            if (frames[ii].data == NULL)
+            {
+                ok = 0;
+                continue;
+            }
+            frame_store_doubles(frames[ii].data, dt, &src[(long)ii * npix], npix);
+        }
+
+        if (ok)
+        {
+            double rate = 0.0;
+            double sum  = time_framedist(frames, &rate);
+            if (dt == FRAME_DTYPE_F64)
+            {
+                ref_rate = rate;
+                ref_sum  = sum;
+            }
+            double relerr = (ref_sum > 0.0) ? fabs(sum - ref_sum) / ref_sum : 0.0;
+            double gbps   = rate * 2.0 * (double)npix * (double)esize * 1.0e-9;
+            printf("  %-6s %16.0f %12.2f %9.2fx %12.2e\n",
+                   frame_dtype_name(dt), rate, gbps,
+                   (ref_rate > 0.0) ? rate / ref_rate : 0.0, relerr);
+            if (relerr > 1.0e-9)
+            {
+                fprintf(stderr, "ERROR: [%s:%d] %s distances differ from f64\n",
+                        __FILE__, __LINE__, frame_dtype_name(dt));
+                status = 1;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: [%s:%d] allocation failed\n", __FILE__, __LINE__);
+            status = 1;
+        }
+
+        if (ok && dt == FRAME_DTYPE_F64)
+        {
+            status |= bench_isas(frames, ref_rate, ref_sum);
+        }
+        if (ok && (dt == FRAME_DTYPE_F64 || dt == FRAME_DTYPE_F32))
+        {
+            status |= bench_batch(frames);
+        }
+
+        for (int ii = 0; ii < DISTBENCH_NFRAMES; ii++)
+        {
+            free(frames[ii].data);
+        }
+    }
+
+    free(src);
+    return status;
+}
@@ -82,6 +82,7 @@ int main(
         {"maxcl",    required_argument, 0, 1002},
         {"maxim",    required_argument, 0, 1003},
         {"entropy",  no_argument,       0, 1004},
+        {"distbench", required_argument, 0, 1005},
         {0, 0, 0, 0}
     };
 
@@ -164,6 +165,8 @@ int main(
             case 1004: /* -entropy */
                 config.use_entropy = 1;
                 break;
+            case 1005: /* -distbench */
+                return run_distance_benchmark(atol(optarg));
             default:
                 fprintf(stderr, "Error: Unknown option\n");
                 print_help(argv[0]);
@@ -13,6 +13,8 @@
 #include <sys/types.h>
 #include <time.h>
 #include "shared/cli_colors.h"
+#include "shared/dist_kernels.h"
+#include "shared/gricres.h"
 
 #define MAX_HISTOGRAM_LIMIT 10000
 
@@ -59,6 +61,9 @@ typedef struct
     /* DCC Matrix */
     double *dcc_matrix;
     int    *dcc_measured;
+
+    /* Results bundle (assignments point into it when loaded from there) */
+    GricRes results;
 } AnalysisState;
 
 /* Function Declarations */
@@ -80,6 +85,12 @@ static int parse_dcc_file(
     const char    *filename,
     AnalysisState *state);
 
+static int load_results_bundle(
+    const char    *filename,
+    AnalysisState *state,
+    int            want_membership,
+    int            want_dcc);
+
 static void compute_derived_stats(
     AnalysisState *state);
 
@@ -88,11 +99,6 @@ static void print_ascii_histogram(
     int         max_val,
     long        total_count);
 
-static double compute_euclidean_distance(
-    const double *restrict p1,
-    const double *restrict p2,
-    int                    dim);
-
 static int analyze_spatial_spread(
     const char    *points_file,
     const char    *anchors_file,
@@ -152,7 +158,7 @@ static void free_state(
     {
         free(state->query_hist);
     }
-    if (state->assignments != NULL)
+    if (state->assignments != NULL && state->results.hdr == NULL)
     {
         free(state->assignments);
     }
@@ -180,6 +186,7 @@ static void free_state(
     {
         free(state->dcc_measured);
     }
+    gricres_close(&state->results);
 } // free_state
 
 /**
@@ -437,6 +444,59 @@ static int parse_dcc_file(
     return 0;
 } // parse_dcc_file
 
+/**
+ * load_results_bundle() - Take membership and distances from results.gricres.
+ * @filename:        Path to the bundle.
+ * @state:           The state structure to fill.
+ * @want_membership: 1 to take the membership column (used in place).
+ * @want_dcc:        1 to take the inter-cluster distances.
+ *
+ * The cluster count of the bundle is used if the run log did not provide one.
+ *
+ * Return: 0 if the bundle was used, -1 if missing or invalid.
+ */
+static int load_results_bundle(
+    const char    *filename,
+    AnalysisState *state,
+    int            want_membership,
+    int            want_dcc)
+{
+    if (gricres_open(&state->results, filename) != 0)
+    {
+        return -1;
+    }
+    if (state->num_clusters <= 0)
+    {
+        state->num_clusters = (int)state->results.hdr->num_clusters;
+    }
+
+    uint64_t count = 0;
+    const int32_t *memb = gricres_section(&state->results, GRICRES_SEC_MEMBERSHIP, &count);
+    if (want_membership && memb != NULL)
+    {
+        state->assignments = (int *)memb;
+        state->assignments_count = (long)count;
+    }
+
+    const GricResDcc *dcc = gricres_section(&state->results, GRICRES_SEC_DCC, &count);
+    int n = state->num_clusters;
+    if (want_dcc && dcc != NULL && n > 0)
+    {
+        state->dcc_matrix = calloc((size_t)n * n, sizeof(double));
+        state->dcc_measured = calloc((size_t)n * n, sizeof(int));
+        for (uint64_t e = 0; state->dcc_measured != NULL && e < count; e++)
+        {
+            if (state->dcc_matrix != NULL && dcc[e].i >= 0 && dcc[e].i < n && dcc[e].j >= 0
+                && dcc[e].j < n)
+            {
+                state->dcc_matrix[dcc[e].i * n + dcc[e].j] = dcc[e].d;
+                state->dcc_measured[dcc[e].i * n + dcc[e].j] = 1;
+            }
+        }
+    }
+    return 0;
+} // load_results_bundle
+
 /**
  * compute_derived_stats() - Compute cluster sizes, entropy, transition matrix, and lifetimes.
  * @state: AnalysisState configuration and assignments populated.
@@ -554,28 +614,6 @@ static void print_ascii_histogram(
     } // for (int k = 0; ...)
 } // print_ascii_histogram
 
-/**
- * compute_euclidean_distance() - Internal fast Euclidean distance function.
- * @p1:  First vector pointer.
- * @p2:  Second vector pointer.
- * @dim: Vector dimension.
- *
- * Return: Euclidean distance.
- */
-static double compute_euclidean_distance(
-    const double *restrict p1,
-    const double *restrict p2,
-    int                    dim)
-{
-    double sum = 0.0;
-    for (int k = 0; k < dim; k++)
-    {
-        double diff = p1[k] - p2[k];
-        sum += diff * diff;
-    }
-    return sqrt(sum);
-} // compute_euclidean_distance
-
 /**
  * analyze_spatial_spread() - Optional analysis of points spatial spread from anchors.
  * @points_file:  Original coordinates text file.
@@ -715,9 +753,9 @@ static int analyze_spatial_spread(
         int assigned_c = state->assignments[frame_idx];
         if (assigned_c >= 0 && assigned_c < n)
         {
-            double d = compute_euclidean_distance(point_coords,
-                                                  &anchors[assigned_c * dim],
-                                                  dim);
+            double d = dist_l2_f64(point_coords,
+                                   &anchors[assigned_c * dim],
+                                   dim);
             cluster_dist_sum[assigned_c] += d;
             cluster_dist_sq_sum[assigned_c] += (d * d);
             if (d > cluster_dist_max[assigned_c])
@@ -1121,6 +1159,7 @@ int main(
     char **argv)
 {
     cli_colors_init();
+    dist_kernels_init();
 
     char *dir_path = NULL;
     char *log_override = NULL;
@@ -1210,9 +1249,11 @@ int main(
     char memb_path[4096] = {0};
     char dcc_path[4096] = {0};
     char anchors_path[4096] = {0};
+    char res_path[4096] = {0};
 
     if (dir_path != NULL)
     {
+        snprintf(res_path, sizeof(res_path), "%s/%s", dir_path, GRICRES_FILE);
         snprintf(log_path, sizeof(log_path), "%s/cluster_run.log", dir_path);
         snprintf(memb_path, sizeof(memb_path), "%s/frame_membership.txt", dir_path);
         snprintf(dcc_path, sizeof(dcc_path), "%s/dcc.txt", dir_path);
@@ -1250,6 +1291,21 @@ int main(
         }
     }
 
+    /* Binary results bundle replaces the membership and DCC text files */
+    if (res_path[0] != '\0' && (memb_override == NULL || dcc_override == NULL)
+        && load_results_bundle(res_path, &state, memb_override == NULL,
+                               dcc_override == NULL) == 0)
+    {
+        if (memb_override == NULL)
+        {
+            memb_path[0] = '\0';
+        }
+        if (dcc_override == NULL)
+        {
+            dcc_path[0] = '\0';
+        }
+    }
+
     /* Read membership log */
     if (memb_path[0] != '\0')
     {
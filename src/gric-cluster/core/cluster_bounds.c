@@ -10,7 +10,7 @@
 #include <stdlib.h>
 
 /**
- * update_dcc_bounds() - Update dcc_min/dcc_max and propagate bounds to other clusters.
+ * update_dcc_bounds() - Record an exact pair distance and propagate bounds to other clusters.
  * @state: Running state of the clustering execution.
  * @config: Config parameters of the clustering execution.
  * @i: First cluster index.
@@ -27,14 +27,10 @@ void update_dcc_bounds(
     int            j,
     double         d_exact)
 {
-    int N = config->algo.maxnbclust;
+    (void)config;
+    DccStore *dcc = &state->scratch.dcc;
 
-    state->scratch.dcc_min[i * N + j] = d_exact;
-    state->scratch.dcc_min[j * N + i] = d_exact;
-    state->scratch.dcc_max[i * N + j] = d_exact;
-    state->scratch.dcc_max[j * N + i] = d_exact;
-    state->scratch.dcc_measured[i * N + j] = 1;
-    state->scratch.dcc_measured[j * N + i] = 1;
+    dcc_set_exact(dcc, i, j, d_exact);
 
     for (int k = 0; k < state->num_clusters; k++)
     {
@@ -43,60 +39,64 @@ void update_dcc_bounds(
             continue;
         }
 
+        double max_ik = dcc_get_max(dcc, i, k);
+        double max_jk = dcc_get_max(dcc, j, k);
+        double min_ik = dcc_get_min(dcc, i, k);
+        double min_jk = dcc_get_min(dcc, j, k);
+
         // Upper Bound Refinement for (i, k) using (j, k)
-        if (state->scratch.dcc_max[j * N + k] < 1e18)
+        if (max_jk < 1e18)
         {
-            double new_max = d_exact + state->scratch.dcc_max[j * N + k];
-            if (new_max < state->scratch.dcc_max[i * N + k])
+            double new_max = d_exact + max_jk;
+            if (new_max < max_ik)
             {
-                state->scratch.dcc_max[i * N + k] = new_max;
-                state->scratch.dcc_max[k * N + i] = new_max;
+                max_ik = new_max;
+                dcc_set_max(dcc, i, k, new_max);
             }
         }
 
         // Upper Bound Refinement for (j, k) using (i, k)
-        if (state->scratch.dcc_max[i * N + k] < 1e18)
+        if (max_ik < 1e18)
         {
-            double new_max = d_exact + state->scratch.dcc_max[i * N + k];
-            if (new_max < state->scratch.dcc_max[j * N + k])
+            double new_max = d_exact + max_ik;
+            if (new_max < max_jk)
             {
-                state->scratch.dcc_max[j * N + k] = new_max;
-                state->scratch.dcc_max[k * N + j] = new_max;
+                max_jk = new_max;
+                dcc_set_max(dcc, j, k, new_max);
             }
         }
 
         // Lower Bound Refinement for (i, k) using (j, k)
-        if (state->scratch.dcc_max[j * N + k] < 1e18)
+        if (max_jk < 1e18)
         {
-            double l1 = d_exact - state->scratch.dcc_max[j * N + k];
-            if (l1 > 0.0 && l1 > state->scratch.dcc_min[i * N + k])
+            double l1 = d_exact - max_jk;
+            if (l1 > 0.0 && l1 > min_ik)
             {
-                state->scratch.dcc_min[i * N + k] = l1;
-                state->scratch.dcc_min[k * N + i] = l1;
+                min_ik = l1;
+                dcc_set_min(dcc, i, k, l1);
             }
         }
-        double l2 = state->scratch.dcc_min[j * N + k] - d_exact;
-        if (l2 > 0.0 && l2 > state->scratch.dcc_min[i * N + k])
+        double l2 = min_jk - d_exact;
+        if (l2 > 0.0 && l2 > min_ik)
         {
-            state->scratch.dcc_min[i * N + k] = l2;
-            state->scratch.dcc_min[k * N + i] = l2;
+            min_ik = l2;
+            dcc_set_min(dcc, i, k, l2);
         }
 
         // Lower Bound Refinement for (j, k) using (i, k)
-        if (state->scratch.dcc_max[i * N + k] < 1e18)
+        if (max_ik < 1e18)
         {
-            double l3 = d_exact - state->scratch.dcc_max[i * N + k];
-            if (l3 > 0.0 && l3 > state->scratch.dcc_min[j * N + k])
+            double l3 = d_exact - max_ik;
+            if (l3 > 0.0 && l3 > min_jk)
             {
-                state->scratch.dcc_min[j * N + k] = l3;
-                state->scratch.dcc_min[k * N + j] = l3;
+                min_jk = l3;
+                dcc_set_min(dcc, j, k, l3);
             }
         }
-        double l4 = state->scratch.dcc_min[i * N + k] - d_exact;
-        if (l4 > 0.0 && l4 > state->scratch.dcc_min[j * N + k])
+        double l4 = min_ik - d_exact;
+        if (l4 > 0.0 && l4 > min_jk)
         {
-            state->scratch.dcc_min[j * N + k] = l4;
-            state->scratch.dcc_min[k * N + j] = l4;
+            dcc_set_min(dcc, j, k, l4);
         }
     }
 }
@@ -106,123 +106,24 @@ void update_dcc_bounds(
  * @config: Config parameters of the clustering execution.
  * @state: Running state of the clustering execution.
  *
- * Scans all active cluster pairs, gathers unmeasured ones, sorts them by dcc_min
- * in ascending order, and computes/propagates exact distances for the top E pairs.
+ * Takes the E unmeasured pairs with the smallest dcc_min from the refine
+ * queue, which is kept up to date across steps instead of rescanning all
+ * pairs, then computes/propagates their exact distances.
  */
 void refine_sparse_bounds(
     ClusterConfig *config,
     ClusterState  *state)
 {
-    int N = config->algo.maxnbclust;
     int E = config->optim.sparse_dcc_extra_evals;
     if (E <= 0 || state->num_clusters <= 1)
     {
         return;
     }
 
-    int Q = state->scratch.refine_queue_capacity;
-    if (Q <= 0)
-    {
-        Q = 1024;
-    }
-
-    /* Rebuild the queue if the number of clusters has changed (topology changed)
-     * or if we do not have enough elements left to satisfy E requests. */
-    if (state->num_clusters != state->scratch.refine_queue_last_num_clusters ||
-        state->scratch.refine_queue_idx + E > state->scratch.refine_queue_size)
-    {
-        Candidate best_pairs[Q];
-        for (int k = 0; k < Q; k++)
-        {
-            best_pairs[k].id = -1;
-            best_pairs[k].p = -1e30;
-        }
-
-        #pragma omp parallel
-        {
-            Candidate local_best[Q];
-            for (int k = 0; k < Q; k++)
-            {
-                local_best[k].id = -1;
-                local_best[k].p = -1e30;
-            }
-
-            #pragma omp for nowait
-            for (int i = 0; i < state->num_clusters; i++)
-            {
-                char *measured_row = &state->scratch.dcc_measured[i * N];
-                double *dcc_min_row = &state->scratch.dcc_min[i * N];
-                for (int j = i + 1; j < state->num_clusters; j++)
-                {
-                    if (!measured_row[j])
-                    {
-                        double dcc_val = dcc_min_row[j];
-                        double score = -dcc_val;
-
-                        if (score > local_best[Q - 1].p)
-                        {
-                            int k = Q - 2;
-                            while (k >= 0 && score > local_best[k].p)
-                            {
-                                local_best[k + 1] = local_best[k];
-                                k--;
-                            }
-                            local_best[k + 1].id = (i << 16) | j;
-                            local_best[k + 1].p = score;
-                        }
-                    }
-                }
-            }
-
-            #pragma omp critical
-            {
-                for (int idx = 0; idx < Q; idx++)
-                {
-                    if (local_best[idx].id == -1)
-                    {
-                        continue;
-                    }
-                    double score = local_best[idx].p;
-                    if (score > best_pairs[Q - 1].p)
-                    {
-                        int k = Q - 2;
-                        while (k >= 0 && score > best_pairs[k].p)
-                        {
-                            best_pairs[k + 1] = best_pairs[k];
-                            k--;
-                        }
-                        best_pairs[k + 1] = local_best[idx];
-                    }
-                }
-            }
-        }
-
-        /* Copy back to scratch queue */
-        int count = 0;
-        for (int k = 0; k < Q; k++)
-        {
-            if (best_pairs[k].id != -1)
-            {
-                state->scratch.refine_queue[count] = best_pairs[k];
-                count++;
-            }
-        }
-        state->scratch.refine_queue_size = count;
-        state->scratch.refine_queue_idx = 0;
-        state->scratch.refine_queue_last_num_clusters = state->num_clusters;
-    }
-
-    /* Pop the next E candidates from the queue */
-    int found = 0;
-    for (int idx = 0; idx < E; idx++)
-    {
-        int q_idx = state->scratch.refine_queue_idx + idx;
-        if (q_idx < state->scratch.refine_queue_size)
-        {
-            found++;
-        }
-    }
-
+    int pair_i[E];
+    int pair_j[E];
+    int found = refine_queue_next(&state->scratch.refine, &state->scratch.dcc,
+                                  state->num_clusters, E, pair_i, pair_j);
     if (found <= 0)
     {
         return;
@@ -232,13 +133,9 @@ void refine_sparse_bounds(
     #pragma omp parallel for if(found >= 2)
     for (int idx = 0; idx < found; idx++)
     {
-        int q_idx = state->scratch.refine_queue_idx + idx;
-        int i = state->scratch.refine_queue[q_idx].id >> 16;
-        int j = state->scratch.refine_queue[q_idx].id & 0xFFFF;
-
         distances[idx] = get_dist(
-            &state->clusters[i].anchor,
-            &state->clusters[j].anchor,
+            &state->clusters[pair_i[idx]].anchor,
+            &state->clusters[pair_j[idx]].anchor,
             -1,
             -1.0,
             -1.0,
@@ -248,11 +145,6 @@ void refine_sparse_bounds(
 
     for (int idx = 0; idx < found; idx++)
     {
-        int q_idx = state->scratch.refine_queue_idx + idx;
-        int i = state->scratch.refine_queue[q_idx].id >> 16;
-        int j = state->scratch.refine_queue[q_idx].id & 0xFFFF;
-        update_dcc_bounds(state, config, i, j, distances[idx]);
+        update_dcc_bounds(state, config, pair_i[idx], pair_j[idx], distances[idx]);
     }
-
-    state->scratch.refine_queue_idx += found;
 }
@@ -13,6 +13,9 @@
 #include "framedistance.h"
 #include "frameread.h"
 #include "cluster_shm.h"
+#include "knn_online.h"
+#include "spec_batch.h"
+#include "shared/gricres.h"
 #include "tile_map.h"
 #include "tile_state.h"
 #include <stdio.h>
@@ -55,6 +58,72 @@ double get_dist(
     double         current_gprob,
     ClusterConfig *config,
     ClusterState  *state)
+{
+    int exact;
+    return get_dist_bounded(a, b, cluster_idx, cluster_prob, current_gprob, 0.0, &exact,
+                            config, state);
+}
+
+/**
+ * get_dist_bounded() - get_dist() with early abandon beyond a distance limit.
+ * @a:            Pointer to the first Frame.
+ * @b:            Pointer to the second Frame (cluster anchor).
+ * @cluster_idx:  Index of the cluster.
+ * @cluster_prob: Prior predictive probability of matching the cluster.
+ * @current_gprob: Geometric consistency probability.
+ * @limit:        Distance above which the exact value is not needed
+ *                (<= 0 for an exact evaluation).
+ * @exact:        Output; 1 if the result is exact, 0 if it is a lower bound.
+ * @config:       Pointer to the active ClusterConfig.
+ * @state:        Pointer to the active ClusterState.
+ *
+ * Same bookkeeping as get_dist(); abandoned evaluations are additionally
+ * counted in telemetry.framedist_abandoned.
+ *
+ * Return: The Euclidean distance, or a lower bound greater than @limit.
+ */
+double get_dist_bounded(
+    Frame         *a,
+    Frame         *b,
+    int            cluster_idx,
+    double         cluster_prob,
+    double         current_gprob,
+    double         limit,
+    int           *exact,
+    ClusterConfig *config,
+    ClusterState  *state)
+{
+    double d = framedist_bounded(a, b, limit, exact);
+    account_dist(a, b, cluster_idx, cluster_prob, current_gprob, d, *exact, config, state);
+    return d;
+}
+
+/**
+ * account_dist() - Bookkeeping of one frame-to-frame distance evaluation.
+ * @a:            Pointer to the first Frame.
+ * @b:            Pointer to the second Frame (cluster anchor).
+ * @cluster_idx:  Index of the cluster, or -1 for an inter-cluster distance.
+ * @cluster_prob: Prior predictive probability of matching the cluster.
+ * @current_gprob: Geometric consistency probability.
+ * @d:            Distance (or lower bound) found.
+ * @exact:        1 if @d is exact, 0 if it is a lower bound.
+ * @config:       Pointer to the active ClusterConfig.
+ * @state:        Pointer to the active ClusterState.
+ *
+ * Counts the evaluation in the telemetry, writes the distance log line and
+ * the verbose trace, exactly as get_dist_bounded() does for the distances it
+ * computes. Used directly for distances evaluated ahead of time.
+ */
+void account_dist(
+    Frame         *a,
+    Frame         *b,
+    int            cluster_idx,
+    double         cluster_prob,
+    double         current_gprob,
+    double         d,
+    int            exact,
+    ClusterConfig *config,
+    ClusterState  *state)
 {
 #ifdef _OPENMP
 #pragma omp atomic
@@ -74,7 +143,13 @@ double get_dist(
 #endif
         state->telemetry.framedist_calls_intercluster++;
     }
-    double d = framedist(a, b);
+    if (!exact)
+    {
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+        state->telemetry.framedist_abandoned++;
+    }
 
     if (config->output.distall_mode && state->distall_out)
     {
@@ -89,8 +164,70 @@ double get_dist(
                "  [VV] Computed distance: Frame %5d to Cluster %4d = %12.5e\n" ANSI_COLOR_RESET,
                a->id, cluster_idx, d);
     }
+}
 
-    return d;
+/**
+ * get_dist_batch() - Distances from one frame to several cluster anchors.
+ * @a:        Pointer to the frame.
+ * @clusters: Indices of the target clusters.
+ * @n:        Number of clusters.
+ * @config:   Pointer to the active ClusterConfig.
+ * @state:    Pointer to the active ClusterState.
+ * @out:      Output; @n distances.
+ *
+ * Evaluates all @n distances with framedist_batch() using the cached anchor
+ * norms, so the frame is streamed once per group of anchors. Results at or
+ * near rlim are exact. Records the same statistics, distance log lines and
+ * verbose traces as @n calls to get_dist().
+ */
+void get_dist_batch(
+    Frame         *a,
+    const int     *clusters,
+    int            n,
+    ClusterConfig *config,
+    ClusterState  *state,
+    double        *out)
+{
+    Frame  *anchors[n];
+    double  nsq[n];
+
+    for (int kk = 0; kk < n; kk++)
+    {
+        anchors[kk] = &state->clusters[clusters[kk]].anchor;
+        nsq[kk] = state->clusters[clusters[kk]].norm_sq;
+    }
+
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+    state->telemetry.framedist_calls += n;
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+    state->telemetry.framedist_calls_sample += n;
+
+    framedist_batch(a, anchors, nsq, n, config->algo.rlim, out);
+
+    for (int kk = 0; kk < n; kk++)
+    {
+        Cluster *cl = &state->clusters[clusters[kk]];
+
+        if (config->output.distall_mode && state->distall_out)
+        {
+            double ratio = (config->algo.rlim > 0.0) ? out[kk] / config->algo.rlim : -1.0;
+            fprintf(state->distall_out, "%-8d %-8d %-12.6f %-12.6f %-8d %-12.6f %-12.6f\n",
+                    a->id, cl->anchor.id, out[kk], ratio, cl->id, cl->prob,
+                    state->scratch.current_gprobs[clusters[kk]]);
+        }
+
+        if (config->output.verbose_level >= 2)
+        {
+            printf(ANSI_COLOR_BLUE
+                   "  [VV] Computed distance: Frame %5d to Cluster %4d = %12.5e (batch)\n"
+                   ANSI_COLOR_RESET,
+                   a->id, cl->id, out[kk]);
+        }
+    }
 }
 
 /**
@@ -113,6 +250,19 @@ void run_clustering(
     }
 #endif
 
+    /*
+     * Readers prefer the results bundle over the text outputs, so one left by
+     * an earlier run into this directory must not outlive them (-gricres
+     * writes a new one once the run completes).
+     */
+    if (config->output.user_outdir)
+    {
+        char bundle_path[1024];
+        snprintf(bundle_path, sizeof(bundle_path), "%s/%s", config->output.user_outdir,
+                 GRICRES_FILE);
+        remove(bundle_path);
+    }
+
     /* Check for multi-tile mode and dispatch if needed */
     {
         int num_tiles = 1;
@@ -178,6 +328,16 @@ void run_clustering(
                     config->input.tile_config_file);
             }
 
+            if (config->output.output_gricres)
+            {
+                printf("NOTE: -gricres is not supported in multi-tile mode; "
+                       "no %s written\n", GRICRES_FILE);
+            }
+            if (config->output.knn_k > 0)
+            {
+                printf("NOTE: -knn is not supported in multi-tile mode; "
+                       "no %s written\n", KNN_ONLINE_FILE);
+            }
             run_clustering_multitile(config, mts);
 
             multitile_free(mts);
@@ -186,14 +346,47 @@ void run_clustering(
         }
     } // Check for multi-tile mode
 
+    /* Large frames: split each distance across the -ncpu threads */
+    framedist_set_threads(config->optim.ncpu);
+    {
+        long npix = get_frame_width() * get_frame_height();
+        int  team = framedist_team_size(npix);
+        if (team > 1)
+        {
+            printf("Distance team: %d threads per distance (%ld pixels per frame)\n", team,
+                   npix);
+        }
+    }
+
     long actual_frames = get_num_frames();
     if (actual_frames > config->input.maxnbfr)
     {
         actual_frames = config->input.maxnbfr;
     }
 
-    state->assignments = (int *)malloc(actual_frames * sizeof(int));
-    state->frame_infos = (FrameInfo *)calloc(actual_frames, sizeof(FrameInfo));
+    /*
+     * Rolling history: 2 * window slots, of which history_slide() keeps the
+     * newest half. The window covers the longest lookback of -pred/-predf.
+     */
+    long history_slots = actual_frames;
+    if (config->input.history_window > 0)
+    {
+        long window = config->input.history_window;
+        long need = (long)config->optim.pred_h + config->optim.pred_len + 1;
+        if (config->optim.pred_mode && window < need)
+        {
+            window = need;
+        }
+        if (2 * window < actual_frames)
+        {
+            state->history_cap = 2 * window;
+            history_slots = state->history_cap;
+            printf("Rolling history: %ld frames kept\n", window);
+        }
+    }
+
+    state->assignments = (int *)malloc(history_slots * sizeof(int));
+    state->frame_infos = (FrameInfo *)calloc(history_slots, sizeof(FrameInfo));
 
     // Allocate telemetry and scratch tracking matrices
     {
@@ -261,12 +454,63 @@ void run_clustering(
         }
     }
 
+    /* Membership columns of the results bundle fill as frames are assigned */
+    if (config->output.output_gricres)
+    {
+        char out_path[1024];
+        snprintf(out_path, sizeof(out_path), "%s/%s", config->output.user_outdir, GRICRES_FILE);
+        state->gricres = (GricResWriter *)malloc(sizeof(GricResWriter));
+        if (state->gricres && gricres_writer_open(state->gricres, out_path) != 0)
+        {
+            free(state->gricres);
+            state->gricres = NULL;
+        }
+    }
+
+    /* Online k-NN: each frame is searched against the frames before it */
+    if (config->output.knn_k > 0)
+    {
+        char out_path[1024];
+        if (config->output.user_outdir)
+        {
+            snprintf(out_path, sizeof(out_path), "%s/%s", config->output.user_outdir,
+                     KNN_ONLINE_FILE);
+        }
+        else
+        {
+            snprintf(out_path, sizeof(out_path), "%s", KNN_ONLINE_FILE);
+        }
+        state->knn = (KnnOnline *)malloc(sizeof(KnnOnline));
+        if (state->knn
+            && knn_online_open(state->knn, out_path, config->output.knn_k,
+                               config->input.history_window,
+                               config->input.stream_input_mode) != 0)
+        {
+            free(state->knn);
+            state->knn = NULL;
+        }
+    }
+
     struct timespec start, end;
     clock_gettime(CLOCK_MONOTONIC, &start);
 
     int  prev_assigned_cluster = -1;
     long prev_missed_frames = 0;
 
+    /* Speculative batches need frames ahead; a live stream delivers them one by one */
+    SpecBatch spec = {0};
+    if (config->optim.spec_batch > 1)
+    {
+        if (config->input.stream_input_mode)
+        {
+            printf("NOTE: -specbatch ignored for stream input\n");
+        }
+        else if (spec_batch_init(&spec, config->optim.spec_batch) == 0)
+        {
+            state->spec = &spec;
+        }
+    }
+
     printf("Clustering sequence\n");
 
     // Main clustering loop: reads and assigns each frame sequentially
@@ -280,11 +524,39 @@ void run_clustering(
 
         // Fetch the next frame from the configured input source (FITS, MP4, or Stream)
         struct timespec io_start, io_end;
-        clock_gettime(CLOCK_MONOTONIC, &io_start);
-        Frame *current_frame = getframe();
-        clock_gettime(CLOCK_MONOTONIC, &io_end);
-        state->telemetry.time_io_ms += (io_end.tv_sec - io_start.tv_sec) * 1000.0 +
-                                       (io_end.tv_nsec - io_start.tv_nsec) / 1000000.0;
+        Frame *current_frame = NULL;
+        if (state->spec != NULL)
+        {
+            current_frame = spec_batch_pop(&spec);
+            if (current_frame == NULL)
+            {
+                /* Read the next batch, then evaluate its distances ahead */
+                clock_gettime(CLOCK_MONOTONIC, &io_start);
+                spec.nframes = 0;
+                while (spec.nframes < spec.size && i + spec.nframes < actual_frames)
+                {
+                    Frame *fr = getframe();
+                    if (!fr)
+                    {
+                        break;
+                    }
+                    spec.frames[spec.nframes++] = fr;
+                }
+                clock_gettime(CLOCK_MONOTONIC, &io_end);
+                state->telemetry.time_io_ms += (io_end.tv_sec - io_start.tv_sec) * 1000.0 +
+                                               (io_end.tv_nsec - io_start.tv_nsec) / 1000000.0;
+                spec_batch_eval(&spec, config, state);
+                current_frame = spec_batch_pop(&spec);
+            }
+        }
+        else
+        {
+            clock_gettime(CLOCK_MONOTONIC, &io_start);
+            current_frame = getframe();
+            clock_gettime(CLOCK_MONOTONIC, &io_end);
+            state->telemetry.time_io_ms += (io_end.tv_sec - io_start.tv_sec) * 1000.0 +
+                                           (io_end.tv_nsec - io_start.tv_nsec) / 1000000.0;
+        }
         if (!current_frame)
         {
             break;
@@ -299,6 +571,11 @@ void run_clustering(
         {
             break;
         }
+        if (state->spec != NULL)
+        {
+            /* A frame's own cluster is the likeliest match of the next frames */
+            spec_batch_note(&spec, state, res);
+        }
 
         if (state->shm_ptr != NULL)
         {
@@ -355,6 +632,20 @@ void run_clustering(
         printf("\n");
     }
 
+    if (state->spec != NULL)
+    {
+        /* Frames read ahead but not clustered (stop or early exit) */
+        for (Frame *fr = spec_batch_pop(&spec); fr != NULL; fr = spec_batch_pop(&spec))
+        {
+            free_frame(fr);
+        }
+        state->telemetry.spec_evaluated = spec.evaluated;
+        state->telemetry.spec_used = spec.used;
+        state->telemetry.time_spec_ms = spec.time_ms;
+        spec_batch_free(&spec);
+        state->spec = NULL;
+    }
+
     clock_gettime(CLOCK_MONOTONIC, &end);
     double elapsed_ms =
         (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0;
@@ -371,6 +662,17 @@ void run_clustering(
            state->telemetry.framedist_calls,
            state->telemetry.framedist_calls_sample,
            state->telemetry.framedist_calls_intercluster);
+    if (config->optim.abandon_factor > 0.0)
+    {
+        printf("Early-abandoned distances: %ld\n", state->telemetry.framedist_abandoned);
+    }
+    if (state->telemetry.spec_evaluated > 0)
+    {
+        printf("Speculative distances: %ld evaluated ahead, %ld used (%.1f%%), %.3f ms\n",
+               state->telemetry.spec_evaluated, state->telemetry.spec_used,
+               100.0 * state->telemetry.spec_used / state->telemetry.spec_evaluated,
+               state->telemetry.time_spec_ms);
+    }
 
     double total_steps_ms = state->telemetry.time_step_1 +
                             state->telemetry.time_step_2 +
@@ -521,6 +823,12 @@ void run_clustering(
     {
         fclose(ascii_out);
     }
+    if (state->knn)
+    {
+        knn_online_close(state->knn);
+        free(state->knn);
+        state->knn = NULL;
+    }
 
     if (state->telemetry.dist_counts)
     {
@@ -586,22 +894,23 @@ void print_clustering_metrics(
     }
 
     long assigned_count = 0;
-    for (long t = 0; t < total_frames; t++)
+    for (long t = state->history_base; t < total_frames; t++)
     {
-        int assigned_cl = state->frame_infos[t].assignment;
+        const FrameInfo *fi = &state->frame_infos[t - state->history_base];
+        int assigned_cl = fi->assignment;
         if (assigned_cl < 0 || assigned_cl >= K)
         {
             continue;
         }
 
         double d = 0.0;
-        if (state->frame_infos[t].cluster_indices && state->frame_infos[t].distances)
+        if (fi->cluster_indices && fi->distances)
         {
-            for (int i = 0; i < state->frame_infos[t].num_dists; i++)
+            for (int i = 0; i < fi->num_dists; i++)
             {
-                if (state->frame_infos[t].cluster_indices[i] == assigned_cl)
+                if (fi->cluster_indices[i] == assigned_cl)
                 {
-                    d = state->frame_infos[t].distances[i];
+                    d = fi->distances[i];
                     break;
                 }
             }
@@ -681,7 +990,8 @@ void print_clustering_metrics(
         printf("Clustering Metrics:\n");
     }
     printf("    Clusters:            %d (%d active)\n", K, active_clusters);
-    printf("    Assigned Frames:     %ld / %ld\n", assigned_count, total_frames);
+    printf("    Assigned Frames:     %ld / %ld\n", assigned_count,
+           total_frames - state->history_base);
     printf("    RMS Distance:        %.4f  (Avg cluster RMS: %.4f, Max: %.4f)\n",
            global_rms, avg_cluster_rms, global_max_dist);
     printf("    Cluster Sizes:       Min=%ld, Max=%ld, Mean=%.1f\n",
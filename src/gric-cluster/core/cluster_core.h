@@ -27,6 +27,54 @@ double get_dist(
     ClusterConfig *config,
     ClusterState  *state);
 
+/**
+ * @brief get_dist() variant that may stop early once the distance exceeds @limit.
+ *
+ * Sets *@exact to 0 when the returned value is only a lower bound (> @limit).
+ * A @limit <= 0 always computes the exact distance.
+ */
+double get_dist_bounded(
+    Frame         *a,
+    Frame         *b,
+    int            cluster_idx,
+    double         cluster_prob,
+    double         current_gprob,
+    double         limit,
+    int           *exact,
+    ClusterConfig *config,
+    ClusterState  *state);
+
+/**
+ * @brief Telemetry, distance log and verbose trace of one distance evaluation.
+ *
+ * What get_dist_bounded() records for distance @d; used for distances that
+ * were evaluated ahead of time (see spec_batch.h).
+ */
+void account_dist(
+    Frame         *a,
+    Frame         *b,
+    int            cluster_idx,
+    double         cluster_prob,
+    double         current_gprob,
+    double         d,
+    int            exact,
+    ClusterConfig *config,
+    ClusterState  *state);
+
+/**
+ * @brief Distances from frame @a to the anchors of @n clusters in one batch.
+ *
+ * Streams @a once per group of anchors (see framedist_batch()); telemetry,
+ * distance log and verbose output are the same as n get_dist() calls.
+ */
+void get_dist_batch(
+    Frame         *a,
+    const int     *clusters,
+    int            n,
+    ClusterConfig *config,
+    ClusterState  *state,
+    double        *out);
+
 void print_clustering_metrics(
     const ClusterState *state,
     int                 tile_id);
@@ -1,17 +1,24 @@
 /**
  * @file cluster_core_multitile.c
- * @brief Multi-tile clustering orchestrator using OpenMP tasks.
+ * @brief Multi-tile clustering orchestrator with one persistent worker per tile.
  *
- * Reads full-image frames, scatters pixels into per-tile
- * sub-frames, dispatches parallel Independent Spatial Clustering (Pass 1) tasks
- * via cluster_frame(), and records the assignment tuple for
- * each frame. Joint Trajectory Fusion (Pass 2) is deferred to Phase 6.
+ * The main thread reads full-image frames, hands each tile a slot of its
+ * queue (a view of the frame read through the tile's row spans, or a gathered
+ * copy for fragmented -tilemap tiles), and records the assignment
+ * tuple of each frame once every tile has clustered it. Each tile worker runs
+ * Independent Spatial Clustering (Pass 1) via cluster_frame() on the frames
+ * of its queue. With -tile_lag N a fast tile may run up to N frames ahead of
+ * the last recorded frame; Joint Trajectory Fusion (Pass 2) and joint
+ * prediction need the whole tuple of the previous frame and run in lockstep.
+ * With -ncpu 1, or -xtile in lockstep, the main thread clusters the tiles
+ * itself in a fixed order, which keeps the results independent of scheduling.
  */
 
 #define _POSIX_C_SOURCE 200809L
 #include "cluster_core_multitile.h"
 #include "tile_state.h"
 #include "frame_scatter.h"
+#include "frame_dtype.h"
 #include "cluster_step.h"
 #include "cluster_core.h"
 #include "cluster_io.h"
@@ -19,6 +26,7 @@
 #include "frameread.h"
 #include "tuple_retrieval.h"
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -58,79 +66,565 @@ static int compare_tuples(
 }
 
 
+/** Pipeline state shared by the main thread and the tile workers. */
+typedef struct
+{
+    ClusterConfig   *global_config;
+    MultiTileState  *mts;
+    long             num_frames;   /**< Frames the run may read */
+    int              lag;          /**< Frames a tile may run ahead of the last recorded one */
+    int              depth;        /**< Queue slots per tile (lag + 2) */
+    Frame           *sources[TILE_LAG_MAX + 2]; /**< Full-image frame of each slot */
+    int              ncpu;         /**< OpenMP threads for Pass 2 */
+    int              omp_threads;  /**< OpenMP threads per tile worker */
+    long             recorded;     /**< Frames whose tuple is recorded */
+    int              quit;         /**< Set once every posted frame is recorded */
+    int              idle_workers; /**< Workers blocked on @work_cond */
+    int              main_waiting; /**< Main thread blocked on @done_cond */
+    pthread_mutex_t  lock;         /**< Only guards the waits and the two flags above */
+    pthread_cond_t   work_cond;    /**< Head or recorded advanced, or shutdown */
+    pthread_cond_t   done_cond;    /**< A tile tail advanced */
+} TilePipeline;
+
+typedef struct
+{
+    TilePipeline *pl;
+    int           tile;
+} TileWorkerArg;
+
+/*
+ * Guards tuple_history, the occurrence index and the CPT while tiles run
+ * ahead of the recorder (-tile_lag > 0): the recorder writes them, the
+ * cross-tile prior hooks of the workers read them.
+ */
+static pthread_rwlock_t history_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static double pipe_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6;
+}
+
 /**
- * make_task_frame() - Create a heap-allocated Frame for one tile task.
- * @tile_frame: Pre-allocated tile sub-frame (scatter buffer).
+ * pipeline_wake_workers() - Wake the tile workers after head or recorded advanced.
+ * @pl: Pipeline state.
  *
- * Allocates a new Frame struct on the heap, copies metadata from
- * @tile_frame, malloc's a fresh data buffer, and memcpy's the
- * tile pixel data into it. The resulting Frame is safe to pass
- * to cluster_frame(), which will call free_frame() on it.
+ * Called after the atomic store; taking the lock orders the store before the
+ * wakeup of a worker that has just checked its gate.
+ */
+static void pipeline_wake_workers(
+    TilePipeline *pl)
+{
+    pthread_mutex_lock(&pl->lock);
+    if (pl->idle_workers > 0)
+    {
+        pthread_cond_broadcast(&pl->work_cond);
+    }
+    pthread_mutex_unlock(&pl->lock);
+}
+
+/**
+ * pipeline_wake_main() - Wake the main thread after a tile tail advanced.
+ * @pl: Pipeline state.
+ */
+static void pipeline_wake_main(
+    TilePipeline *pl)
+{
+    pthread_mutex_lock(&pl->lock);
+    if (pl->main_waiting)
+    {
+        pthread_cond_signal(&pl->done_cond);
+    }
+    pthread_mutex_unlock(&pl->lock);
+}
+
+/**
+ * pipeline_frame_done() - Check whether every tile has clustered frame @t.
+ * @pl: Pipeline state.
+ * @t:  Frame index.
+ *
+ * Return: 1 if all tile tails are past @t, 0 otherwise.
+ */
+static int pipeline_frame_done(
+    TilePipeline *pl,
+    long          t)
+{
+    for (int m = 0; m < pl->mts->num_tiles; m++)
+    {
+        if (__atomic_load_n(&pl->mts->tile_states[m].queue.tail, __ATOMIC_ACQUIRE) <= t)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void inject_cross_tile_priors_locked(
+    void *state,
+    void *ctx)
+{
+    pthread_rwlock_rdlock(&history_lock);
+    inject_cross_tile_priors(state, ctx);
+    pthread_rwlock_unlock(&history_lock);
+}
+
+static void inject_cross_tile_priors_st_locked(
+    void *state,
+    void *ctx)
+{
+    pthread_rwlock_rdlock(&history_lock);
+    inject_cross_tile_priors_st(state, ctx);
+    pthread_rwlock_unlock(&history_lock);
+}
+
+/**
+ * tile_build_posterior() - Copy or construct the Pass 1 posterior of a tile.
+ * @ts: Tile state after cluster_frame().
  *
- * Return: Pointer to newly allocated Frame, or NULL on failure.
+ * Used by Pass 2 fusion. With entropy mode the measured posterior is copied;
+ * otherwise a soft posterior is built around the Pass 1 assignment.
  */
-static Frame *make_task_frame(const Frame *tile_frame)
+static void tile_build_posterior(
+    TileState *ts)
 {
-    Frame *tf = malloc(sizeof(*tf));
-    if (tf == NULL)
+    if (ts->pass1_posterior == NULL)
     {
-        return NULL;
+        return;
     }
 
-    tf->id    = tile_frame->id;
-    tf->cnt0  = tile_frame->cnt0;
-    tf->atime = tile_frame->atime;
-    tf->width  = tile_frame->width;
-    tf->height = tile_frame->height;
+    int ncl = ts->state.num_clusters;
+    if (ncl > ts->config.algo.maxnbclust)
+    {
+        ncl = ts->config.algo.maxnbclust;
+    }
 
-    /*
-     * Allocate at the full-image buffer size so that
-     * free_frame()'s pool returns correctly-sized
-     * buffers to getframe().
-     */
-    long full_w = get_frame_width();
-    long full_h = get_frame_height();
-    size_t pool_bytes =
-        (size_t)(full_w * full_h) * sizeof(double);
-    size_t tile_bytes =
-        (size_t)(tile_frame->width
-                 * tile_frame->height)
-        * sizeof(double);
+    if (ts->config.optim.entropy_mode && ts->state.scratch.entropy_p_current)
+    {
+        memcpy(
+            ts->pass1_posterior,
+            ts->state.scratch.entropy_p_current,
+            (size_t) ncl * sizeof(double));
+        return;
+    }
+
+    int res = ts->pass1_assignment;
+    if (res < 0 || res >= ncl)
+    {
+        /* Flat distribution if no valid assignment */
+        for (int k = 0; k < ncl; k++)
+        {
+            ts->pass1_posterior[k] = 1.0 / ncl;
+        }
+    }
+    else if (ncl == 1)
+    {
+        ts->pass1_posterior[0] = 1.0;
+    }
+    else
+    {
+        double epsilon = 0.1; /* 10% weight open for spatial/temporal corrections */
+        double sum_others = 0.0;
+        for (int k = 0; k < ncl; k++)
+        {
+            if (k != res)
+            {
+                double prior = ts->state.scratch.mixed_probs ? ts->state.scratch.mixed_probs[k] : 1.0;
+                ts->pass1_posterior[k] = prior;
+                sum_others += prior;
+            }
+        }
+
+        for (int k = 0; k < ncl; k++)
+        {
+            if (k == res)
+            {
+                ts->pass1_posterior[k] = 1.0 - epsilon;
+            }
+            else if (sum_others > 0.0)
+            {
+                ts->pass1_posterior[k] = epsilon * (ts->pass1_posterior[k] / sum_others);
+            }
+            else
+            {
+                ts->pass1_posterior[k] = epsilon / (ncl - 1);
+            }
+        }
+    }
+}
+
+/**
+ * tile_set_hooks() - Install the cross-tile prior hook of a tile.
+ * @pl: Pipeline state.
+ * @ts: Tile state.
+ *
+ * Workers that run ahead of the recorder read the shared history under
+ * history_lock. Serial tiles read it unlocked; -xtile never runs on
+ * lockstep workers (see run_clustering_multitile()).
+ */
+static void tile_set_hooks(
+    TilePipeline *pl,
+    TileState    *ts)
+{
+    int xtile_mode = pl->global_config->optim.xtile_mode;
+
+    if (xtile_mode == 1)
+    {
+        ts->state.cross_tile_hook = (pl->lag > 0) ? inject_cross_tile_priors_locked
+                                                  : inject_cross_tile_priors;
+        ts->state.cross_tile_ctx = ts;
+    }
+    else if (xtile_mode == 2)
+    {
+        ts->state.cross_tile_hook = (pl->lag > 0) ? inject_cross_tile_priors_st_locked
+                                                  : inject_cross_tile_priors_st;
+        ts->state.cross_tile_ctx = ts;
+    }
+    else
+    {
+        ts->state.cross_tile_hook = NULL;
+        ts->state.cross_tile_ctx = NULL;
+    }
+}
+
+/**
+ * tile_cluster_frame() - Pass 1 of frame @t on one tile.
+ * @pl:   Pipeline state.
+ * @tile: Tile index.
+ * @t:    Frame index; its queue slot is published.
+ *
+ * Clusters the slot, posts the assignment on the cross-tile board and
+ * builds the Pass 2 posterior. The caller advances the queue tail.
+ */
+static void tile_cluster_frame(
+    TilePipeline *pl,
+    int           tile,
+    long          t)
+{
+    MultiTileState *mts  = pl->mts;
+    TileState      *ts   = &mts->tile_states[tile];
+    TileSlot       *slot = &ts->queue.slots[t % ts->queue.depth];
+
+    ts->cur_frame = t;
+    ts->pass1_old_ncl = ts->state.num_clusters;
+    for (int i = 0; i < ts->config.algo.maxnbclust; i++)
+    {
+        ts->temp_indices[i] = -1;
+    }
+    for (int i = 0; i < mts->num_tiles; i++)
+    {
+        ts->last_injected_assignment[i] = -1;
+    }
+
+    int res = cluster_frame(
+        &ts->config,
+        &ts->state,
+        &slot->frame,
+        &ts->prev_assigned_cluster,
+        ts->ascii_out,
+        ts->temp_indices,
+        ts->temp_dists,
+        ts->sorting_candidates,
+        ts->verbose_candidates);
+
+    ts->pass1_assignment = (res >= 0) ? res : -1;
+    slot->assignment = ts->pass1_assignment;
+    xtile_board_post(&ts->xtile_board[tile], t, res);
+    tile_build_posterior(ts);
+}
+
+/**
+ * tile_worker_main() - Persistent Pass 1 worker of one tile.
+ * @arg: TileWorkerArg.
+ *
+ * Clusters frame t of the tile queue once it is published and the recorder
+ * has reached t - lag, then advances the queue tail. Exits when the
+ * pipeline is shut down.
+ *
+ * Return: NULL.
+ */
+static void *tile_worker_main(
+    void *arg)
+{
+    TileWorkerArg  *wa  = (TileWorkerArg *) arg;
+    TilePipeline   *pl  = wa->pl;
+    TileState      *ts  = &pl->mts->tile_states[wa->tile];
+    TileQueue      *q   = &ts->queue;
+
+#ifdef _OPENMP
+    omp_set_num_threads(pl->omp_threads);
+#endif
+    tile_set_hooks(pl, ts);
+
+    for (long t = 0;; t++)
+    {
+        double t0 = pipe_now_ms();
+        long head;
+        long recorded;
+        pthread_mutex_lock(&pl->lock);
+        for (;;)
+        {
+            head     = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+            recorded = __atomic_load_n(&pl->recorded, __ATOMIC_ACQUIRE);
+            if ((head > t && recorded >= t - pl->lag) || pl->quit)
+            {
+                break;
+            }
+            pl->idle_workers++;
+            pthread_cond_wait(&pl->work_cond, &pl->lock);
+            pl->idle_workers--;
+        }
+        pthread_mutex_unlock(&pl->lock);
+        if (head <= t)
+        {
+            break;
+        }
+        double t1 = pipe_now_ms();
+
+        tile_cluster_frame(pl, wa->tile, t);
+
+        double t2 = pipe_now_ms();
+        ts->pipe.frames++;
+        ts->pipe.wait_ms += t1 - t0;
+        ts->pipe.busy_ms += t2 - t1;
+        ts->pipe.lead_sum += t - recorded;
+        if (t - recorded > ts->pipe.lead_max)
+        {
+            ts->pipe.lead_max = t - recorded;
+        }
+        ts->pipe.queued_sum += head - t - 1;
+
+        __atomic_store_n(&q->tail, t + 1, __ATOMIC_RELEASE);
+        pipeline_wake_main(pl);
+    }
+    return NULL;
+}
+
+/**
+ * run_tiles_serial() - Pass 1 of frame @t on every tile, last tile first, on the caller.
+ * @pl: Pipeline state.
+ * @t:  Frame index; its queue slots are published.
+ *
+ * Used instead of the workers when the run must not depend on thread
+ * scheduling: tile m sees the same-frame posts of tiles m+1..M-1 only. This
+ * is the order in which a one-thread OpenMP team ran the former per-tile
+ * tasks, so -ncpu 1 results are unchanged.
+ */
+static void run_tiles_serial(
+    TilePipeline *pl,
+    long          t)
+{
+    for (int m = pl->mts->num_tiles - 1; m >= 0; m--)
+    {
+        TileState *ts = &pl->mts->tile_states[m];
+        double     t1 = pipe_now_ms();
+
+        tile_cluster_frame(pl, m, t);
+
+        ts->pipe.frames++;
+        ts->pipe.busy_ms += pipe_now_ms() - t1;
+        __atomic_store_n(&ts->queue.tail, t + 1, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * record_frame() - Record the assignment tuple of frame @r.
+ * @pl:             Pipeline state.
+ * @r:              Frame index; every tile has clustered it.
+ * @membership_out: Membership file, or NULL.
+ *
+ * In lockstep mode Pass 2 fusion runs here, one OpenMP task per tile,
+ * before the tuple is stored. Joint prediction for frame @r + 1 also runs
+ * here, before the workers are allowed to start it.
+ */
+static void record_frame(
+    TilePipeline *pl,
+    long          r,
+    FILE         *membership_out)
+{
+    ClusterConfig  *global_config = pl->global_config;
+    MultiTileState *mts = pl->mts;
+    int num_tiles = mts->num_tiles;
+    int slot_idx = (int)(r % pl->depth);
+
+    /* ---- Joint Trajectory Fusion (Pass 2) ---- */
+    if (mts->tuple_count > 0 && num_tiles > 1 && !global_config->optim.disable_pass2)
+    {
+#ifdef _OPENMP
+#pragma omp parallel num_threads(pl->ncpu)
+#pragma omp single
+#endif
+        {
+            for (int m = 0; m < num_tiles; m++)
+            {
+#ifdef _OPENMP
+#pragma omp task firstprivate(m)
+#endif
+                pass2_fuse(mts, m, &mts->tile_states[m].queue.slots[slot_idx].frame);
+            }
+#ifdef _OPENMP
+#pragma omp taskwait
+#endif
+        }
+        for (int m = 0; m < num_tiles; m++)
+        {
+            TileState *ts = &mts->tile_states[m];
+            ts->queue.slots[slot_idx].assignment = ts->pass1_assignment;
+        }
+    }
+
+    /* ---- Record assignment tuple ---- */
+    if (pl->lag > 0)
+    {
+        pthread_rwlock_wrlock(&history_lock);
+    }
+    {
+        long base = mts->tuple_count * (long) num_tiles;
+        long t = mts->tuple_count;
+        int maxcl = mts->tile_states[0].config.algo.maxnbclust;
+
+        for (int m = 0; m < num_tiles; m++)
+        {
+            int ass = mts->tile_states[m].queue.slots[slot_idx].assignment;
+            mts->tuple_history[base + m] = ass;
+            if (ass >= 0 && ass < maxcl)
+            {
+                mts->occurrence_prev[t * (long)num_tiles + m] =
+                    mts->occurrence_head[m * maxcl + ass];
+                mts->occurrence_head[m * maxcl + ass] = (int)t;
+            }
+        }
+        if (global_config->optim.xtile_mode)
+        {
+            cpt_update_incremental(
+                mts->cpt,
+                &mts->cpt_scale,
+                mts->tuple_history,
+                mts->tuple_count,
+                num_tiles,
+                maxcl,
+                global_config->optim.xtile_decay);
+        }
+        mts->tuple_count++;
+    }
+    if (pl->lag > 0)
+    {
+        pthread_rwlock_unlock(&history_lock);
+    }
+
+    /* ---- Write membership line ---- */
+    if (membership_out)
+    {
+        fprintf(membership_out, "%ld", r);
+        for (int m = 0; m < num_tiles; m++)
+        {
+            fprintf(membership_out, "  %d",
+                    mts->tile_states[m].queue.slots[slot_idx].assignment);
+        }
+        fprintf(membership_out, "\n");
+    }
 
-    if (pool_bytes < tile_bytes)
+    /* ---- Predict joint transitions for the next frame's priors & candidates ---- */
+    if (global_config->optim.pred_mode && r + 1 < pl->num_frames)
     {
-        pool_bytes = tile_bytes;
+        predict_joint_tuples(
+            mts,
+            global_config->optim.pred_len,
+            global_config->optim.pred_h,
+            global_config->optim.pred_n);
     }
 
-    tf->data = calloc(1, pool_bytes);
-    if (tf->data == NULL)
+    __atomic_store_n(&pl->recorded, r + 1, __ATOMIC_RELEASE);
+    pipeline_wake_workers(pl);
+}
+
+/**
+ * record_until() - Record frames in order until @target frames are recorded.
+ * @pl:             Pipeline state.
+ * @target:         Number of recorded frames to reach.
+ * @membership_out: Membership file, or NULL.
+ * @block:          Wait for the tiles if 1; otherwise record only finished frames.
+ *
+ * Return: Number of frames recorded by this call.
+ */
+static long record_until(
+    TilePipeline *pl,
+    long          target,
+    FILE         *membership_out,
+    int           block)
+{
+    long n = 0;
+    while (pl->recorded < target)
     {
-        free(tf);
-        return NULL;
+        long r = pl->recorded;
+        if (!pipeline_frame_done(pl, r))
+        {
+            if (!block)
+            {
+                break;
+            }
+            pthread_mutex_lock(&pl->lock);
+            pl->main_waiting = 1;
+            while (!pipeline_frame_done(pl, r))
+            {
+                pthread_cond_wait(&pl->done_cond, &pl->lock);
+            }
+            pl->main_waiting = 0;
+            pthread_mutex_unlock(&pl->lock);
+        }
+        record_frame(pl, r, membership_out);
+        n++;
     }
+    return n;
+}
 
-    memcpy(tf->data, tile_frame->data, tile_bytes);
-    return tf;
+static void print_progress(
+    long                   frames_done,
+    long                   actual_frames,
+    const struct timespec *wall_start)
+{
+    if (frames_done % 100 == 0
+        || frames_done == actual_frames)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double elapsed_s =
+            (now.tv_sec - wall_start->tv_sec)
+            + (now.tv_nsec - wall_start->tv_nsec)
+              / 1.0e9;
+        double fps =
+            (elapsed_s > 0.0)
+            ? (double) frames_done / elapsed_s
+            : 0.0;
+        printf("\rMulti-tile: frame %ld / %ld  "
+               "(%.1f fps)",
+               frames_done, actual_frames, fps);
+        fflush(stdout);
+    }
 }
 
 
 /**
  * run_clustering_multitile() - Multi-tile parallel clustering.
- * @global_config: Global clustering configuration (ncpu, etc.).
+ * @global_config: Global clustering configuration (ncpu, tile_lag, etc.).
  * @mts:           Initialised MultiTileState with per-tile states.
  *
- * Outer loop reads full-image frames sequentially, scatters
- * each into per-tile sub-frames, then dispatches M independent
- * OpenMP tasks for Independent Spatial Clustering (Pass 1).  Each task calls
- * cluster_frame() on a freshly copied Frame so the internal
- * free_frame() does not touch the reusable scatter buffers.
+ * Starts one worker thread per tile, each with a queue of tile_lag + 2
+ * preallocated frame slots. The main thread reads full-image frames and
+ * points each tile's next free slot at the frame (tiles read in place
+ * through their spans keep the frame alive until its tuple is recorded;
+ * other tiles are gathered into the slot buffer). It records the assignment
+ * tuples in frame order into mts->tuple_history, running Pass 2 fusion first
+ * when enabled.
  *
- * After all tasks complete (taskwait barrier), the per-tile
- * assignments are recorded in mts->tuple_history.
+ * Tiles may cluster up to tile_lag frames beyond the last recorded frame.
+ * Pass 2 and -pred need the complete tuple of the previous frame, so they
+ * force tile_lag to 0 (lockstep: frame t + 1 starts once frame t is recorded).
  *
- * After all frames are processed, Joint Trajectory Fusion (Pass 2)
- * is executed to resolve tile boundary noise using global
- * historical sequence transitions.
+ * With -ncpu 1, or -xtile in lockstep, no workers are started: the main
+ * thread clusters each frame tile by tile (see run_tiles_serial()), so the
+ * same-frame priors a tile receives (and the results) do not depend on
+ * thread scheduling.
  */
 void run_clustering_multitile(
     ClusterConfig  *global_config,
@@ -150,32 +644,54 @@ void run_clustering_multitile(
         actual_frames = global_config->input.maxnbfr;
     }
 
+    int lag = global_config->optim.tile_lag;
+    if (lag > 0
+        && (global_config->optim.pred_mode
+            || (!global_config->optim.disable_pass2 && num_tiles > 1)))
+    {
+        printf("NOTE: -tile_lag ignored: Pass 2 fusion and -pred run tiles in lockstep\n");
+        lag = 0;
+    }
+    int serial = (ncpu == 1 || (global_config->optim.xtile_mode && lag == 0));
+    if (serial && lag > 0)
+    {
+        printf("NOTE: -tile_lag ignored: with -ncpu 1 tiles run serially\n");
+        lag = 0;
+    }
+
     printf("Multi-tile clustering: %d tiles, %ld frames, "
-           "%d threads\n",
-           num_tiles, actual_frames, ncpu);
+           "%d threads, lag %d%s\n",
+           num_tiles, actual_frames, ncpu, lag, serial ? ", serial tiles" : "");
 
-#ifdef _OPENMP
-    /*
-     * Allow nested parallelism when tiles < cpus so that
-     * each tile task can still use intra-tile OpenMP
-     * parallelism (e.g. in framedist).
-     */
-    if (num_tiles < ncpu)
+    TilePipeline pl;
+    memset(&pl, 0, sizeof(pl));
+    pl.global_config = global_config;
+    pl.mts           = mts;
+    pl.num_frames    = actual_frames;
+    pl.lag           = lag;
+    pl.depth         = lag + 2;
+    pl.ncpu          = ncpu;
+    pl.omp_threads   = serial ? ncpu : (ncpu > num_tiles) ? ncpu / num_tiles : 1;
+    pthread_mutex_init(&pl.lock, NULL);
+    pthread_cond_init(&pl.work_cond, NULL);
+    pthread_cond_init(&pl.done_cond, NULL);
+
+    for (int m = 0; m < num_tiles; m++)
     {
-        omp_set_max_active_levels(2);
+        if (tile_queue_init(&mts->tile_states[m], get_frame_dtype(), pl.depth) != 0)
+        {
+            fprintf(stderr, "ERROR: [%s:%d] tile %d queue alloc failed\n",
+                    __FILE__, __LINE__, m);
+            return;
+        }
     }
-#endif
+    xtile_board_reset(mts->xtile_board, num_tiles);
 
-    /* Allocate per-tile scatter buffers */
-    Frame *scatter_buf =
-        calloc((size_t) num_tiles, sizeof(Frame));
-    if (scatter_buf == NULL)
+    int any_view = 0;
+    for (int m = 0; m < num_tiles; m++)
     {
-        fprintf(stderr,
-            "ERROR: scatter buffer alloc failed\n");
-        return;
+        any_view |= tiledef_use_view(&mts->tile_map->tiles[m]);
     }
-    frame_scatter_alloc(mts->tile_map, scatter_buf);
 
     /* ---- Open membership file ---- */
     FILE *membership_out = NULL;
@@ -223,14 +739,52 @@ void run_clustering_multitile(
     struct timespec wall_start;
     clock_gettime(CLOCK_MONOTONIC, &wall_start);
 
-    long frames_done = 0;
-
+    /* ---- Start tile workers ---- */
+    pthread_t     *workers = calloc((size_t) num_tiles, sizeof(pthread_t));
+    TileWorkerArg *wargs   = calloc((size_t) num_tiles, sizeof(TileWorkerArg));
+    int started = 0;
+    if (serial)
+    {
 #ifdef _OPENMP
-#pragma omp parallel num_threads(ncpu)
-{
-#pragma omp single
-{
+        omp_set_num_threads(pl.omp_threads);
 #endif
+        for (int m = 0; m < num_tiles; m++)
+        {
+            tile_set_hooks(&pl, &mts->tile_states[m]);
+        }
+    }
+    else if (workers != NULL && wargs != NULL)
+    {
+        for (; started < num_tiles; started++)
+        {
+            wargs[started].pl   = &pl;
+            wargs[started].tile = started;
+            if (pthread_create(&workers[started], NULL, tile_worker_main,
+                               &wargs[started]) != 0)
+            {
+                break;
+            }
+        }
+    }
+    if (!serial && started < num_tiles)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] cannot start tile workers\n",
+                __FILE__, __LINE__);
+        actual_frames = 0;
+    }
+
+    /* Frame 0 predictions (later ones are made as each frame is recorded) */
+    if (global_config->optim.pred_mode && actual_frames > 0)
+    {
+        predict_joint_tuples(
+            mts,
+            global_config->optim.pred_len,
+            global_config->optim.pred_h,
+            global_config->optim.pred_n);
+    }
+
+    long frames_done = 0;
+    long posted = 0;
     for (long fi = 0; fi < actual_frames; fi++)
     {
         if (stop_requested)
@@ -238,273 +792,100 @@ void run_clustering_multitile(
             break;
         }
 
-        /* ---- Read full-image frame ---- */
+        /* ---- Read full-image frame (overlaps with the tile workers) ---- */
         Frame *src = getframe();
         if (src == NULL)
         {
             break;
         }
 
-        /* ---- Scatter into per-tile buffers ---- */
-        frame_scatter(src, mts->tile_map, scatter_buf);
-
-        /* ---- Initialize cross-tile board for this frame ---- */
-        for (int m = 0; m < num_tiles; m++)
+        /* ---- Wait until the slot of frame fi - depth is recorded ---- */
+        long n = record_until(&pl, fi - pl.depth + 1, membership_out, 1);
+        for (long ii = 0; ii < n; ii++)
         {
-            mts->xtile_board[m] = -1;
+            print_progress(++frames_done, actual_frames, &wall_start);
         }
 
-        /* ---- Predict joint transitions for Pass 1 priors & candidates ---- */
-        if (global_config->optim.pred_mode)
+        /*
+         * ---- Hand the frame to the tiles and publish ----
+         * View slots read the tiles in place, so the frame stays alive until
+         * its tuple is recorded; the slot's previous frame is released here.
+         */
+        int slot = (int)(fi % pl.depth);
+        if (any_view && src->borrowed)
         {
-            predict_joint_tuples(
-                mts,
-                global_config->optim.pred_len,
-                global_config->optim.pred_h,
-                global_config->optim.pred_n);
+            /* Do not hold stream slices across frames */
+            Frame *own = malloc(sizeof(*own));
+            if (own == NULL || frame_take(own, src) != 0)
+            {
+                fprintf(stderr, "ERROR: [%s:%d] cannot copy stream frame %ld\n",
+                        __FILE__, __LINE__, fi);
+                free_frame(src);
+                free(own);
+                break;
+            }
+            free_frame(src);
+            src = own;
         }
-
-        /* ---- Dispatch M Pass 1 tasks ---- */
         for (int m = 0; m < num_tiles; m++)
         {
-            TileState *ts = &mts->tile_states[m];
-            Frame *task_frame =
-                make_task_frame(&scatter_buf[m]);
-            if (task_frame == NULL)
-            {
-                fprintf(stderr,
-                    "ERROR: make_task_frame tile %d\n",
-                    m);
-                continue;
-            }
-
-#ifdef _OPENMP
-#pragma omp task firstprivate(m, ts, task_frame)
-{
-#endif
-            ts->pass1_old_ncl = ts->state.num_clusters;
-            for (int i = 0; i < ts->config.algo.maxnbclust; i++)
-            {
-                ts->temp_indices[i] = -1;
-            }
-            for (int i = 0; i < num_tiles; i++)
-            {
-                ts->last_injected_assignment[i] = -1;
-            }
-            if (global_config->optim.xtile_mode == 1)
-            {
-                ts->state.cross_tile_hook = inject_cross_tile_priors;
-                ts->state.cross_tile_ctx = ts;
-            }
-            else if (global_config->optim.xtile_mode == 2)
-            {
-                ts->state.cross_tile_hook = inject_cross_tile_priors_st;
-                ts->state.cross_tile_ctx = ts;
-            }
-            else
-            {
-                ts->state.cross_tile_hook = NULL;
-                ts->state.cross_tile_ctx = NULL;
-            }
-            int res = cluster_frame(
-                &ts->config,
-                &ts->state,
-                task_frame,
-                &ts->prev_assigned_cluster,
-                ts->ascii_out,
-                ts->temp_indices,
-                ts->temp_dists,
-                ts->sorting_candidates,
-                ts->verbose_candidates);
-
-            if (res >= 0)
-            {
-                ts->pass1_assignment = res;
-            }
-            else
-            {
-                ts->pass1_assignment = -1;
-            }
-            __atomic_store_n(&ts->xtile_board[m], res, __ATOMIC_RELEASE);
-
-            /* Copy or construct posterior for Pass 2 fusion */
-            if (ts->pass1_posterior)
-            {
-                int ncl = ts->state.num_clusters;
-                if (ncl > ts->config.algo.maxnbclust)
-                {
-                    ncl = ts->config.algo.maxnbclust;
-                }
-
-                if (ts->config.optim.entropy_mode && ts->state.scratch.entropy_p_current)
-                {
-                    memcpy(
-                        ts->pass1_posterior,
-                        ts->state.scratch.entropy_p_current,
-                        (size_t) ncl * sizeof(double));
-                }
-                else
-                {
-                    /* Construct soft posterior around Pass 1 assignment */
-                    int res = ts->pass1_assignment;
-                    if (res < 0 || res >= ncl)
-                    {
-                        /* Flat distribution if no valid assignment */
-                        for (int k = 0; k < ncl; k++)
-                        {
-                            ts->pass1_posterior[k] = 1.0 / ncl;
-                        }
-                    }
-                    else if (ncl == 1)
-                    {
-                        ts->pass1_posterior[0] = 1.0;
-                    }
-                    else
-                    {
-                        double epsilon = 0.1; /* 10% weight open for spatial/temporal corrections */
-                        double sum_others = 0.0;
-                        for (int k = 0; k < ncl; k++)
-                        {
-                            if (k != res)
-                            {
-                                double prior = ts->state.scratch.mixed_probs ? ts->state.scratch.mixed_probs[k] : 1.0;
-                                ts->pass1_posterior[k] = prior;
-                                sum_others += prior;
-                            }
-                        }
-
-                        if (sum_others > 0.0)
-                        {
-                            for (int k = 0; k < ncl; k++)
-                            {
-                                if (k == res)
-                                {
-                                    ts->pass1_posterior[k] = 1.0 - epsilon;
-                                }
-                                else
-                                {
-                                    ts->pass1_posterior[k] = epsilon * (ts->pass1_posterior[k] / sum_others);
-                                }
-                            }
-                        }
-                        else
-                        {
-                            for (int k = 0; k < ncl; k++)
-                            {
-                                if (k == res)
-                                {
-                                    ts->pass1_posterior[k] = 1.0 - epsilon;
-                                }
-                                else
-                                {
-                                    ts->pass1_posterior[k] = epsilon / (ncl - 1);
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-#ifdef _OPENMP
-} // omp task
-#endif
-        } // for each tile m
-
-#ifdef _OPENMP
-#pragma omp taskwait
-#endif
-
-        /* ---- Joint Trajectory Fusion (Pass 2) ---- */
-        if (mts->tuple_count > 0 && num_tiles > 1 && !global_config->optim.disable_pass2)
+            TileQueue *q = &mts->tile_states[m].queue;
+            frame_scatter_tile(src, &mts->tile_map->tiles[m], &q->slots[slot].frame);
+        }
+        free_frame(pl.sources[slot]);
+        pl.sources[slot] = NULL;
+        if (any_view)
         {
-            for (int m = 0; m < num_tiles; m++)
-            {
-#ifdef _OPENMP
-#pragma omp task firstprivate(m)
-{
-#endif
-                pass2_fuse(mts, m, &scatter_buf[m]);
-#ifdef _OPENMP
-} // omp task
-#endif
-            } // for each tile m (Pass 2)
-
-#ifdef _OPENMP
-#pragma omp taskwait
-#endif
-        } // if tuple_count > 0
-
-        /* ---- Record assignment tuple ---- */
+            pl.sources[slot] = src;
+        }
+        else
         {
-            long base = mts->tuple_count * (long) num_tiles;
-            long t = mts->tuple_count;
-            int maxcl = mts->tile_states[0].config.algo.maxnbclust;
-
-            for (int m = 0; m < num_tiles; m++)
-            {
-                int ass = mts->tile_states[m].pass1_assignment;
-                mts->tuple_history[base + m] = ass;
-                if (ass >= 0 && ass < maxcl)
-                {
-                    mts->occurrence_prev[t * (long)num_tiles + m] =
-                        mts->occurrence_head[m * maxcl + ass];
-                    mts->occurrence_head[m * maxcl + ass] = (int)t;
-                }
-            }
-            if (global_config->optim.xtile_mode)
-            {
-                cpt_update_incremental(
-                    mts->cpt,
-                    &mts->cpt_scale,
-                    mts->tuple_history,
-                    mts->tuple_count,
-                    num_tiles,
-                    maxcl,
-                    global_config->optim.xtile_decay);
-            }
-            mts->tuple_count++;
+            free_frame(src);
         }
-
-        /* ---- Write membership line ---- */
-        if (membership_out)
+        for (int m = 0; m < num_tiles; m++)
         {
-            fprintf(membership_out, "%ld", fi);
-            for (int m = 0; m < num_tiles; m++)
-            {
-                fprintf(membership_out, "  %d",
-                    mts->tile_states[m]
-                        .pass1_assignment);
-            }
-            fprintf(membership_out, "\n");
+            __atomic_store_n(&mts->tile_states[m].queue.head, fi + 1, __ATOMIC_RELEASE);
+        }
+        posted = fi + 1;
+        if (serial)
+        {
+            run_tiles_serial(&pl, fi);
+        }
+        else
+        {
+            pipeline_wake_workers(&pl);
         }
 
-        /* ---- Free source frame ---- */
-        free_frame(src);
-        frames_done++;
-
-        /* ---- Progress ---- */
-        if (frames_done % 100 == 0
-            || frames_done == actual_frames)
-        {
-            struct timespec now;
-            clock_gettime(CLOCK_MONOTONIC, &now);
-            double elapsed_s =
-                (now.tv_sec - wall_start.tv_sec)
-                + (now.tv_nsec - wall_start.tv_nsec)
-                  / 1.0e9;
-            double fps =
-                (elapsed_s > 0.0)
-                ? (double) frames_done / elapsed_s
-                : 0.0;
-            printf("\rMulti-tile: frame %ld / %ld  "
-                   "(%.1f fps)",
-                   frames_done, actual_frames, fps);
-            fflush(stdout);
+        n = record_until(&pl, posted, membership_out, 0);
+        for (long ii = 0; ii < n; ii++)
+        {
+            print_progress(++frames_done, actual_frames, &wall_start);
         }
     } // for each frame fi
-#ifdef _OPENMP
-} // omp single
-} // omp parallel
-#endif
+
+    /* ---- Drain and stop the workers ---- */
+    long n = record_until(&pl, posted, membership_out, 1);
+    for (long ii = 0; ii < n; ii++)
+    {
+        print_progress(++frames_done, actual_frames, &wall_start);
+    }
+    pthread_mutex_lock(&pl.lock);
+    pl.quit = 1;
+    pthread_cond_broadcast(&pl.work_cond);
+    pthread_mutex_unlock(&pl.lock);
+    for (int m = 0; m < started; m++)
+    {
+        pthread_join(workers[m], NULL);
+    }
+    free(workers);
+    free(wargs);
+    for (int slot = 0; slot < pl.depth; slot++)
+    {
+        free_frame(pl.sources[slot]);
+    }
+    pthread_cond_destroy(&pl.work_cond);
+    pthread_cond_destroy(&pl.done_cond);
+    pthread_mutex_destroy(&pl.lock);
 
     printf("\n");
 
@@ -535,12 +916,19 @@ void run_clustering_multitile(
                 t->framedist_calls_intercluster;
             total_dfc += dfc;
             total_dcc += dcc;
+            TilePipeStats *ps = &mts->tile_states[m].pipe;
+            long nfr = (ps->frames > 0) ? ps->frames : 1;
             printf("  Tile %3d: %d clusters, "
-                   "dfc=%ld, dcc=%ld\n",
+                   "dfc=%ld, dcc=%ld, "
+                   "busy %.1f ms, wait %.1f ms, "
+                   "lead avg %.2f max %ld, queue avg %.2f\n",
                    m,
                    mts->tile_states[m]
                        .state.num_clusters,
-                   dfc, dcc);
+                   dfc, dcc,
+                   ps->busy_ms, ps->wait_ms,
+                   (double) ps->lead_sum / nfr, ps->lead_max,
+                   (double) ps->queued_sum / nfr);
             print_clustering_metrics(&mts->tile_states[m].state, m);
         }
         printf("Total framedist: %ld "
@@ -636,6 +1024,11 @@ void run_clustering_multitile(
                             }
                             double d = 0.0;
                             TileState *ts = &mts->tile_states[m];
+                            /* Distances are only kept with -gprob / -predf */
+                            if (ts->state.frame_infos[t].cluster_indices == NULL)
+                            {
+                                continue;
+                            }
                             for (int d_idx = 0;
                                  d_idx < ts->state.frame_infos[t].num_dists;
                                  d_idx++)
@@ -705,7 +1098,4 @@ void run_clustering_multitile(
     /* ---- Write per-tile results ---- */
     write_results_multitile(global_config, mts);
 
-    /* ---- Cleanup scatter buffers ---- */
-    frame_scatter_free(scatter_buf, num_tiles);
-    free(scatter_buf);
 }
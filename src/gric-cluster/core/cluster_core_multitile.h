@@ -5,19 +5,21 @@
  * @file cluster_core_multitile.h
  * @brief Multi-tile clustering entry point declaration.
  *
- * Orchestrates parallel per-tile clustering using OpenMP
- * tasks, with tuple recording for later Bayesian fusion.
+ * Orchestrates parallel per-tile clustering with one
+ * persistent worker thread per tile, with tuple recording
+ * for later Bayesian fusion.
  */
 
 #include "cluster_defs.h"
 #include "tile_state.h"
 
 /**
- * @brief Run multi-tile clustering with OpenMP task parallelism.
+ * @brief Run multi-tile clustering with one worker thread per tile.
  *
- * Reads full-image frames, scatters them into per-tile
- * sub-frames, dispatches parallel Independent Spatial Clustering (Pass 1) tasks,
- * and records the resulting assignment tuples.
+ * Reads full-image frames, gathers them into per-tile
+ * queue slots, runs Independent Spatial Clustering (Pass 1) on each tile's
+ * worker (up to -tile_lag frames apart), and records the resulting
+ * assignment tuples in frame order.
  */
 void run_clustering_multitile(
     ClusterConfig  *global_config,
@@ -8,6 +8,9 @@
  */
 
 #include "common.h"
+#include "dcc_store.h"
+#include "frame_log.h"
+#include "refine_queue.h"
 #include <signal.h>
 #include <stdio.h>
 
@@ -36,30 +39,38 @@ typedef struct
 typedef struct
 {
     long  maxnbfr;           /**< Max frames to process */
+    long  history_window;    /**< Frames of per-frame history kept (0 = all) */
     char *fits_filename;     /**< Path to input FITS or stream */
     int   scandist_mode;     /**< 1 = scandist-only */
     int   filelist_mode;     /**< 1 = input is file list */
     int   stream_input_mode; /**< 1 = shared-memory stream */
     int   cnt2sync_mode;     /**< 1 = cnt2 semaphore sync */
+    int   stream_zerocopy;   /**< 1 = frames reference stream slices */
+    int   write_gricbin;     /**< 1 = write the ASCII .gricbin sidecar */
     int   tile_grid_x;       /**< Tile grid columns (0=tilemap) */
     int   tile_grid_y;       /**< Tile grid rows (0=tilemap) */
     char *tile_map_file;     /**< Path to integer FITS tile map */
     char *tile_config_file;  /**< Per-tile ASCII config file */
     int   retrieval_window;  /**< Tuple retrieval lookback */
+    FrameDType frame_dtype;  /**< Pixel storage type of frames/anchors */
+    int   prefetch_depth;    /**< Frames decoded ahead by a reader thread (0=off) */
 } ConfigInput;
 
 /** Optimization and acceleration parameters. */
 typedef struct
 {
     int    ncpu;                    /**< Number of OpenMP threads */
+    int    spec_batch;              /**< Frames per speculative batch (0 = off) */
     int    gprob_mode;              /**< 1 to enable geometric probability */
     double fmatch_a;                /**< gprob exponential decay parameter a */
     double fmatch_b;                /**< gprob exponential decay parameter b */
     int    max_gprob_visitors;      /**< Max visitor entries per cluster */
+    long   framelog_keep;           /**< Frames whose measurements are kept (0 = all) */
     int    pred_mode;               /**< 0=off, 1=binary (-pred), 2=fuzzy (-predf) */
     int    pred_len;                /**< Pattern length for prediction matching */
     int    pred_h;                  /**< History horizon for pattern search */
     int    pred_n;                  /**< Max prediction candidates returned */
+    int    pred_batch;              /**< 1 to evaluate prediction candidates in one batch */
     int    te4_mode;                /**< 1 to enable 4-point triangle ineq. */
     int    te5_mode;                /**< 1 to enable 5-point triangle ineq. */
     int    entropy_mode;            /**< 1 to enable entropy-guided search */
@@ -72,11 +83,13 @@ typedef struct
     double entropy_leader_cutoff;   /**< Threshold for dominant leader bypass (e.g. 0.50) */
     int    sparse_dcc_mode;         /**< 1 to enable bounded sparse DCC, 0 for dense */
     int    sparse_dcc_extra_evals;  /**< Extra inter-cluster measurements per new cluster */
+    double abandon_factor;          /**< Early-abandon limit in units of rlim (0 = off) */
     int    soft_bayesian_mode;      /**< 1 to enable soft Bayesian updates */
     double soft_bayesian_sigma_coeff; /**< Coefficient multiplying rlim for sigma */
     int    disable_pass2;           /**< 1 to disable Pass 2 fusion (tuple prediction) */
     int    xtile_mode;              /**< 1 to enable live cross-tile prior injection */
     double xtile_decay;             /**< Decay coefficient for CPT history (0.0 to 1.0] */
+    int    tile_lag;                /**< Frames a tile may run ahead of the slowest (0 = lockstep) */
 } ConfigOptim;
 
 /** Cross-tile injection callback signature. */
@@ -102,6 +115,8 @@ typedef struct
     int   output_discarded;  /**< 1 to write discarded-frame list */
     int   output_clustered;  /**< 1 to write clustered-frame cube */
     int   output_clusters;   /**< 1 to write per-cluster frame lists */
+    int   output_gricres;    /**< 1 to write the binary results bundle */
+    int   knn_k;             /**< Online k-NN neighbors per frame (0 = off) */
     char *shm_filename;      /**< Shared-memory status image name */
 } ConfigOutput;
 
@@ -114,10 +129,18 @@ typedef struct
     ConfigOutput    output;
 } ClusterConfig;
 
+/** One measurement of a frame against a cluster, kept for -gprob. */
+typedef struct
+{
+    int    frame;    /**< Frame index */
+    int    cluster;  /**< Cluster the frame was assigned to, -1 until recorded */
+    double distance; /**< Exact frame-to-anchor distance, -1 if none was measured */
+} VisitorEntry;
+
 // VisitorList structure
 typedef struct
 {
-    int *frames;
+    VisitorEntry *entries;
     int count;
     int capacity;
 } VisitorList;
@@ -128,6 +151,7 @@ typedef struct
     long    framedist_calls;
     long    framedist_calls_sample;
     long    framedist_calls_intercluster;
+    long    framedist_abandoned;   /**< Evaluations stopped early (-abandon) */
     long    clusters_pruned;
     long    total_frames_processed;
     long    total_missed_frames;
@@ -162,6 +186,9 @@ typedef struct
     uint64_t pred_attempts;     /**< Frames where pred returned >= 1 candidate */
     uint64_t pred_hits;         /**< Frames where 1st pred candidate was assigned */
     uint64_t pred_same_as_last; /**< Frames where 1st pred == previous cluster */
+    long     spec_evaluated;    /**< Distances evaluated ahead (-specbatch) */
+    long     spec_used;         /**< Of those, used by the sequential step */
+    double   time_spec_ms;      /**< Time spent evaluating ahead (ms) */
 } ClusterTelemetry;
 
 // Candidate structure for sorting
@@ -178,17 +205,56 @@ typedef struct
     double score; /**< Computed score (information gain or prune value) */
 } TargetScore;
 
+/**
+ * Cached consistency masks of one target cluster i.
+ *
+ * Bit k of mask (i, j) is set when measuring i could still separate
+ * hypothesis j from candidate k, given the bounds of row i. Bounds of row i
+ * are snapshotted in d_min/d_max; masks are built per hypothesis j on first
+ * use and extended when clusters are added.
+ */
+typedef struct
+{
+    int       target;     /**< Target cluster i, -1 if the row is free */
+    long      last_pass;  /**< Pass of the last acquisition (LRU order) */
+    int       nk;         /**< Clusters covered by the bound snapshot */
+    double   *d_min;      /**< Snapshot of dcc_min(i, k) */
+    double   *d_max;      /**< Snapshot of dcc_max(i, k) */
+    int      *slot_of;    /**< Per hypothesis j: mask slot, -1 if not built */
+    int      *slot_cover; /**< Per slot: clusters covered by the mask */
+    int      *slot_j;     /**< Per slot: hypothesis j owning the slot */
+    uint64_t *bits;       /**< Mask slots, `words` words each */
+    int       nslots;     /**< Slots in use */
+    int       cap;        /**< Slots allocated */
+} ConsistencyRow;
+
+/** LRU cache of consistency-mask rows, filled on demand by the entropy search. */
+typedef struct
+{
+    ConsistencyRow *rows;   /**< Cached rows */
+    int             nrows;  /**< Rows allocated (grows if one pass needs more) */
+    int             max_rows; /**< Rows kept between passes (memory budget) */
+    int             n;      /**< Cluster capacity (maxnbclust) */
+    int             words;  /**< 64-bit words per mask */
+    int            *row_of; /**< Per cluster: cached row, -1 if none */
+    long            pass;   /**< Current acquisition pass */
+} ConsistencyCache;
+
 // Scratch/Calculation structure
 typedef struct
 {
     double *current_gprobs;     /**< Geometric probabilities computed during search */
-    double *dcc_min;            /**< Pairwise inter-cluster minimum distance bounds */
-    double *dcc_max;            /**< Pairwise inter-cluster maximum distance bounds */
-    char   *dcc_measured;       /**< 1 if exactly measured, 0 if unmeasured */
+    DccStore dcc;               /**< Pairwise inter-cluster distance bounds (min, max,
+                                     measured flag), dense or sparse (-sparse_dcc) */
+    char   *dist_lower_bound;   /**< Per temp_dists slot: 1 if the entry is an
+                                     early-abandon lower bound, 0 if exact */
+    double *dfc_cache;          /**< Per cluster: distance prefetched for this frame */
+    long   *dfc_cache_stamp;    /**< Per cluster: frame index + 1 of dfc_cache entry */
+    long    visitor_shift_stamp; /**< Frame index + 1 of the last remove_cluster() */
     int    *probsortedclindex;  /**< Cluster indices sorted by descending prior probability */
     int    *clmembflag;         /**< Flag indicating if a cluster is an active candidate */
     double *mixed_probs;        /**< Prior predictive probabilities (frequency * sequence) */
-    uint64_t *consistency_mask; /**< Precomputed 3D geometric consistency bitmask */
+    ConsistencyCache consistency; /**< On-demand geometric consistency masks */
     double *entropy_p_current;  /**< Pre-allocated buffer for entropy search probabilities */
     Candidate *entropy_candidates; /**< Pre-allocated buffer for sorting candidates */
     TargetScore *entropy_prob_scores;  /**< Pre-allocated buffer for target scores */
@@ -196,25 +262,94 @@ typedef struct
     int         *entropy_active_indices; /**< Pre-allocated active indices array */
     double      *entropy_plog2p;       /**< Pre-allocated plog2p probabilities array */
     uint8_t     *entropy_visited;      /**< Pre-allocated visited boolean array */
-    Candidate   *refine_queue;         /**< Pre-allocated queue of closest unmeasured pairs */
-    int          refine_queue_size;    /**< Number of active items in the queue */
-    int          refine_queue_idx;     /**< Current index in the queue */
-    int          refine_queue_capacity;/**< Capacity of the queue */
-    int          refine_queue_last_num_clusters; /**< Number of clusters at last queue rebuild */
+    RefineQueue  refine;               /**< Closest unmeasured pairs, kept across steps */
     int         *tuple_pred_candidates;/**< Pre-populated candidates from joint prediction */
     int          tuple_pred_count;     /**< Number of candidates pre-populated */
 } ClusterScratch;
 
+/** One cluster removal not yet applied to the whole assignment history. */
+typedef struct
+{
+    int removed; /**< Removed cluster index */
+    int target;  /**< Merge target after renumbering, -1 if discarded */
+    int count;   /**< Number of clusters before the removal */
+} RemapOp;
+
+/** Frames [start, end) whose assignments still predate removal op `gen`. */
+typedef struct
+{
+    long start; /**< First frame */
+    long end;   /**< One past the last frame */
+    int  gen;   /**< First removal op not yet applied to these frames */
+} RemapSpan;
+
+/**
+ * Pending renumbering of the assignment history.
+ *
+ * remove_cluster() appends an op instead of rewriting every past frame;
+ * resolve_assignments() applies the pending ops to the frames a reader needs.
+ */
+typedef struct
+{
+    RemapOp   *ops;       /**< Removal log */
+    int        nops;      /**< Ops in the log */
+    int        ops_cap;   /**< Ops allocated */
+    RemapSpan *spans;     /**< Stale frame ranges, oldest first */
+    int        nspans;    /**< Spans in use */
+    int        spans_cap; /**< Spans allocated */
+    int       *map;       /**< Scratch: composed renumbering */
+    int       *map_tmp;   /**< Scratch: composition buffer */
+    int        map_cap;   /**< Entries allocated in map and map_tmp */
+} AssignRemap;
+
+/**
+ * Per-cluster occurrence chains over the assignment history.
+ *
+ * Every frame is linked to the previous frame recorded under the same
+ * serial. A serial names one cluster as it was when created; merging a
+ * cluster into another splices its serial into the target's member list,
+ * so chains never need renumbering. Readers walk the chains of the
+ * serials listed from serial_of[c] to visit the frames of cluster c.
+ */
+typedef struct
+{
+    int  *prev;         /**< Per frame f: previous frame of its serial, at prev[f - history_base] */
+    long  frames_cap;   /**< Slots allocated in prev */
+    long  num_frames;   /**< Frames recorded; the index is only used when it covers all */
+    int  *serial_of;    /**< Per cluster index: first serial of its member list, -1 if none */
+    int   clusters_cap; /**< Entries allocated in serial_of */
+    int  *head;         /**< Per serial: latest frame recorded, -1 if none */
+    int  *next_member;  /**< Per serial: next serial of the same cluster, -1 at the end */
+    int  *tail_member;  /**< Per first serial: last serial of its member list */
+    int   num_serials;  /**< Serials handed out */
+    int   serials_cap;  /**< Serials allocated */
+    int   broken;       /**< Set after an allocation failure or a gap; readers fall back */
+} OccurrenceIndex;
+
 /* Forward declaration — full definition in cluster_trace.h */
 struct TraceBuffer;
 
+/* Forward declaration — full definition in spec_batch.h */
+struct SpecBatch;
+
+/* Forward declaration — full definition in shared/gricres.h */
+struct GricResWriter;
+
+/* Forward declaration — full definition in knn_online.h */
+struct KnnOnline;
+
 // State structure
 typedef struct
 {
     Cluster          *clusters;
     VisitorList      *cluster_visitors;
-    int              *assignments;
+    int              *assignments;      /**< Per-frame cluster (see resolve_assignments()) */
+    AssignRemap       assign_remap;     /**< Removals not yet applied to assignments */
+    OccurrenceIndex   occ_index;        /**< Occurrence chains for -pred (see occ_index_record()) */
     FrameInfo        *frame_infos;
+    FrameLog          frame_log;        /**< Storage of frame_infos measurements */
+    long              history_base;     /**< Frame held in assignments[0]/frame_infos[0] */
+    long              history_cap;      /**< Rolling history slots (0 = whole run) */
     int               num_clusters;
     FILE             *distall_out;
     long             *transition_matrix;
@@ -224,6 +359,9 @@ typedef struct
     CrossTileHookFn   cross_tile_hook;  /**< Hook callback for cross-tile updates */
     void             *cross_tile_ctx;   /**< Callback context */
     struct TraceBuffer *trace;          /**< Explain trace buffer (NULL = disabled) */
+    struct SpecBatch   *spec;           /**< Speculative frame batch (NULL = disabled) */
+    struct GricResWriter *gricres;      /**< Results bundle being written (NULL = disabled) */
+    struct KnnOnline     *knn;          /**< Online k-NN index (NULL = disabled) */
 } ClusterState;
 
 /** Minimum cluster count for OpenMP parallelization of pruning loops. */
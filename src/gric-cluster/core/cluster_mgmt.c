@@ -7,11 +7,17 @@
  *
  * Main Functions:
  * - add_visitor: Records that a frame index has visited/been assigned to a cluster.
+ * - visitors_set_assignment: Stores a frame's assignment in its visitor entries.
  * - remove_cluster: Prunes and completely deletes a cluster from the active set.
+ * - resolve_assignments: Applies pending removals to the assignment history.
+ * - occ_index_record: Links a frame into its cluster's occurrence chain.
+ * - history_slide: Drops the oldest frames of a rolling history.
  */
 #include "cluster_mgmt.h"
 #include "cluster_core.h"
 #include "cluster_steps.h"
+#include "knn_online.h"
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -20,18 +26,22 @@
  * add_visitor() - Safely adds a frame index to a cluster's visitor history.
  * @list:      Pointer to the VisitorList structure.
  * @frame_idx: Index of the frame to append.
+ * @distance:  Exact distance from the frame to the cluster anchor, or -1.
  *
- * Dynamically resizes the integer list capacity as needed (doubles capacity,
- * starting at 16). When the list exceeds VISITOR_COMPACT_THRESHOLD entries,
- * compacts to keep only the most recent VISITOR_COMPACT_KEEP entries to
- * prevent unbounded memory growth in long-running sessions.
+ * The entry's cluster is filled in by visitors_set_assignment() once the
+ * frame is assigned. Dynamically resizes the list capacity as needed
+ * (doubles capacity, starting at 16). When the list exceeds
+ * VISITOR_COMPACT_THRESHOLD entries, compacts to keep only the most recent
+ * VISITOR_COMPACT_KEEP entries to prevent unbounded memory growth in
+ * long-running sessions.
  */
 #define VISITOR_COMPACT_THRESHOLD 2048
 #define VISITOR_COMPACT_KEEP      1024
 
 void add_visitor(
     VisitorList *list,
-    int          frame_idx)
+    int          frame_idx,
+    double       distance)
 {
     /* Compact when the list grows too large */
     if (list->count >= VISITOR_COMPACT_THRESHOLD)
@@ -39,9 +49,9 @@ void add_visitor(
         int keep = VISITOR_COMPACT_KEEP;
         int start = list->count - keep;
         memmove(
-            list->frames,
-            list->frames + start,
-            (size_t)keep * sizeof(int)
+            list->entries,
+            list->entries + start,
+            (size_t)keep * sizeof(VisitorEntry)
         );
         list->count = keep;
     }
@@ -51,13 +61,13 @@ void add_visitor(
         int new_capacity =
             (list->capacity == 0)
                 ? 16 : list->capacity * 2;
-        int *new_frames = (int *)realloc(
-            list->frames,
-            (size_t)new_capacity * sizeof(int)
+        VisitorEntry *new_entries = (VisitorEntry *)realloc(
+            list->entries,
+            (size_t)new_capacity * sizeof(VisitorEntry)
         );
-        if (new_frames)
+        if (new_entries)
         {
-            list->frames = new_frames;
+            list->entries = new_entries;
             list->capacity = new_capacity;
         }
         else
@@ -66,7 +76,548 @@ void add_visitor(
             return;
         }
     }
-    list->frames[list->count++] = frame_idx;
+    VisitorEntry *e = &list->entries[list->count++];
+    e->frame    = frame_idx;
+    e->cluster  = -1;
+    e->distance = distance;
+}
+
+/**
+ * visitor_mark() - Set the cluster of @list's entry for @frame, if it is the last one.
+ * @list:    Visitor list.
+ * @frame:   Frame just assigned.
+ * @cluster: Cluster it was assigned to.
+ */
+static void visitor_mark(
+    VisitorList *list,
+    long         frame,
+    int          cluster)
+{
+    if (list->count > 0 && list->entries[list->count - 1].frame == frame)
+    {
+        list->entries[list->count - 1].cluster = cluster;
+    }
+}
+
+/**
+ * visitors_set_assignment() - Record the assignment of @frame in its visitor entries.
+ * @state:    Pointer to the active ClusterState.
+ * @frame:    Frame just assigned.
+ * @cluster:  Cluster it was assigned to.
+ * @measured: Clusters the frame was measured against.
+ * @count:    Number of entries in @measured.
+ *
+ * A frame's entries are the last ones of the lists it was added to. Those
+ * are found through @measured and @cluster, unless a cluster was removed
+ * during the frame (indices in @measured are then stale) and every list is
+ * checked instead.
+ */
+void visitors_set_assignment(
+    ClusterState *state,
+    long          frame,
+    int           cluster,
+    const int    *measured,
+    int           count)
+{
+    if (state->scratch.visitor_shift_stamp == frame + 1)
+    {
+        for (int ii = 0; ii < state->num_clusters; ii++)
+        {
+            visitor_mark(&state->cluster_visitors[ii], frame, cluster);
+        }
+        return;
+    }
+    for (int ii = 0; ii < count; ii++)
+    {
+        if (measured[ii] >= 0 && measured[ii] < state->num_clusters)
+        {
+            visitor_mark(&state->cluster_visitors[measured[ii]], frame, cluster);
+        }
+    }
+    if (cluster >= 0 && cluster < state->num_clusters)
+    {
+        visitor_mark(&state->cluster_visitors[cluster], frame, cluster);
+    }
+}
+
+/**
+ * visitors_remap() - Renumber the recorded assignments of the visitor entries.
+ * @state:   Pointer to the active ClusterState.
+ * @config:  Pointer to the active ClusterConfig.
+ * @removed: Removed cluster index.
+ * @target:  Cluster its frames now belong to (renumbered), or -1 if discarded.
+ *
+ * Entries of the removed cluster move to @target, higher indices shift down,
+ * as in the assignments log. Only the last max_gprob_visitors entries of a
+ * list are ever read again, so older ones are left as they are.
+ */
+static void visitors_remap(
+    ClusterState  *state,
+    ClusterConfig *config,
+    int            removed,
+    int            target)
+{
+    for (int cl_idx = 0; cl_idx < state->num_clusters; cl_idx++)
+    {
+        VisitorList *vl    = &state->cluster_visitors[cl_idx];
+        int          start = 0;
+        if (vl->count > config->optim.max_gprob_visitors)
+        {
+            start = vl->count - config->optim.max_gprob_visitors;
+        }
+        for (int ii = start; ii < vl->count; ii++)
+        {
+            int *c = &vl->entries[ii].cluster;
+            if (*c == removed)
+            {
+                *c = target;
+            }
+            else if (*c > removed)
+            {
+                (*c)--;
+            }
+        }
+    }
+}
+
+/** Pending removals after which the whole history is resolved at once. */
+#define ASSIGN_REMAP_MAX_OPS 1024
+
+/**
+ * remap_reserve_map() - Make the renumbering scratch hold @need entries.
+ * @rm:   Assignment remap state.
+ * @need: Required entries.
+ *
+ * Return: 0 on success, -1 on allocation failure.
+ */
+static int remap_reserve_map(
+    AssignRemap *rm,
+    int          need)
+{
+    if (need <= rm->map_cap)
+    {
+        return 0;
+    }
+    int *map = (int *)realloc(rm->map, (size_t)need * sizeof(int));
+    if (map == NULL)
+    {
+        return -1;
+    }
+    rm->map = map;
+    int *map_tmp = (int *)realloc(rm->map_tmp, (size_t)need * sizeof(int));
+    if (map_tmp == NULL)
+    {
+        return -1;
+    }
+    rm->map_tmp = map_tmp;
+    rm->map_cap = need;
+    return 0;
+}
+
+/**
+ * resolve_assignments() - Apply pending removals to recent assignments.
+ * @state: Pointer to the active ClusterState.
+ * @from:  First frame the caller is about to read.
+ *
+ * Walks the stale spans from the newest, composing the pending removal ops
+ * into one renumbering per span (O(K) per op), and rewrites only the frames
+ * at or after @from. The log is dropped once no stale span remains.
+ */
+void resolve_assignments(
+    ClusterState *state,
+    long          from)
+{
+    AssignRemap *rm   = &state->assign_remap;
+    long         base = state->history_base;
+
+    if (from < base)
+    {
+        from = base;
+    }
+    if (rm->nspans == 0 || rm->spans[rm->nspans - 1].end <= from)
+    {
+        return;
+    }
+    if (remap_reserve_map(rm, state->num_clusters) != 0)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] cannot allocate assignment remap\n",
+                __FILE__, __LINE__);
+        return;
+    }
+
+    /* map: numbering before op `gen` -> current numbering, over `width` clusters */
+    int gen   = rm->nops;
+    int width = state->num_clusters;
+    for (int ii = 0; ii < width; ii++)
+    {
+        rm->map[ii] = ii;
+    }
+
+    while (rm->nspans > 0 && rm->spans[rm->nspans - 1].end > from)
+    {
+        RemapSpan *sp = &rm->spans[rm->nspans - 1];
+        while (gen > sp->gen)
+        {
+            const RemapOp *op = &rm->ops[--gen];
+            for (int a = 0; a < op->count; a++)
+            {
+                int m = (a == op->removed) ? op->target
+                        : (a > op->removed) ? a - 1 : a;
+                rm->map_tmp[a] = (m < 0) ? -1 : rm->map[m];
+            }
+            int *swap   = rm->map;
+            rm->map     = rm->map_tmp;
+            rm->map_tmp = swap;
+            width       = op->count;
+        }
+
+        long lo = (sp->start > from) ? sp->start : from;
+        for (long f = lo; f < sp->end; f++)
+        {
+            int a = state->assignments[f - base];
+            if (a >= 0)
+            {
+                state->assignments[f - base] = (a < width) ? rm->map[a] : -1;
+            }
+        }
+        if (lo > sp->start)
+        {
+            sp->end = lo;
+            break;
+        }
+        rm->nspans--;
+    }
+
+    if (rm->nspans == 0)
+    {
+        rm->nops = 0;
+    }
+}
+
+/**
+ * remap_push() - Queue the renumbering caused by one cluster removal.
+ * @state:  Pointer to the active ClusterState.
+ * @op:     Removal, with the merge target already renumbered.
+ *
+ * Frames recorded since the last removal become a new stale span. When the
+ * log is full, or cannot grow, the whole history is resolved first; if the
+ * op still cannot be queued it is applied to every frame immediately.
+ */
+static void remap_push(
+    ClusterState  *state,
+    RemapOp        op)
+{
+    AssignRemap *rm    = &state->assign_remap;
+    long         total = state->telemetry.total_frames_processed;
+    long         base  = state->history_base;
+    long         clean = (rm->nspans > 0) ? rm->spans[rm->nspans - 1].end : base;
+
+    if (rm->nops >= ASSIGN_REMAP_MAX_OPS)
+    {
+        resolve_assignments(state, base);
+        clean = base;
+    }
+
+    int ok = (remap_reserve_map(rm, op.count) == 0);
+    if (ok && rm->nops == rm->ops_cap)
+    {
+        int      cap = (rm->ops_cap > 0) ? 2 * rm->ops_cap : 16;
+        RemapOp *ops = (RemapOp *)realloc(rm->ops, (size_t)cap * sizeof(RemapOp));
+        ok = (ops != NULL);
+        if (ok)
+        {
+            rm->ops = ops;
+            rm->ops_cap = cap;
+        }
+    }
+    if (ok && rm->nspans == rm->spans_cap)
+    {
+        int        cap   = (rm->spans_cap > 0) ? 2 * rm->spans_cap : 16;
+        RemapSpan *spans = (RemapSpan *)realloc(rm->spans, (size_t)cap * sizeof(RemapSpan));
+        ok = (spans != NULL);
+        if (ok)
+        {
+            rm->spans = spans;
+            rm->spans_cap = cap;
+        }
+    }
+
+    if (!ok)
+    {
+        resolve_assignments(state, base);
+        for (long f = base; f < total; f++)
+        {
+            int a = state->assignments[f - base];
+            if (a == op.removed)
+            {
+                state->assignments[f - base] = op.target;
+            }
+            else if (a > op.removed)
+            {
+                state->assignments[f - base] = a - 1;
+            }
+        }
+        return;
+    }
+
+    if (clean < total)
+    {
+        rm->spans[rm->nspans].start = clean;
+        rm->spans[rm->nspans].end = total;
+        rm->spans[rm->nspans].gen = rm->nops;
+        rm->nspans++;
+    }
+    if (rm->nspans > 0)
+    {
+        rm->ops[rm->nops++] = op;
+    }
+}
+
+/**
+ * assign_remap_free() - Release the pending-removal log.
+ * @remap: Assignment remap state; left zeroed.
+ */
+void assign_remap_free(
+    AssignRemap *remap)
+{
+    free(remap->ops);
+    free(remap->spans);
+    free(remap->map);
+    free(remap->map_tmp);
+    memset(remap, 0, sizeof(*remap));
+}
+
+/**
+ * occ_grow() - Grow an int array to at least @need entries, filling new ones with -1.
+ * @arr:  Array to grow (may point to NULL).
+ * @cap:  Entries allocated; updated.
+ * @need: Required entries.
+ *
+ * Return: 0 on success, -1 on allocation failure.
+ */
+static int occ_grow(
+    int  **arr,
+    long  *cap,
+    long   need)
+{
+    if (need <= *cap)
+    {
+        return 0;
+    }
+    long n = (*cap > 0) ? *cap : 16;
+    while (n < need)
+    {
+        n *= 2;
+    }
+    int *grown = (int *)realloc(*arr, (size_t)n * sizeof(int));
+    if (grown == NULL)
+    {
+        return -1;
+    }
+    memset(grown + *cap, 0xff, (size_t)(n - *cap) * sizeof(int));
+    *arr = grown;
+    *cap = n;
+    return 0;
+}
+
+/**
+ * occ_reserve_serials() - Make room for one more serial.
+ * @occ: Occurrence index.
+ *
+ * Return: 0 on success, -1 on allocation failure.
+ */
+static int occ_reserve_serials(
+    OccurrenceIndex *occ)
+{
+    long need = (long)occ->num_serials + 1;
+    long cap  = occ->serials_cap;
+    long c1 = cap, c2 = cap;
+    if (occ_grow(&occ->head, &cap, need) != 0 ||
+        occ_grow(&occ->next_member, &c1, need) != 0 ||
+        occ_grow(&occ->tail_member, &c2, need) != 0)
+    {
+        return -1;
+    }
+    occ->serials_cap = (int)cap;
+    return 0;
+}
+
+/**
+ * occ_index_record() - Link frame @frame into the chain of cluster @cluster.
+ * @state:   Pointer to the active ClusterState.
+ * @frame:   Frame index; must be the next frame after the last one recorded.
+ * @cluster: Cluster the frame was assigned to, in the current numbering.
+ *
+ * A cluster index that has no serial yet (new cluster) receives one. Frames
+ * assigned to no cluster are counted but linked nowhere. On a gap or an
+ * allocation failure the index is marked broken and readers fall back to
+ * scanning the history.
+ */
+void occ_index_record(
+    ClusterState *state,
+    long          frame,
+    int           cluster)
+{
+    OccurrenceIndex *occ = &state->occ_index;
+
+    if (occ->broken)
+    {
+        return;
+    }
+    if (frame != occ->num_frames || frame > INT_MAX)
+    {
+        occ->broken = 1;
+        return;
+    }
+    long ccap = occ->clusters_cap;
+    long slot = frame - state->history_base;
+    if (occ_grow(&occ->prev, &occ->frames_cap, slot + 1) != 0 ||
+        occ_grow(&occ->serial_of, &ccap, (long)cluster + 1) != 0)
+    {
+        occ->broken = 1;
+        return;
+    }
+    occ->clusters_cap = (int)ccap;
+    occ->num_frames = frame + 1;
+
+    if (cluster < 0)
+    {
+        return;
+    }
+    int s = occ->serial_of[cluster];
+    if (s < 0)
+    {
+        if (occ_reserve_serials(occ) != 0)
+        {
+            occ->broken = 1;
+            return;
+        }
+        s = occ->num_serials++;
+        occ->head[s] = -1;
+        occ->next_member[s] = -1;
+        occ->tail_member[s] = s;
+        occ->serial_of[cluster] = s;
+    }
+    occ->prev[slot] = occ->head[s];
+    occ->head[s] = (int)frame;
+}
+
+/**
+ * occ_index_remove() - Follow the removal of cluster @removed in the index.
+ * @occ:     Occurrence index.
+ * @removed: Removed cluster index.
+ * @target:  Merge target before renumbering, or -1 when discarding.
+ * @count:   Number of clusters before the removal.
+ *
+ * A merge splices the member list of @removed onto the one of @target
+ * (O(1)); a discard drops it. The serials of higher clusters shift down.
+ */
+static void occ_index_remove(
+    OccurrenceIndex *occ,
+    int              removed,
+    int              target,
+    int              count)
+{
+    if (occ->broken || occ->serial_of == NULL)
+    {
+        return;
+    }
+    int lim = (count < occ->clusters_cap) ? count : occ->clusters_cap;
+    if (removed >= lim)
+    {
+        return;
+    }
+
+    int s = occ->serial_of[removed];
+    if (s >= 0 && target >= 0 && target < lim)
+    {
+        int t = occ->serial_of[target];
+        if (t < 0)
+        {
+            occ->serial_of[target] = s;
+        }
+        else
+        {
+            occ->next_member[occ->tail_member[t]] = s;
+            occ->tail_member[t] = occ->tail_member[s];
+        }
+    }
+
+    memmove(occ->serial_of + removed, occ->serial_of + removed + 1,
+            (size_t)(lim - 1 - removed) * sizeof(int));
+    occ->serial_of[lim - 1] = -1;
+}
+
+/**
+ * occ_index_free() - Release the occurrence index.
+ * @occ: Occurrence index; left zeroed (empty).
+ */
+void occ_index_free(
+    OccurrenceIndex *occ)
+{
+    free(occ->prev);
+    free(occ->serial_of);
+    free(occ->head);
+    free(occ->next_member);
+    free(occ->tail_member);
+    memset(occ, 0, sizeof(*occ));
+}
+
+/**
+ * history_slide() - Drop the oldest frames of a full rolling history.
+ * @state: Pointer to the active ClusterState (history_cap > 0).
+ * @frame: Frame about to be recorded.
+ *
+ * Keeps the newest history_cap / 2 frames at the front of assignments,
+ * frame_infos and the occurrence chains, so every window a reader needs
+ * stays contiguous and the copy is amortized to one slot per frame. The
+ * measurements and stale spans of the dropped frames are released.
+ */
+void history_slide(
+    ClusterState *state,
+    long          frame)
+{
+    long base = state->history_base;
+    long keep = state->history_cap / 2;
+    if (frame - base < state->history_cap)
+    {
+        return;
+    }
+    long new_base = frame - keep;
+    long shift    = new_base - base;
+
+    frame_log_retire(&state->frame_log, state->frame_infos, base, new_base);
+    memmove(state->assignments, state->assignments + shift, (size_t)keep * sizeof(int));
+    memmove(state->frame_infos, state->frame_infos + shift, (size_t)keep * sizeof(FrameInfo));
+
+    OccurrenceIndex *occ = &state->occ_index;
+    if (occ->prev != NULL && occ->frames_cap > shift)
+    {
+        long live = occ->frames_cap - shift;
+        memmove(occ->prev, occ->prev + shift, (size_t)live * sizeof(int));
+    }
+
+    AssignRemap *rm   = &state->assign_remap;
+    int          drop = 0;
+    while (drop < rm->nspans && rm->spans[drop].end <= new_base)
+    {
+        drop++;
+    }
+    rm->nspans -= drop;
+    if (drop > 0 && rm->nspans > 0)
+    {
+        memmove(rm->spans, rm->spans + drop, (size_t)rm->nspans * sizeof(RemapSpan));
+    }
+    if (rm->nspans > 0 && rm->spans[0].start < new_base)
+    {
+        rm->spans[0].start = new_base;
+    }
+    if (rm->nspans == 0)
+    {
+        rm->nops = 0;
+    }
+
+    state->history_base = new_base;
 }
 
 /**
@@ -78,11 +629,15 @@ void add_visitor(
  *
  * Reorganizes the active clusters list:
  * 1. Shifts cluster structs, updating cluster IDs.
- * 2. Shifts visitor history arrays.
- * 3. Compacts and shifts the inter-cluster distance matrix (dccarray).
- * 4. Compacts and shifts the inter-cluster transition probability matrix.
- * 5. Rewrites the assignments logs and maps the deleted cluster assignment
- *    either to a new target cluster index (if merging) or -1 (if discarding).
+ * 2. Shifts visitor history arrays and renumbers the assignments they hold.
+ * 3. Clears the cluster's DCC bounds and transition counts; its physical
+ *    slot is reused by the next created cluster, so no matrix is shifted.
+ * 4. Queues the renumbering of the assignments log, which maps the deleted
+ *    cluster either to the merge target (if merging) or -1 (if discarding),
+ *    and hands its occurrence chains to the merge target.
+ *
+ * Costs O(K) plus O(K) per queued removal when the history is resolved,
+ * instead of O(K * maxnbclust + total frames).
  */
 void remove_cluster(
     ClusterState  *state,
@@ -108,7 +663,7 @@ void remove_cluster(
             fprintf(log, "# Discarded Cluster %d\n", index_to_remove);
             for (int ii = 0; ii < state->cluster_visitors[index_to_remove].count; ii++)
             {
-                fprintf(log, "%d ", state->cluster_visitors[index_to_remove].frames[ii]);
+                fprintf(log, "%d ", state->cluster_visitors[index_to_remove].entries[ii].frame);
             }
             fprintf(log, "\n");
             fclose(log);
@@ -126,11 +681,12 @@ void remove_cluster(
         state->clusters[cl_idx] = state->clusters[cl_idx + 1];
         state->clusters[cl_idx].id = cl_idx; // Update ID
     }
+    memset(&state->clusters[state->num_clusters - 1], 0, sizeof(Cluster));
 
     // 3. Shift Visitor Lists
-    if (state->cluster_visitors[index_to_remove].frames)
+    if (state->cluster_visitors[index_to_remove].entries)
     {
-        free(state->cluster_visitors[index_to_remove].frames);
+        free(state->cluster_visitors[index_to_remove].entries);
     }
     for (int cl_idx = index_to_remove; cl_idx < state->num_clusters - 1; cl_idx++)
     {
@@ -138,114 +694,40 @@ void remove_cluster(
     }
     // Zero out the last one (moved)
     memset(&state->cluster_visitors[state->num_clusters - 1], 0, sizeof(VisitorList));
-
-    // 4. Shift DCC Array (Rows and Cols)
-    int N = config->algo.maxnbclust; // Stride is fixed maxnbclust
-
-    // Shift Rows up
-    for (int r = index_to_remove; r < state->num_clusters - 1; r++)
+    int target = (index_target == -1) ? -1
+                 : (index_target > index_to_remove) ? index_target - 1 : index_target;
+    visitors_remap(state, config, index_to_remove, target);
+    state->scratch.visitor_shift_stamp = state->telemetry.total_frames_processed + 1;
+    if (state->knn)
     {
-        memcpy(&state->scratch.dcc_min[r * N], &state->scratch.dcc_min[(r + 1) * N],
-               config->algo.maxnbclust * sizeof(double));
-        memcpy(&state->scratch.dcc_max[r * N], &state->scratch.dcc_max[(r + 1) * N],
-               config->algo.maxnbclust * sizeof(double));
-        memcpy(&state->scratch.dcc_measured[r * N], &state->scratch.dcc_measured[(r + 1) * N],
-               config->algo.maxnbclust * sizeof(char));
+        knn_online_remove_cluster(state->knn, index_to_remove);
     }
-    // Shift Columns left for ALL rows
-    for (int r = 0; r < state->num_clusters - 1; r++)
-    {
-        int dest_idx = r * N + index_to_remove;
-        int src_idx = r * N + index_to_remove + 1;
-        int count = config->algo.maxnbclust - 1 - index_to_remove;
-        if (count > 0)
-        {
-            memmove(&state->scratch.dcc_min[dest_idx], &state->scratch.dcc_min[src_idx],
-                    count * sizeof(double));
-            memmove(&state->scratch.dcc_max[dest_idx], &state->scratch.dcc_max[src_idx],
-                    count * sizeof(double));
-            memmove(&state->scratch.dcc_measured[dest_idx], &state->scratch.dcc_measured[src_idx],
-                    count * sizeof(char));
-        }
-    } // for (int r = 0; r < state->num_clusters - 1; r++)
 
-    // 5. Shift Transition Matrix (Same logic as DCC)
-    // Shift Rows
-    for (int r = index_to_remove; r < state->num_clusters - 1; r++)
+    // 4. Clear the cluster's transition counts (row and column of its slot)
+    int    N = config->algo.maxnbclust; // Stride is fixed maxnbclust
+    size_t p = (size_t)state->scratch.dcc.slot[index_to_remove];
+    for (int k = 0; k < N; k++)
     {
-        memcpy(&state->transition_matrix[r * N], &state->transition_matrix[(r + 1) * N],
-               config->algo.maxnbclust * sizeof(long));
-    }
-    // Shift Cols
-    for (int r = 0; r < state->num_clusters - 1; r++)
-    {
-        int dest_idx = r * N + index_to_remove;
-        int src_idx = r * N + index_to_remove + 1;
-        int count = config->algo.maxnbclust - 1 - index_to_remove;
-        if (count > 0)
-        {
-            memmove(&state->transition_matrix[dest_idx], &state->transition_matrix[src_idx],
-                    count * sizeof(long));
-        }
+        state->transition_matrix[p * N + k] = 0;
+        state->transition_matrix[(size_t)k * N + p] = 0;
     }
 
-    // Clear the now-unused last row/col so newly created clusters don't inherit stale cache/state.
-    int last = state->num_clusters - 1;
-    for (int r = 0; r < N; r++)
-    {
-        state->transition_matrix[last * N + r] = 0;
-        state->transition_matrix[r * N + last] = 0;
-        if (config->optim.sparse_dcc_mode)
-        {
-            state->scratch.dcc_min[last * N + r] = 0.0;
-            state->scratch.dcc_min[r * N + last] = 0.0;
-            state->scratch.dcc_max[last * N + r] = 1e19;
-            state->scratch.dcc_max[r * N + last] = 1e19;
-            state->scratch.dcc_measured[last * N + r] = 0;
-            state->scratch.dcc_measured[r * N + last] = 0;
-        }
-        else
-        {
-            state->scratch.dcc_min[last * N + r] = -1.0;
-            state->scratch.dcc_min[r * N + last] = -1.0;
-            state->scratch.dcc_max[last * N + r] = -1.0;
-            state->scratch.dcc_max[r * N + last] = -1.0;
-            state->scratch.dcc_measured[last * N + r] = 0;
-            state->scratch.dcc_measured[r * N + last] = 0;
-        }
-    } // for (int r = 0; r < N; r++)
-    state->scratch.dcc_min[last * N + last] = 0.0;
-    state->scratch.dcc_max[last * N + last] = 0.0;
-    state->scratch.dcc_measured[last * N + last] = 1;
-    memset(&state->clusters[last], 0, sizeof(Cluster));
+    // 5. Drop the cluster's DCC bounds and park its slot for the next cluster
+    dcc_store_remove(&state->scratch.dcc, index_to_remove, state->num_clusters);
+    refine_queue_remove(&state->scratch.refine, index_to_remove);
 
-    // 6. Correct Assignments Update Loop
-    for (long f = 0; f < state->telemetry.total_frames_processed; f++)
-    {
-        int a = state->assignments[f];
-        if (a == index_to_remove)
-        {
-            if (index_target == -1)
-            {
-                state->assignments[f] = -1;
-            }
-            else
-            {
-                if (index_target > index_to_remove)
-                    state->assignments[f] = index_target - 1;
-                else
-                    state->assignments[f] = index_target;
-            }
-        }
-        else if (a > index_to_remove)
-        {
-            state->assignments[f] = a - 1;
-        }
-    } // for (long f = 0; f < state->telemetry.total_frames_processed; f++)
+    // 6. Queue the assignments renumbering (applied by resolve_assignments())
+    //    and splice the cluster's occurrence chains into the merge target
+    occ_index_remove(&state->occ_index, index_to_remove, index_target, state->num_clusters);
+    RemapOp op;
+    op.removed = index_to_remove;
+    op.target = target;
+    op.count = state->num_clusters;
+    remap_push(state, op);
 
     // 7. Decrement Num Clusters
     state->num_clusters--;
 
-    // 8. Recompute Geometric Consistency Mask
-    recompute_consistency_mask(config, state);
+    // 8. Remap cached geometric consistency masks
+    consistency_remove_cluster(state, index_to_remove);
 }
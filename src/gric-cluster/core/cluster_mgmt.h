@@ -11,21 +11,40 @@
  *
  * @param list Pointer to the VisitorList structure.
  * @param frame_idx Index of the frame to append.
+ * @param distance Exact distance from the frame to the cluster anchor, or -1.
  */
 void add_visitor(
     VisitorList *list,
-    int          frame_idx);
+    int          frame_idx,
+    double       distance);
+
+/**
+ * @brief Store the assignment of @frame in the visitor entries it just added.
+ *
+ * @param state Pointer to the active ClusterState.
+ * @param frame Frame just assigned.
+ * @param cluster Cluster it was assigned to (-1 if none).
+ * @param measured Clusters the frame was measured against.
+ * @param count Number of entries in @measured.
+ */
+void visitors_set_assignment(
+    ClusterState *state,
+    long          frame,
+    int           cluster,
+    const int    *measured,
+    int           count);
 
 /**
  * @brief Deletes a cluster from state, optionally merging its history.
  *
  * Reorganizes the active clusters list:
  * 1. Shifts cluster structs, updating cluster IDs.
- * 2. Shifts visitor history arrays.
- * 3. Compacts and shifts the inter-cluster distance matrix (dccarray).
- * 4. Compacts and shifts the inter-cluster transition probability matrix.
- * 5. Rewrites the assignments logs and maps the deleted cluster assignment
- *    either to a new target cluster index (if merging) or -1 (if discarding).
+ * 2. Shifts visitor history arrays and renumbers the assignments they hold.
+ * 3. Clears the cluster's DCC bounds and transition counts, and frees its
+ *    physical slot for the next created cluster (O(K), no matrix shifts).
+ * 4. Queues the renumbering of the assignments log, which maps the deleted
+ *    cluster either to the merge target or to -1 (if discarding); the log
+ *    is rewritten lazily by resolve_assignments().
  *
  * @param state Pointer to the active ClusterState.
  * @param config Pointer to the active ClusterConfig.
@@ -38,4 +57,77 @@ void remove_cluster(
     int            index_to_remove,
     int            index_target);
 
+/**
+ * @brief Apply pending cluster removals to assignments[@from, total_frames_processed).
+ *
+ * Must be called before reading past assignments. Costs O(frames still
+ * stale in the range + pending removals * K).
+ *
+ * @param state Pointer to the active ClusterState.
+ * @param from First frame the caller is about to read.
+ */
+void resolve_assignments(
+    ClusterState *state,
+    long          from);
+
+/**
+ * @brief Release the pending-removal log of @remap.
+ *
+ * @param remap Assignment remap state; left zeroed (no pending removals).
+ */
+void assign_remap_free(
+    AssignRemap *remap);
+
+/**
+ * @brief Link frame @frame (the next one) into the occurrence chain of @cluster.
+ *
+ * @param state Pointer to the active ClusterState.
+ * @param frame Frame index, equal to the number of frames recorded so far.
+ * @param cluster Assigned cluster in the current numbering, or -1.
+ */
+void occ_index_record(
+    ClusterState *state,
+    long          frame,
+    int           cluster);
+
+/**
+ * @brief Release the occurrence index @occ.
+ *
+ * @param occ Occurrence index; left zeroed (empty).
+ */
+void occ_index_free(
+    OccurrenceIndex *occ);
+
+/**
+ * @brief Drop the oldest half of a full rolling history before recording @frame.
+ *
+ * No-op while @frame still fits in the history_cap slots.
+ *
+ * @param state Pointer to the active ClusterState.
+ * @param frame Frame about to be recorded.
+ */
+void history_slide(
+    ClusterState *state,
+    long          frame);
+
+/**
+ * @brief Transition count cell from cluster @from to cluster @to.
+ *
+ * The matrix is indexed by the clusters' physical DCC slots, so that
+ * removing a cluster only clears one row and column.
+ *
+ * @param state Pointer to the active ClusterState.
+ * @param from Previous cluster index.
+ * @param to Next cluster index.
+ * @return Pointer to the count.
+ */
+static inline long *transition_cell(
+    ClusterState *state,
+    int           from,
+    int           to)
+{
+    const DccStore *dcc = &state->scratch.dcc;
+    return &state->transition_matrix[(size_t)dcc->slot[from] * dcc->n + dcc->slot[to]];
+}
+
 #endif // CLUSTER_MGMT_H
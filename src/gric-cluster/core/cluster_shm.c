@@ -105,6 +105,18 @@ int gric_shm_init(
         strcpy(status->input_source, "N/A");
     }
 
+    /* Version 4: prefetch ring */
+    {
+        FramePrefetchStats pf;
+        frameread_prefetch_get_stats(&pf);
+        status->prefetch_depth = (uint32_t)pf.depth;
+        status->prefetch_fill = (uint32_t)pf.fill;
+        status->prefetch_avg_fill = pf.avg_fill;
+        status->prefetch_stalls = (uint64_t)pf.stalls;
+        status->prefetch_stall_ms = pf.stall_ms;
+        status->prefetch_full_waits = (uint64_t)pf.full_waits;
+    }
+
     struct timespec now;
     clock_gettime(CLOCK_REALTIME, &now);
     status->last_update_time = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
@@ -10,7 +10,7 @@
 #include <stdint.h>
 
 #define GRIC_SHM_MAGIC   0x47524943 // 'GRIC'
-#define GRIC_SHM_VERSION 3
+#define GRIC_SHM_VERSION 4
 
 typedef enum
 {
@@ -90,6 +90,14 @@ typedef struct
     double   entropy_last_initial;     // H at meas_idx==0 for last frame
     double   entropy_avg_initial;      // Running average H at meas_idx==0
     double   entropy_gate_ratio;       // Fraction of calls gated
+
+    /* Version 4 Expanded Fields */
+    uint32_t prefetch_depth;           // Prefetch ring capacity (0 = synchronous reads)
+    uint32_t prefetch_fill;            // Frames currently decoded ahead
+    double   prefetch_avg_fill;        // Mean ring occupancy seen by the consumer
+    uint64_t prefetch_stalls;          // Reads that found the ring empty
+    double   prefetch_stall_ms;        // Time blocked on an empty ring (ms)
+    uint64_t prefetch_full_waits;      // Reader-thread waits on a full ring
 } GricClusterShmStatus;
 
 /**
@@ -11,7 +11,7 @@
  *   - For predicted cluster anchors (if targeting a prediction candidate).
  *   - For standard search candidates (measured in sequence of mixed probability). If a candidate
  *     does not match, distances between cluster anchors are computed to tighten DCC
- *     bounds (dcc_min/dcc_max, tracked by dcc_measured) and prune other candidate
+ *     bounds (scratch.dcc, see dcc_store.h) and prune other candidate
  *     clusters via triangle inequalities.
  * - Step 4 (New cluster creation): Pairwise distances between the new cluster anchor and all
  *   existing cluster anchors are measured and cached to maintain DCC bounds.
@@ -23,6 +23,7 @@
 #include "cluster_math.h"
 #include "cluster_prune.h"
 #include "cluster_bounds.h"
+#include "frameread.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -82,11 +83,17 @@ int cluster_frame(
         clock_gettime(CLOCK_MONOTONIC, &step_start);
         initialize_initial_cluster(config, state, current_frame, &assigned_cluster);
         clock_gettime(CLOCK_MONOTONIC, &step_end);
+        if (assigned_cluster == -2)
+        {
+            free_frame(current_frame);
+            return -2;
+        }
         state->telemetry.time_step_1 += (step_end.tv_sec - step_start.tv_sec) * 1000.0 +
                                         (step_end.tv_nsec - step_start.tv_nsec) / 1000000.0;
         state->telemetry.last_assignment_dist = 0.0;
         temp_indices[0] = 0;
         temp_dists[0] = 0.0;
+        state->scratch.dist_lower_bound[0] = 0;
         temp_count = 1;
     }
     else
@@ -102,6 +109,7 @@ int cluster_frame(
         int num_preds = 0;
         int current_pred_idx = 0;
         int first_pred = -1;  /* first prediction candidate */
+        int pred_batched = 0; /* prediction candidates already batch-evaluated */
 
         // Step 2: Retrieve prediction candidates.
         // Retrieves prediction candidates at the very start of processing the frame if
@@ -111,7 +119,20 @@ int cluster_frame(
         if (config->optim.pred_mode &&
             state->telemetry.total_frames_processed >= config->optim.pred_len)
         {
-            int *local_candidates = (int *)malloc((size_t)config->optim.pred_n * sizeof(int));
+            /* Thread-local candidate buffers, grown on demand (no per-frame allocation) */
+            static __thread int *local_buf = NULL;
+            static __thread int *pred_buf = NULL;
+            static __thread int  pred_cap = 0;
+            if (config->optim.pred_n > pred_cap)
+            {
+                free(local_buf);
+                free(pred_buf);
+                local_buf = (int *)malloc((size_t)config->optim.pred_n * sizeof(int));
+                pred_buf = (int *)malloc((size_t)config->optim.pred_n * sizeof(int));
+                pred_cap = (local_buf != NULL && pred_buf != NULL) ? config->optim.pred_n : 0;
+            }
+
+            int *local_candidates = (pred_cap > 0) ? local_buf : NULL;
             int num_local = 0;
             if (local_candidates != NULL)
             {
@@ -119,7 +140,7 @@ int cluster_frame(
                                                       config->optim.pred_n);
             }
 
-            pred_candidates = (int *)malloc((size_t)config->optim.pred_n * sizeof(int));
+            pred_candidates = (pred_cap > 0) ? pred_buf : NULL;
             if (pred_candidates != NULL)
             {
                 if (num_local == 1)
@@ -175,10 +196,6 @@ int cluster_frame(
                     }
                 }
             }
-            if (local_candidates != NULL)
-            {
-                free(local_candidates);
-            }
         }
         clock_gettime(CLOCK_MONOTONIC, &s2_end);
         state->telemetry.time_step_2 += (s2_end.tv_sec - s2_start.tv_sec) * 1000.0 +
@@ -295,6 +312,29 @@ int cluster_frame(
                 }
             }
 
+            // Prediction batch: on the first prediction target, evaluate it together
+            // with the remaining active prediction candidates in one pass over the frame.
+            if (is_prediction && config->optim.pred_batch && !pred_batched)
+            {
+                int batch[num_preds];
+                int nbatch = 0;
+                batch[nbatch++] = cj;
+                for (int p = current_pred_idx; p < num_preds; p++)
+                {
+                    int pc = pred_candidates[p];
+                    if (pc != cj && pc >= 0 && pc < state->num_clusters &&
+                        state->scratch.clmembflag[pc])
+                    {
+                        batch[nbatch++] = pc;
+                    }
+                }
+                if (nbatch > 1)
+                {
+                    prefetch_candidate_distances(batch, nbatch, current_frame, config, state);
+                }
+                pred_batched = 1;
+            }
+
             // Step 3c: Measure distance to target.
             // Output: Returns computed distance dfc; updates temp_indices/temp_dists and
             // increments temp_count.
@@ -334,11 +374,6 @@ int cluster_frame(
             state->telemetry.pred_hits++;
         }
 
-        if (pred_candidates)
-        {
-            free(pred_candidates);
-        }
-
         // Step 4: Handling of new cluster creation and cache limits.
         // If no existing cluster matches within 'rlim', we must create a new cluster.
         // If the max cluster capacity 'maxnbclust' is reached, we execute the configured
@@ -5,21 +5,47 @@
 #include <stdlib.h>
 #include <time.h>
 
+/** Pixel storage type of Frame.data (zero-initialised frames are f64). */
+typedef enum
+{
+    FRAME_DTYPE_F64 = 0, /**< double (default, historical layout) */
+    FRAME_DTYPE_F32,     /**< float */
+    FRAME_DTYPE_U16,     /**< uint16_t */
+    FRAME_DTYPE_U8       /**< uint8_t */
+} FrameDType;
+
+/** Run of consecutive pixels [offset, offset + len) of a larger frame. */
+typedef struct
+{
+    long offset;
+    long len;
+} FrameSpan;
+
 typedef struct
 {
-    double *data;
+    void *data;       /**< Pixel buffer, element type given by dtype */
+    FrameDType dtype; /**< Storage type of data */
     long width;
     long height;
     int id;
     uint64_t cnt0;
     struct timespec atime;
+    int borrowed;     /**< FRAME_OWNED, or who owns data (see below) */
+    const FrameSpan *spans; /**< Tile view (FRAME_BORROW_TILE only): pixels are these runs of data */
+    int num_spans;          /**< Number of spans; unused when spans is NULL */
 } Frame;
 
+/* Frame.borrowed values */
+#define FRAME_OWNED         0 /**< data is owned and recycled by free_frame() */
+#define FRAME_BORROW_STREAM 1 /**< data points into an ImageStreamIO slice */
+#define FRAME_BORROW_TILE   2 /**< Frame and data belong to a tile worker; free_frame() is a no-op */
+
 typedef struct
 {
-    Frame  anchor; /**< Frame serving as the cluster anchor point */
-    int    id;     /**< Unique cluster index identifier */
-    double prob;   /**< Prior frequency probability distribution (CFPD/DFPD) */
+    Frame  anchor;  /**< Frame serving as the cluster anchor point */
+    int    id;      /**< Unique cluster index identifier */
+    double prob;    /**< Prior frequency probability distribution (CFPD/DFPD) */
+    double norm_sq; /**< Cached ||anchor||^2 for batched dot-product distances */
 } Cluster;
 
 typedef struct
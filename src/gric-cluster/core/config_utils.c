@@ -11,6 +11,10 @@
  * - write_config_file: Dumps the active configuration to a file.
  */
 #include "config_utils.h"
+#include "frame_dtype.h"
+#include "frameread.h"
+#include "spec_batch.h"
+#include "tile_state.h"
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -62,6 +66,15 @@ int apply_option(ClusterConfig *config, const char *key, const char *value)
         config->optim.ncpu = atoi(value);
         return 1;
     }
+    else if (matches(key, "-specbatch"))
+    {
+        if (!value)
+            return -1;
+        config->optim.spec_batch = atoi(value);
+        if (config->optim.spec_batch < 0 || config->optim.spec_batch > SPEC_BATCH_MAX)
+            return -1;
+        return 1;
+    }
     else if (matches(key, "-maxim"))
     {
         if (!value)
@@ -69,6 +82,15 @@ int apply_option(ClusterConfig *config, const char *key, const char *value)
         config->input.maxnbfr = atol(value);
         return 1;
     }
+    else if (matches(key, "-history"))
+    {
+        if (!value)
+            return -1;
+        config->input.history_window = atol(value);
+        if (config->input.history_window < 0)
+            return -1;
+        return 1;
+    }
     else if (matches(key, "-avg"))
     {
         config->output.average_mode = 1;
@@ -132,6 +154,16 @@ int apply_option(ClusterConfig *config, const char *key, const char *value)
         config->input.cnt2sync_mode = 1;
         return 0;
     }
+    else if (matches(key, "-stream_zerocopy"))
+    {
+        config->input.stream_zerocopy = 1;
+        return 0;
+    }
+    else if (matches(key, "-gricbin"))
+    {
+        config->input.write_gricbin = 1;
+        return 0;
+    }
     else if (matches(key, "-fmatcha"))
     {
         if (!value)
@@ -153,6 +185,15 @@ int apply_option(ClusterConfig *config, const char *key, const char *value)
         config->optim.max_gprob_visitors = atoi(value);
         return 1;
     }
+    else if (matches(key, "-framelog_keep"))
+    {
+        if (!value)
+            return -1;
+        config->optim.framelog_keep = atol(value);
+        if (config->optim.framelog_keep < 0)
+            return -1;
+        return 1;
+    }
     else if (matches(key, "-te4"))
     {
         config->optim.te4_mode = 1;
@@ -225,6 +266,21 @@ int apply_option(ClusterConfig *config, const char *key, const char *value)
         config->optim.sparse_dcc_extra_evals = atoi(value);
         return 1;
     }
+    else if (matches(key, "-predbatch"))
+    {
+        config->optim.pred_batch = 1;
+        return 0;
+    }
+    else if (matches(key, "-abandon"))
+    {
+        if (!value)
+            return -1;
+        config->optim.abandon_factor = atof(value);
+        /* Factors below 1 would abandon potential matches (d < rlim) */
+        if (config->optim.abandon_factor != 0.0 && config->optim.abandon_factor < 1.0)
+            return -1;
+        return 1;
+    }
     else if (matches(key, "-soft_bayesian"))
     {
         config->optim.soft_bayesian_mode = 1;
@@ -270,6 +326,15 @@ int apply_option(ClusterConfig *config, const char *key, const char *value)
         config->optim.xtile_decay = atof(value);
         return 1;
     }
+    else if (matches(key, "-tile_lag"))
+    {
+        if (!value)
+            return -1;
+        config->optim.tile_lag = atoi(value);
+        if (config->optim.tile_lag < 0 || config->optim.tile_lag > TILE_LAG_MAX)
+            return -1;
+        return 1;
+    }
     else if (matches(key, "-tm"))
     {
         if (!value)
@@ -358,6 +423,20 @@ int apply_option(ClusterConfig *config, const char *key, const char *value)
         config->output.output_clusters = 1;
         return 0;
     }
+    else if (matches(key, "-gricres"))
+    {
+        config->output.output_gricres = 1;
+        return 0;
+    }
+    else if (matches(key, "-knn"))
+    {
+        if (!value)
+            return -1;
+        config->output.knn_k = atoi(value);
+        if (config->output.knn_k < 0)
+            return -1;
+        return 1;
+    }
     else if (strncmp(key, "-predf", 6) == 0
              || strncmp(key, "predf", 5) == 0)
     {
@@ -475,6 +554,22 @@ int apply_option(ClusterConfig *config, const char *key, const char *value)
         config->input.retrieval_window = atoi(value);
         return 1;
     }
+    else if (matches(key, "-dtype"))
+    {
+        if (!value || frame_dtype_parse(value, &config->input.frame_dtype) != 0)
+            return -1;
+        return 1;
+    }
+    else if (matches(key, "-prefetch"))
+    {
+        if (!value)
+            return -1;
+        config->input.prefetch_depth = atoi(value);
+        if (config->input.prefetch_depth < 0 ||
+            config->input.prefetch_depth > FRAMEREAD_PREFETCH_MAX)
+            return -1;
+        return 1;
+    }
 
     return -1; // Unknown option
 }
@@ -563,7 +658,11 @@ int write_config_file(const char *filename, ClusterConfig *config)
     fprintf(f, "dprob %f\n", config->algo.deltaprob);
     fprintf(f, "maxcl %d\n", config->algo.maxnbclust);
     fprintf(f, "maxim %ld\n", config->input.maxnbfr);
+    if (config->input.history_window > 0)
+        fprintf(f, "history %ld\n", config->input.history_window);
     fprintf(f, "ncpu %d\n", config->optim.ncpu);
+    if (config->optim.spec_batch > 1)
+        fprintf(f, "specbatch %d\n", config->optim.spec_batch);
 
     if (config->output.average_mode)
         fprintf(f, "avg\n");
@@ -587,10 +686,20 @@ int write_config_file(const char *filename, ClusterConfig *config)
         fprintf(f, "stream\n");
     if (config->input.cnt2sync_mode)
         fprintf(f, "cnt2sync\n");
+    if (config->input.stream_zerocopy)
+        fprintf(f, "stream_zerocopy\n");
+    if (config->input.write_gricbin)
+        fprintf(f, "gricbin\n");
+    if (config->input.frame_dtype != FRAME_DTYPE_F64)
+        fprintf(f, "dtype %s\n", frame_dtype_name(config->input.frame_dtype));
+    if (config->input.prefetch_depth > 0)
+        fprintf(f, "prefetch %d\n", config->input.prefetch_depth);
 
     fprintf(f, "fmatcha %f\n", config->optim.fmatch_a);
     fprintf(f, "fmatchb %f\n", config->optim.fmatch_b);
     fprintf(f, "maxvis %d\n", config->optim.max_gprob_visitors);
+    if (config->optim.framelog_keep > 0)
+        fprintf(f, "framelog_keep %ld\n", config->optim.framelog_keep);
 
     if (config->optim.te4_mode)
         fprintf(f, "te4\n");
@@ -617,6 +726,14 @@ int write_config_file(const char *filename, ClusterConfig *config)
         fprintf(f, "sparse_dcc\n");
         fprintf(f, "sparse_dcc_extra_evals %d\n", config->optim.sparse_dcc_extra_evals);
     }
+    if (config->optim.pred_batch)
+    {
+        fprintf(f, "predbatch\n");
+    }
+    if (config->optim.abandon_factor > 0.0)
+    {
+        fprintf(f, "abandon %f\n", config->optim.abandon_factor);
+    }
     if (config->optim.soft_bayesian_mode)
     {
         fprintf(f, "soft_bayesian\n");
@@ -653,6 +770,10 @@ int write_config_file(const char *filename, ClusterConfig *config)
         fprintf(f, "clustered\n");
     if (config->output.output_clusters)
         fprintf(f, "clusters\n");
+    if (config->output.output_gricres)
+        fprintf(f, "gricres\n");
+    if (config->output.knn_k > 0)
+        fprintf(f, "knn %d\n", config->output.knn_k);
 
     if (config->optim.pred_mode)
     {
@@ -707,6 +828,10 @@ int write_config_file(const char *filename, ClusterConfig *config)
         fprintf(f, "xtile_decay %f\n",
                 config->optim.xtile_decay);
     }
+    if (config->optim.tile_lag > 0)
+    {
+        fprintf(f, "tile_lag %d\n", config->optim.tile_lag);
+    }
 
     fclose(f);
     return 0;
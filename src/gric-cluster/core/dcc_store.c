@@ -0,0 +1,541 @@
+/**
+ * @file dcc_store.c
+ * @brief Inter-cluster distance bound store (dense matrix or sparse rows).
+ *
+ * Dense mode allocates maxnbclust x maxnbclust arrays, as every pair is
+ * measured when a cluster is created. Sparse mode (-sparse_dcc) only stores
+ * pairs that were measured or tightened by triangle-inequality propagation,
+ * so memory scales with the number of known pairs instead of capacity.
+ *
+ * Main Functions:
+ * - dcc_store_init / dcc_store_free / dcc_store_reset: Lifecycle.
+ * - dcc_store_grow: Raise cluster capacity (WASM API).
+ * - dcc_store_remove: Delete a cluster index and shift higher indices down.
+ *
+ * Every public function takes logical cluster indices, translated through
+ * the slot table to the physical rows and columns that hold the data.
+ * - dcc_set_exact / dcc_set_min / dcc_set_max / dcc_clear_pair: Updates.
+ */
+#include "dcc_store.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DCC_ROW_MIN_CAP 8
+
+/**
+ * slots_identity() - Map logical indices [@from, @to) to the same physical slots.
+ * @s:    Store.
+ * @from: First index.
+ * @to:   End index.
+ */
+static void slots_identity(
+    DccStore *s,
+    int       from,
+    int       to)
+{
+    for (int ii = from; ii < to; ii++)
+    {
+        s->slot[ii] = ii;
+    }
+}
+
+/**
+ * dense_fill_default() - Mark every dense pair unmeasured.
+ * @s: Dense store.
+ */
+static void dense_fill_default(
+    DccStore *s)
+{
+    size_t pairs = (size_t)s->n * s->n;
+    for (size_t ii = 0; ii < pairs; ii++)
+    {
+        s->min[ii] = -1.0;
+        s->max[ii] = -1.0;
+    }
+    memset(s->measured, 0, pairs);
+}
+
+/**
+ * dcc_store_init() - Allocate a bound store.
+ * @s:      Store to initialize.
+ * @n:      Cluster capacity (maxnbclust).
+ * @sparse: 1 for sparse rows (-sparse_dcc), 0 for dense arrays.
+ *
+ * Dense entries start unmeasured at -1; sparse rows start empty.
+ *
+ * Return: 0 on success, -1 on allocation failure (@s is left freeable).
+ */
+int dcc_store_init(
+    DccStore *s,
+    int       n,
+    int       sparse)
+{
+    memset(s, 0, sizeof(*s));
+    s->n = n;
+    s->sparse = sparse;
+
+    s->slot = (int *)malloc((size_t)n * sizeof(int));
+    if (s->slot == NULL)
+    {
+        return -1;
+    }
+    slots_identity(s, 0, n);
+
+    if (sparse)
+    {
+        s->rows = (DccRow *)calloc((size_t)n, sizeof(DccRow));
+        return (s->rows != NULL) ? 0 : -1;
+    }
+
+    size_t pairs = (size_t)n * n;
+    s->min = (double *)malloc(pairs * sizeof(double));
+    s->max = (double *)malloc(pairs * sizeof(double));
+    s->measured = (char *)malloc(pairs * sizeof(char));
+    if (s->min == NULL || s->max == NULL || s->measured == NULL)
+    {
+        return -1;
+    }
+    dense_fill_default(s);
+    return 0;
+}
+
+/**
+ * dcc_store_free() - Release a bound store.
+ * @s: Store to release; may be zero-initialized.
+ */
+void dcc_store_free(
+    DccStore *s)
+{
+    if (s->rows != NULL)
+    {
+        for (int ii = 0; ii < s->n; ii++)
+        {
+            free(s->rows[ii].slots);
+        }
+    }
+    free(s->rows);
+    free(s->min);
+    free(s->max);
+    free(s->measured);
+    free(s->slot);
+    s->rows = NULL;
+    s->min = NULL;
+    s->max = NULL;
+    s->measured = NULL;
+    s->slot = NULL;
+}
+
+/**
+ * dcc_store_reset() - Forget all pairs.
+ * @s: Store to reset.
+ */
+void dcc_store_reset(
+    DccStore *s)
+{
+    slots_identity(s, 0, s->n);
+    if (!s->sparse)
+    {
+        dense_fill_default(s);
+        return;
+    }
+    for (int ii = 0; ii < s->n; ii++)
+    {
+        free(s->rows[ii].slots);
+        memset(&s->rows[ii], 0, sizeof(DccRow));
+    }
+}
+
+/**
+ * dcc_store_grow() - Raise the cluster capacity.
+ * @s:     Store to grow.
+ * @new_n: New capacity, larger than the current one.
+ *
+ * Return: 0 on success, -1 on allocation failure (@s is unchanged).
+ */
+int dcc_store_grow(
+    DccStore *s,
+    int       new_n)
+{
+    int old_n = s->n;
+
+    if (s->sparse)
+    {
+        int *slot = (int *)realloc(s->slot, (size_t)new_n * sizeof(int));
+        if (slot == NULL)
+        {
+            return -1;
+        }
+        s->slot = slot;
+        DccRow *rows = (DccRow *)realloc(s->rows, (size_t)new_n * sizeof(DccRow));
+        if (rows == NULL)
+        {
+            return -1;
+        }
+        memset(&rows[old_n], 0, (size_t)(new_n - old_n) * sizeof(DccRow));
+        s->rows = rows;
+        s->n = new_n;
+        slots_identity(s, old_n, new_n);
+        return 0;
+    }
+
+    DccStore g;
+    if (dcc_store_init(&g, new_n, 0) != 0)
+    {
+        dcc_store_free(&g);
+        return -1;
+    }
+    for (int ii = 0; ii < old_n; ii++)
+    {
+        memcpy(&g.min[(size_t)ii * new_n], &s->min[(size_t)ii * old_n],
+               (size_t)old_n * sizeof(double));
+        memcpy(&g.max[(size_t)ii * new_n], &s->max[(size_t)ii * old_n],
+               (size_t)old_n * sizeof(double));
+        memcpy(&g.measured[(size_t)ii * new_n], &s->measured[(size_t)ii * old_n],
+               (size_t)old_n);
+    }
+    memcpy(g.slot, s->slot, (size_t)old_n * sizeof(int));
+    dcc_store_free(s);
+    *s = g;
+    return 0;
+}
+
+/**
+ * row_insert() - Find or create the slot of column @col in a sparse row.
+ * @row: Sparse row.
+ * @col: Column (larger cluster index of the pair).
+ *
+ * New slots start at the implicit default [0, DCC_UNBOUNDED], unmeasured.
+ * The row is rehashed to twice its size above a 0.7 load factor.
+ *
+ * Return: Slot of @col, or NULL on allocation failure.
+ */
+static DccEntry *row_insert(
+    DccRow *row,
+    int     col)
+{
+    if ((row->count + 1) * 10 > row->cap * 7)
+    {
+        int       cap   = (row->cap > 0) ? 2 * row->cap : DCC_ROW_MIN_CAP;
+        DccEntry *slots = (DccEntry *)malloc((size_t)cap * sizeof(DccEntry));
+        if (slots == NULL)
+        {
+            return NULL;
+        }
+        for (int ii = 0; ii < cap; ii++)
+        {
+            slots[ii].col = -1;
+        }
+        for (int ii = 0; ii < row->cap; ii++)
+        {
+            if (row->slots[ii].col != -1)
+            {
+                int h = dcc_hash(row->slots[ii].col, cap);
+                while (slots[h].col != -1)
+                {
+                    h = (h + 1) & (cap - 1);
+                }
+                slots[h] = row->slots[ii];
+            }
+        }
+        free(row->slots);
+        row->slots = slots;
+        row->cap = cap;
+    }
+
+    int mask = row->cap - 1;
+    int h    = dcc_hash(col, row->cap);
+    while (row->slots[h].col != -1)
+    {
+        if (row->slots[h].col == col)
+        {
+            return &row->slots[h];
+        }
+        h = (h + 1) & mask;
+    }
+    row->slots[h].col = col;
+    row->slots[h].min = 0.0;
+    row->slots[h].max = DCC_UNBOUNDED;
+    row->slots[h].measured = 0;
+    row->count++;
+    return &row->slots[h];
+}
+
+/**
+ * row_erase() - Remove slot @pos from a sparse row (backward-shift deletion).
+ * @row: Sparse row.
+ * @pos: Occupied slot index.
+ */
+static void row_erase(
+    DccRow *row,
+    int     pos)
+{
+    int mask = row->cap - 1;
+    int hole = pos;
+
+    for (int k = (pos + 1) & mask; row->slots[k].col != -1; k = (k + 1) & mask)
+    {
+        int home = dcc_hash(row->slots[k].col, row->cap);
+        if (((k - home) & mask) >= ((k - hole) & mask))
+        {
+            row->slots[hole] = row->slots[k];
+            hole = k;
+        }
+    }
+    row->slots[hole].col = -1;
+    row->count--;
+}
+
+/**
+ * sparse_slot() - Find or create the entry of pair (@i, @j).
+ * @s: Sparse store.
+ * @i: First cluster index.
+ * @j: Second cluster index, different from @i.
+ *
+ * Return: Entry, or NULL on allocation failure.
+ */
+static DccEntry *sparse_slot(
+    DccStore *s,
+    int       i,
+    int       j)
+{
+    int pi = s->slot[i];
+    int pj = s->slot[j];
+    return (pi < pj) ? row_insert(&s->rows[pi], pj) : row_insert(&s->rows[pj], pi);
+}
+
+/**
+ * dense_clear_slots() - Mark dense pair (@pi, @pj) of physical slots unmeasured.
+ * @s:  Dense store.
+ * @pi: First physical slot.
+ * @pj: Second physical slot.
+ */
+static void dense_clear_slots(
+    DccStore *s,
+    int       pi,
+    int       pj)
+{
+    size_t ij = (size_t)pi * s->n + pj;
+    size_t ji = (size_t)pj * s->n + pi;
+    s->min[ij] = -1.0;
+    s->min[ji] = -1.0;
+    s->max[ij] = -1.0;
+    s->max[ji] = -1.0;
+    s->measured[ij] = 0;
+    s->measured[ji] = 0;
+}
+
+/**
+ * sparse_clear_slots() - Delete sparse pair (@pi, @pj) of physical slots.
+ * @s:  Sparse store.
+ * @pi: First physical slot.
+ * @pj: Second physical slot, different from @pi.
+ */
+static void sparse_clear_slots(
+    DccStore *s,
+    int       pi,
+    int       pj)
+{
+    const DccEntry *e = dcc_find_slots(s, pi, pj);
+    if (e != NULL)
+    {
+        DccRow *row = &s->rows[(pi < pj) ? pi : pj];
+        row_erase(row, (int)(e - row->slots));
+    }
+}
+
+/**
+ * dcc_set_exact() - Record an exact pair distance.
+ * @s: Store.
+ * @i: First cluster index.
+ * @j: Second cluster index.
+ * @d: Measured distance.
+ */
+void dcc_set_exact(
+    DccStore *s,
+    int       i,
+    int       j,
+    double    d)
+{
+    if (!s->sparse)
+    {
+        size_t ij = (size_t)s->slot[i] * s->n + s->slot[j];
+        size_t ji = (size_t)s->slot[j] * s->n + s->slot[i];
+        s->min[ij] = d;
+        s->min[ji] = d;
+        s->max[ij] = d;
+        s->max[ji] = d;
+        s->measured[ij] = 1;
+        s->measured[ji] = 1;
+        return;
+    }
+    if (i == j)
+    {
+        return;
+    }
+    DccEntry *e = sparse_slot(s, i, j);
+    if (e != NULL)
+    {
+        e->min = d;
+        e->max = d;
+        e->measured = 1;
+    }
+}
+
+/**
+ * dcc_set_min() - Overwrite the lower bound of a pair.
+ * @s: Store.
+ * @i: First cluster index.
+ * @j: Second cluster index.
+ * @v: New lower bound.
+ */
+void dcc_set_min(
+    DccStore *s,
+    int       i,
+    int       j,
+    double    v)
+{
+    if (!s->sparse)
+    {
+        s->min[(size_t)s->slot[i] * s->n + s->slot[j]] = v;
+        s->min[(size_t)s->slot[j] * s->n + s->slot[i]] = v;
+        return;
+    }
+    if (i == j)
+    {
+        return;
+    }
+    DccEntry *e = sparse_slot(s, i, j);
+    if (e != NULL)
+    {
+        e->min = v;
+    }
+}
+
+/**
+ * dcc_set_max() - Overwrite the upper bound of a pair.
+ * @s: Store.
+ * @i: First cluster index.
+ * @j: Second cluster index.
+ * @v: New upper bound.
+ */
+void dcc_set_max(
+    DccStore *s,
+    int       i,
+    int       j,
+    double    v)
+{
+    if (!s->sparse)
+    {
+        s->max[(size_t)s->slot[i] * s->n + s->slot[j]] = v;
+        s->max[(size_t)s->slot[j] * s->n + s->slot[i]] = v;
+        return;
+    }
+    if (i == j)
+    {
+        return;
+    }
+    DccEntry *e = sparse_slot(s, i, j);
+    if (e != NULL)
+    {
+        e->max = v;
+    }
+}
+
+/**
+ * dcc_clear_pair() - Return a pair to its unmeasured default.
+ * @s: Store.
+ * @i: First cluster index.
+ * @j: Second cluster index.
+ *
+ * Dense pairs are set to -1; sparse pairs are deleted from their row.
+ */
+void dcc_clear_pair(
+    DccStore *s,
+    int       i,
+    int       j)
+{
+    if (!s->sparse)
+    {
+        dense_clear_slots(s, s->slot[i], s->slot[j]);
+        return;
+    }
+    if (i != j)
+    {
+        sparse_clear_slots(s, s->slot[i], s->slot[j]);
+    }
+}
+
+/**
+ * dcc_store_remove() - Delete a cluster and renumber the higher indices.
+ * @s:     Store.
+ * @r:     Removed cluster index.
+ * @count: Number of clusters before removal.
+ *
+ * Clears every pair between @r and the other live clusters, so that the
+ * freed slot holds no stale bounds, then shifts the slot table down over
+ * @r and parks the freed slot at index @count - 1, where the next created
+ * cluster picks it up. Pairs with dead slots are already clear, so the
+ * cost is O(@count) instead of moving whole rows and columns.
+ */
+void dcc_store_remove(
+    DccStore *s,
+    int       r,
+    int       count)
+{
+    int p = s->slot[r];
+
+    for (int ii = 0; ii < count; ii++)
+    {
+        int q = s->slot[ii];
+        if (q == p)
+        {
+            continue;
+        }
+        if (s->sparse)
+        {
+            sparse_clear_slots(s, p, q);
+        }
+        else
+        {
+            dense_clear_slots(s, p, q);
+        }
+    }
+
+    if (s->sparse)
+    {
+        free(s->rows[p].slots);
+        memset(&s->rows[p], 0, sizeof(DccRow));
+    }
+    else
+    {
+        size_t pp = (size_t)p * s->n + p;
+        s->min[pp] = 0.0;
+        s->max[pp] = 0.0;
+        s->measured[pp] = 1;
+    }
+
+    memmove(&s->slot[r], &s->slot[r + 1], (size_t)(count - 1 - r) * sizeof(int));
+    s->slot[count - 1] = p;
+}
+
+/**
+ * dcc_store_bytes() - Heap footprint of the store.
+ * @s: Store.
+ *
+ * Return: Bytes held by the dense arrays or by the sparse rows and slots.
+ */
+size_t dcc_store_bytes(
+    const DccStore *s)
+{
+    size_t bytes = (size_t)s->n * sizeof(int);
+    if (!s->sparse)
+    {
+        return bytes + (size_t)s->n * s->n * (2 * sizeof(double) + sizeof(char));
+    }
+    bytes += (size_t)s->n * sizeof(DccRow);
+    for (int ii = 0; ii < s->n; ii++)
+    {
+        bytes += (size_t)s->rows[ii].cap * sizeof(DccEntry);
+    }
+    return bytes;
+}
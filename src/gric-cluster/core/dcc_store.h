@@ -0,0 +1,242 @@
+#ifndef DCC_STORE_H
+#define DCC_STORE_H
+
+/**
+ * @file dcc_store.h
+ * @brief Inter-cluster distance bound store (dense matrix or sparse rows).
+ *
+ * Holds dcc_min / dcc_max / dcc_measured for every cluster pair. Dense mode
+ * keeps the historical N x N arrays (unmeasured entries are -1). Sparse mode
+ * (-sparse_dcc) keeps one open-addressing hash row per cluster holding only
+ * pairs that were measured or tightened; absent pairs have the implicit
+ * bounds [0, DCC_UNBOUNDED] and the diagonal is implicitly exact at 0.
+ *
+ * Callers use logical cluster indices; the store maps them to stable
+ * physical slots so that removing a cluster only shifts the slot table.
+ * A pair is stored once, in the row of the smaller physical slot.
+ * Concurrent readers are safe; concurrent writers are safe as long as they
+ * touch distinct rows.
+ */
+
+#include <stddef.h>
+
+/** Upper bound of a sparse pair that has no finite bound yet. */
+#define DCC_UNBOUNDED 1e19
+
+/** One stored pair of a sparse row. */
+typedef struct
+{
+    double min;      /**< Lower distance bound */
+    double max;      /**< Upper distance bound */
+    int    col;      /**< Larger cluster index of the pair, -1 if the slot is empty */
+    char   measured; /**< 1 if exactly measured */
+} DccEntry;
+
+/** Sparse row: linear-probing hash table keyed by column. */
+typedef struct
+{
+    DccEntry *slots; /**< Hash slots, NULL until the first insertion */
+    int       cap;   /**< Slot count (power of two, or 0) */
+    int       count; /**< Occupied slots */
+} DccRow;
+
+/** Inter-cluster distance bounds for up to n clusters. */
+typedef struct
+{
+    int     n;        /**< Cluster capacity (maxnbclust) */
+    int     sparse;   /**< 1 for hashed rows, 0 for dense arrays */
+    double *min;      /**< Dense: n x n minimum bounds */
+    double *max;      /**< Dense: n x n maximum bounds */
+    char   *measured; /**< Dense: n x n exact-measurement flags */
+    DccRow *rows;     /**< Sparse: n rows */
+    int    *slot;     /**< Physical slot of each logical cluster index */
+} DccStore;
+
+/**
+ * @brief Allocate a store for @n clusters; returns 0 on success, -1 on failure.
+ */
+int dcc_store_init(
+    DccStore *s,
+    int       n,
+    int       sparse);
+
+/**
+ * @brief Release all memory held by @s.
+ */
+void dcc_store_free(
+    DccStore *s);
+
+/**
+ * @brief Forget all pairs (back to the state right after dcc_store_init()).
+ */
+void dcc_store_reset(
+    DccStore *s);
+
+/**
+ * @brief Raise the capacity to @new_n clusters, keeping existing pairs.
+ */
+int dcc_store_grow(
+    DccStore *s,
+    int       new_n);
+
+/**
+ * @brief Delete cluster @r of @count and shift higher indices down by one.
+ *
+ * Costs O(@count): the pairs of @r are cleared and its slot is parked at
+ * logical index @count - 1 for the next created cluster.
+ */
+void dcc_store_remove(
+    DccStore *s,
+    int       r,
+    int       count);
+
+/**
+ * @brief Heap bytes currently held by @s.
+ */
+size_t dcc_store_bytes(
+    const DccStore *s);
+
+/**
+ * @brief Set pair (@i, @j) to the exact distance @d (both directions).
+ */
+void dcc_set_exact(
+    DccStore *s,
+    int       i,
+    int       j,
+    double    d);
+
+/**
+ * @brief Set the lower bound of pair (@i, @j) (both directions).
+ */
+void dcc_set_min(
+    DccStore *s,
+    int       i,
+    int       j,
+    double    v);
+
+/**
+ * @brief Set the upper bound of pair (@i, @j) (both directions).
+ */
+void dcc_set_max(
+    DccStore *s,
+    int       i,
+    int       j,
+    double    v);
+
+/**
+ * @brief Return pair (@i, @j) to its unmeasured default.
+ */
+void dcc_clear_pair(
+    DccStore *s,
+    int       i,
+    int       j);
+
+/**
+ * @brief Home slot of column @col in a row of @cap slots.
+ */
+static inline int dcc_hash(
+    int col,
+    int cap)
+{
+    return (int)(((unsigned)col * 2654435761u) & (unsigned)(cap - 1));
+}
+
+/**
+ * @brief Stored entry of sparse pair (@pi, @pj) of physical slots, or NULL.
+ */
+static inline const DccEntry *dcc_find_slots(
+    const DccStore *s,
+    int             pi,
+    int             pj)
+{
+    int lo = (pi < pj) ? pi : pj;
+    int hi = (pi < pj) ? pj : pi;
+    const DccRow *row = &s->rows[lo];
+
+    if (row->count == 0)
+    {
+        return NULL;
+    }
+    int mask = row->cap - 1;
+    for (int h = dcc_hash(hi, row->cap); row->slots[h].col != -1; h = (h + 1) & mask)
+    {
+        if (row->slots[h].col == hi)
+        {
+            return &row->slots[h];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Stored entry of sparse pair (@i, @j), or NULL if absent.
+ */
+static inline const DccEntry *dcc_find(
+    const DccStore *s,
+    int             i,
+    int             j)
+{
+    return dcc_find_slots(s, s->slot[i], s->slot[j]);
+}
+
+/**
+ * @brief Lower distance bound of pair (@i, @j).
+ */
+static inline double dcc_get_min(
+    const DccStore *s,
+    int             i,
+    int             j)
+{
+    if (!s->sparse)
+    {
+        return s->min[(size_t)s->slot[i] * s->n + s->slot[j]];
+    }
+    if (i == j)
+    {
+        return 0.0;
+    }
+    const DccEntry *e = dcc_find(s, i, j);
+    return e ? e->min : 0.0;
+}
+
+/**
+ * @brief Upper distance bound of pair (@i, @j).
+ */
+static inline double dcc_get_max(
+    const DccStore *s,
+    int             i,
+    int             j)
+{
+    if (!s->sparse)
+    {
+        return s->max[(size_t)s->slot[i] * s->n + s->slot[j]];
+    }
+    if (i == j)
+    {
+        return 0.0;
+    }
+    const DccEntry *e = dcc_find(s, i, j);
+    return e ? e->max : DCC_UNBOUNDED;
+}
+
+/**
+ * @brief 1 if pair (@i, @j) was measured exactly.
+ */
+static inline int dcc_get_measured(
+    const DccStore *s,
+    int             i,
+    int             j)
+{
+    if (!s->sparse)
+    {
+        return s->measured[(size_t)s->slot[i] * s->n + s->slot[j]];
+    }
+    if (i == j)
+    {
+        return 1;
+    }
+    const DccEntry *e = dcc_find(s, i, j);
+    return e ? e->measured : 0;
+}
+
+#endif // DCC_STORE_H
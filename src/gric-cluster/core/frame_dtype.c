@@ -0,0 +1,291 @@
+/**
+ * @file frame_dtype.c
+ * @brief Frame pixel storage types and conversion helpers.
+ *
+ * Frames may store pixels as f64, f32, u16 or u8 (selected with -dtype).
+ * Narrow types reduce memory bandwidth in framedist() and the footprint of
+ * stored anchors; readers convert into the storage type once at ingest, and
+ * writers convert back to double where an output format requires it.
+ *
+ * Main Functions:
+ * - frame_dtype_size: Bytes per pixel.
+ * - frame_dtype_parse / frame_dtype_name: CLI name mapping.
+ * - frame_set / frame_store_doubles: Conversion into the storage type.
+ * - frame_as_double: Zero-copy (f64) or converted double view of a frame.
+ * - frame_take: Transfer (or copy borrowed) pixels into a frame that outlives the input.
+ */
+#include "frame_dtype.h"
+#include <math.h>
+#include <string.h>
+
+/**
+ * frame_dtype_size() - Size in bytes of one pixel.
+ * @dtype: Storage type.
+ *
+ * Return: Bytes per pixel.
+ */
+size_t frame_dtype_size(
+    FrameDType dtype)
+{
+    switch (dtype)
+    {
+    case FRAME_DTYPE_F32:
+        return sizeof(float);
+    case FRAME_DTYPE_U16:
+        return sizeof(uint16_t);
+    case FRAME_DTYPE_U8:
+        return sizeof(uint8_t);
+    default:
+        return sizeof(double);
+    }
+}
+
+/**
+ * frame_dtype_name() - Short name of a storage type.
+ * @dtype: Storage type.
+ *
+ * Return: Static string ("f64", "f32", "u16" or "u8").
+ */
+const char *frame_dtype_name(
+    FrameDType dtype)
+{
+    switch (dtype)
+    {
+    case FRAME_DTYPE_F32:
+        return "f32";
+    case FRAME_DTYPE_U16:
+        return "u16";
+    case FRAME_DTYPE_U8:
+        return "u8";
+    default:
+        return "f64";
+    }
+}
+
+/**
+ * frame_dtype_parse() - Parse a storage type name.
+ * @name:  Name as given on the command line.
+ * @dtype: Output storage type.
+ *
+ * Return: 0 on success, -1 if @name is not a known type.
+ */
+int frame_dtype_parse(
+    const char *name,
+    FrameDType *dtype)
+{
+    if (strcmp(name, "f64") == 0 || strcmp(name, "double") == 0)
+    {
+        *dtype = FRAME_DTYPE_F64;
+    }
+    else if (strcmp(name, "f32") == 0 || strcmp(name, "float") == 0)
+    {
+        *dtype = FRAME_DTYPE_F32;
+    }
+    else if (strcmp(name, "u16") == 0)
+    {
+        *dtype = FRAME_DTYPE_U16;
+    }
+    else if (strcmp(name, "u8") == 0)
+    {
+        *dtype = FRAME_DTYPE_U8;
+    }
+    else
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * clamp_round() - Round @v to the nearest integer within [0, @maxval].
+ */
+static inline double clamp_round(
+    double v,
+    double maxval)
+{
+    if (!(v > 0.0))
+    {
+        return 0.0;
+    }
+    if (v >= maxval)
+    {
+        return maxval;
+    }
+    return floor(v + 0.5);
+}
+
+/**
+ * frame_set() - Store a value into one pixel of a frame.
+ * @f:  Destination frame.
+ * @ii: Pixel index.
+ * @v:  Value; rounded and clamped when @f stores an integer type.
+ */
+void frame_set(
+    Frame *f,
+    long   ii,
+    double v)
+{
+    switch (f->dtype)
+    {
+    case FRAME_DTYPE_F32:
+        ((float *)f->data)[ii] = (float)v;
+        break;
+    case FRAME_DTYPE_U16:
+        ((uint16_t *)f->data)[ii] = (uint16_t)clamp_round(v, 65535.0);
+        break;
+    case FRAME_DTYPE_U8:
+        ((uint8_t *)f->data)[ii] = (uint8_t)clamp_round(v, 255.0);
+        break;
+    default:
+        ((double *)f->data)[ii] = v;
+        break;
+    }
+}
+
+/**
+ * frame_store_doubles() - Convert a double array into a typed pixel buffer.
+ * @dst:   Destination buffer of @n pixels of type @dtype.
+ * @dtype: Destination storage type.
+ * @src:   Source doubles.
+ * @n:     Number of pixels.
+ */
+void frame_store_doubles(
+    void         *dst,
+    FrameDType    dtype,
+    const double *src,
+    long          n)
+{
+    switch (dtype)
+    {
+    case FRAME_DTYPE_F32:
+    {
+        float *d = (float *)dst;
+        for (long ii = 0; ii < n; ii++)
+        {
+            d[ii] = (float)src[ii];
+        }
+        break;
+    }
+    case FRAME_DTYPE_U16:
+    {
+        uint16_t *d = (uint16_t *)dst;
+        for (long ii = 0; ii < n; ii++)
+        {
+            d[ii] = (uint16_t)clamp_round(src[ii], 65535.0);
+        }
+        break;
+    }
+    case FRAME_DTYPE_U8:
+    {
+        uint8_t *d = (uint8_t *)dst;
+        for (long ii = 0; ii < n; ii++)
+        {
+            d[ii] = (uint8_t)clamp_round(src[ii], 255.0);
+        }
+        break;
+    }
+    default:
+        if (dst != src)
+        {
+            memcpy(dst, src, (size_t)n * sizeof(double));
+        }
+        break;
+    }
+}
+
+/**
+ * frame_as_double() - Double view of a frame's pixels.
+ * @f:       Source frame.
+ * @scratch: Caller buffer of width*height doubles, used for non-f64 frames.
+ *
+ * Return: @f->data directly when the frame stores f64, otherwise @scratch
+ * filled with the converted pixels.
+ */
+const double *frame_as_double(
+    const Frame *f,
+    double      *scratch)
+{
+    long n = f->width * f->height;
+
+    switch (f->dtype)
+    {
+    case FRAME_DTYPE_F32:
+    {
+        const float *s = (const float *)f->data;
+        for (long ii = 0; ii < n; ii++)
+        {
+            scratch[ii] = (double)s[ii];
+        }
+        return scratch;
+    }
+    case FRAME_DTYPE_U16:
+    {
+        const uint16_t *s = (const uint16_t *)f->data;
+        for (long ii = 0; ii < n; ii++)
+        {
+            scratch[ii] = (double)s[ii];
+        }
+        return scratch;
+    }
+    case FRAME_DTYPE_U8:
+    {
+        const uint8_t *s = (const uint8_t *)f->data;
+        for (long ii = 0; ii < n; ii++)
+        {
+            scratch[ii] = (double)s[ii];
+        }
+        return scratch;
+    }
+    default:
+        return (const double *)f->data;
+    }
+}
+
+/**
+ * frame_take() - Give @dst ownership of the pixels of @src.
+ * @dst: Destination, typically a cluster anchor.
+ * @src: Frame returned by the reader; released later with free_frame().
+ *
+ * Owned buffers are moved (@src->data becomes NULL). Borrowed buffers
+ * (zero-copy stream slices) are copied, and @src keeps its reference so
+ * that free_frame() can still check the slice for overruns after the copy.
+ * Tile views are gathered span by span into a compact buffer.
+ *
+ * Return: 0 on success, -1 if the copy cannot be allocated.
+ */
+int frame_take(
+    Frame *dst,
+    Frame *src)
+{
+    *dst = *src;
+    if (!src->borrowed)
+    {
+        src->data = NULL;
+        return 0;
+    }
+
+    size_t esize  = frame_dtype_size(src->dtype);
+    size_t nbytes = (size_t)src->width * src->height * esize;
+    dst->data = malloc(nbytes);
+    dst->borrowed = 0;
+    dst->spans = NULL;
+    dst->num_spans = 0;
+    if (dst->data == NULL)
+    {
+        return -1;
+    }
+    if (frame_is_view(src))
+    {
+        char       *out = (char *)dst->data;
+        const char *in  = (const char *)src->data;
+        for (int ss = 0; ss < src->num_spans; ss++)
+        {
+            size_t len = (size_t)src->spans[ss].len * esize;
+            memcpy(out, in + (size_t)src->spans[ss].offset * esize, len);
+            out += len;
+        }
+        return 0;
+    }
+    memcpy(dst->data, src->data, nbytes);
+    return 0;
+}
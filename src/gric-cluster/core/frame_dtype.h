@@ -0,0 +1,94 @@
+#ifndef FRAME_DTYPE_H
+#define FRAME_DTYPE_H
+
+/**
+ * @file frame_dtype.h
+ * @brief Frame pixel storage types and conversion helpers.
+ */
+
+#include "common.h"
+#include <stddef.h>
+
+/**
+ * @brief Size in bytes of one pixel stored as @dtype.
+ */
+size_t frame_dtype_size(
+    FrameDType dtype);
+
+/**
+ * @brief Short name ("f64", "f32", "u16", "u8") of @dtype.
+ */
+const char *frame_dtype_name(
+    FrameDType dtype);
+
+/**
+ * @brief Parse a dtype name; returns 0 on success, -1 if unknown.
+ */
+int frame_dtype_parse(
+    const char *name,
+    FrameDType *dtype);
+
+/**
+ * @brief Read pixel @ii of @f as double.
+ */
+static inline double frame_get(
+    const Frame *f,
+    long         ii)
+{
+    switch (f->dtype)
+    {
+    case FRAME_DTYPE_F32:
+        return (double)((const float *)f->data)[ii];
+    case FRAME_DTYPE_U16:
+        return (double)((const uint16_t *)f->data)[ii];
+    case FRAME_DTYPE_U8:
+        return (double)((const uint8_t *)f->data)[ii];
+    default:
+        return ((const double *)f->data)[ii];
+    }
+}
+
+/**
+ * @brief Nonzero if @f is a tile view whose pixels are spans of a source frame.
+ *
+ * frame_get() on a view indexes the source frame; the distance functions and
+ * frame_take() follow the spans.
+ */
+static inline int frame_is_view(
+    const Frame *f)
+{
+    return f->borrowed == FRAME_BORROW_TILE && f->spans != NULL;
+}
+
+/**
+ * @brief Store @v into pixel @ii of @f (rounded and clamped for integer types).
+ */
+void frame_set(
+    Frame *f,
+    long   ii,
+    double v);
+
+/**
+ * @brief Convert @n doubles from @src into a buffer of type @dtype.
+ */
+void frame_store_doubles(
+    void         *dst,
+    FrameDType    dtype,
+    const double *src,
+    long          n);
+
+/**
+ * @brief Return the pixels of @f as doubles, converting into @scratch if needed.
+ */
+const double *frame_as_double(
+    const Frame *f,
+    double      *scratch);
+
+/**
+ * @brief Move the pixels of @src into @dst, copying them if @src borrows its buffer.
+ */
+int frame_take(
+    Frame *dst,
+    Frame *src);
+
+#endif // FRAME_DTYPE_H
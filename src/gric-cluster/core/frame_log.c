@@ -0,0 +1,170 @@
+/**
+ * @file frame_log.c
+ * @brief Append-only arena holding the per-frame measurement log.
+ *
+ * Chunks are filled front to back and linked oldest to newest; a frame's
+ * entries never straddle two chunks. Retiring frames releases whole chunks
+ * from the old end and keeps standard-size ones on a spare list, which the
+ * next append reuses before allocating.
+ *
+ * Main Functions:
+ * - frame_log_append: Hand out room for one frame's measurements.
+ * - frame_log_retire: Drop the measurements of frames before a given one.
+ * - frame_log_free: Release every chunk.
+ */
+#include "frame_log.h"
+#include <stdlib.h>
+
+/**
+ * chunk_new() - Take a spare chunk of at least @n entries, or allocate one.
+ * @log: Measurement log.
+ * @n:   Entries needed by the frame being appended.
+ *
+ * Return: Empty chunk, or NULL on allocation failure.
+ */
+static FrameLogChunk *chunk_new(
+    FrameLog *log,
+    int       n)
+{
+    FrameLogChunk *c = log->spare;
+    if (c != NULL && c->cap >= n)
+    {
+        log->spare = c->next;
+    }
+    else
+    {
+        int    cap   = (n > FRAME_LOG_CHUNK_ENTRIES) ? n : FRAME_LOG_CHUNK_ENTRIES;
+        size_t bytes = sizeof(FrameLogChunk) + (size_t)cap * (sizeof(double) + sizeof(int));
+        c = (FrameLogChunk *)malloc(bytes);
+        if (c == NULL)
+        {
+            return NULL;
+        }
+        c->distances = (double *)(c + 1);
+        c->indices   = (int *)(c->distances + cap);
+        c->cap       = cap;
+        log->bytes  += bytes;
+    }
+    c->next        = NULL;
+    c->used        = 0;
+    c->first_frame = -1;
+    c->last_frame  = -1;
+    return c;
+}
+
+/**
+ * frame_log_append() - Point @fi at room for @n entries of frame @frame.
+ * @log:   Measurement log.
+ * @fi:    Frame info of @frame; receives cluster_indices and distances.
+ * @frame: Frame index, not lower than any frame appended before.
+ * @n:     Entries to reserve (may be 0).
+ *
+ * Return: 0 on success, -1 on allocation failure (@fi untouched).
+ */
+int frame_log_append(
+    FrameLog  *log,
+    FrameInfo *fi,
+    long       frame,
+    int        n)
+{
+    FrameLogChunk *c = log->newest;
+    if (c == NULL || c->cap - c->used < n)
+    {
+        c = chunk_new(log, n);
+        if (c == NULL)
+        {
+            return -1;
+        }
+        if (log->newest != NULL)
+        {
+            log->newest->next = c;
+        }
+        else
+        {
+            log->oldest = c;
+        }
+        log->newest = c;
+    }
+
+    fi->distances       = c->distances + c->used;
+    fi->cluster_indices = c->indices + c->used;
+    c->used += n;
+    if (c->first_frame < 0)
+    {
+        c->first_frame = frame;
+    }
+    c->last_frame = frame;
+    return 0;
+}
+
+/**
+ * frame_log_retire() - Release the entries of every frame before @before.
+ * @log:    Measurement log.
+ * @infos:  Frame info array the log's entries belong to.
+ * @base:   Frame held in infos[0]; older frames are no longer in @infos.
+ * @before: First frame whose entries must stay available.
+ *
+ * Only chunks holding no frame at or after @before are released, so a few
+ * older frames may stay available. The chunk being filled is never
+ * released. Released frames get NULL pointers and zero measurements;
+ * standard-size chunks go to the spare list, larger ones are freed.
+ */
+void frame_log_retire(
+    FrameLog  *log,
+    FrameInfo *infos,
+    long       base,
+    long       before)
+{
+    while (log->oldest != NULL && log->oldest != log->newest &&
+           log->oldest->last_frame < before)
+    {
+        FrameLogChunk *c = log->oldest;
+        log->oldest = c->next;
+
+        long f = (c->first_frame > base) ? c->first_frame : base;
+        for (; c->first_frame >= 0 && f <= c->last_frame; f++)
+        {
+            infos[f - base].cluster_indices = NULL;
+            infos[f - base].distances       = NULL;
+            infos[f - base].num_dists       = 0;
+        }
+        log->retired = c->last_frame + 1;
+
+        if (c->cap == FRAME_LOG_CHUNK_ENTRIES)
+        {
+            c->next    = log->spare;
+            log->spare = c;
+        }
+        else
+        {
+            log->bytes -= sizeof(FrameLogChunk) +
+                          (size_t)c->cap * (sizeof(double) + sizeof(int));
+            free(c);
+        }
+    }
+}
+
+/**
+ * frame_log_free() - Free every chunk of @log.
+ * @log: Measurement log; left zeroed (empty).
+ */
+void frame_log_free(
+    FrameLog *log)
+{
+    FrameLogChunk *lists[2] = {log->oldest, log->spare};
+    for (int ii = 0; ii < 2; ii++)
+    {
+        FrameLogChunk *c = lists[ii];
+        while (c != NULL)
+        {
+            FrameLogChunk *next = c->next;
+            free(c);
+            c = next;
+        }
+    }
+    log->oldest  = NULL;
+    log->newest  = NULL;
+    log->spare   = NULL;
+    log->bytes   = 0;
+    log->retired = 0;
+}
@@ -0,0 +1,76 @@
+#ifndef FRAME_LOG_H
+#define FRAME_LOG_H
+
+/**
+ * @file frame_log.h
+ * @brief Append-only arena holding the per-frame measurement log.
+ *
+ * With -gprob or -predf every frame keeps the clusters it was measured
+ * against and the distances found (FrameInfo.cluster_indices/distances).
+ * Instead of two heap blocks per frame, the entries are appended to large
+ * chunks (distances and indices stored as separate arrays) and FrameInfo
+ * points into them. With a retention window, chunks whose frames all fell
+ * out of the window are detached from their frames and reused, so memory
+ * stays bounded and steady-state recording does not allocate.
+ */
+
+#include "common.h"
+#include <stddef.h>
+
+/** Entries per chunk (a larger chunk is made for a frame that needs more). */
+#define FRAME_LOG_CHUNK_ENTRIES 16384
+
+/** One arena chunk; distances and indices follow the header in one block. */
+typedef struct FrameLogChunk
+{
+    struct FrameLogChunk *next;        /**< Next (newer) chunk, or next spare */
+    double               *distances;   /**< cap distances */
+    int                  *indices;     /**< cap cluster indices */
+    int                   cap;         /**< Entries allocated */
+    int                   used;        /**< Entries handed out */
+    long                  first_frame; /**< First frame with entries here, -1 if none */
+    long                  last_frame;  /**< Last frame with entries here */
+} FrameLogChunk;
+
+/** Chunked measurement log of one ClusterState (zero-initialized = empty). */
+typedef struct
+{
+    FrameLogChunk *oldest;     /**< Oldest live chunk */
+    FrameLogChunk *newest;     /**< Chunk being filled */
+    FrameLogChunk *spare;      /**< Retired chunks kept for reuse */
+    size_t         bytes;      /**< Bytes allocated (live and spare chunks) */
+    long           retired;    /**< Frames before this one have no entries left */
+} FrameLog;
+
+/**
+ * @brief Point @fi at room for @n entries of frame @frame; returns 0 on success, -1 on failure.
+ *
+ * Frames must be appended in increasing order. On failure @fi is left untouched.
+ */
+int frame_log_append(
+    FrameLog  *log,
+    FrameInfo *fi,
+    long       frame,
+    int        n);
+
+/**
+ * @brief Release the entries of every frame before @before (whole chunks only).
+ *
+ * The released frames of @infos (holding frames from @base on) get NULL
+ * pointers and no measurements.
+ */
+void frame_log_retire(
+    FrameLog  *log,
+    FrameInfo *infos,
+    long       base,
+    long       before);
+
+/**
+ * @brief Free every chunk of @log; left zeroed (empty).
+ *
+ * FrameInfo entries still pointing into the log become dangling.
+ */
+void frame_log_free(
+    FrameLog *log);
+
+#endif // FRAME_LOG_H
@@ -0,0 +1,645 @@
+/**
+ * @file knn_online.c
+ * @brief Online k-nearest-neighbor index of the past frames (-knn k).
+ *
+ * Every assigned frame is searched against the frames before it, then
+ * added to the group of its cluster. The search is the three-level pruning
+ * of gric-knn on the live clustering state:
+ * 1. Groups are ranked by max(0, dcc_min(home, g) - r_home - radius(g));
+ *    once that bound reaches tau the remaining groups are skipped.
+ * 2. The query-to-anchor distance of a group (taken from the step's exact
+ *    measurements when available) gives d - radius(g).
+ * 3. Members outside the annulus |d(q, anchor) - r(member)| < tau are
+ *    skipped; the others are measured exactly.
+ *
+ * Main Functions:
+ * - knn_online_open: Start the index and its output file.
+ * - knn_online_frame: Search, write and index one frame.
+ * - knn_online_remove_cluster: Follow a cluster removal.
+ * - knn_online_close: Print statistics and release the index.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "knn_online.h"
+#include "frame_dtype.h"
+#include "framedistance.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * copy_frame() - Copy the pixels of @src into @dst, reusing its buffer.
+ * @dst: Destination owned by the index (zeroed or a previous copy).
+ * @src: Frame to copy; tile views are gathered span by span.
+ *
+ * Return: 0 on success, -1 if the buffer cannot be allocated.
+ */
+static int copy_frame(
+    Frame       *dst,
+    const Frame *src)
+{
+    size_t esize  = frame_dtype_size(src->dtype);
+    size_t nbytes = (size_t)src->width * src->height * esize;
+    size_t have   = (dst->data != NULL) ?
+                    (size_t)dst->width * dst->height * frame_dtype_size(dst->dtype) : 0;
+
+    if (have != nbytes)
+    {
+        free(dst->data);
+        dst->data = malloc(nbytes);
+        if (dst->data == NULL)
+        {
+            memset(dst, 0, sizeof(*dst));
+            return -1;
+        }
+    }
+    void *data = dst->data;
+    *dst = *src;
+    dst->data = data;
+    dst->borrowed = FRAME_OWNED;
+    dst->spans = NULL;
+    dst->num_spans = 0;
+
+    if (frame_is_view(src))
+    {
+        char       *out = (char *)dst->data;
+        const char *in  = (const char *)src->data;
+        for (int ss = 0; ss < src->num_spans; ss++)
+        {
+            size_t len = (size_t)src->spans[ss].len * esize;
+            memcpy(out, in + (size_t)src->spans[ss].offset * esize, len);
+            out += len;
+        }
+        return 0;
+    }
+    memcpy(dst->data, src->data, nbytes);
+    return 0;
+}
+
+/**
+ * payload_slot() - Retained copy of frame @f.
+ * @kn: Index.
+ * @f:  Frame index.
+ *
+ * Return: Slot of @f in the payload array.
+ */
+static inline Frame *payload_slot(
+    KnnOnline *kn,
+    long       f)
+{
+    return &kn->payload[(kn->window > 0) ? f % kn->slots : f];
+}
+
+/**
+ * heap_push() - Offer neighbor @f at distance @d to the k-NN max-heap.
+ * @kn: Index.
+ * @f:  Candidate frame.
+ * @d:  Its distance to the query.
+ */
+static void heap_push(
+    KnnOnline *kn,
+    long       f,
+    double     d)
+{
+    long   *hf = kn->heap_frame;
+    double *hd = kn->heap_dist;
+    int     ii;
+
+    if (kn->heap_count < kn->k)
+    {
+        ii = kn->heap_count++;
+        while (ii > 0 && hd[(ii - 1) / 2] < d)
+        {
+            hf[ii] = hf[(ii - 1) / 2];
+            hd[ii] = hd[(ii - 1) / 2];
+            ii = (ii - 1) / 2;
+        }
+        hf[ii] = f;
+        hd[ii] = d;
+        return;
+    }
+    if (d >= hd[0])
+    {
+        return;
+    }
+    ii = 0;
+    for (;;)
+    {
+        int child = 2 * ii + 1;
+        if (child >= kn->k)
+        {
+            break;
+        }
+        if (child + 1 < kn->k && hd[child + 1] > hd[child])
+        {
+            child++;
+        }
+        if (hd[child] <= d)
+        {
+            break;
+        }
+        hf[ii] = hf[child];
+        hd[ii] = hd[child];
+        ii = child;
+    }
+    hf[ii] = f;
+    hd[ii] = d;
+}
+
+/**
+ * heap_tau() - Distance a candidate must beat to enter the k-NN heap.
+ * @kn: Index.
+ *
+ * Return: Largest neighbor distance, or INFINITY while fewer than k are held.
+ */
+static inline double heap_tau(
+    const KnnOnline *kn)
+{
+    return (kn->heap_count < kn->k) ? INFINITY : kn->heap_dist[0];
+}
+
+/**
+ * compare_scores() - Sort groups by ascending lower bound.
+ * @a: Pointer to first KnnOnlineScore.
+ * @b: Pointer to second KnnOnlineScore.
+ *
+ * Return: -1, 0 or 1.
+ */
+static int compare_scores(
+    const void *a,
+    const void *b)
+{
+    const KnnOnlineScore *sa = (const KnnOnlineScore *)a;
+    const KnnOnlineScore *sb = (const KnnOnlineScore *)b;
+    if (sa->lb != sb->lb)
+    {
+        return (sa->lb < sb->lb) ? -1 : 1;
+    }
+    return sa->group - sb->group;
+}
+
+/**
+ * sync_groups() - Give a group to every cluster created since the last frame.
+ * @kn:    Index.
+ * @state: Clustering state.
+ *
+ * Clusters are only ever appended, and removals are followed by
+ * knn_online_remove_cluster(), so the clusters without a group are the last
+ * ones. Each new group holds a copy of its cluster's anchor.
+ *
+ * Return: 0 on success, -1 on allocation failure.
+ */
+static int sync_groups(
+    KnnOnline    *kn,
+    ClusterState *state)
+{
+    while (kn->num_mapped < state->num_clusters)
+    {
+        if (kn->num_mapped == kn->clusters_cap)
+        {
+            int  cap = (kn->clusters_cap > 0) ? 2 * kn->clusters_cap : 64;
+            int *map = (int *)realloc(kn->group_of, (size_t)cap * sizeof(int));
+            if (map == NULL)
+            {
+                return -1;
+            }
+            kn->group_of = map;
+            kn->clusters_cap = cap;
+        }
+        if (kn->num_groups == kn->groups_cap)
+        {
+            int cap = (kn->groups_cap > 0) ? 2 * kn->groups_cap : 64;
+            KnnOnlineGroup *groups =
+                (KnnOnlineGroup *)realloc(kn->groups, (size_t)cap * sizeof(KnnOnlineGroup));
+            if (groups == NULL)
+            {
+                return -1;
+            }
+            kn->groups = groups;
+            int            *cl = (int *)realloc(kn->cluster_of, (size_t)cap * sizeof(int));
+            double         *ad = (double *)realloc(kn->anchor_dist, (size_t)cap * sizeof(double));
+            KnnOnlineScore *order =
+                (KnnOnlineScore *)realloc(kn->order, (size_t)cap * sizeof(KnnOnlineScore));
+            kn->cluster_of = cl ? cl : kn->cluster_of;
+            kn->anchor_dist = ad ? ad : kn->anchor_dist;
+            kn->order = order ? order : kn->order;
+            if (cl == NULL || ad == NULL || order == NULL)
+            {
+                return -1;
+            }
+            kn->groups_cap = cap;
+        }
+
+        int             c = kn->num_mapped;
+        int             g = kn->num_groups;
+        KnnOnlineGroup *grp = &kn->groups[g];
+        memset(grp, 0, sizeof(*grp));
+        if (copy_frame(&grp->anchor, &state->clusters[c].anchor) != 0)
+        {
+            return -1;
+        }
+        kn->cluster_of[g] = c;
+        kn->group_of[c] = g;
+        kn->num_groups++;
+        kn->num_mapped++;
+    } // while (kn->num_mapped < state->num_clusters)
+    return 0;
+}
+
+/**
+ * scan_group() - Annular filter and exact distances over the members of a group.
+ * @kn:       Index.
+ * @g:        Group.
+ * @query:    Query frame.
+ * @r_center: Query distance to the group's anchor.
+ * @oldest:   Oldest frame still searched.
+ */
+static void scan_group(
+    KnnOnline   *kn,
+    int          g,
+    const Frame *query,
+    double       r_center,
+    long         oldest)
+{
+    KnnOnlineGroup *grp = &kn->groups[g];
+
+    while (grp->start < grp->count && grp->frame[grp->start] < oldest)
+    {
+        grp->start++;
+    }
+    for (int m = grp->start; m < grp->count; m++)
+    {
+        if (fabs(r_center - grp->r[m]) >= heap_tau(kn))
+        {
+            kn->members_pruned++;
+            continue;
+        }
+        double d = framedist((Frame *)query, payload_slot(kn, grp->frame[m]));
+        kn->dists++;
+        if (d >= 0.0)
+        {
+            heap_push(kn, grp->frame[m], d);
+        }
+    }
+}
+
+/**
+ * add_member() - Append frame @f at distance @r to group @g.
+ * @kn: Index.
+ * @g:  Group.
+ * @f:  Frame.
+ * @r:  Its distance to the group's anchor.
+ *
+ * Members that left the window are dropped from the front once they make
+ * up half of the list.
+ *
+ * Return: 0 on success, -1 on allocation failure.
+ */
+static int add_member(
+    KnnOnline *kn,
+    int        g,
+    long       f,
+    double     r)
+{
+    KnnOnlineGroup *grp = &kn->groups[g];
+
+    if (grp->count == grp->cap && grp->start > grp->count / 2)
+    {
+        grp->count -= grp->start;
+        memmove(grp->frame, grp->frame + grp->start, (size_t)grp->count * sizeof(long));
+        memmove(grp->r, grp->r + grp->start, (size_t)grp->count * sizeof(double));
+        grp->start = 0;
+    }
+    if (grp->count == grp->cap)
+    {
+        int     cap = (grp->cap > 0) ? 2 * grp->cap : 16;
+        long   *fr = (long *)realloc(grp->frame, (size_t)cap * sizeof(long));
+        double *rr = (double *)realloc(grp->r, (size_t)cap * sizeof(double));
+        grp->frame = fr ? fr : grp->frame;
+        grp->r = rr ? rr : grp->r;
+        if (fr == NULL || rr == NULL)
+        {
+            return -1;
+        }
+        grp->cap = cap;
+    }
+    grp->frame[grp->count] = f;
+    grp->r[grp->count] = r;
+    grp->count++;
+    if (r > grp->radius)
+    {
+        grp->radius = r;
+    }
+    return 0;
+}
+
+/**
+ * write_row() - Write the neighbors held in the heap for frame @f.
+ * @kn: Index.
+ * @f:  Query frame.
+ *
+ * Neighbors are written nearest first; missing ones as -1.
+ */
+static void write_row(
+    KnnOnline *kn,
+    long       f)
+{
+    int n = kn->heap_count;
+
+    /* Heap order to ascending distance (k is small) */
+    for (int ii = 1; ii < n; ii++)
+    {
+        long   hf = kn->heap_frame[ii];
+        double hd = kn->heap_dist[ii];
+        int    jj = ii - 1;
+        while (jj >= 0 && kn->heap_dist[jj] > hd)
+        {
+            kn->heap_frame[jj + 1] = kn->heap_frame[jj];
+            kn->heap_dist[jj + 1] = kn->heap_dist[jj];
+            jj--;
+        }
+        kn->heap_frame[jj + 1] = hf;
+        kn->heap_dist[jj + 1] = hd;
+    }
+
+    fprintf(kn->out, "%-8ld", f);
+    for (int ii = 0; ii < kn->k; ii++)
+    {
+        if (ii < n)
+        {
+            fprintf(kn->out, "  %-8ld %12.6f", kn->heap_frame[ii], kn->heap_dist[ii]);
+        }
+        else
+        {
+            fprintf(kn->out, "  %-8d %12.6f", -1, -1.0);
+        }
+    }
+    fprintf(kn->out, "\n");
+    if (kn->flush)
+    {
+        fflush(kn->out);
+    }
+}
+
+/**
+ * knn_online_open() - Start an index of @k neighbors writing to @path.
+ * @kn:     Index to initialize.
+ * @path:   Output file.
+ * @k:      Neighbors per frame.
+ * @window: Frames searched (0 = all past frames).
+ * @flush:  1 to flush every line.
+ *
+ * Return: 0 on success, -1 on failure (@kn is left zeroed).
+ */
+int knn_online_open(
+    KnnOnline  *kn,
+    const char *path,
+    int         k,
+    long        window,
+    int         flush)
+{
+    memset(kn, 0, sizeof(*kn));
+    kn->k = k;
+    kn->window = window;
+    kn->flush = flush;
+    kn->heap_frame = (long *)malloc((size_t)k * sizeof(long));
+    kn->heap_dist = (double *)malloc((size_t)k * sizeof(double));
+    if (window > 0)
+    {
+        kn->slots = window;
+        kn->payload = (Frame *)calloc((size_t)window, sizeof(Frame));
+    }
+    kn->out = fopen(path, "w");
+    if (kn->out == NULL || kn->heap_frame == NULL || kn->heap_dist == NULL
+        || (window > 0 && kn->payload == NULL))
+    {
+        fprintf(stderr, "ERROR: [%s:%d] cannot start online k-NN index %s\n", __FILE__,
+                __LINE__, path);
+        if (kn->out)
+        {
+            fclose(kn->out);
+            kn->out = NULL;
+        }
+        knn_online_close(kn);
+        return -1;
+    }
+    fprintf(kn->out, "# gric-cluster online k-NN: k = %d, past frames%s\n", k,
+            (window > 0) ? " in the -history window" : "");
+    fprintf(kn->out, "# Columns: query_frame_id  [neighbor_1 dist_1  neighbor_2 dist_2 ...]\n");
+    return 0;
+}
+
+/**
+ * knn_online_frame() - Search, write and index frame @frame_idx.
+ * @kn:        Index.
+ * @state:     Clustering state (clusters, dcc bounds, step flags).
+ * @frame_idx: Frame index.
+ * @frame:     Frame just assigned.
+ * @cluster:   Cluster it was assigned to.
+ * @dist:      Its distance to that cluster's anchor.
+ * @indices:   Clusters measured by the step.
+ * @dists:     Their distances (exact unless flagged in dist_lower_bound).
+ * @count:     Entries in @indices.
+ *
+ * The step's measurements are only used as anchor distances when no
+ * cluster was removed during the step, since a removal renumbers the
+ * clusters after the measurements were taken.
+ */
+void knn_online_frame(
+    KnnOnline    *kn,
+    ClusterState *state,
+    long          frame_idx,
+    const Frame  *frame,
+    int           cluster,
+    double        dist,
+    const int    *indices,
+    const double *dists,
+    int           count)
+{
+    if (sync_groups(kn, state) != 0)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] online k-NN index allocation failed\n", __FILE__,
+                __LINE__);
+        return;
+    }
+
+    /* A frame that created its cluster handed its pixels to the anchor */
+    const Frame *query = frame;
+    if (query->data == NULL && cluster >= 0 && cluster < state->num_clusters)
+    {
+        query = &state->clusters[cluster].anchor;
+    }
+    if (query->data == NULL)
+    {
+        return;
+    }
+
+    long oldest = (kn->window > 0 && frame_idx > kn->window) ? frame_idx - kn->window : 0;
+    int  home = (cluster >= 0 && cluster < kn->num_mapped) ? kn->group_of[cluster] : -1;
+    kn->heap_count = 0;
+
+    for (int g = 0; g < kn->num_groups; g++)
+    {
+        kn->anchor_dist[g] = -1.0;
+    }
+    if (state->scratch.visitor_shift_stamp != frame_idx + 1)
+    {
+        for (int ii = 0; ii < count; ii++)
+        {
+            if (!state->scratch.dist_lower_bound[ii] && indices[ii] >= 0
+                && indices[ii] < kn->num_mapped)
+            {
+                kn->anchor_dist[kn->group_of[indices[ii]]] = dists[ii];
+            }
+        }
+    }
+
+    // Home cluster first: its members are the likeliest neighbors
+    if (home >= 0)
+    {
+        scan_group(kn, home, query, dist, oldest);
+    }
+
+    // Level 1: rank the other groups by their dcc lower bound
+    int nscores = 0;
+    for (int g = 0; g < kn->num_groups; g++)
+    {
+        KnnOnlineGroup *grp = &kn->groups[g];
+        if (g == home || grp->count == 0 || grp->frame[grp->count - 1] < oldest)
+        {
+            continue;
+        }
+        double lb = 0.0;
+        if (home >= 0 && kn->cluster_of[g] >= 0)
+        {
+            lb = dcc_get_min(&state->scratch.dcc, cluster, kn->cluster_of[g]) - dist
+                 - grp->radius;
+        }
+        kn->order[nscores].group = g;
+        kn->order[nscores].lb = (lb > 0.0) ? lb : 0.0;
+        nscores++;
+    }
+    qsort(kn->order, (size_t)nscores, sizeof(KnnOnlineScore), compare_scores);
+
+    for (int ii = 0; ii < nscores; ii++)
+    {
+        if (kn->order[ii].lb >= heap_tau(kn))
+        {
+            kn->groups_pruned += nscores - ii;
+            break;
+        }
+
+        // Level 2: query-to-anchor distance
+        int             g = kn->order[ii].group;
+        KnnOnlineGroup *grp = &kn->groups[g];
+        double          d_anchor = kn->anchor_dist[g];
+        if (d_anchor < 0.0)
+        {
+            d_anchor = framedist((Frame *)query, &grp->anchor);
+            kn->dists++;
+            if (d_anchor < 0.0)
+            {
+                continue;
+            }
+        }
+        if (d_anchor - grp->radius >= heap_tau(kn))
+        {
+            kn->groups_pruned++;
+            continue;
+        }
+
+        // Level 3 and 4: annular member filter, then exact distances
+        scan_group(kn, g, query, d_anchor, oldest);
+    } // for (int ii = 0; ...)
+
+    write_row(kn, frame_idx);
+
+    /* Index the frame for the frames after it */
+    if (kn->window <= 0 && frame_idx >= kn->slots)
+    {
+        long   slots = (kn->slots > 0) ? 2 * kn->slots : 1024;
+        while (slots <= frame_idx)
+        {
+            slots *= 2;
+        }
+        Frame *payload = (Frame *)realloc(kn->payload, (size_t)slots * sizeof(Frame));
+        if (payload == NULL)
+        {
+            fprintf(stderr, "ERROR: [%s:%d] online k-NN index allocation failed\n", __FILE__,
+                    __LINE__);
+            return;
+        }
+        memset(payload + kn->slots, 0, (size_t)(slots - kn->slots) * sizeof(Frame));
+        kn->payload = payload;
+        kn->slots = slots;
+    }
+    if (home < 0 || copy_frame(payload_slot(kn, frame_idx), query) != 0
+        || add_member(kn, home, frame_idx, dist) != 0)
+    {
+        return;
+    }
+    kn->num_frames = frame_idx + 1;
+}
+
+/**
+ * knn_online_remove_cluster() - Follow the removal of cluster @index.
+ * @kn:    Index.
+ * @index: Cluster index being removed; later clusters shift down by one.
+ *
+ * The cluster's group stays in the index: its anchor copy and member
+ * distances still bound the search, only without the dcc bound.
+ */
+void knn_online_remove_cluster(
+    KnnOnline *kn,
+    int        index)
+{
+    if (index < 0 || index >= kn->num_mapped)
+    {
+        return;
+    }
+    kn->cluster_of[kn->group_of[index]] = -1;
+    for (int c = index + 1; c < kn->num_mapped; c++)
+    {
+        kn->group_of[c - 1] = kn->group_of[c];
+        kn->cluster_of[kn->group_of[c - 1]] = c - 1;
+    }
+    kn->num_mapped--;
+}
+
+/**
+ * knn_online_close() - Close the output, print the search statistics, release the index.
+ * @kn: Index; left zeroed.
+ */
+void knn_online_close(
+    KnnOnline *kn)
+{
+    if (kn->out)
+    {
+        fclose(kn->out);
+        long   n = kn->num_frames;
+        long   w = (kn->window > 0 && kn->window < n) ? kn->window : n;
+        double brute = 0.5 * (double)w * (double)(w - 1) + (double)(n - w) * (double)w;
+        printf("Online k-NN (k = %d): %ld distances for %ld frames (%.2f%% of brute force), "
+               "%ld groups and %ld members pruned\n",
+               kn->k, kn->dists, n, (brute > 0.0) ? 100.0 * (double)kn->dists / brute : 0.0,
+               kn->groups_pruned, kn->members_pruned);
+    }
+    for (int g = 0; g < kn->num_groups; g++)
+    {
+        free(kn->groups[g].anchor.data);
+        free(kn->groups[g].frame);
+        free(kn->groups[g].r);
+    }
+    for (long f = 0; f < kn->slots; f++)
+    {
+        free(kn->payload[f].data);
+    }
+    free(kn->payload);
+    free(kn->groups);
+    free(kn->group_of);
+    free(kn->cluster_of);
+    free(kn->anchor_dist);
+    free(kn->order);
+    free(kn->heap_frame);
+    free(kn->heap_dist);
+    memset(kn, 0, sizeof(*kn));
+}
@@ -0,0 +1,117 @@
+#ifndef KNN_ONLINE_H
+#define KNN_ONLINE_H
+
+/**
+ * @file knn_online.h
+ * @brief Online k-nearest-neighbor index of the past frames (-knn k).
+ *
+ * While frames are clustered, each cluster's members are kept with their
+ * distance to the cluster anchor (the assignment distance) together with a
+ * copy of every frame. Each new frame is then searched against the frames
+ * before it with the pruning of gric-knn: clusters whose inter-cluster
+ * lower bound (dcc) or anchor distance rules them out are skipped, then
+ * members outside the annulus |d(q, anchor) - r(member)| < tau. Results are
+ * written to knn_online.txt as the frames are assigned, so no offline
+ * gric-knn pass is needed.
+ *
+ * The index follows the cluster lifecycle: a removed cluster keeps its
+ * group (anchor copy and members), which is still searched without the
+ * dcc bound. With -history N only the last N frames are kept and searched.
+ */
+
+#include "cluster_defs.h"
+
+/** Output file name inside the output directory. */
+#define KNN_ONLINE_FILE "knn_online.txt"
+
+/** Members of one cluster as seen by the index. */
+typedef struct
+{
+    Frame   anchor; /**< Copy of the cluster anchor */
+    double  radius; /**< Largest member-to-anchor distance recorded */
+    long   *frame;  /**< Member frames, oldest first */
+    double *r;      /**< Member-to-anchor distances */
+    int     start;  /**< First member still in the window */
+    int     count;  /**< Members recorded */
+    int     cap;    /**< Members allocated */
+} KnnOnlineGroup;
+
+/** Group with the lower bound of its distance to the query. */
+typedef struct
+{
+    int    group; /**< Group */
+    double lb;    /**< Lower bound on the query distance to its members */
+} KnnOnlineScore;
+
+/** Online k-NN index and search scratch. */
+typedef struct KnnOnline
+{
+    int             k;          /**< Neighbors per frame */
+    FILE           *out;        /**< knn_online.txt */
+    int             flush;      /**< 1 to flush every line (stream input) */
+    long            window;     /**< Frames searched (0 = all past frames) */
+    Frame          *payload;    /**< Retained frames; frame f at f % slots (or f) */
+    long            slots;      /**< Entries of payload */
+    long            num_frames; /**< Frames inserted (last frame + 1) */
+    KnnOnlineGroup *groups;     /**< One group per cluster ever created */
+    int             num_groups;
+    int             groups_cap;
+    int            *group_of;   /**< Per cluster index: its group */
+    int            *cluster_of; /**< Per group: its cluster index, -1 once removed */
+    int             num_mapped; /**< Cluster indices with a group */
+    int             clusters_cap;
+    double         *anchor_dist; /**< Per group: query-to-anchor distance, -1 if unknown */
+    KnnOnlineScore *order;       /**< Search order scratch, one entry per group */
+    long           *heap_frame;  /**< Neighbor max-heap: frames */
+    double         *heap_dist;   /**< Neighbor max-heap: distances */
+    int             heap_count;
+    long            dists;          /**< Frame distances evaluated by the search */
+    long            groups_pruned;  /**< Groups skipped by the dcc or anchor bound */
+    long            members_pruned; /**< Members skipped by the annular bound */
+} KnnOnline;
+
+/**
+ * @brief Start an index of @k neighbors writing to @path; returns 0 on success.
+ *
+ * @window frames are searched (0 = all past frames); @flush flushes every line.
+ */
+int knn_online_open(
+    KnnOnline  *kn,
+    const char *path,
+    int         k,
+    long        window,
+    int         flush);
+
+/**
+ * @brief Search the neighbors of frame @frame_idx, write them, then index it.
+ *
+ * Frames come in increasing order. @frame is the assigned frame (its pixels
+ * may have moved into the anchor of a cluster it created); @cluster and @dist
+ * are its assignment. The exact measurements of the step (@indices, @dists,
+ * @count) stand in for anchor distances.
+ */
+void knn_online_frame(
+    KnnOnline    *kn,
+    ClusterState *state,
+    long          frame_idx,
+    const Frame  *frame,
+    int           cluster,
+    double        dist,
+    const int    *indices,
+    const double *dists,
+    int           count);
+
+/**
+ * @brief Follow the removal of cluster @index (remove_cluster()).
+ */
+void knn_online_remove_cluster(
+    KnnOnline *kn,
+    int        index);
+
+/**
+ * @brief Close the output, print the search statistics and release the index.
+ */
+void knn_online_close(
+    KnnOnline *kn);
+
+#endif // KNN_ONLINE_H
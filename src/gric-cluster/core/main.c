@@ -15,7 +15,9 @@
 #include "cluster_scandist.h"
 #include "config_utils.h"
 #include "cluster_shm.h"
+#include "cluster_steps.h"
 #include "frameread.h"
+#include "shared/dist_kernels.h"
 #include <ctype.h>
 #include <signal.h>
 #include <stdio.h>
@@ -48,6 +50,7 @@ int main(int argc, char *argv[])
 {
     init_colors_io();
     init_colors_help();
+    dist_kernels_init();
     struct timespec prog_start;
     clock_gettime(CLOCK_REALTIME, &prog_start);
 
@@ -123,6 +126,8 @@ int main(int argc, char *argv[])
     config.optim.entropy_leader_cutoff = 0.50;
     config.optim.sparse_dcc_mode = 0;
     config.optim.sparse_dcc_extra_evals = 0;
+    config.optim.abandon_factor = 0.0;
+    config.optim.pred_batch = 0;
     config.optim.soft_bayesian_mode = 0;
     config.optim.soft_bayesian_sigma_coeff = 1.0;
     config.optim.disable_pass2 = 1;
@@ -145,6 +150,8 @@ int main(int argc, char *argv[])
     config.output.output_discarded = 0;
     config.output.output_clustered = 0;
     config.output.output_clusters = 0;
+    config.output.output_gricres = 0;
+    config.output.knn_k = 0;
 
     int arg_idx = 1;
     int rlim_set = 0;
@@ -291,6 +298,9 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    set_frameread_dtype(config.input.frame_dtype);
+    set_frameread_zerocopy(config.input.stream_zerocopy);
+    set_frameread_gricbin(config.input.write_gricbin);
     if (init_frameread(config.input.fits_filename,
                        config.input.stream_input_mode,
                        config.input.cnt2sync_mode,
@@ -397,53 +407,26 @@ int main(int argc, char *argv[])
 
     // Allocate State
     size_t max_clusters = (size_t)config.algo.maxnbclust;
-    size_t cluster_pairs = max_clusters * max_clusters;
-    /* Number of 64-bit words in the consistency bitmask per cluster pair */
-    int words = (config.algo.maxnbclust + 63) / 64;
-    size_t consistency_words = cluster_pairs * (size_t)words;
 
     state.clusters = (Cluster *)malloc(max_clusters * sizeof(Cluster));
-    state.scratch.dcc_min = (double *)malloc(cluster_pairs * sizeof(double));
-    state.scratch.dcc_max = (double *)malloc(cluster_pairs * sizeof(double));
-    state.scratch.dcc_measured = (char *)malloc(cluster_pairs * sizeof(char));
-
-    if (config.optim.sparse_dcc_mode)
+    if (dcc_store_init(&state.scratch.dcc, config.algo.maxnbclust,
+                       config.optim.sparse_dcc_mode) != 0)
     {
-        for (size_t r = 0; r < max_clusters; r++)
-        {
-            for (size_t c = 0; c < max_clusters; c++)
-            {
-                size_t idx = r * max_clusters + c;
-                if (r == c)
-                {
-                    state.scratch.dcc_min[idx] = 0.0;
-                    state.scratch.dcc_max[idx] = 0.0;
-                    state.scratch.dcc_measured[idx] = 1;
-                }
-                else
-                {
-                    state.scratch.dcc_min[idx] = 0.0;
-                    state.scratch.dcc_max[idx] = 1e19;
-                    state.scratch.dcc_measured[idx] = 0;
-                }
-            }
-        }
+        fprintf(stderr, "ERROR: [%s:%d] cannot allocate DCC bounds for %d clusters\n",
+                __FILE__, __LINE__, config.algo.maxnbclust);
+        return 1;
     }
-    else
+    if (consistency_cache_init(&state.scratch.consistency, config.algo.maxnbclust) != 0)
     {
-        for (size_t ii = 0; ii < cluster_pairs; ii++)
-        {
-            state.scratch.dcc_min[ii] = -1.0;
-            state.scratch.dcc_max[ii] = -1.0;
-            state.scratch.dcc_measured[ii] = 0;
-        }
+        fprintf(stderr, "ERROR: [%s:%d] cannot allocate consistency cache for %d clusters\n",
+                __FILE__, __LINE__, config.algo.maxnbclust);
+        return 1;
     }
 
     state.scratch.current_gprobs = (double *)malloc(max_clusters * sizeof(double));
     state.cluster_visitors = (VisitorList *)calloc(max_clusters, sizeof(VisitorList));
     state.scratch.probsortedclindex = (int *)malloc(max_clusters * sizeof(int));
     state.scratch.clmembflag = (int *)malloc(max_clusters * sizeof(int));
-    state.scratch.consistency_mask = (uint64_t *)calloc(consistency_words, sizeof(uint64_t));
     state.scratch.entropy_p_current = (double *)malloc(max_clusters * sizeof(double));
     state.scratch.entropy_candidates = (Candidate *)malloc(max_clusters * sizeof(Candidate));
     state.scratch.entropy_prob_scores = (TargetScore *)malloc(max_clusters * sizeof(TargetScore));
@@ -451,12 +434,11 @@ int main(int argc, char *argv[])
     state.scratch.entropy_active_indices = (int *)malloc(max_clusters * sizeof(int));
     state.scratch.entropy_plog2p = (double *)malloc(max_clusters * sizeof(double));
     state.scratch.entropy_visited = (uint8_t *)malloc(max_clusters * sizeof(uint8_t));
+    state.scratch.dist_lower_bound = (char *)calloc(max_clusters, sizeof(char));
+    state.scratch.dfc_cache = (double *)calloc(max_clusters, sizeof(double));
+    state.scratch.dfc_cache_stamp = (long *)calloc(max_clusters, sizeof(long));
     /* Scratch buffers for sparse DCC bound refinement scheduling */
-    state.scratch.refine_queue = (Candidate *)malloc(1024 * sizeof(Candidate));
-    state.scratch.refine_queue_size = 0;
-    state.scratch.refine_queue_idx = 0;
-    state.scratch.refine_queue_capacity = 1024;
-    state.scratch.refine_queue_last_num_clusters = 0;
+    refine_queue_init(&state.scratch.refine);
     state.scratch.tuple_pred_candidates = (int *)malloc(max_clusters * sizeof(int));
     state.scratch.tuple_pred_count = 0;
 
@@ -468,7 +450,12 @@ int main(int argc, char *argv[])
 
     struct timespec clust_start, clust_end;
     clock_gettime(CLOCK_MONOTONIC, &clust_start);
+    if (config.input.prefetch_depth > 0)
+    {
+        frameread_prefetch_start(config.input.prefetch_depth, config.input.maxnbfr);
+    }
     run_clustering(&config, &state);
+    frameread_prefetch_stop();
     clock_gettime(CLOCK_MONOTONIC, &clust_end);
     double clust_ms = (clust_end.tv_sec - clust_start.tv_sec) * 1000.0 +
                       (clust_end.tv_nsec - clust_start.tv_nsec) / 1000000.0;
@@ -506,29 +493,21 @@ int main(int argc, char *argv[])
     }
     free(state.clusters);
 
-    for (long frame_idx = 0; frame_idx < state.telemetry.total_frames_processed; frame_idx++)
-    {
-        if (state.frame_infos[frame_idx].cluster_indices)
-            free(state.frame_infos[frame_idx].cluster_indices);
-        if (state.frame_infos[frame_idx].distances)
-            free(state.frame_infos[frame_idx].distances);
-    }
+    frame_log_free(&state.frame_log);
     free(state.frame_infos);
 
     for (int cl_idx = 0; cl_idx < config.algo.maxnbclust; cl_idx++)
     {
-        if (state.cluster_visitors[cl_idx].frames)
-            free(state.cluster_visitors[cl_idx].frames);
+        if (state.cluster_visitors[cl_idx].entries)
+            free(state.cluster_visitors[cl_idx].entries);
     }
     free(state.cluster_visitors);
     free(state.scratch.current_gprobs);
 
-    free(state.scratch.dcc_min);
-    free(state.scratch.dcc_max);
-    free(state.scratch.dcc_measured);
+    dcc_store_free(&state.scratch.dcc);
     free(state.scratch.probsortedclindex);
     free(state.scratch.clmembflag);
-    free(state.scratch.consistency_mask);
+    consistency_cache_free(&state.scratch.consistency);
     free(state.scratch.entropy_p_current);
     free(state.scratch.entropy_candidates);
     free(state.scratch.entropy_prob_scores);
@@ -536,9 +515,14 @@ int main(int argc, char *argv[])
     free(state.scratch.entropy_active_indices);
     free(state.scratch.entropy_plog2p);
     free(state.scratch.entropy_visited);
-    free(state.scratch.refine_queue);
+    free(state.scratch.dist_lower_bound);
+    free(state.scratch.dfc_cache);
+    free(state.scratch.dfc_cache_stamp);
+    refine_queue_free(&state.scratch.refine);
     free(state.scratch.tuple_pred_candidates);
     free(state.assignments);
+    assign_remap_free(&state.assign_remap);
+    occ_index_free(&state.occ_index);
 
     if (state.telemetry.pruned_fraction_sum)
         free(state.telemetry.pruned_fraction_sum);
@@ -0,0 +1,424 @@
+/**
+ * @file refine_queue.c
+ * @brief Priority queue of the closest unmeasured cluster pairs (-sparse_dcc_extra_evals).
+ *
+ * Each cluster holds one heap entry: the key is a lower bound on dcc_min
+ * over its unmeasured pairs, and the partner (when known) is the pair that
+ * reached it. Since lower bounds only rise, a key can only become stale by
+ * being too low; the top entry is checked against the store and its row
+ * rescanned when the check fails, so the first valid top is the closest
+ * pair overall. Every unmeasured pair stays covered by the row of one of
+ * its clusters: rows are scanned in full and a new cluster's row holds all
+ * of its new pairs.
+ *
+ * Main Functions:
+ * - refine_queue_init / refine_queue_free / refine_queue_reset: Lifecycle.
+ * - refine_queue_next: Take the next closest unmeasured pairs.
+ * - refine_queue_remove: Follow a cluster removal.
+ */
+#include "refine_queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * entry_less() - Heap order: ascending key, then ascending pair.
+ * @a: First entry.
+ * @b: Second entry.
+ *
+ * Return: 1 if @a comes before @b.
+ */
+static inline int entry_less(
+    const RefineEntry *a,
+    const RefineEntry *b)
+{
+    if (a->key != b->key)
+    {
+        return a->key < b->key;
+    }
+    return a->pair < b->pair;
+}
+
+/**
+ * entry_cluster() - Cluster owning entry @e.
+ */
+static inline int entry_cluster(
+    const RefineEntry *e)
+{
+    return (int)(e->pair >> 32);
+}
+
+/**
+ * entry_partner() - Partner of entry @e, or REFINE_NO_PARTNER.
+ */
+static inline uint32_t entry_partner(
+    const RefineEntry *e)
+{
+    return (uint32_t)(e->pair & 0xFFFFFFFFu);
+}
+
+/**
+ * make_pair() - 64-bit key of cluster @i and partner @partner.
+ */
+static inline uint64_t make_pair(
+    int      i,
+    uint32_t partner)
+{
+    return ((uint64_t)(uint32_t)i << 32) | partner;
+}
+
+/**
+ * place() - Store @e at heap position @p and record the position.
+ */
+static inline void place(
+    RefineQueue       *q,
+    int                p,
+    const RefineEntry *e)
+{
+    q->heap[p] = *e;
+    q->pos[entry_cluster(e)] = p;
+}
+
+/**
+ * sift_up() - Move the entry at @p towards the root while it precedes its parent.
+ * @q: Queue.
+ * @p: Heap position.
+ */
+static void sift_up(
+    RefineQueue *q,
+    int          p)
+{
+    RefineEntry e = q->heap[p];
+    while (p > 0 && entry_less(&e, &q->heap[(p - 1) / 2]))
+    {
+        place(q, p, &q->heap[(p - 1) / 2]);
+        p = (p - 1) / 2;
+    }
+    place(q, p, &e);
+}
+
+/**
+ * sift_down() - Move the entry at @p towards the leaves while a child precedes it.
+ * @q: Queue.
+ * @p: Heap position.
+ */
+static void sift_down(
+    RefineQueue *q,
+    int          p)
+{
+    RefineEntry e = q->heap[p];
+    for (;;)
+    {
+        int child = 2 * p + 1;
+        if (child >= q->size)
+        {
+            break;
+        }
+        if (child + 1 < q->size && entry_less(&q->heap[child + 1], &q->heap[child]))
+        {
+            child++;
+        }
+        if (!entry_less(&q->heap[child], &e))
+        {
+            break;
+        }
+        place(q, p, &q->heap[child]);
+        p = child;
+    }
+    place(q, p, &e);
+}
+
+/**
+ * delete_at() - Remove the entry at heap position @p.
+ * @q: Queue.
+ * @p: Heap position.
+ */
+static void delete_at(
+    RefineQueue *q,
+    int          p)
+{
+    q->pos[entry_cluster(&q->heap[p])] = -1;
+    q->size--;
+    if (p == q->size)
+    {
+        return;
+    }
+    RefineEntry last = q->heap[q->size];
+    place(q, p, &last);
+    if (p > 0 && entry_less(&last, &q->heap[(p - 1) / 2]))
+    {
+        sift_up(q, p);
+    }
+    else
+    {
+        sift_down(q, p);
+    }
+}
+
+/**
+ * in_batch() - 1 if pair (@i, @j) is already among the first @found pairs taken.
+ */
+static int in_batch(
+    int        i,
+    int        j,
+    const int *pair_i,
+    const int *pair_j,
+    int        found)
+{
+    for (int ii = 0; ii < found; ii++)
+    {
+        if ((pair_i[ii] == i && pair_j[ii] == j) || (pair_i[ii] == j && pair_j[ii] == i))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * scan_row() - Closest unmeasured partner of cluster @i outside the current batch.
+ * @dcc:          Bound store.
+ * @i:            Cluster.
+ * @num_clusters: Active clusters.
+ * @pair_i:       First clusters of the pairs already taken.
+ * @pair_j:       Second clusters of the pairs already taken.
+ * @found:        Pairs already taken.
+ * @key:          Output: its lower bound, clamped at 0.
+ *
+ * Ties go to the lowest partner index.
+ *
+ * Return: The partner, or -1 if every pair of @i is measured or taken.
+ */
+static int scan_row(
+    const DccStore *dcc,
+    int             i,
+    int             num_clusters,
+    const int      *pair_i,
+    const int      *pair_j,
+    int             found,
+    double         *key)
+{
+    int    best = -1;
+    double best_key = 0.0;
+
+    for (int jj = 0; jj < num_clusters; jj++)
+    {
+        if (jj == i || dcc_get_measured(dcc, i, jj))
+        {
+            continue;
+        }
+        double k = dcc_get_min(dcc, i, jj);
+        k = (k > 0.0) ? k : 0.0;
+        if ((best < 0 || k < best_key) && !in_batch(i, jj, pair_i, pair_j, found))
+        {
+            best = jj;
+            best_key = k;
+            if (best_key <= 0.0)
+            {
+                break;
+            }
+        }
+    }
+    *key = best_key;
+    return best;
+}
+
+/**
+ * reserve() - Make room for @n clusters.
+ * @q: Queue.
+ * @n: Clusters.
+ *
+ * Return: 0 on success, -1 on allocation failure (the queue is unchanged).
+ */
+static int reserve(
+    RefineQueue *q,
+    int          n)
+{
+    if (n <= q->cap)
+    {
+        return 0;
+    }
+    int cap = (q->cap > 0) ? 2 * q->cap : 64;
+    while (cap < n)
+    {
+        cap *= 2;
+    }
+    RefineEntry *heap = (RefineEntry *)realloc(q->heap, (size_t)cap * sizeof(RefineEntry));
+    if (heap == NULL)
+    {
+        return -1;
+    }
+    q->heap = heap;
+    int *pos = (int *)realloc(q->pos, (size_t)cap * sizeof(int));
+    if (pos == NULL)
+    {
+        return -1;
+    }
+    q->pos = pos;
+    q->cap = cap;
+    return 0;
+}
+
+/**
+ * refine_queue_init() - Initialize an empty queue.
+ * @q: Queue.
+ */
+void refine_queue_init(
+    RefineQueue *q)
+{
+    q->heap = NULL;
+    q->pos = NULL;
+    q->size = 0;
+    q->cap = 0;
+    q->tracked = 0;
+}
+
+/**
+ * refine_queue_free() - Release all memory held by a queue.
+ * @q: Queue; left empty.
+ */
+void refine_queue_free(
+    RefineQueue *q)
+{
+    free(q->heap);
+    free(q->pos);
+    refine_queue_init(q);
+}
+
+/**
+ * refine_queue_reset() - Forget every cluster, keeping the allocation.
+ * @q: Queue.
+ */
+void refine_queue_reset(
+    RefineQueue *q)
+{
+    q->size = 0;
+    q->tracked = 0;
+}
+
+/**
+ * refine_queue_next() - Take the next closest unmeasured pairs.
+ * @q:            Queue.
+ * @dcc:          Bound store.
+ * @num_clusters: Active clusters.
+ * @max_pairs:    Capacity of @pair_i and @pair_j.
+ * @pair_i:       Output: first cluster of each pair.
+ * @pair_j:       Output: second cluster of each pair.
+ *
+ * Rows of the clusters created since the last call are scanned and pushed,
+ * then the top entry is taken while it is still exact, and rescanned
+ * otherwise. A taken entry keeps its key without a partner: it is rescanned
+ * once its pair has been measured.
+ *
+ * Return: Pairs written, in ascending lower-bound order.
+ */
+int refine_queue_next(
+    RefineQueue    *q,
+    const DccStore *dcc,
+    int             num_clusters,
+    int             max_pairs,
+    int            *pair_i,
+    int            *pair_j)
+{
+    if (reserve(q, num_clusters) != 0)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] refine queue allocation failed\n", __FILE__, __LINE__);
+        return 0;
+    }
+
+    while (q->tracked < num_clusters)
+    {
+        int         c = q->tracked++;
+        double      key;
+        int         partner = scan_row(dcc, c, num_clusters, NULL, NULL, 0, &key);
+        RefineEntry e;
+        if (partner < 0)
+        {
+            q->pos[c] = -1;
+            continue;
+        }
+        e.key = key;
+        e.pair = make_pair(c, (uint32_t)partner);
+        q->size++;
+        place(q, q->size - 1, &e);
+        sift_up(q, q->size - 1);
+    }
+
+    int found = 0;
+    while (found < max_pairs && q->size > 0)
+    {
+        RefineEntry *top = &q->heap[0];
+        int          i = entry_cluster(top);
+        uint32_t     partner = entry_partner(top);
+
+        if (partner != REFINE_NO_PARTNER && !dcc_get_measured(dcc, i, (int)partner))
+        {
+            int    j = (int)partner;
+            double k = dcc_get_min(dcc, i, j);
+            k = (k > 0.0) ? k : 0.0;
+            if (k == top->key && !in_batch(i, j, pair_i, pair_j, found))
+            {
+                pair_i[found] = (i < j) ? i : j;
+                pair_j[found] = (i < j) ? j : i;
+                found++;
+                top->pair = make_pair(i, REFINE_NO_PARTNER);
+                sift_down(q, 0);
+                continue;
+            }
+        }
+
+        double key;
+        int    j = scan_row(dcc, i, num_clusters, pair_i, pair_j, found, &key);
+        if (j < 0)
+        {
+            delete_at(q, 0);
+            continue;
+        }
+        top->key = key;
+        top->pair = make_pair(i, (uint32_t)j);
+        sift_down(q, 0);
+    } // while (found < max_pairs && q->size > 0)
+    return found;
+}
+
+/**
+ * refine_queue_remove() - Follow the removal of cluster @index.
+ * @q:     Queue.
+ * @index: Removed cluster; higher indices shift down by one.
+ *
+ * Renumbering keeps the relative order of the other entries; entries that
+ * pointed at @index lose their partner, which only moves them down, so the
+ * heap is rebuilt in O(K).
+ */
+void refine_queue_remove(
+    RefineQueue *q,
+    int          index)
+{
+    if (index < 0 || index >= q->tracked)
+    {
+        return;
+    }
+    if (q->pos[index] >= 0)
+    {
+        delete_at(q, q->pos[index]);
+    }
+    for (int ii = 0; ii < q->size; ii++)
+    {
+        RefineEntry *e = &q->heap[ii];
+        int          i = entry_cluster(e);
+        uint32_t     partner = entry_partner(e);
+        if (partner != REFINE_NO_PARTNER && (int)partner >= index)
+        {
+            partner = ((int)partner == index) ? REFINE_NO_PARTNER : partner - 1;
+        }
+        e->pair = make_pair((i > index) ? i - 1 : i, partner);
+    }
+    for (int c = index + 1; c < q->tracked; c++)
+    {
+        q->pos[c - 1] = q->pos[c];
+    }
+    q->tracked--;
+    for (int ii = q->size / 2 - 1; ii >= 0; ii--)
+    {
+        sift_down(q, ii);
+    }
+}
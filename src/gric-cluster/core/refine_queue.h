@@ -0,0 +1,81 @@
+#ifndef REFINE_QUEUE_H
+#define REFINE_QUEUE_H
+
+/**
+ * @file refine_queue.h
+ * @brief Priority queue of the closest unmeasured cluster pairs (-sparse_dcc_extra_evals).
+ *
+ * Holds one entry per cluster: its unmeasured partner with the smallest
+ * dcc_min, keyed by that bound, in a min-heap indexed by cluster. Lower
+ * bounds only rise (update_dcc_bounds() tightens them, measured pairs leave
+ * the candidates), so an entry's key stays a lower bound for every
+ * unmeasured pair of its cluster; a stale entry is rescanned when it
+ * reaches the top. New clusters are scanned once when they appear, and
+ * cluster removals re-index the entries. Pairs are identified by 64-bit
+ * keys (cluster << 32 | partner), so the cluster count is not limited.
+ */
+
+#include "dcc_store.h"
+#include <stdint.h>
+
+/** Heap entry: a cluster and its closest known unmeasured partner. */
+typedef struct
+{
+    double   key;  /**< dcc_min of the pair when the partner was chosen */
+    uint64_t pair; /**< Cluster << 32 | partner (REFINE_NO_PARTNER: rescan) */
+} RefineEntry;
+
+/** Partner field of an entry that must be rescanned. */
+#define REFINE_NO_PARTNER 0xFFFFFFFFu
+
+/** Closest unmeasured pairs, maintained across steps. */
+typedef struct
+{
+    RefineEntry *heap;    /**< Min-heap on (key, pair) */
+    int         *pos;     /**< Per cluster: heap position, -1 if all its pairs are measured */
+    int          size;    /**< Entries in heap */
+    int          cap;     /**< Clusters allocated in heap and pos */
+    int          tracked; /**< Clusters [0, tracked) have been scanned */
+} RefineQueue;
+
+/**
+ * @brief Initialize an empty queue (no allocation until clusters appear).
+ */
+void refine_queue_init(
+    RefineQueue *q);
+
+/**
+ * @brief Release all memory held by @q.
+ */
+void refine_queue_free(
+    RefineQueue *q);
+
+/**
+ * @brief Forget every cluster (after dcc_store_reset()).
+ */
+void refine_queue_reset(
+    RefineQueue *q);
+
+/**
+ * @brief Take up to @max_pairs distinct closest unmeasured pairs of the first
+ *        @num_clusters clusters into @pair_i / @pair_j; returns how many.
+ *
+ * Clusters created since the last call are scanned first. The pairs are
+ * expected to be measured before the next call.
+ */
+int refine_queue_next(
+    RefineQueue    *q,
+    const DccStore *dcc,
+    int             num_clusters,
+    int             max_pairs,
+    int            *pair_i,
+    int            *pair_j);
+
+/**
+ * @brief Follow the removal of cluster @index (higher indices shift down by one).
+ */
+void refine_queue_remove(
+    RefineQueue *q,
+    int          index);
+
+#endif // REFINE_QUEUE_H
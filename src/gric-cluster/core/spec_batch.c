@@ -0,0 +1,201 @@
+/**
+ * @file spec_batch.c
+ * @brief Speculative multi-frame distance batches (-specbatch B).
+ *
+ * Consecutive frames of a replayed sequence tend to follow the same
+ * measurement path, so the clusters measured by the last clustered frame
+ * are evaluated ahead for every frame of the next batch. This is the only
+ * part of the step that runs in parallel; everything that depends on the
+ * outcome of earlier frames (priors, pruning, cluster creation) stays
+ * sequential.
+ *
+ * Main Functions:
+ * - spec_batch_eval: Evaluate a batch's distances ahead, in parallel.
+ * - spec_batch_take: Hand an evaluated distance to the sequential step.
+ * - spec_batch_note: Record the measurement path of the current frame.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "spec_batch.h"
+#include "framedistance.h"
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * spec_batch_init() - Allocate a batch of @size frames.
+ * @sb:   Batch; zero-initialized by the caller.
+ * @size: Frames per batch (2 .. SPEC_BATCH_MAX).
+ *
+ * Return: 0 on success, -1 on allocation failure.
+ */
+int spec_batch_init(
+    SpecBatch *sb,
+    int        size)
+{
+    sb->size   = size;
+    sb->frames = (Frame **)calloc((size_t)size, sizeof(Frame *));
+    sb->dist   = (double *)malloc((size_t)size * SPEC_WIDTH_MAX * sizeof(double));
+    sb->exact  = (char *)malloc((size_t)size * SPEC_WIDTH_MAX);
+    if (sb->frames == NULL || sb->dist == NULL || sb->exact == NULL)
+    {
+        spec_batch_free(sb);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * spec_batch_eval() - Evaluate the distances of the batch's frames ahead.
+ * @sb:     Batch holding nframes freshly read frames.
+ * @config: Pointer to the active ClusterConfig.
+ * @state:  Pointer to the active ClusterState.
+ *
+ * Targets are the clusters of the last frame's measurement path that still
+ * exist with the same anchor. The (frame, target) pairs are spread over the
+ * OpenMP threads; framedist_bounded() is evaluated with the limit
+ * measure_distance_to_cluster() uses, so the values are the ones the
+ * sequential step would compute. Nothing is counted in the telemetry here;
+ * spec_batch_take() hands a value over and the caller accounts for it then.
+ */
+void spec_batch_eval(
+    SpecBatch     *sb,
+    ClusterConfig *config,
+    ClusterState  *state)
+{
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    Frame *anchors[SPEC_WIDTH_MAX];
+    sb->next  = 0;
+    sb->width = 0;
+    sb->limit = config->optim.abandon_factor * config->algo.rlim;
+    for (int ii = 0; ii < sb->path_len; ii++)
+    {
+        int c = sb->path[ii];
+        if (c < state->num_clusters && state->clusters[c].anchor.id == sb->path_ids[ii])
+        {
+            anchors[sb->width] = &state->clusters[c].anchor;
+            sb->anchor_ids[sb->width] = sb->path_ids[ii];
+            sb->width++;
+        }
+    }
+
+    long   npairs = (long)sb->nframes * sb->width;
+    int    width  = sb->width;
+    double limit  = sb->limit;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 4) if (npairs > 1)
+#endif
+    for (long kk = 0; kk < npairs; kk++)
+    {
+        int exact = 1;
+        sb->dist[kk]  = framedist_bounded(sb->frames[kk / width], anchors[kk % width],
+                                          limit, &exact);
+        sb->exact[kk] = (char)exact;
+    }
+    sb->evaluated += npairs;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    sb->time_ms += (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1000000.0;
+}
+
+/**
+ * spec_batch_pop() - Hand out the next frame of the batch.
+ * @sb: Batch.
+ *
+ * Starts a new measurement path for the frame.
+ *
+ * Return: Next frame, or NULL once every frame of the batch was handed out.
+ */
+Frame *spec_batch_pop(
+    SpecBatch *sb)
+{
+    if (sb->next >= sb->nframes)
+    {
+        return NULL;
+    }
+    sb->path_len = 0;
+    return sb->frames[sb->next++];
+}
+
+/**
+ * spec_batch_take() - Fetch a distance evaluated ahead.
+ * @sb:    Batch.
+ * @frame: Frame being clustered (the last one handed out).
+ * @cl:    Cluster the step is about to measure.
+ * @limit: Early-abandon limit the step would use.
+ * @d:     Output distance (or lower bound).
+ * @exact: Output; 1 if *@d is exact.
+ *
+ * Return: 1 if the distance was evaluated ahead, 0 otherwise.
+ */
+int spec_batch_take(
+    SpecBatch     *sb,
+    const Frame   *frame,
+    const Cluster *cl,
+    double         limit,
+    double        *d,
+    int           *exact)
+{
+    int f = sb->next - 1;
+    if (f < 0 || sb->frames[f] != frame || limit != sb->limit)
+    {
+        return 0;
+    }
+    for (int ii = 0; ii < sb->width; ii++)
+    {
+        if (sb->anchor_ids[ii] == cl->anchor.id)
+        {
+            long kk = (long)f * sb->width + ii;
+            *d     = sb->dist[kk];
+            *exact = sb->exact[kk];
+            sb->used++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * spec_batch_note() - Record a cluster on the current frame's measurement path.
+ * @sb:    Batch.
+ * @state: Pointer to the active ClusterState.
+ * @cj:    Cluster measured (or assigned).
+ *
+ * Keeps the first SPEC_WIDTH_MAX distinct clusters.
+ */
+void spec_batch_note(
+    SpecBatch    *sb,
+    ClusterState *state,
+    int           cj)
+{
+    if (cj < 0 || cj >= state->num_clusters || sb->path_len >= SPEC_WIDTH_MAX)
+    {
+        return;
+    }
+    int id = state->clusters[cj].anchor.id;
+    for (int ii = 0; ii < sb->path_len; ii++)
+    {
+        if (sb->path_ids[ii] == id)
+        {
+            return;
+        }
+    }
+    sb->path[sb->path_len]     = cj;
+    sb->path_ids[sb->path_len] = id;
+    sb->path_len++;
+}
+
+/**
+ * spec_batch_free() - Release the batch buffers.
+ * @sb: Batch; left with no buffers. Queued frames are the caller's.
+ */
+void spec_batch_free(
+    SpecBatch *sb)
+{
+    free(sb->frames);
+    free(sb->dist);
+    free(sb->exact);
+    sb->frames = NULL;
+    sb->dist   = NULL;
+    sb->exact  = NULL;
+}
@@ -0,0 +1,97 @@
+#ifndef SPEC_BATCH_H
+#define SPEC_BATCH_H
+
+/**
+ * @file spec_batch.h
+ * @brief Speculative multi-frame distance batches (-specbatch B).
+ *
+ * Frames are read B at a time. Before the first of them is clustered, the
+ * distances of all B frames to the clusters measured by the last clustered
+ * frame are evaluated in parallel. The frames are then clustered one by one
+ * exactly as without batching: a distance the sequential step needs is
+ * taken from the batch when it was evaluated ahead, and computed on the spot
+ * otherwise (e.g. for clusters created inside the batch). Distances are
+ * matched by anchor frame, so renumbering after a removal is harmless, and
+ * evaluated with the same early-abandon limit, so results are identical.
+ */
+
+#include "cluster_defs.h"
+
+/** Largest batch (-specbatch B). */
+#define SPEC_BATCH_MAX 1024
+
+/** Clusters evaluated ahead per batch. */
+#define SPEC_WIDTH_MAX 8
+
+/** One batch of frames and their distances evaluated ahead. */
+typedef struct SpecBatch
+{
+    int     size;                       /**< Frames read per batch (B) */
+    Frame **frames;                     /**< Frames of the current batch */
+    int     nframes;                    /**< Frames in the current batch */
+    int     next;                       /**< Next frame to hand out */
+    int     width;                      /**< Clusters evaluated for this batch */
+    int     anchor_ids[SPEC_WIDTH_MAX]; /**< Anchor frame of each evaluated cluster */
+    double  limit;                      /**< Early-abandon limit used */
+    double *dist;                       /**< nframes x width distances (or lower bounds) */
+    char   *exact;                      /**< nframes x width: 1 if exact */
+    int     path[SPEC_WIDTH_MAX];       /**< Clusters measured by the current frame */
+    int     path_ids[SPEC_WIDTH_MAX];   /**< Their anchor frames */
+    int     path_len;                   /**< Entries in path */
+    long    evaluated;                  /**< Distances evaluated ahead */
+    long    used;                       /**< Of those, taken by the sequential step */
+    double  time_ms;                    /**< Time spent evaluating ahead */
+} SpecBatch;
+
+/**
+ * @brief Allocate a batch of @size frames; returns 0 on success, -1 on failure.
+ */
+int spec_batch_init(
+    SpecBatch *sb,
+    int        size);
+
+/**
+ * @brief Evaluate the distances of frames[0, nframes) ahead, in parallel.
+ *
+ * The clusters measured by the last clustered frame are the targets. Resets
+ * the frame cursor to the start of the batch.
+ */
+void spec_batch_eval(
+    SpecBatch     *sb,
+    ClusterConfig *config,
+    ClusterState  *state);
+
+/**
+ * @brief Next frame of the batch, or NULL once the batch is used up.
+ */
+Frame *spec_batch_pop(
+    SpecBatch *sb);
+
+/**
+ * @brief Fetch the distance of @frame to cluster @cl if it was evaluated ahead.
+ *
+ * Returns 1 and sets *@d and *@exact on a hit, 0 otherwise.
+ */
+int spec_batch_take(
+    SpecBatch     *sb,
+    const Frame   *frame,
+    const Cluster *cl,
+    double         limit,
+    double        *d,
+    int           *exact);
+
+/**
+ * @brief Note that the current frame was measured against cluster @cj.
+ */
+void spec_batch_note(
+    SpecBatch    *sb,
+    ClusterState *state,
+    int           cj);
+
+/**
+ * @brief Release the batch buffers (frames still queued are not freed).
+ */
+void spec_batch_free(
+    SpecBatch *sb);
+
+#endif // SPEC_BATCH_H
@@ -87,6 +87,11 @@ TileMap *tilemap_create_single(
         tm->tiles[0].pixel_indices[ii] = (int) ii;
     }
 
+    if (tilemap_build_spans(tm) != 0)
+    {
+        tilemap_free(tm);
+        return NULL;
+    }
     return tm;
 }
 
@@ -200,6 +205,10 @@ TileMap *tilemap_create_grid(
         } // for tx
     } // for ty
 
+    if (tilemap_build_spans(tm) != 0)
+    {
+        goto cleanup;
+    }
     return tm;
 
 cleanup:
@@ -424,6 +433,11 @@ TileMap *tilemap_load_fits(
         }
     } // sort loop
 
+    if (tilemap_build_spans(tm) != 0)
+    {
+        tilemap_free(tm);
+        return NULL;
+    }
     return tm;
 }
 
@@ -447,11 +461,73 @@ TileMap *tilemap_load_fits(
 #endif /* USE_CFITSIO */
 
 
+/**
+ * tilemap_build_spans() - Run-length encode tile pixel indices.
+ * @tm: Tile map with sorted pixel_indices.
+ *
+ * Each run of consecutive indices becomes one FrameSpan, so a tile of a
+ * regular grid has one span per image row it covers (a single span when
+ * the tile spans full rows). The spans let the tile pipeline compute
+ * distances directly on the full-image frame (see tiledef_use_view()).
+ *
+ * Return: 0 on success, -1 on allocation failure.
+ */
+int tilemap_build_spans(TileMap *tm)
+{
+    for (int tt = 0; tt < tm->num_tiles; tt++)
+    {
+        TileDef *td = &tm->tiles[tt];
+        free(td->spans);
+        td->spans = NULL;
+        td->num_spans = 0;
+        if (td->num_pixels == 0)
+        {
+            continue;
+        }
+
+        int nruns = 1;
+        for (uint64_t ii = 1; ii < td->num_pixels; ii++)
+        {
+            if (td->pixel_indices[ii] != td->pixel_indices[ii - 1] + 1)
+            {
+                nruns++;
+            }
+        }
+
+        td->spans = malloc((size_t) nruns * sizeof(FrameSpan));
+        if (td->spans == NULL)
+        {
+            return -1;
+        }
+
+        int ss = 0;
+        td->spans[0].offset = td->pixel_indices[0];
+        td->spans[0].len    = 1;
+        for (uint64_t ii = 1; ii < td->num_pixels; ii++)
+        {
+            if (td->pixel_indices[ii] == td->pixel_indices[ii - 1] + 1)
+            {
+                td->spans[ss].len++;
+            }
+            else
+            {
+                ss++;
+                td->spans[ss].offset = td->pixel_indices[ii];
+                td->spans[ss].len    = 1;
+            }
+        }
+        td->num_spans = nruns;
+    } // for each tile tt
+
+    return 0;
+}
+
+
 /**
  * tilemap_free() - Free all memory owned by a TileMap.
  * @tm: Pointer to the TileMap to free (may be NULL).
  *
- * Frees every tile's pixel_indices array, the tiles array,
+ * Frees every tile's pixel_indices and spans arrays, the tiles array,
  * and the TileMap struct itself.
  */
 void tilemap_free(TileMap *tm)
@@ -466,6 +542,7 @@ void tilemap_free(TileMap *tm)
         for (int tt = 0; tt < tm->num_tiles; tt++)
         {
             free(tm->tiles[tt].pixel_indices);
+            free(tm->tiles[tt].spans);
         }
         free(tm->tiles);
     }
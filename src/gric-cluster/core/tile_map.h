@@ -7,13 +7,19 @@
  *        partitioning an image into spatial tiles.
  */
 
+#include "common.h"
 #include <stdint.h>
 
+/** Shortest average span length for which tiles are read in place. */
+#define TILE_VIEW_MIN_RUN 8
+
 /** Single tile: a list of pixel indices into the full image. */
 typedef struct
 {
-    int      *pixel_indices; /**< Sorted 1D pixel offsets */
-    uint64_t  num_pixels;    /**< Number of pixels in tile */
+    int       *pixel_indices; /**< Sorted 1D pixel offsets */
+    uint64_t   num_pixels;    /**< Number of pixels in tile */
+    FrameSpan *spans;         /**< pixel_indices as runs (rows of a grid tile) */
+    int        num_spans;
 } TileDef;
 
 /** Complete tile map for the image. */
@@ -43,6 +49,23 @@ TileMap *tilemap_create_single(
     long img_width,
     long img_height);
 
+/** Run-length encode the pixel indices of every tile into TileDef.spans. */
+int tilemap_build_spans(TileMap *tm);
+
+/**
+ * @brief Nonzero if tile @td is read in place through its spans.
+ *
+ * True for single-run tiles and tiles whose runs average at least
+ * TILE_VIEW_MIN_RUN pixels; other tiles are gathered into a buffer.
+ */
+static inline int tiledef_use_view(
+    const TileDef *td)
+{
+    return td->spans != NULL
+           && (td->num_spans == 1
+               || td->num_pixels >= (uint64_t) td->num_spans * TILE_VIEW_MIN_RUN);
+}
+
 /** Free all memory owned by a TileMap. */
 void tilemap_free(TileMap *tm);
 
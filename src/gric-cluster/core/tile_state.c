@@ -5,6 +5,9 @@
  */
 
 #include "tile_state.h"
+#include "cluster_steps.h"
+#include "cluster_mgmt.h"
+#include "frame_dtype.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -58,7 +61,7 @@ MultiTileState *multitile_init(
 
     /* Allocate cross-tile shared structures */
     mts->xtile_board = calloc(
-        (size_t) mts->num_tiles, sizeof(volatile int));
+        (size_t) mts->num_tiles, sizeof(int64_t));
     size_t cpt_entries =
         (size_t) mts->num_tiles * maxnbc * mts->num_tiles * maxnbc;
     mts->cpt = calloc(cpt_entries, sizeof(double));
@@ -85,8 +88,6 @@ MultiTileState *multitile_init(
         {
             size_t mc = (size_t) maxnbc;
             size_t pairs = mc * mc;
-            int words = (maxnbc + 63) / 64;
-            size_t cw = pairs * (size_t) words;
 
             memset(&ts->state, 0, sizeof(ts->state));
 
@@ -94,12 +95,8 @@ MultiTileState *multitile_init(
                 mc * sizeof(Cluster));
             ts->state.cluster_visitors = calloc(
                 mc, sizeof(VisitorList));
-            ts->state.scratch.dcc_min = malloc(
-                pairs * sizeof(double));
-            ts->state.scratch.dcc_max = malloc(
-                pairs * sizeof(double));
-            ts->state.scratch.dcc_measured = malloc(
-                pairs * sizeof(char));
+            dcc_store_init(&ts->state.scratch.dcc, maxnbc,
+                           ts->config.optim.sparse_dcc_mode);
             ts->state.scratch.current_gprobs = malloc(
                 mc * sizeof(double));
             ts->state.scratch.probsortedclindex = malloc(
@@ -108,8 +105,7 @@ MultiTileState *multitile_init(
                 mc * sizeof(int));
             ts->state.scratch.mixed_probs = calloc(
                 mc, sizeof(double));
-            ts->state.scratch.consistency_mask = calloc(
-                cw, sizeof(uint64_t));
+            consistency_cache_init(&ts->state.scratch.consistency, maxnbc);
             ts->state.scratch.entropy_p_current = malloc(
                 mc * sizeof(double));
             ts->state.scratch.entropy_candidates = malloc(
@@ -124,21 +120,17 @@ MultiTileState *multitile_init(
                 mc * sizeof(double));
             ts->state.scratch.entropy_visited = malloc(
                 mc * sizeof(uint8_t));
-            ts->state.scratch.refine_queue = malloc(
-                1024 * sizeof(Candidate));
-            ts->state.scratch.refine_queue_capacity = 1024;
+            ts->state.scratch.dist_lower_bound = calloc(
+                mc, sizeof(char));
+            ts->state.scratch.dfc_cache = calloc(
+                mc, sizeof(double));
+            ts->state.scratch.dfc_cache_stamp = calloc(
+                mc, sizeof(long));
+            refine_queue_init(&ts->state.scratch.refine);
             ts->state.scratch.tuple_pred_candidates = malloc(
                 mc * sizeof(int));
             ts->state.scratch.tuple_pred_count = 0;
 
-            /* Init DCC bounds */
-            for (size_t ii = 0; ii < pairs; ii++)
-            {
-                ts->state.scratch.dcc_min[ii] = -1.0;
-                ts->state.scratch.dcc_max[ii] = -1.0;
-                ts->state.scratch.dcc_measured[ii] = 0;
-            }
-
             ts->state.transition_matrix = calloc(
                 pairs, sizeof(long));
 
@@ -266,6 +258,16 @@ void multitile_free(MultiTileState *mts)
             {
                 free(ts->state.scratch.tuple_pred_candidates);
             }
+            free(ts->state.scratch.dist_lower_bound);
+            free(ts->state.scratch.dfc_cache);
+            free(ts->state.scratch.dfc_cache_stamp);
+            dcc_store_free(&ts->state.scratch.dcc);
+            refine_queue_free(&ts->state.scratch.refine);
+            consistency_cache_free(&ts->state.scratch.consistency);
+            assign_remap_free(&ts->state.assign_remap);
+            occ_index_free(&ts->state.occ_index);
+            frame_log_free(&ts->state.frame_log);
+            tile_queue_free(ts);
         } // for each tile m
 
         free(mts->tile_states);
@@ -279,6 +281,88 @@ void multitile_free(MultiTileState *mts)
     free(mts);
 }
 
+/**
+ * tile_queue_init - Preallocate the worker queue of one tile.
+ * @ts:    Tile state (tile_def must be set).
+ * @dtype: Pixel storage type of the scattered frames.
+ * @depth: Number of slots, i.e. frames that can be in flight.
+ *
+ * Tiles that tiledef_use_view() accepts get view slots: the slot frame points
+ * at the full-image frame and reads the tile through its spans. Other tiles
+ * get a tile-sized buffer per slot, reused for every frame gathered into it.
+ * Slot frames are FRAME_BORROW_TILE so cluster_frame() copies them when they
+ * become anchors and free_frame() leaves them alone.
+ *
+ * Return: 0 on success, -1 on allocation failure.
+ */
+int tile_queue_init(
+    TileState *ts,
+    FrameDType dtype,
+    int        depth)
+{
+    TileQueue *q = &ts->queue;
+    long npix = (long) ts->tile_def->num_pixels;
+
+    q->slots = calloc((size_t) depth, sizeof(TileSlot));
+    if (q->slots == NULL)
+    {
+        return -1;
+    }
+    q->depth = depth;
+    q->head  = 0;
+    q->tail  = 0;
+
+    int view = tiledef_use_view(ts->tile_def);
+    for (int s = 0; s < depth; s++)
+    {
+        Frame *f = &q->slots[s].frame;
+        if (view)
+        {
+            f->spans     = ts->tile_def->spans;
+            f->num_spans = ts->tile_def->num_spans;
+        }
+        else
+        {
+            f->data = malloc((size_t) npix * frame_dtype_size(dtype));
+            if (f->data == NULL)
+            {
+                tile_queue_free(ts);
+                return -1;
+            }
+        }
+        f->dtype    = dtype;
+        f->width    = npix;
+        f->height   = 1;
+        f->borrowed = FRAME_BORROW_TILE;
+        q->slots[s].assignment = -1;
+    }
+    memset(&ts->pipe, 0, sizeof(ts->pipe));
+    return 0;
+}
+
+/**
+ * tile_queue_free - Release the worker queue of one tile.
+ * @ts: Tile state (queue may be unallocated).
+ */
+void tile_queue_free(
+    TileState *ts)
+{
+    TileQueue *q = &ts->queue;
+    if (q->slots != NULL)
+    {
+        for (int s = 0; s < q->depth; s++)
+        {
+            /* View slots point into the source frame, owned by the pipeline */
+            if (q->slots[s].frame.spans == NULL)
+            {
+                free(q->slots[s].frame.data);
+            }
+        }
+        free(q->slots);
+    }
+    memset(q, 0, sizeof(*q));
+}
+
 /**
  * multitile_load_tile_config - Parse per-tile config file.
  * @mts:  Multi-tile state with allocated tile_states.
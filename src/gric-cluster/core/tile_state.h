@@ -10,6 +10,42 @@
 #include "cluster_defs.h"
 #include "tile_map.h"
 
+/** Upper bound of -tile_lag. */
+#define TILE_LAG_MAX 64
+
+/** One frame handed to a tile worker. */
+typedef struct
+{
+    Frame frame;      /**< Tile view of the source frame, or gathered copy (FRAME_BORROW_TILE) */
+    int   assignment; /**< Cluster chosen for this frame (after Pass 2 in lockstep mode) */
+} TileSlot;
+
+/**
+ * Single-producer single-consumer ring of tile frames.
+ *
+ * The producer fills slot (head % depth) and then advances head; the tile
+ * worker clusters frame tail and then advances tail. Both counters only grow
+ * and are accessed with __atomic builtins.
+ */
+typedef struct
+{
+    TileSlot *slots;
+    int       depth;
+    long      head; /**< Frames published to the worker */
+    long      tail; /**< Frames the worker has finished */
+} TileQueue;
+
+/** Per-tile pipeline telemetry. */
+typedef struct
+{
+    long   frames;     /**< Frames clustered */
+    double busy_ms;    /**< Wall time spent clustering */
+    double wait_ms;    /**< Wall time spent waiting for input or the lag window */
+    long   lead_sum;   /**< Sum over frames of (frame - frames fully recorded) */
+    long   lead_max;   /**< Largest lead over the recorded frames */
+    long   queued_sum; /**< Sum over frames of frames waiting in the queue */
+} TilePipeStats;
+
 /** Per-tile clustering state and configuration. */
 typedef struct
 {
@@ -28,7 +64,10 @@ typedef struct
     FILE          *ascii_out;
     int            prev_assigned_cluster;
     int            pass1_old_ncl;      /**< Number of clusters before Pass 1 */
-    volatile int  *xtile_board;        /**< Shared cross-tile assignment board */
+    volatile int64_t *xtile_board;     /**< Shared cross-tile assignment board */
+    long           cur_frame;          /**< Frame being clustered (board stamp) */
+    TileQueue      queue;              /**< Frames handed to the tile worker */
+    TilePipeStats  pipe;               /**< Worker telemetry */
     double        *cpt;                /**< Shared Conditional Probability Table */
     double        *cpt_scale;          /**< Shared CPT scale factor pointer */
     int           *last_injected_assignment; /**< Resolved neighbor track list */
@@ -46,11 +85,54 @@ typedef struct
     int            retrieval_window; /**< Lookback horizon */
     int           *occurrence_head;  /**< [M × max_clusters] flat */
     int           *occurrence_prev;  /**< [maxnbfr × M] flat */
-    volatile int  *xtile_board;      /**< Shared board flat [M] */
+    volatile int64_t *xtile_board;   /**< Shared board flat [M], see xtile_board_post() */
     double        *cpt;              /**< Shared CPT flat [M * Kmax * M * Kmax] */
     double         cpt_scale;        /**< Shared CPT scale factor */
 } MultiTileState;
 
+/**
+ * @brief Publish assignment @ass of tile frame @frame on a cross-tile board entry.
+ *
+ * Entries pack (frame + 1) in the high word so that a neighbour working on
+ * another frame never reads a stale assignment; a zero entry is empty.
+ */
+static inline void xtile_board_post(
+    volatile int64_t *entry,
+    long              frame,
+    int               ass)
+{
+    __atomic_store_n(entry, (int64_t)(((uint64_t)(frame + 1) << 32) | (uint32_t)ass),
+                     __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Assignment posted on @entry for frame @frame, or -1 if none.
+ */
+static inline int xtile_board_read(
+    const volatile int64_t *entry,
+    long                    frame)
+{
+    int64_t v = __atomic_load_n(entry, __ATOMIC_ACQUIRE);
+    if ((uint64_t)v >> 32 != (uint64_t)(frame + 1))
+    {
+        return -1;
+    }
+    return (int)(uint32_t)v;
+}
+
+/**
+ * @brief Clear all @num_tiles entries of a cross-tile board.
+ */
+static inline void xtile_board_reset(
+    volatile int64_t *board,
+    int               num_tiles)
+{
+    for (int m = 0; m < num_tiles; m++)
+    {
+        __atomic_store_n(&board[m], 0, __ATOMIC_RELEASE);
+    }
+}
+
 /** Allocate and initialise multi-tile state. */
 MultiTileState *multitile_init(
     ClusterConfig *global,
@@ -60,6 +142,16 @@ MultiTileState *multitile_init(
 /** Free all multi-tile resources (not the TileMap). */
 void multitile_free(MultiTileState *mts);
 
+/** Allocate @depth preallocated slots for the worker queue of tile @ts. */
+int tile_queue_init(
+    TileState *ts,
+    FrameDType dtype,
+    int        depth);
+
+/** Free the worker queue of tile @ts. */
+void tile_queue_free(
+    TileState *ts);
+
 /** Parse per-tile config overrides from ASCII file. */
 int multitile_load_tile_config(
     MultiTileState *mts,
@@ -29,6 +29,10 @@ static const struct help_entry help_entries[] = {
     /* Input */
     {"stream",     "Input is an ImageStreamIO stream"},
     {"cnt2sync",   "Enable cnt2 synchronization"},
+    {"stream_zerocopy", "Reference stream slices without copying"},
+    {"dtype",      "Frame storage type (f64|f32|u16|u8)"},
+    {"prefetch",   "Decode frames ahead in a reader thread"},
+    {"gricbin",    "Write a binary sidecar of ASCII input"},
     /* Core */
     {"rlim",
      "Distance threshold for cluster membership"},
@@ -38,16 +42,22 @@ static const struct help_entry help_entries[] = {
     {"dprob",      "Delta probability"},
     {"maxcl",      "Max number of clusters"},
     {"ncpu",       "Number of CPUs to use"},
+    {"specbatch",  "Evaluate distances of B frames ahead"},
     {"maxcl_strategy",
                    "Strategy when maxcl reached"},
     {"discard_frac",
                    "Fraction of oldest clusters to discard"},
     {"maxim",      "Max number of frames"},
+    {"history",    "Frames of per-frame history kept"},
     {"gprob",      "Use geometrical probability"},
     {"fmatcha",    "Set fmatch parameter a"},
     {"fmatchb",    "Set fmatch parameter b"},
     {"maxvis",     "Max visitors for gprob history"},
+    {"framelog_keep",
+                   "Frames whose measurements are kept"},
     {"pred",       "Prediction with pattern detection"},
+    {"predbatch",
+     "Batch-evaluate prediction candidates"},
     {"te4",
      "Use 4-point triangle inequality pruning"},
     {"te5",
@@ -66,6 +76,8 @@ static const struct help_entry help_entries[] = {
      "Popcount-only surrogate (skip Shannon)"},
     {"soft_bayesian",
      "Enable Soft Bayesian update"},
+    {"abandon",
+     "Early-abandon distances beyond factor*rlim"},
     {"sparse_dcc",
      "Sparse cluster-to-cluster distance matrix"},
     {"sparse_dcc_extra_evals",
@@ -97,6 +109,10 @@ static const struct help_entry help_entries[] = {
      "Enable *.clustered.txt output"},
     {"clusters",
      "Enable individual cluster files"},
+    {"gricres",
+     "Enable results.gricres binary bundle"},
+    {"knn",
+     "Write each frame's k nearest past frames"},
     {"no_dcc",
      "Disable dcc.txt output"},
     {"shm",
@@ -118,6 +134,8 @@ static const struct help_entry help_entries[] = {
      "Enable live cross-tile prior injection (1: spatial, 2: hybrid)"},
     {"xtile_decay",
      "Decay coefficient for CPT history co-occurrence table"},
+    {"tile_lag",
+     "Frames a fast tile may run ahead of slow tiles"},
     {"no_xtile",
      "Disable cross-tile trajectory correction (and live prior injection)"},
     {"no_pass2",
@@ -320,6 +338,14 @@ static void print_help_raw(
 #endif
     print_colored_line("    -cnt2sync                Enable cnt2 synchronization (increment cnt2 "
                        "after read)");
+    print_colored_line("    -stream_zerocopy         Cluster stream slices in place (copy only "
+                       "new anchors)");
+    print_colored_line("    -dtype <type>            Frame storage type f64|f32|u16|u8 "
+                       "(default: f64)");
+    print_colored_line("    -prefetch <N>            Decode up to N frames ahead in a reader "
+                       "thread (default: 0 = off)");
+    print_colored_line("    -gricbin                 Write <input>.gricbin binary sidecar of ASCII "
+                       "input for later runs");
 
     printf("  Clustering Control %s(use '-h clustering'"
            " for details)%s\n",
@@ -330,7 +356,11 @@ static void print_help_raw(
     print_colored_line("    -dprob <val>             Delta probability (default: 0.01)");
     print_colored_line("    -maxcl <val>             Max number of clusters (default: 1000)");
     print_colored_line("    -maxim <val>             Max number of frames (default: 100000)");
+    print_colored_line("    -history <N>             Keep a rolling history of the last N frames "
+                       "(default: 0 = all)");
     print_colored_line("    -ncpu <val>              Number of CPUs to use (default: 1)");
+    print_colored_line("      -specbatch <B>         Evaluate distances of B frames ahead in "
+                       "parallel (default: 0 = off)");
 
     printf("    %sTiling:%s\n",
            ANSI_BOLD, ANSI_COLOR_RESET);
@@ -342,6 +372,8 @@ static void print_help_raw(
                        "(default: 1000)");
     print_colored_line("      -xtile [mode]          Enable live cross-tile prior injection (1: spatial, 2: hybrid, default: 2)");
     print_colored_line("      -xtile_decay <val>     Decay coefficient for CPT history (0.0 to 1.0]");
+    print_colored_line("      -tile_lag <N>          Frames a tile may run ahead of the slowest "
+                       "(default: 0)");
     print_colored_line("      -no_xtile              Disable cross-tile Trajectory Fusion & prior injection");
 
     printf("    %sPrediction:%s\n",
@@ -350,6 +382,8 @@ static void print_help_raw(
                        "(default: 10,1000,2)");
     print_colored_line("                            l: pattern length  "
                        "h: history size  n: candidates");
+    print_colored_line("      -predbatch             Evaluate all prediction candidates "
+                       "in one pass");
     print_colored_line("    -tm <coeff>              Transition matrix mixing "
                        "(0.0 to 1.0)");
 
@@ -374,6 +408,8 @@ static void print_help_raw(
            ANSI_BOLD, ANSI_COLOR_RESET);
     print_colored_line("    -te4                     Use 4-point triangle inequality pruning");
     print_colored_line("    -te5                     Use 5-point triangle inequality pruning");
+    print_colored_line("    -abandon <f>             Early-abandon distances beyond f*rlim "
+                       "(f >= 1, default: 0 = off)");
     print_colored_line("    -sparse_dcc              Enable sparse cluster-to-cluster "
                        "distance matrix");
     print_colored_line("      -sparse_dcc_extra_evals  Extra DCC evals per step "
@@ -388,6 +424,8 @@ static void print_help_raw(
                        "(default: 0.5)");
     print_colored_line("      -maxvis <val>          Max visitors for gprob history "
                        "(default: 1000)");
+    print_colored_line("      -framelog_keep <N>     Keep measurements of the last N frames "
+                       "(default: 0 = all)");
 
     printf("    %sSoft Bayesian:%s\n",
            ANSI_BOLD, ANSI_COLOR_RESET);
@@ -449,7 +487,11 @@ static void print_help_raw(
     print_colored_line("    -clustered               Enable *.clustered.txt output "
                        "(default: disabled)");
     print_colored_line("    -clusters                Enable individual cluster files (cluster_X) "
-                       "(default: disabled)\n");
+                       "(default: disabled)");
+    print_colored_line("    -gricres                 Enable results.gricres binary bundle "
+                       "(default: disabled)");
+    print_colored_line("    -knn <k>                 Write each frame's k nearest past frames "
+                       "to knn_online.txt (default: disabled)\n");
 
     printf("%sEXAMPLES%s\n", ANSI_BOLD_CYAN, ANSI_COLOR_RESET);
     printf("  %s$%s %sgric-cluster%s"
@@ -10,6 +10,9 @@
 
 #include "cluster_io.h"
 #include "common.h"
+#include "frame_dtype.h"
+#include "frameread.h"
+#include "shared/dist_kernels.h"
 
 /**
  * write_run_log() - Dumps step-by-step diagnostic information of the execution.
@@ -70,12 +73,15 @@ void write_run_log(
         fprintf(f, "PARAM_FMATCHB: %f\n", config->optim.fmatch_b);
         fprintf(f, "PARAM_TE4: %d\n", config->optim.te4_mode);
         fprintf(f, "PARAM_TE5: %d\n", config->optim.te5_mode);
+        fprintf(f, "PARAM_ABANDON: %f\n", config->optim.abandon_factor);
         fprintf(f, "PARAM_ENTROPY: %d\n", config->optim.entropy_mode);
         fprintf(f, "PARAM_ENTROPY_FAST: %d\n", config->optim.entropy_fast_mode);
         fprintf(f, "PARAM_ENTROPY_GATE: %f\n", config->optim.entropy_gate_bits);
         fprintf(f, "PARAM_ENTROPY_FIRST_GATE: %f\n", config->optim.entropy_first_gate_bits);
         fprintf(f, "PARAM_ENTROPY_MAX_TARGETS: %d\n", config->optim.entropy_max_targets);
         fprintf(f, "PARAM_ENTROPY_MIN_PROB: %f\n", config->optim.entropy_min_prob);
+        fprintf(f, "PARAM_DTYPE: %s\n", frame_dtype_name(config->input.frame_dtype));
+        fprintf(f, "DIST_KERNEL_ISA: %s\n", dist_isa_name(dist_kernels_isa()));
 
         if (config->output.output_dcc)
         {
@@ -125,8 +131,27 @@ void write_run_log(
         fprintf(f, "STATS_DISTS_SAMPLE: %ld\n", state->telemetry.framedist_calls_sample);
         fprintf(f, "STATS_DISTS_INTERCLUSTER: %ld\n",
                 state->telemetry.framedist_calls_intercluster);
+        fprintf(f, "STATS_DISTS_ABANDONED: %ld\n", state->telemetry.framedist_abandoned);
         fprintf(f, "STATS_PRUNED: %ld\n", state->telemetry.clusters_pruned);
         fprintf(f, "STATS_MAX_RSS_KB: %ld\n", max_rss);
+        fprintf(f, "STATS_DCC_BYTES: %zu\n", dcc_store_bytes(&state->scratch.dcc));
+        if (config->input.prefetch_depth > 0)
+        {
+            FramePrefetchStats pf;
+            frameread_prefetch_get_stats(&pf);
+            fprintf(f, "STATS_PREFETCH_DEPTH: %d\n", pf.depth);
+            fprintf(f, "STATS_PREFETCH_AVG_FILL: %.3f\n", pf.avg_fill);
+            fprintf(f, "STATS_PREFETCH_STALLS: %ld\n", pf.stalls);
+            fprintf(f, "STATS_PREFETCH_STALL_MS: %.3f\n", pf.stall_ms);
+            fprintf(f, "STATS_PREFETCH_FULL_WAITS: %ld\n", pf.full_waits);
+        }
+        if (config->optim.spec_batch > 1)
+        {
+            fprintf(f, "STATS_SPEC_BATCH: %d\n", config->optim.spec_batch);
+            fprintf(f, "STATS_SPEC_EVALUATED: %ld\n", state->telemetry.spec_evaluated);
+            fprintf(f, "STATS_SPEC_USED: %ld\n", state->telemetry.spec_used);
+            fprintf(f, "STATS_SPEC_TIME_MS: %.3f\n", state->telemetry.time_spec_ms);
+        }
         fprintf(f, "STATS_TIME_STEP_1_MS: %.3f\n", state->telemetry.time_step_1);
         fprintf(f, "STATS_TIME_STEP_2_MS: %.3f\n", state->telemetry.time_step_2);
         fprintf(f, "STATS_TIME_STEP_3A_MS: %.3f\n", state->telemetry.time_step_3a);
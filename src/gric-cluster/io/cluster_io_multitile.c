@@ -8,8 +8,10 @@
 
 #include "cluster_io_multitile.h"
 #include "cluster_io.h"
+#include "cluster_mgmt.h"
 #include "tile_state.h"
 #include "frameread.h"
+#include "frame_dtype.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -73,11 +75,10 @@ static void write_tile_anchors(
 
     for (int c = 0; c < ts->state.num_clusters; c++)
     {
-        const double *data =
-            ts->state.clusters[c].anchor.data;
+        const Frame *anchor = &ts->state.clusters[c].anchor;
         for (long k = 0; k < nelements; k++)
         {
-            fprintf(fp, "%f ", data[k]);
+            fprintf(fp, "%f ", frame_get(anchor, k));
         }
         fprintf(fp, "\n");
     } // for each cluster c
@@ -220,6 +221,7 @@ void write_results_multitile(
         safe_mkdir(tile_dir);
 
         TileState *ts = &mts->tile_states[m];
+        resolve_assignments(&ts->state, 0);
 
         if (config->output.output_anchors)
         {
@@ -241,12 +243,16 @@ void write_results_multitile(
                 fits_create_img(afptr, DOUBLE_IMG, 3, naxes, &status);
 
                 long nelements = ts->tile_frame.width * ts->tile_frame.height;
-                for (int i = 0; i < ts->state.num_clusters; i++)
+                double *conv = (double *)malloc((size_t)nelements * sizeof(double));
+                for (int i = 0; i < ts->state.num_clusters && conv; i++)
                 {
                     long fpixel[3] = {1, 1, i + 1};
                     fits_write_pix(afptr, TDOUBLE, fpixel, nelements,
-                                   ts->state.clusters[i].anchor.data, &status);
+                                   (double *)frame_as_double(&ts->state.clusters[i].anchor,
+                                                             conv),
+                                   &status);
                 }
+                free(conv);
                 fits_close_file(afptr, &status);
 #else
                 printf("  Tile %d: writing anchors.txt (FITS disabled)\n", m);
@@ -271,20 +277,16 @@ void write_results_multitile(
             if (dcc_fp)
             {
                 int ncl = ts->state.num_clusters;
-                int maxcl =
-                    ts->config.algo.maxnbclust;
+                const DccStore *dcc =
+                    &ts->state.scratch.dcc;
                 for (int i = 0; i < ncl; i++)
                 {
                     for (int j = 0; j < ncl; j++)
                     {
-                        int idx =
-                            i * maxcl + j;
                         double d =
-                            ts->state.scratch
-                                .dcc_min[idx];
+                            dcc_get_min(dcc, i, j);
                         int meas =
-                            ts->state.scratch
-                                .dcc_measured[idx];
+                            dcc_get_measured(dcc, i, j);
                         if (meas && d >= 0)
                         {
                             fprintf(dcc_fp,
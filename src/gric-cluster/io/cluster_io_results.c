@@ -18,8 +18,709 @@
 #endif
 
 #include "cluster_io.h"
+#include "cluster_mgmt.h"
 #include "common.h"
+#include "frame_dtype.h"
 #include "frameread.h"
+#include "shared/gricres.h"
+
+/** Cluster frame files (-clusters) kept open at once while routing frames. */
+#define RESULTS_MAX_OPEN 64
+
+/** Memory for the per-cluster -avg accumulators of one pass over the input. */
+#define RESULTS_AVG_BUDGET ((size_t)256 << 20)
+
+/** Storage of the per-cluster frame files and averages. */
+typedef enum
+{
+    RESULTS_SINK_NONE = 0, /**< Not compiled in: nothing written */
+    RESULTS_SINK_PNG,      /**< cluster_NNNN/frameNNNNN.png, average_NNNN.png */
+    RESULTS_SINK_ASCII,    /**< cluster_N.txt, average.txt */
+    RESULTS_SINK_FITS      /**< cluster_N.fits cubes, average.fits */
+} ResultsSink;
+
+/**
+ * Per-cluster frame files written in input order. At most RESULTS_MAX_OPEN
+ * are open at a time; the least recently used one is closed to make room
+ * and reopened for appending when its cluster comes back.
+ */
+typedef struct
+{
+    ResultsSink sink;                           /**< Storage of the files */
+    const char *out_dir;                        /**< Output directory */
+    long        width;                          /**< Frame width */
+    long        height;                         /**< Frame height */
+    const int  *counts;                         /**< Members per cluster (FITS cube depth) */
+    int        *written;                        /**< Frames written per cluster */
+    int         slot_cluster[RESULTS_MAX_OPEN]; /**< Cluster of each slot, -1 if free */
+    long        slot_used[RESULTS_MAX_OPEN];    /**< Last use of each slot, 0 if free */
+    void       *slot_file[RESULTS_MAX_OPEN];    /**< FILE * or fitsfile * */
+    long        clock;                          /**< Use counter */
+} ClusterFiles;
+
+/**
+ * cluster_files_close() - Close the file held in slot @ss.
+ * @cf: Cluster files.
+ * @ss: Slot index.
+ */
+static void cluster_files_close(
+    ClusterFiles *cf,
+    int           ss)
+{
+    if (cf->slot_cluster[ss] < 0)
+    {
+        return;
+    }
+    if (cf->sink == RESULTS_SINK_ASCII)
+    {
+        fclose((FILE *)cf->slot_file[ss]);
+    }
+#ifdef USE_CFITSIO
+    else if (cf->sink == RESULTS_SINK_FITS)
+    {
+        int status = 0;
+        fits_close_file((fitsfile *)cf->slot_file[ss], &status);
+    }
+#endif
+    cf->slot_cluster[ss] = -1;
+    cf->slot_used[ss]    = 0;
+    cf->slot_file[ss]    = NULL;
+}
+
+/**
+ * cluster_files_get() - Open file of cluster @c, opening it if needed.
+ * @cf: Cluster files (ASCII or FITS sink).
+ * @c:  Cluster index.
+ *
+ * A cluster's first open creates its file (a FITS cube sized for all its
+ * members); later opens append to it.
+ *
+ * Return: FILE * or fitsfile *, or NULL if the file cannot be opened.
+ */
+static void *cluster_files_get(
+    ClusterFiles *cf,
+    int           c)
+{
+    /* Free slots have slot_used 0, so they are taken before any open one */
+    int ss_free = 0;
+    for (int ss = 0; ss < RESULTS_MAX_OPEN; ss++)
+    {
+        if (cf->slot_cluster[ss] == c)
+        {
+            cf->slot_used[ss] = ++cf->clock;
+            return cf->slot_file[ss];
+        }
+        if (cf->slot_used[ss] < cf->slot_used[ss_free])
+        {
+            ss_free = ss;
+        }
+    }
+    cluster_files_close(cf, ss_free);
+
+    char  fname[1024];
+    void *file = NULL;
+    if (cf->sink == RESULTS_SINK_ASCII)
+    {
+        snprintf(fname, sizeof(fname), "%s/cluster_%d.txt", cf->out_dir, c);
+        file = fopen(fname, cf->written[c] ? "a" : "w");
+    }
+#ifdef USE_CFITSIO
+    else if (cf->sink == RESULTS_SINK_FITS)
+    {
+        int       status = 0;
+        fitsfile *fptr   = NULL;
+        if (cf->written[c] == 0)
+        {
+            snprintf(fname, sizeof(fname), "!%s/cluster_%d.fits", cf->out_dir, c);
+            fits_create_file(&fptr, fname, &status);
+            long cnaxes[3] = {cf->width, cf->height, cf->counts[c]};
+            fits_create_img(fptr, DOUBLE_IMG, 3, cnaxes, &status);
+        }
+        else
+        {
+            snprintf(fname, sizeof(fname), "%s/cluster_%d.fits", cf->out_dir, c);
+            fits_open_file(&fptr, fname, READWRITE, &status);
+        }
+        file = (status == 0) ? fptr : NULL;
+    }
+#endif
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    cf->slot_cluster[ss_free] = c;
+    cf->slot_used[ss_free]    = ++cf->clock;
+    cf->slot_file[ss_free]    = file;
+    return file;
+}
+
+/**
+ * cluster_files_write() - Append frame @f to the file(s) of cluster @c.
+ * @cf: Cluster files.
+ * @c:  Cluster index.
+ * @f:  Frame index.
+ * @px: Frame pixels as doubles.
+ */
+static void cluster_files_write(
+    ClusterFiles *cf,
+    int           c,
+    long          f,
+    const double *px)
+{
+    long nelements = cf->width * cf->height;
+
+    if (cf->sink == RESULTS_SINK_PNG)
+    {
+#ifdef USE_PNG
+        char out_path[4096];
+        snprintf(out_path, sizeof(out_path), "%s/cluster_%04d/frame%05ld.png", cf->out_dir, c,
+                 f);
+        write_png_frame(out_path, (double *)px, cf->width, cf->height);
+#endif
+    }
+    else if (cf->sink == RESULTS_SINK_ASCII)
+    {
+        FILE *cfptr = (FILE *)cluster_files_get(cf, c);
+        if (cfptr)
+        {
+            for (long k = 0; k < nelements; k++)
+            {
+                fprintf(cfptr, "%f ", px[k]);
+            }
+            fprintf(cfptr, "\n");
+        }
+    }
+#ifdef USE_CFITSIO
+    else if (cf->sink == RESULTS_SINK_FITS)
+    {
+        fitsfile *cfptr = (fitsfile *)cluster_files_get(cf, c);
+        if (cfptr)
+        {
+            int  status    = 0;
+            long fpixel[3] = {1, 1, cf->written[c] + 1};
+            fits_write_pix(cfptr, TDOUBLE, fpixel, nelements, (double *)px, &status);
+        }
+    }
+#endif
+    cf->written[c]++;
+}
+
+/**
+ * clustered_open() - Create the -clustered file and write its header.
+ * @config:  Pointer to the active ClusterConfig.
+ * @state:   Pointer to the active ClusterState.
+ * @out_dir: Output directory.
+ *
+ * Return: Open file, or NULL on failure.
+ */
+static FILE *clustered_open(
+    ClusterConfig *config,
+    ClusterState  *state,
+    const char    *out_dir)
+{
+    const char *base_name_only = strrchr(config->input.fits_filename, '/');
+
+    if (base_name_only)
+    {
+        base_name_only++;
+    }
+    else
+    {
+        base_name_only = config->input.fits_filename;
+    }
+
+    char *temp_base = strdup(base_name_only);
+    if (temp_base == NULL)
+    {
+        return NULL;
+    }
+    char *ext = strrchr(temp_base, '.');
+
+    if (ext && strcmp(ext, ".txt") == 0)
+    {
+        *ext = '\0';
+    }
+
+    char *clustered_fname = (char *)malloc(strlen(out_dir) + strlen(temp_base) + 30);
+    if (clustered_fname == NULL)
+    {
+        free(temp_base);
+        return NULL;
+    }
+    sprintf(clustered_fname, "%s/%s.clustered.txt", out_dir, temp_base);
+    free(temp_base);
+    FILE *clustered_out = fopen(clustered_fname, "w");
+    free(clustered_fname);
+
+    if (clustered_out == NULL)
+    {
+        return NULL;
+    }
+
+    fprintf(clustered_out, "# Parameters:\n");
+    fprintf(clustered_out, "# rlim %.6f\n", config->algo.rlim);
+    fprintf(clustered_out, "# dprob %.6f\n", config->algo.deltaprob);
+    fprintf(clustered_out, "# maxcl %d\n", config->algo.maxnbclust);
+    fprintf(clustered_out, "# maxim %ld\n", config->input.maxnbfr);
+    fprintf(clustered_out, "# gprob_mode %d\n", config->optim.gprob_mode);
+    fprintf(clustered_out, "# fmatcha %.2f\n", config->optim.fmatch_a);
+    fprintf(clustered_out, "# fmatchb %.2f\n", config->optim.fmatch_b);
+
+    fprintf(clustered_out, "# Stats:\n");
+    fprintf(clustered_out, "# Total Clusters %d\n", state->num_clusters);
+    fprintf(clustered_out,
+            "# Total Distance Computations %ld\n",
+            state->telemetry.framedist_calls);
+    fprintf(clustered_out, "# Clusters Pruned %ld\n",
+            state->telemetry.clusters_pruned);
+
+    double avg_dist = 0.0;
+    if (state->telemetry.total_frames_processed > 0)
+    {
+        avg_dist = (double)state->telemetry.framedist_calls /
+                   state->telemetry.total_frames_processed;
+    }
+    fprintf(clustered_out, "# Avg Dist/Frame %.2f\n", avg_dist);
+
+    if (state->telemetry.pruned_fraction_sum && state->telemetry.step_counts)
+    {
+        for (int k = 0; k < state->telemetry.max_steps_recorded; k++)
+        {
+            if (state->telemetry.step_counts[k] > 0)
+            {
+                fprintf(clustered_out,
+                        "# Pruning Step %d: %.4f\n",
+                        k,
+                        state->telemetry.pruned_fraction_sum[k] /
+                        state->telemetry.step_counts[k]);
+            }
+            else if (k > 0 && state->telemetry.step_counts[k] == 0)
+            {
+                break;
+            }
+        } // for (int k = 0; ...)
+    }
+    return clustered_out;
+}
+
+/**
+ * write_averages() - Write the averages of clusters [@c0, @c1).
+ * @sink:      Output storage.
+ * @out_dir:   Output directory.
+ * @counts:    Members per cluster.
+ * @c0:        First cluster of the group.
+ * @c1:        End of the group.
+ * @acc:       Pixel sums of the group, one frame per cluster; divided in place.
+ * @nelements: Pixels per frame.
+ * @avg_file:  ASCII average.txt (RESULTS_SINK_ASCII).
+ * @avg_fits:  FITS average cube (RESULTS_SINK_FITS).
+ */
+static void write_averages(
+    ResultsSink sink,
+    const char *out_dir,
+    const int  *counts,
+    int         c0,
+    int         c1,
+    double     *acc,
+    long        nelements,
+    FILE       *avg_file,
+    void       *avg_fits)
+{
+    (void)out_dir;
+    (void)avg_fits;
+    for (int c = c0; c < c1; c++)
+    {
+        double *avg = acc + (size_t)(c - c0) * nelements;
+        if (counts[c] == 0)
+        {
+            if (sink == RESULTS_SINK_ASCII && avg_file)
+            {
+                for (long k = 0; k < nelements; k++)
+                {
+                    fprintf(avg_file, "0.0 ");
+                }
+                fprintf(avg_file, "\n");
+            }
+            continue;
+        }
+
+        if (sink == RESULTS_SINK_ASCII)
+        {
+            if (avg_file)
+            {
+                for (long k = 0; k < nelements; k++)
+                {
+                    fprintf(avg_file, "%f ", avg[k] / counts[c]);
+                }
+                fprintf(avg_file, "\n");
+            }
+            continue;
+        }
+
+        for (long k = 0; k < nelements; k++)
+        {
+            avg[k] /= counts[c];
+        }
+#ifdef USE_PNG
+        if (sink == RESULTS_SINK_PNG)
+        {
+            char out_path[4096];
+            snprintf(out_path, sizeof(out_path), "%s/average_%04d.png", out_dir, c);
+            write_png_frame(out_path, avg, get_frame_width(), get_frame_height());
+        }
+#endif
+#ifdef USE_CFITSIO
+        if (sink == RESULTS_SINK_FITS && avg_fits)
+        {
+            int  status    = 0;
+            long fpixel[3] = {1, 1, c + 1};
+            fits_write_pix((fitsfile *)avg_fits, TDOUBLE, fpixel, nelements, avg, &status);
+        }
+#endif
+    }
+}
+
+/**
+ * write_member_frames() - Write every output that needs the input frames again.
+ * @config:   Pointer to the active ClusterConfig.
+ * @state:    Pointer to the active ClusterState.
+ * @out_dir:  Output directory.
+ * @counts:   Members per cluster.
+ * @conv_buf: Double conversion buffer of one frame.
+ *
+ * Per-cluster frame files (-clusters), averages (-avg) and the -clustered
+ * file are fed from one sequential pass over the input: each frame is read
+ * once, in order, and routed to its cluster's file and accumulator. Only
+ * RESULTS_MAX_OPEN cluster files are open at a time. The -avg accumulators
+ * take one frame per cluster; when they would exceed RESULTS_AVG_BUDGET the
+ * clusters are split into groups and the input is read again for each
+ * further group (members of the group only).
+ */
+static void write_member_frames(
+    ClusterConfig *config,
+    ClusterState  *state,
+    const char    *out_dir,
+    const int     *counts,
+    double        *conv_buf)
+{
+    long width     = get_frame_width();
+    long height    = get_frame_height();
+    long nelements = width * height;
+    long base      = state->history_base;
+    long nframes   = state->telemetry.total_frames_processed;
+    int  K         = state->num_clusters;
+
+    ResultsSink sink = RESULTS_SINK_NONE;
+    if (config->output.pngout_mode)
+    {
+#ifdef USE_PNG
+        sink = RESULTS_SINK_PNG;
+#endif
+    }
+    else if (is_ascii_input_mode() && !config->output.fitsout_mode)
+    {
+        sink = RESULTS_SINK_ASCII;
+    }
+    else
+    {
+#ifdef USE_CFITSIO
+        sink = RESULTS_SINK_FITS;
+#endif
+    }
+
+    int to_files = config->output.output_clusters && sink != RESULTS_SINK_NONE;
+    int to_avg   = config->output.average_mode && sink != RESULTS_SINK_NONE;
+
+    int active_cluster_count = 0;
+
+    for (int c = 0; c < K; c++)
+    {
+        if (counts[c] > 0)
+        {
+            active_cluster_count++;
+        }
+    }
+
+    if (config->output.output_clusters)
+    {
+        printf("Writing cluster files (%d files)\n", active_cluster_count);
+    }
+
+    /* Averages of `group` clusters are accumulated per pass */
+    int     group   = (K > 0) ? K : 1;
+    double *avg_acc = NULL;
+    if (to_avg)
+    {
+        size_t per = (size_t)nelements * sizeof(double);
+        if ((size_t)group * per > RESULTS_AVG_BUDGET)
+        {
+            group = (per < RESULTS_AVG_BUDGET) ? (int)(RESULTS_AVG_BUDGET / per) : 1;
+        }
+        avg_acc = (double *)malloc((size_t)group * per);
+        if (avg_acc == NULL)
+        {
+            fprintf(stderr, "ERROR: [%s:%d] average buffer allocation failed\n",
+                    __FILE__, __LINE__);
+            to_avg = 0;
+            group  = (K > 0) ? K : 1;
+        }
+    }
+    if (config->output.average_mode)
+    {
+        int npass = (K + group - 1) / group;
+        if (npass > 1)
+        {
+            printf("Writing average cluster files (%d passes of %d clusters)\n", npass, group);
+        }
+        else
+        {
+            printf("Writing average cluster files\n");
+        }
+    }
+
+    ClusterFiles cf;
+    memset(&cf, 0, sizeof(cf));
+    cf.sink    = sink;
+    cf.out_dir = out_dir;
+    cf.width   = width;
+    cf.height  = height;
+    cf.counts  = counts;
+    cf.written = (int *)calloc((K > 0) ? K : 1, sizeof(int));
+    for (int ss = 0; ss < RESULTS_MAX_OPEN; ss++)
+    {
+        cf.slot_cluster[ss] = -1;
+    }
+    if (cf.written == NULL)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] cluster file table allocation failed\n",
+                __FILE__, __LINE__);
+        free(avg_acc);
+        return;
+    }
+    if (to_files && sink == RESULTS_SINK_PNG)
+    {
+        for (int c = 0; c < K; c++)
+        {
+            if (counts[c] > 0)
+            {
+                char cluster_dir[1024];
+                snprintf(cluster_dir, sizeof(cluster_dir), "%s/cluster_%04d", out_dir, c);
+                safe_mkdir(cluster_dir);
+            }
+        }
+    }
+
+    FILE *avg_file = NULL;
+    void *avg_fits = NULL;
+    char  out_path[4096];
+    if (to_avg && sink == RESULTS_SINK_ASCII)
+    {
+        snprintf(out_path, sizeof(out_path), "%s/average.txt", out_dir);
+        avg_file = fopen(out_path, "w");
+    }
+#ifdef USE_CFITSIO
+    if (to_avg && sink == RESULTS_SINK_FITS)
+    {
+        int       status = 0;
+        fitsfile *avg_ptr = NULL;
+        snprintf(out_path, sizeof(out_path), "!%s/average.fits", out_dir);
+        fits_create_file(&avg_ptr, out_path, &status);
+        long anaxes[3] = {width, height, K};
+        fits_create_img(avg_ptr, DOUBLE_IMG, 3, anaxes, &status);
+        avg_fits = avg_ptr;
+    }
+#endif
+
+    FILE *clustered_out = NULL;
+    if (config->output.output_clustered)
+    {
+        printf("Writing clustered output file\n");
+        clustered_out = clustered_open(config, state, out_dir);
+    }
+
+    int next_new_cluster = 0;
+    int c0 = 0;
+    do
+    {
+        int c1    = (K - c0 < group) ? K : c0 + group;
+        int first = (c0 == 0);
+        if (to_avg)
+        {
+            memset(avg_acc, 0, (size_t)(c1 - c0) * nelements * sizeof(double));
+        }
+
+        for (long f = base; f < nframes; f++)
+        {
+            int c      = state->assignments[f - base];
+            int member = (c >= 0 && c < K && counts[c] > 0);
+            int need_file = first && to_files && member;
+            int need_avg  = to_avg && member && c >= c0 && c < c1;
+            int need_line = first && clustered_out != NULL;
+
+            if (need_line && c == next_new_cluster)
+            {
+                fprintf(clustered_out, "# NEWCLUSTER %d %ld ", c, f);
+                for (long k = 0; k < nelements; k++)
+                {
+                    fprintf(clustered_out, "%f ", frame_get(&state->clusters[c].anchor, k));
+                }
+                fprintf(clustered_out, "\n");
+                next_new_cluster++;
+            }
+            if (!need_file && !need_avg && !need_line)
+            {
+                continue;
+            }
+
+            Frame *fr = getframe_at(f);
+            if (fr == NULL)
+            {
+                continue;
+            }
+            const double *px = frame_as_double(fr, conv_buf);
+            if (need_file)
+            {
+                cluster_files_write(&cf, c, f, px);
+            }
+            if (need_avg)
+            {
+                double *acc = avg_acc + (size_t)(c - c0) * nelements;
+                for (long k = 0; k < nelements; k++)
+                {
+                    acc[k] += px[k];
+                }
+            }
+            if (need_line)
+            {
+                fprintf(clustered_out, "%ld %d ", f, c);
+                for (long k = 0; k < nelements; k++)
+                {
+                    fprintf(clustered_out, "%f ", px[k]);
+                }
+                fprintf(clustered_out, "\n");
+            }
+            free_frame(fr);
+        } // for (long f = base; ...)
+
+        if (first)
+        {
+            for (int ss = 0; ss < RESULTS_MAX_OPEN; ss++)
+            {
+                cluster_files_close(&cf, ss);
+            }
+            if (clustered_out)
+            {
+                fclose(clustered_out);
+                clustered_out = NULL;
+            }
+        }
+        if (to_avg)
+        {
+            write_averages(sink, out_dir, counts, c0, c1, avg_acc, nelements, avg_file,
+                           avg_fits);
+        }
+        c0 = c1;
+    } while (to_avg && c0 < K);
+
+    if (avg_file)
+    {
+        fclose(avg_file);
+    }
+#ifdef USE_CFITSIO
+    if (avg_fits)
+    {
+        int status = 0;
+        fits_close_file((fitsfile *)avg_fits, &status);
+    }
+#endif
+    free(cf.written);
+    free(avg_acc);
+}
+
+/**
+ * drop_gricres() - Abandon the results bundle, if one is being written.
+ * @state: Pointer to the active ClusterState.
+ */
+static void drop_gricres(
+    ClusterState *state)
+{
+    if (state->gricres)
+    {
+        gricres_writer_abort(state->gricres);
+        free(state->gricres);
+        state->gricres = NULL;
+    }
+}
+
+/**
+ * finish_gricres() - Complete the results bundle (-gricres).
+ * @config:            Pointer to the active ClusterConfig.
+ * @state:             Pointer to the active ClusterState; its bundle writer is released.
+ * @cluster_counts:    Member count of each cluster.
+ * @cluster_max_radii: Largest member distance of each cluster, or NULL.
+ * @conv_buf:          Double conversion buffer of one frame.
+ *
+ * The membership columns were filled during the run; this appends the
+ * measured inter-cluster distances, the per-cluster summary and the anchors,
+ * then writes the header with the run parameters and distance telemetry.
+ */
+static void finish_gricres(
+    ClusterConfig *config,
+    ClusterState  *state,
+    const int     *cluster_counts,
+    const double  *cluster_max_radii,
+    double        *conv_buf)
+{
+    GricResWriter *w = state->gricres;
+    int K = state->num_clusters;
+    printf("Writing %s\n", GRICRES_FILE);
+
+    gricres_writer_begin(w, GRICRES_SEC_DCC, sizeof(GricResDcc));
+    for (int i = 0; i < K; i++)
+    {
+        for (int j = 0; j < K; j++)
+        {
+            double d = dcc_get_min(&state->scratch.dcc, i, j);
+            if (dcc_get_measured(&state->scratch.dcc, i, j) && d >= 0)
+            {
+                GricResDcc e = {i, j, d};
+                gricres_writer_put(w, &e, 1);
+            }
+        }
+    }
+
+    gricres_writer_begin(w, GRICRES_SEC_CLUSTERS, sizeof(GricResCluster));
+    for (int c = 0; c < K; c++)
+    {
+        GricResCluster e = {cluster_counts[c], cluster_max_radii ? cluster_max_radii[c] : 0.0};
+        gricres_writer_put(w, &e, 1);
+    }
+
+    long nelements = get_frame_width() * get_frame_height();
+    gricres_writer_begin(w, GRICRES_SEC_ANCHORS, sizeof(double));
+    for (int c = 0; c < K; c++)
+    {
+        gricres_writer_put(w, frame_as_double(&state->clusters[c].anchor, conv_buf),
+                           (size_t)nelements);
+    }
+
+    GricResHeader info = {0};
+    info.num_clusters       = (uint64_t)K;
+    info.frame_width        = (uint64_t)get_frame_width();
+    info.frame_height       = (uint64_t)get_frame_height();
+    info.rlim               = config->algo.rlim;
+    info.deltaprob          = config->algo.deltaprob;
+    info.maxcl              = config->algo.maxnbclust;
+    info.dists              = (uint64_t)state->telemetry.framedist_calls;
+    info.dists_sample       = (uint64_t)state->telemetry.framedist_calls_sample;
+    info.dists_intercluster = (uint64_t)state->telemetry.framedist_calls_intercluster;
+    info.dists_abandoned    = (uint64_t)state->telemetry.framedist_abandoned;
+    info.pruned             = (uint64_t)state->telemetry.clusters_pruned;
+    gricres_writer_finish(w, &info);
+
+    free(w);
+    state->gricres = NULL;
+}
 
 /**
  * write_results() - Outputs the clustered coordinate and membership files.
@@ -35,6 +736,10 @@ void write_results(
 {
     char *out_dir = NULL;
 
+    /* Frames older than history_base are no longer held in a rolling history */
+    long base = state->history_base;
+    resolve_assignments(state, base);
+
     if (config->output.user_outdir)
     {
         out_dir = strdup(config->output.user_outdir);
@@ -46,6 +751,7 @@ void write_results(
 
     if (!out_dir)
     {
+        drop_gricres(state);
         return;
     }
 
@@ -64,9 +770,9 @@ void write_results(
             {
                 for (int j = 0; j < state->num_clusters; j++)
                 {
-                    double d = state->scratch.dcc_min[i * config->algo.maxnbclust + j];
+                    double d = dcc_get_min(&state->scratch.dcc, i, j);
 
-                    if (state->scratch.dcc_measured[i * config->algo.maxnbclust + j] && d >= 0)
+                    if (dcc_get_measured(&state->scratch.dcc, i, j) && d >= 0)
                     {
                         fprintf(dcc_out, "%d %d %.6f\n", i, j, d);
                     }
@@ -89,7 +795,7 @@ void write_results(
             {
                 for (int j = 0; j < state->num_clusters; j++)
                 {
-                    long val = state->transition_matrix[i * config->algo.maxnbclust + j];
+                    long val = *transition_cell(state, i, j);
 
                     if (val > 0)
                     {
@@ -106,6 +812,17 @@ void write_results(
     long height = get_frame_height();
     long nelements = width * height;
 
+    /* Double view of narrow-dtype frames for writers that need doubles */
+    double *conv_buf = (double *)malloc((size_t)nelements * sizeof(double));
+    if (conv_buf == NULL)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] conversion buffer allocation failed\n",
+                __FILE__, __LINE__);
+        drop_gricres(state);
+        free(out_dir);
+        return;
+    }
+
     if (config->output.output_anchors)
     {
         printf("Writing anchors\n");
@@ -115,7 +832,10 @@ void write_results(
             for (int i = 0; i < state->num_clusters; i++)
             {
                 snprintf(out_path, sizeof(out_path), "%s/anchor_%04d.png", out_dir, i);
-                write_png_frame(out_path, state->clusters[i].anchor.data, width, height);
+                write_png_frame(out_path,
+                                (double *)frame_as_double(&state->clusters[i].anchor,
+                                                          conv_buf),
+                                width, height);
             }
 #else
             fprintf(stderr, "Warning: PNG output requested but not compiled in.\n");
@@ -132,7 +852,7 @@ void write_results(
                 {
                     for (long k = 0; k < nelements; k++)
                     {
-                        fprintf(afptr, "%f ", state->clusters[i].anchor.data[k]);
+                        fprintf(afptr, "%f ", frame_get(&state->clusters[i].anchor, k));
                     }
                     fprintf(afptr, "\n");
                 }
@@ -153,7 +873,8 @@ void write_results(
             {
                 long fpixel[3] = {1, 1, i + 1};
                 fits_write_pix(afptr, TDOUBLE, fpixel, nelements,
-                               state->clusters[i].anchor.data, &status);
+                               (double *)frame_as_double(&state->clusters[i].anchor, conv_buf),
+                               &status);
             }
             fits_close_file(afptr, &status);
 #else
@@ -168,7 +889,7 @@ void write_results(
                 {
                     for (long k = 0; k < nelements; k++)
                     {
-                        fprintf(afptr, "%f ", state->clusters[i].anchor.data[k]);
+                        fprintf(afptr, "%f ", frame_get(&state->clusters[i].anchor, k));
                     }
                     fprintf(afptr, "\n");
                 }
@@ -181,11 +902,11 @@ void write_results(
     // Cluster Counts
     int *cluster_counts = (int *)calloc(state->num_clusters, sizeof(int));
 
-    for (long i = 0; i < state->telemetry.total_frames_processed; i++)
+    for (long i = base; i < state->telemetry.total_frames_processed; i++)
     {
-        if (state->assignments[i] >= 0 && state->assignments[i] < state->num_clusters)
+        if (state->assignments[i - base] >= 0 && state->assignments[i - base] < state->num_clusters)
         {
-            cluster_counts[state->assignments[i]]++;
+            cluster_counts[state->assignments[i - base]]++;
         }
     }
 
@@ -206,449 +927,55 @@ void write_results(
     }
 
     // Write Cluster Radii
+    double *cluster_max_radii = (double *)calloc(state->num_clusters, sizeof(double));
+    if (cluster_max_radii)
     {
-        double *cluster_max_radii = (double *)calloc(state->num_clusters, sizeof(double));
-        if (cluster_max_radii)
-        {
-            for (long f = 0; f < state->telemetry.total_frames_processed; f++)
-            {
-                int c = state->assignments[f];
-                if (c >= 0 && c < state->num_clusters && state->frame_infos &&
-                    state->frame_infos[f].cluster_indices && state->frame_infos[f].distances)
-                {
-                    double d = 0.0;
-                    for (int i = 0; i < state->frame_infos[f].num_dists; i++)
-                    {
-                        if (state->frame_infos[f].cluster_indices[i] == c)
-                        {
-                            d = state->frame_infos[f].distances[i];
-                            break;
-                        }
-                    }
-                    if (d > cluster_max_radii[c])
-                    {
-                        cluster_max_radii[c] = d;
-                    }
-                }
-            } // for (long f = 0; ...)
-
-            snprintf(out_path, sizeof(out_path), "%s/cluster_radii.txt", out_dir);
-            FILE *radii_out = fopen(out_path, "w");
-            if (radii_out)
-            {
-                fprintf(radii_out, "# cluster_id member_count max_radius\n");
-                for (int c = 0; c < state->num_clusters; c++)
-                {
-                    fprintf(radii_out, "%d %d %.6f\n",
-                            c, cluster_counts[c], cluster_max_radii[c]);
-                }
-                fclose(radii_out);
-            } // if (radii_out)
-            free(cluster_max_radii);
-        } // if (cluster_max_radii)
-    } // Write Cluster Radii
-
-    // Average buffer
-    double *avg_buffer = NULL;
-
-    if (config->output.average_mode)
-    {
-        avg_buffer = (double *)calloc(nelements, sizeof(double));
-    }
-
-    int active_cluster_count = 0;
-
-    for (int c = 0; c < state->num_clusters; c++)
-    {
-        if (cluster_counts[c] > 0)
-        {
-            active_cluster_count++;
-        }
-    }
-
-    if (config->output.output_clusters)
-    {
-        printf("Writing cluster files (%d files)\n", active_cluster_count);
-    }
-
-    if (config->output.average_mode)
-    {
-        printf("Writing average cluster files\n");
-    }
-
-    if (config->output.pngout_mode)
-    {
-#ifdef USE_PNG
-        for (int c = 0; c < state->num_clusters; c++)
-        {
-            if (cluster_counts[c] == 0)
-            {
-                continue;
-            }
-
-            if (config->output.output_clusters)
-            {
-                char cluster_dir[1024];
-                snprintf(cluster_dir, sizeof(cluster_dir), "%s/cluster_%04d", out_dir, c);
-                safe_mkdir(cluster_dir);
-            }
-
-            if (config->output.average_mode)
-            {
-                for (long k = 0; k < nelements; k++)
-                {
-                    avg_buffer[k] = 0.0;
-                }
-            }
-
-            for (long f = 0; f < state->telemetry.total_frames_processed; f++)
-            {
-                if (state->assignments[f] == c)
-                {
-                    Frame *fr = getframe_at(f);
-
-                    if (fr)
-                    {
-                        if (config->output.output_clusters)
-                        {
-                            char cluster_dir[1024];
-                            snprintf(cluster_dir, sizeof(cluster_dir), "%s/cluster_%04d",
-                                     out_dir, c);
-                            snprintf(out_path, sizeof(out_path), "%s/frame%05ld.png",
-                                     cluster_dir, f);
-                            write_png_frame(out_path, fr->data, width, height);
-                        }
-                        if (config->output.average_mode)
-                        {
-                            for (long k = 0; k < nelements; k++)
-                            {
-                                avg_buffer[k] += fr->data[k];
-                            }
-                        }
-                        free_frame(fr);
-                    }
-                }
-            } // for (long f = 0; ...)
-
-            if (config->output.average_mode)
-            {
-                for (long k = 0; k < nelements; k++)
-                {
-                    avg_buffer[k] /= cluster_counts[c];
-                }
-                snprintf(out_path, sizeof(out_path), "%s/average_%04d.png", out_dir, c);
-                write_png_frame(out_path, avg_buffer, width, height);
-            }
-        } // for (int c = 0; ...)
-#endif
-    }
-    else if (is_ascii_input_mode() && !config->output.fitsout_mode)
-    {
-        FILE *avg_file = NULL;
-
-        if (config->output.average_mode)
-        {
-            snprintf(out_path, sizeof(out_path), "%s/average.txt", out_dir);
-            avg_file = fopen(out_path, "w");
-        }
-
-        for (int c = 0; c < state->num_clusters; c++)
+        for (long f = base; f < state->telemetry.total_frames_processed; f++)
         {
-            if (cluster_counts[c] == 0)
+            int c = state->assignments[f - base];
+            const FrameInfo *fi = state->frame_infos ? &state->frame_infos[f - base] : NULL;
+            if (c >= 0 && c < state->num_clusters && fi &&
+                fi->cluster_indices && fi->distances)
             {
-                if (avg_file)
+                double d = 0.0;
+                for (int i = 0; i < fi->num_dists; i++)
                 {
-                    for (long k = 0; k < nelements; k++)
+                    if (fi->cluster_indices[i] == c)
                     {
-                        fprintf(avg_file, "0.0 ");
+                        d = fi->distances[i];
+                        break;
                     }
-                    fprintf(avg_file, "\n");
                 }
-                continue;
-            }
-
-            FILE *cfptr = NULL;
-
-            if (config->output.output_clusters)
-            {
-                char fname[1024];
-                snprintf(fname, sizeof(fname), "%s/cluster_%d.txt", out_dir, c);
-                cfptr = fopen(fname, "w");
-            }
-
-            if (config->output.average_mode)
-            {
-                for (long k = 0; k < nelements; k++)
-                {
-                    avg_buffer[k] = 0.0;
-                }
-            }
-
-            for (long f = 0; f < state->telemetry.total_frames_processed; f++)
-            {
-                if (state->assignments[f] == c)
-                {
-                    Frame *fr = getframe_at(f);
-
-                    if (fr)
-                    {
-                        for (long k = 0; k < nelements; k++)
-                        {
-                            if (cfptr)
-                            {
-                                fprintf(cfptr, "%f ", fr->data[k]);
-                            }
-                            if (config->output.average_mode)
-                            {
-                                avg_buffer[k] += fr->data[k];
-                            }
-                        }
-                        if (cfptr)
-                        {
-                            fprintf(cfptr, "\n");
-                        }
-                        free_frame(fr);
-                    }
-                }
-            } // for (long f = 0; ...)
-
-            if (cfptr)
-            {
-                fclose(cfptr);
-            }
-
-            if (avg_file)
-            {
-                for (long k = 0; k < nelements; k++)
+                if (d > cluster_max_radii[c])
                 {
-                    fprintf(avg_file, "%f ", avg_buffer[k] / cluster_counts[c]);
+                    cluster_max_radii[c] = d;
                 }
-                fprintf(avg_file, "\n");
             }
-        } // for (int c = 0; ...)
-
-        if (avg_file)
-        {
-            fclose(avg_file);
-        }
-    } // else if (is_ascii_input_mode() ...)
-    else
-    {
-#ifdef USE_CFITSIO
-        int status = 0;
-        fitsfile *avg_ptr = NULL;
+        } // for (long f = 0; ...)
 
-        if (config->output.average_mode)
+        snprintf(out_path, sizeof(out_path), "%s/cluster_radii.txt", out_dir);
+        FILE *radii_out = fopen(out_path, "w");
+        if (radii_out)
         {
-            snprintf(out_path, sizeof(out_path), "!%s/average.fits", out_dir);
-            fits_create_file(&avg_ptr, out_path, &status);
-            long anaxes[3] = {width, height, state->num_clusters};
-            fits_create_img(avg_ptr, DOUBLE_IMG, 3, anaxes, &status);
-        }
-
-        for (int c = 0; c < state->num_clusters; c++)
-        {
-            if (cluster_counts[c] == 0)
-            {
-                continue;
-            }
-
-            fitsfile *cfptr = NULL;
-
-            if (config->output.output_clusters)
-            {
-                char fname[1024];
-                snprintf(fname, sizeof(fname), "!%s/cluster_%d.fits", out_dir, c);
-                fits_create_file(&cfptr, fname, &status);
-                long cnaxes[3] = {width, height, cluster_counts[c]};
-                fits_create_img(cfptr, DOUBLE_IMG, 3, cnaxes, &status);
-            }
-
-            if (config->output.average_mode)
-            {
-                for (long k = 0; k < nelements; k++)
-                {
-                    avg_buffer[k] = 0.0;
-                }
-            }
-
-            int fr_count = 0;
-
-            for (long f = 0; f < state->telemetry.total_frames_processed; f++)
-            {
-                if (state->assignments[f] == c)
-                {
-                    Frame *fr = getframe_at(f);
-
-                    if (fr)
-                    {
-                        if (cfptr)
-                        {
-                            long fpixel[3] = {1, 1, fr_count + 1};
-                            fits_write_pix(cfptr, TDOUBLE, fpixel, nelements, fr->data, &status);
-                        }
-                        if (config->output.average_mode)
-                        {
-                            for (long k = 0; k < nelements; k++)
-                            {
-                                avg_buffer[k] += fr->data[k];
-                            }
-                        }
-                        free_frame(fr);
-                        fr_count++;
-                    }
-                }
-            } // for (long f = 0; ...)
-
-            if (cfptr)
-            {
-                fits_close_file(cfptr, &status);
-            }
-
-            if (config->output.average_mode && avg_ptr)
+            fprintf(radii_out, "# cluster_id member_count max_radius\n");
+            for (int c = 0; c < state->num_clusters; c++)
             {
-                for (long k = 0; k < nelements; k++)
-                {
-                    avg_buffer[k] /= cluster_counts[c];
-                }
-                long fpixel[3] = {1, 1, c + 1};
-                fits_write_pix(avg_ptr, TDOUBLE, fpixel, nelements, avg_buffer, &status);
+                fprintf(radii_out, "%d %d %.6f\n",
+                        c, cluster_counts[c], cluster_max_radii[c]);
             }
-        } // for (int c = 0; ...)
+            fclose(radii_out);
+        } // if (radii_out)
+    } // if (cluster_max_radii)
 
-        if (avg_ptr)
-        {
-            fits_close_file(avg_ptr, &status);
-        }
-#else
-        // Fallback ASCII logic if FITS disabled but we reached here
-        // (Similar to block above)
-#endif
-    } // else
-
-    if (avg_buffer)
+    if (state->gricres)
     {
-        free(avg_buffer);
+        finish_gricres(config, state, cluster_counts, cluster_max_radii, conv_buf);
     }
 
-    if (config->output.output_clustered)
-    {
-        printf("Writing clustered output file\n");
-        const char *base_name_only = strrchr(config->input.fits_filename, '/');
-
-        if (base_name_only)
-        {
-            base_name_only++;
-        }
-        else
-        {
-            base_name_only = config->input.fits_filename;
-        }
-
-        char *temp_base = strdup(base_name_only);
-        char *ext = strrchr(temp_base, '.');
-
-        if (ext && strcmp(ext, ".txt") == 0)
-        {
-            *ext = '\0';
-        }
-
-        char *clustered_fname =
-            (char *)malloc(strlen(out_dir) + strlen(temp_base) + 30);
-
-        if (clustered_fname)
-        {
-            sprintf(clustered_fname, "%s/%s.clustered.txt", out_dir, temp_base);
-            free(temp_base);
-            FILE *clustered_out = fopen(clustered_fname, "w");
-
-            if (clustered_out)
-            {
-                fprintf(clustered_out, "# Parameters:\n");
-                fprintf(clustered_out, "# rlim %.6f\n", config->algo.rlim);
-                fprintf(clustered_out, "# dprob %.6f\n", config->algo.deltaprob);
-                fprintf(clustered_out, "# maxcl %d\n", config->algo.maxnbclust);
-                fprintf(clustered_out, "# maxim %ld\n", config->input.maxnbfr);
-                fprintf(clustered_out, "# gprob_mode %d\n", config->optim.gprob_mode);
-                fprintf(clustered_out, "# fmatcha %.2f\n", config->optim.fmatch_a);
-                fprintf(clustered_out, "# fmatchb %.2f\n", config->optim.fmatch_b);
-
-                fprintf(clustered_out, "# Stats:\n");
-                fprintf(clustered_out, "# Total Clusters %d\n", state->num_clusters);
-                fprintf(clustered_out,
-                        "# Total Distance Computations %ld\n",
-                        state->telemetry.framedist_calls);
-                fprintf(clustered_out, "# Clusters Pruned %ld\n",
-                        state->telemetry.clusters_pruned);
-
-                double avg_dist = 0.0;
-                if (state->telemetry.total_frames_processed > 0)
-                {
-                    avg_dist = (double)state->telemetry.framedist_calls /
-                               state->telemetry.total_frames_processed;
-                }
-                fprintf(clustered_out, "# Avg Dist/Frame %.2f\n", avg_dist);
-
-                if (state->telemetry.pruned_fraction_sum && state->telemetry.step_counts)
-                {
-                    for (int k = 0; k < state->telemetry.max_steps_recorded; k++)
-                    {
-                        if (state->telemetry.step_counts[k] > 0)
-                        {
-                            fprintf(clustered_out,
-                                    "# Pruning Step %d: %.4f\n",
-                                    k,
-                                    state->telemetry.pruned_fraction_sum[k] /
-                                    state->telemetry.step_counts[k]);
-                        }
-                        else if (k > 0 && state->telemetry.step_counts[k] == 0)
-                        {
-                            break;
-                        }
-                    } // for (int k = 0; ...)
-                }
-
-                int next_new_cluster = 0;
-
-                for (long i = 0; i < state->telemetry.total_frames_processed; i++)
-                {
-                    int assigned = state->assignments[i];
-
-                    if (assigned == next_new_cluster)
-                    {
-                        fprintf(clustered_out, "# NEWCLUSTER %d %ld ", assigned, i);
-                        for (long k = 0; k < nelements; k++)
-                        {
-                            fprintf(clustered_out, "%f ",
-                                    state->clusters[assigned].anchor.data[k]);
-                        }
-                        fprintf(clustered_out, "\n");
-                        next_new_cluster++;
-                    }
-
-                    Frame *fr = getframe_at(i);
-
-                    if (fr)
-                    {
-                        fprintf(clustered_out, "%ld %d ", i, assigned);
-                        for (long k = 0; k < nelements; k++)
-                        {
-                            fprintf(clustered_out, "%f ", fr->data[k]);
-                        }
-                        fprintf(clustered_out, "\n");
-                        free_frame(fr);
-                    }
-                } // for (long i = 0; ...)
-                fclose(clustered_out);
-            } // if (clustered_out)
-            free(clustered_fname);
-        } // if (clustered_fname)
-        else
-        {
-            free(temp_base);
-        }
-    } // if (config->output.output_clustered)
+    write_member_frames(config, state, out_dir, cluster_counts, conv_buf);
 
+    free(cluster_max_radii);
+    free(conv_buf);
     free(cluster_counts);
     free(out_dir);
 }
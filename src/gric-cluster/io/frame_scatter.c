@@ -1,4 +1,5 @@
 #include "frame_scatter.h"
+#include "frame_dtype.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -6,24 +7,104 @@
 /**
  * frame_scatter_alloc() - Pre-allocate data buffers for tile sub-frames.
  * @tm:          Tile map describing M tiles and their pixel counts.
+ * @dtype:       Pixel storage type of the source frames.
  * @tile_frames: Caller-allocated array of M Frame structs to initialise.
  *
- * For each tile m, allocates a contiguous double buffer large enough
- * for tile_frames[m].data and sets width = num_pixels, height = 1.
+ * For each tile m, allocates a contiguous buffer of @dtype pixels large
+ * enough for tile_frames[m].data and sets width = num_pixels, height = 1.
  * The buffers are reused across frames via frame_scatter().
  */
 void frame_scatter_alloc(
     const TileMap *tm,
+    FrameDType     dtype,
     Frame         *tile_frames)
 {
     for (int m = 0; m < tm->num_tiles; m++)
     {
         uint64_t npix = tm->tiles[m].num_pixels;
 
-        tile_frames[m].data =
-            (double *) malloc(npix * sizeof(double));
+        tile_frames[m].data   = malloc(npix * frame_dtype_size(dtype));
+        tile_frames[m].dtype  = dtype;
         tile_frames[m].width  = (long) npix;
         tile_frames[m].height = 1;
+        tile_frames[m].borrowed = 0;
+        tile_frames[m].spans = NULL;
+    }
+}
+
+/**
+ * frame_scatter_tile() - Gather the pixels of one tile from a full-image frame.
+ * @src: Source frame covering the full image.
+ * @td:  Tile definition with its sorted pixel-index list.
+ * @tf:  Destination tile frame with a buffer of @td->num_pixels pixels of
+ *       the same dtype as @src, or a tile view (frame_is_view()).
+ *
+ * Copies metadata (id, cnt0, atime) from @src and gathers the tile pixels
+ * into the contiguous buffer of @tf. A view is only pointed at @src, which
+ * must then outlive every use of @tf.
+ */
+void frame_scatter_tile(
+    const Frame   *restrict src,
+    const TileDef *restrict td,
+    Frame         *restrict tf)
+{
+    /* Copy metadata from source frame */
+    tf->id    = src->id;
+    tf->cnt0  = src->cnt0;
+    tf->atime = src->atime;
+
+    if (frame_is_view(tf))
+    {
+        tf->data = src->data;
+        return;
+    }
+
+    /* Gather pixels into contiguous tile buffer */
+    const int      *restrict idx  = td->pixel_indices;
+    const uint64_t           npix = td->num_pixels;
+
+    switch (src->dtype)
+    {
+    case FRAME_DTYPE_F32:
+    {
+        const float *restrict sd = (const float *)src->data;
+        float       *restrict dd = (float *)tf->data;
+        for (uint64_t i = 0; i < npix; i++)
+        {
+            dd[i] = sd[idx[i]];
+        }
+        break;
+    }
+    case FRAME_DTYPE_U16:
+    {
+        const uint16_t *restrict sd = (const uint16_t *)src->data;
+        uint16_t       *restrict dd = (uint16_t *)tf->data;
+        for (uint64_t i = 0; i < npix; i++)
+        {
+            dd[i] = sd[idx[i]];
+        }
+        break;
+    }
+    case FRAME_DTYPE_U8:
+    {
+        const uint8_t *restrict sd = (const uint8_t *)src->data;
+        uint8_t       *restrict dd = (uint8_t *)tf->data;
+        for (uint64_t i = 0; i < npix; i++)
+        {
+            dd[i] = sd[idx[i]];
+        }
+        break;
+    }
+    default:
+    {
+        const double *restrict sd = (const double *)src->data;
+        double       *restrict dd = (double *)tf->data;
+        for (uint64_t i = 0; i < npix; i++)
+        {
+            dd[i] = sd[idx[i]];
+        }
+        break;
+    }
     }
 }
 
@@ -34,13 +115,9 @@ void frame_scatter_alloc(
  * @tile_frames: Pre-allocated array of M tile sub-frames (from
  *               frame_scatter_alloc).
  *
- * Copies metadata (id, cnt0, atime) from @src into every tile frame,
- * then gathers pixel values from @src->data into each tile's
- * contiguous buffer using the tile's sorted pixel-index list.
- *
- * The data buffers in @tile_frames must already be allocated by
- * frame_scatter_alloc(); this function only writes pixel data and
- * metadata.
+ * Calls frame_scatter_tile() for every tile. The tile buffers must have
+ * been allocated with the same dtype as @src by frame_scatter_alloc();
+ * this function only writes pixel data and metadata.
  */
 void frame_scatter(
     const Frame   *restrict src,
@@ -49,24 +126,7 @@ void frame_scatter(
 {
     for (int m = 0; m < tm->num_tiles; m++)
     {
-        const TileDef *td = &tm->tiles[m];
-        Frame *tf = &tile_frames[m];
-
-        /* Copy metadata from source frame */
-        tf->id    = src->id;
-        tf->cnt0  = src->cnt0;
-        tf->atime = src->atime;
-
-        /* Gather pixels into contiguous tile buffer */
-        const int      *restrict idx = td->pixel_indices;
-        const double   *restrict sd  = src->data;
-        double         *restrict dd  = tf->data;
-        const uint64_t  npix         = td->num_pixels;
-
-        for (uint64_t i = 0; i < npix; i++)
-        {
-            dd[i] = sd[idx[i]];
-        }
+        frame_scatter_tile(src, &tm->tiles[m], &tile_frames[m]);
     }
 }
 
@@ -12,11 +12,22 @@ void frame_scatter(
     const TileMap *tm,
     Frame         *tile_frames);
 
+/**
+ * @brief Gather the pixels of tile @td from a full-image Frame into @tf.
+ *
+ * A tile view @tf is pointed at @src instead; no pixels are copied.
+ */
+void frame_scatter_tile(
+    const Frame   *src,
+    const TileDef *td,
+    Frame         *tf);
+
 /**
  * @brief Allocate data buffers for M tile sub-frames.
  */
 void frame_scatter_alloc(
     const TileMap *tm,
+    FrameDType     dtype,
     Frame         *tile_frames);
 
 /**
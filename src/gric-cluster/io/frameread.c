@@ -4,12 +4,14 @@
  */
 
 #include "common.h"
+#include "frame_dtype.h"
 #include "frameread.h"
 #include "png_io.h"
 #include "frameread_internal.h"
 #include <ctype.h>
 #include <errno.h>
 #include <limits.h>
+#include <pthread.h>
 #include <semaphore.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,8 +22,10 @@
 fitsfile *fptr = NULL;
 #endif
 
-FILE *ascii_ptr = NULL;
-long *ascii_line_offsets = NULL;
+AsciiMap ascii_map;
+GricBin ascii_bin;
+int ascii_use_bin = 0;
+int ascii_write_bin = 0;
 int is_ascii_mode = 0;
 
 char **file_list = NULL;
@@ -51,15 +55,20 @@ long stream_read_counter = 0;
 int is_3d = 0;
 double cumulative_wait_time_sec = 0.0;
 int cnt2sync_enabled = 0;
+int stream_zerocopy = 0;
+uint64_t *stream_borrow_seq = NULL;
+uint64_t stream_overrun_seq = 0;
 #endif
 
 long num_frames = 0;
 long frame_width = 0;
 long frame_height = 0;
 int current_frame_idx = 0;
+FrameDType frame_dtype = FRAME_DTYPE_F64;
 
-double *frame_data_pool[FRAME_DATA_POOL_SIZE];
+void *frame_data_pool[FRAME_DATA_POOL_SIZE];
 int frame_data_pool_count = 0;
+pthread_mutex_t frame_pool_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /**
  * init_filelist() - Initialize the frame reader in file list (PNG sequence) mode.
@@ -224,14 +233,43 @@ int init_frameread(
 #endif
 }
 
+/**
+ * reader_borrows_frames() - Query if frames reference reader memory instead of a pool buffer.
+ *
+ * Return: 1 in zero-copy stream mode, 0 otherwise.
+ */
+static int reader_borrows_frames(void)
+{
+#ifdef USE_IMAGESTREAMIO
+    return is_stream_mode && stream_zerocopy;
+#else
+    return 0;
+#endif
+}
+
 /**
  * getframe() - Retrieve the next sequential frame.
  *
- * Calls getframe_at with the current frame index.
+ * Pops the frame from the prefetch ring while frameread_prefetch_start() is
+ * active, otherwise reads it synchronously.
  *
  * Return: Pointer to the populated Frame struct, or NULL on error or EOF.
  */
 Frame *getframe(void)
+{
+    if (frameread_prefetch_active())
+    {
+        return frameread_prefetch_pop();
+    }
+    return getframe_sequential();
+}
+
+/**
+ * getframe_sequential() - Read the frame at the current index and advance it.
+ *
+ * Return: Pointer to the populated Frame struct, or NULL on error or EOF.
+ */
+Frame *getframe_sequential(void)
 {
 #ifndef USE_IMAGESTREAMIO
     if (current_frame_idx >= num_frames)
@@ -270,23 +308,24 @@ Frame *getframe_at(
     frame_struct->width = frame_width;
     frame_struct->height = frame_height;
     frame_struct->id = index;
+    frame_struct->dtype = frame_dtype;
+    frame_struct->borrowed = 0;
+    frame_struct->spans = NULL;
+    frame_struct->num_spans = 0;
 
-    if (!is_filelist_mode)
+    if (!is_filelist_mode && !reader_borrows_frames())
     {
         int got_from_pool = 0;
-#ifdef _OPENMP
-#pragma omp critical(frame_pool)
-#endif
+        pthread_mutex_lock(&frame_pool_lock);
+        if (frame_data_pool_count > 0)
         {
-            if (frame_data_pool_count > 0)
-            {
-                frame_struct->data = frame_data_pool[--frame_data_pool_count];
-                got_from_pool = 1;
-            }
+            frame_struct->data = frame_data_pool[--frame_data_pool_count];
+            got_from_pool = 1;
         }
+        pthread_mutex_unlock(&frame_pool_lock);
         if (!got_from_pool)
         {
-            frame_struct->data = (double *)malloc(nelements * sizeof(double));
+            frame_struct->data = malloc((size_t)nelements * frame_dtype_size(frame_dtype));
         }
         if (frame_struct->data == NULL)
         {
@@ -307,8 +346,8 @@ Frame *getframe_at(
     {
         int w = 0;
         int h = 0;
-        frame_struct->data = read_png_frame(file_list[index], &w, &h);
-        if (frame_struct->data == NULL)
+        double *png = read_png_frame(file_list[index], &w, &h);
+        if (png == NULL)
         {
             fprintf(stderr, "Error reading frame %ld: %s\n", index, file_list[index]);
             free(frame_struct);
@@ -319,10 +358,20 @@ Frame *getframe_at(
             fprintf(stderr,
                     "Error: Frame dimension mismatch in file list. Expected %ldx%ld, got %dx%d\n",
                     frame_width, frame_height, w, h);
-            free(frame_struct->data);
+            free(png);
             free(frame_struct);
             return NULL;
         }
+        if (frame_dtype == FRAME_DTYPE_F64)
+        {
+            frame_struct->data = png;
+        }
+        else
+        {
+            /* Narrow in place: the typed buffer never outgrows the double one */
+            frame_store_doubles(png, frame_dtype, png, nelements);
+            frame_struct->data = png;
+        }
     }
     else if (is_ascii_mode)
     {
@@ -379,25 +428,35 @@ Frame *getframe_at(
 /**
  * free_frame() - Return a frame structure and buffer to the reuse pool or release memory.
  * @frame_ptr: Pointer to the Frame struct to free.
+ *
+ * Borrowed stream slices are not freed; they are checked for overruns instead.
+ * Tile worker frames (FRAME_BORROW_TILE) are left untouched.
  */
 void free_frame(
     Frame *frame_ptr)
 {
     if (frame_ptr != NULL)
     {
-        if (frame_ptr->data != NULL)
+        if (frame_ptr->borrowed == FRAME_BORROW_TILE)
         {
-            int returned_to_pool = 0;
-#ifdef _OPENMP
-#pragma omp critical(frame_pool)
+            return;
+        }
+        if (frame_ptr->borrowed)
+        {
+#ifdef USE_IMAGESTREAMIO
+            release_stream_slice(frame_ptr);
 #endif
+        }
+        else if (frame_ptr->data != NULL)
+        {
+            int returned_to_pool = 0;
+            pthread_mutex_lock(&frame_pool_lock);
+            if (frame_data_pool_count < FRAME_DATA_POOL_SIZE)
             {
-                if (frame_data_pool_count < FRAME_DATA_POOL_SIZE)
-                {
-                    frame_data_pool[frame_data_pool_count++] = frame_ptr->data;
-                    returned_to_pool = 1;
-                }
+                frame_data_pool[frame_data_pool_count++] = frame_ptr->data;
+                returned_to_pool = 1;
             }
+            pthread_mutex_unlock(&frame_pool_lock);
             if (!returned_to_pool)
             {
                 free(frame_ptr->data);
@@ -412,15 +471,14 @@ void free_frame(
  */
 void close_frameread(void)
 {
-#ifdef _OPENMP
-#pragma omp critical(frame_pool)
-#endif
+    frameread_prefetch_stop();
+
+    pthread_mutex_lock(&frame_pool_lock);
+    while (frame_data_pool_count > 0)
     {
-        while (frame_data_pool_count > 0)
-        {
-            free(frame_data_pool[--frame_data_pool_count]);
-        }
+        free(frame_data_pool[--frame_data_pool_count]);
     }
+    pthread_mutex_unlock(&frame_pool_lock);
 
     if (is_filelist_mode)
     {
@@ -467,6 +525,7 @@ void close_frameread(void)
  */
 void reset_frameread(void)
 {
+    frameread_prefetch_stop();
     current_frame_idx = 0;
 
     if (is_ascii_mode)
@@ -517,6 +576,55 @@ long get_missed_frames(void)
 #endif
 }
 
+/**
+ * set_frameread_dtype() - Select the pixel storage type of returned frames.
+ * @dtype: Storage type; must be called before the first getframe().
+ */
+void set_frameread_dtype(
+    FrameDType dtype)
+{
+    frame_dtype = dtype;
+}
+
+/**
+ * set_frameread_zerocopy() - Let stream frames reference the shared-memory slice.
+ * @enable: 1 to request zero-copy ingest; must be called before init_frameread().
+ *
+ * Only honoured for ImageStreamIO streams whose datatype matches the frame
+ * storage type; other inputs are always copied.
+ */
+void set_frameread_zerocopy(
+    int enable)
+{
+#ifdef USE_IMAGESTREAMIO
+    stream_zerocopy = enable;
+#else
+    (void)enable;
+#endif
+}
+
+/**
+ * set_frameread_gricbin() - Write the binary sidecar of ASCII inputs.
+ * @enable: 1 to write <input>.gricbin; must be called before init_frameread().
+ *
+ * A current sidecar is always used when present; this only controls creating it.
+ */
+void set_frameread_gricbin(
+    int enable)
+{
+    ascii_write_bin = enable;
+}
+
+/**
+ * get_frame_dtype() - Get the pixel storage type of returned frames.
+ *
+ * Return: Storage type.
+ */
+FrameDType get_frame_dtype(void)
+{
+    return frame_dtype;
+}
+
 /**
  * get_frame_width() - Get width of the frame.
  *
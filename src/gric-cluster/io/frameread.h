@@ -18,7 +18,7 @@ int init_frameread(
 Frame *getframe(void);
 
 /**
- * @brief Retrieve a frame at a specific index.
+ * @brief Retrieve a frame at a specific index (not while prefetching).
  */
 Frame *getframe_at(
     long index);
@@ -74,6 +74,29 @@ int is_3d_stream_mode(void);
  */
 double get_stream_wait_time(void);
 
+/**
+ * @brief Select the pixel storage type of frames returned by getframe().
+ */
+void set_frameread_dtype(
+    FrameDType dtype);
+
+/**
+ * @brief Request zero-copy stream frames (data points into the ImageStreamIO slice).
+ */
+void set_frameread_zerocopy(
+    int enable);
+
+/**
+ * @brief Request a .gricbin sidecar when an ASCII input is indexed.
+ */
+void set_frameread_gricbin(
+    int enable);
+
+/**
+ * @brief Get the pixel storage type of frames returned by getframe().
+ */
+FrameDType get_frame_dtype(void);
+
 /**
  * @brief Get the width of the ingested frames.
  */
@@ -89,4 +112,47 @@ long get_frame_height(void);
  */
 int is_ascii_input_mode(void);
 
+/** Largest accepted -prefetch ring depth. */
+#define FRAMEREAD_PREFETCH_MAX 32
+
+/** Prefetch ring telemetry. */
+typedef struct
+{
+    int    depth;      /**< Ring capacity in frames (0 if never started) */
+    int    fill;       /**< Frames currently decoded and waiting */
+    double avg_fill;   /**< Mean ring occupancy seen by getframe() */
+    long   frames;     /**< Frames handed out from the ring */
+    long   stalls;     /**< getframe() calls that found the ring empty */
+    double stall_ms;   /**< Time spent waiting on an empty ring (ms) */
+    long   full_waits; /**< Times the reader thread waited on a full ring */
+} FramePrefetchStats;
+
+/**
+ * @brief Start a reader thread that decodes up to @depth frames ahead of getframe().
+ */
+int frameread_prefetch_start(
+    int  depth,
+    long max_frames);
+
+/**
+ * @brief Check if getframe() is served by the prefetch ring.
+ */
+int frameread_prefetch_active(void);
+
+/**
+ * @brief Take the next frame from the prefetch ring (blocks while it is empty).
+ */
+Frame *frameread_prefetch_pop(void);
+
+/**
+ * @brief Stop the reader thread and rewind to the first unconsumed frame.
+ */
+void frameread_prefetch_stop(void);
+
+/**
+ * @brief Snapshot prefetch ring occupancy and stall counters.
+ */
+void frameread_prefetch_get_stats(
+    FramePrefetchStats *stats);
+
 #endif // FRAMEREAD_H
@@ -1,118 +1,86 @@
 /**
  * @file frameread_ascii.c
  * @brief ASCII format reader implementation.
+ *
+ * The text file is memory-mapped and indexed once (see shared/gricbin.c);
+ * frames are parsed straight from the mapping, so random access needs no
+ * seek and concurrent readers need no lock. When a current <file>.gricbin
+ * sidecar exists, frames are copied from it instead and no text is parsed.
  */
 
 #include "frameread_internal.h"
-#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* Values parsed per batch when converting to a non-double frame type */
+#define ASCII_PARSE_BATCH 256
+
 /**
  * init_ascii() - Initialize the ASCII format frame reader.
  * @filename: Path to the ASCII (.txt) file containing coordinates.
  *
- * Opens the ASCII file, reads all lines to count the number of frames, records the byte
- * offset of each line for fast random-access seeking, and determines the width (number of
- * columns) from the first line.
+ * Maps a current .gricbin sidecar if there is one. Otherwise maps the text
+ * file, indexes the byte offset of every line (one frame per line) and takes
+ * the width (number of columns) from the first line; with
+ * set_frameread_gricbin(), the sidecar is then written for later runs.
  *
  * Return: 0 on success, or -1 on failure.
  */
 int init_ascii(
     char *filename)
 {
-    ascii_ptr = fopen(filename, "r");
-    if (ascii_ptr == NULL)
+    if (gricbin_open(&ascii_bin, filename) == 0)
     {
-        perror("Failed to open ASCII file");
-        return -1;
+        if (ascii_bin.hdr->dtype == GRICBIN_F32 && frame_dtype != FRAME_DTYPE_F32)
+        {
+            /* Widening stored floats would change the coordinates */
+            printf("Ignoring f32 sidecar %s%s for -dtype %s\n", filename, GRICBIN_SUFFIX,
+                   frame_dtype_name(frame_dtype));
+            gricbin_close(&ascii_bin);
+        }
+        else if (ascii_bin.hdr->num_frames > 0)
+        {
+            is_ascii_mode = 1;
+            ascii_use_bin = 1;
+            num_frames = (long)ascii_bin.hdr->num_frames;
+            frame_width = (long)ascii_bin.hdr->width;
+            frame_height = 1;
+            return 0;
+        }
+        else
+        {
+            gricbin_close(&ascii_bin);
+        }
     }
 
-    is_ascii_mode = 1;
-    num_frames = 0;
-
-    size_t capacity = 1024;
-    ascii_line_offsets = (long *)malloc(capacity * sizeof(long));
-    if (ascii_line_offsets == NULL)
+    if (ascii_map_open(&ascii_map, filename, 0) != 0)
     {
-        perror("Memory allocation failed");
-        fclose(ascii_ptr);
-        ascii_ptr = NULL;
         return -1;
     }
-
-    {
-        /* Read lines and index offset locations */
-        char *line = NULL;
-        size_t len = 0;
-        long offset = ftell(ascii_ptr);
-        int first_line = 1;
-
-        while (getline(&line, &len, ascii_ptr) != -1)
-        {
-            if ((size_t)num_frames >= capacity)
-            {
-                capacity *= 2;
-                long *new_offsets = (long *)realloc(ascii_line_offsets, capacity * sizeof(long));
-                if (new_offsets == NULL)
-                {
-                    perror("Memory reallocation failed");
-                    free(line);
-                    free(ascii_line_offsets);
-                    ascii_line_offsets = NULL;
-                    fclose(ascii_ptr);
-                    ascii_ptr = NULL;
-                    return -1;
-                }
-                ascii_line_offsets = new_offsets;
-            }
-            ascii_line_offsets[num_frames] = offset;
-            num_frames++;
-
-            if (first_line)
-            {
-                int cols = 0;
-                char *p = line;
-                int in_num = 0;
-                while (*p)
-                {
-                    if (!isspace((unsigned char)*p))
-                    {
-                        if (!in_num)
-                        {
-                            cols++;
-                            in_num = 1;
-                        }
-                    }
-                    else
-                    {
-                        in_num = 0;
-                    }
-                    p++;
-                }
-                frame_width = cols;
-                frame_height = 1;
-                first_line = 0;
-            }
-
-            offset = ftell(ascii_ptr);
-        }
-
-        free(line);
-    }
-
-    if (num_frames == 0)
+    if (ascii_map.num_lines == 0)
     {
         fprintf(stderr, "Error: Empty ASCII file.\n");
-        free(ascii_line_offsets);
-        ascii_line_offsets = NULL;
-        fclose(ascii_ptr);
-        ascii_ptr = NULL;
+        ascii_map_close(&ascii_map);
         return -1;
     }
 
-    rewind(ascii_ptr);
+    is_ascii_mode = 1;
+    ascii_use_bin = 0;
+    num_frames = ascii_map.num_lines;
+    frame_width = ascii_map_count_columns(&ascii_map, 0);
+    frame_height = 1;
+
+    if (ascii_write_bin)
+    {
+        GricBinDType dtype = (frame_dtype == FRAME_DTYPE_F32) ? GRICBIN_F32 : GRICBIN_F64;
+        long rows = gricbin_write(&ascii_map, filename, frame_width, dtype);
+        if (rows >= 0)
+        {
+            printf("Wrote %s%s (%ld x %ld %s)\n", filename, GRICBIN_SUFFIX, rows, frame_width,
+                   (dtype == GRICBIN_F32) ? "f32" : "f64");
+        }
+    }
     return 0;
 }
 
@@ -121,8 +89,9 @@ int init_ascii(
  * @frame_struct: Pointer to the Frame struct to populate.
  * @index:        Zero-based index of the frame to retrieve.
  *
- * Seeks to the recorded byte offset of the line in the ASCII file and parses the
- * floating-point values into the frame's data buffer.
+ * Copies the row from the sidecar, or parses the floating-point values that
+ * start at the recorded line offset into the frame's data buffer. Safe to
+ * call from several threads.
  *
  * Return: 0 on success, or -1 on failure.
  */
@@ -132,48 +101,70 @@ int getframe_ascii(
 {
     long nelements = frame_width * frame_height;
 
-    if (fseek(ascii_ptr, ascii_line_offsets[index], SEEK_SET) != 0)
+    if (ascii_use_bin)
+    {
+        if (index < 0 || (uint64_t)index >= ascii_bin.hdr->num_frames)
+        {
+            return -1;
+        }
+        const void *row = gricbin_row(&ascii_bin, index);
+        if (ascii_bin.hdr->dtype == GRICBIN_F32)
+        {
+            memcpy(frame_struct->data, row, (size_t)nelements * sizeof(float));
+        }
+        else
+        {
+            frame_store_doubles(frame_struct->data, frame_struct->dtype, (const double *)row,
+                                nelements);
+        }
+        return 0;
+    }
+
+    if (index < 0 || index >= ascii_map.num_lines)
     {
-        perror("fseek failed");
         return -1;
     }
+    const char *p = ascii_map.data + ascii_map.line_offsets[index];
+    const char *end = ascii_map.data + ascii_map.size;
+
+    if (frame_struct->dtype == FRAME_DTYPE_F64)
+    {
+        long n = gric_parse_doubles(p, end, (double *)frame_struct->data, nelements, NULL);
+        return (n == nelements) ? 0 : -1;
+    }
 
-    for (long ii = 0; ii < nelements; ii++)
+    size_t esize = frame_dtype_size(frame_struct->dtype);
+    for (long ii = 0; ii < nelements; ii += ASCII_PARSE_BATCH)
     {
-        if (fscanf(ascii_ptr, "%lf", &frame_struct->data[ii]) != 1)
+        double vals[ASCII_PARSE_BATCH];
+        long n = (nelements - ii < ASCII_PARSE_BATCH) ? nelements - ii : ASCII_PARSE_BATCH;
+        if (gric_parse_doubles(p, end, vals, n, &p) != n)
         {
             return -1;
         }
+        frame_store_doubles((char *)frame_struct->data + ii * esize, frame_struct->dtype, vals,
+                            n);
     }
 
     return 0;
 }
 
 /**
- * close_ascii() - Close the ASCII reader and free line offsets.
+ * close_ascii() - Unmap the ASCII file or its sidecar.
  */
 void close_ascii(void)
 {
-    if (ascii_ptr != NULL)
-    {
-        fclose(ascii_ptr);
-        ascii_ptr = NULL;
-    }
-    if (ascii_line_offsets != NULL)
-    {
-        free(ascii_line_offsets);
-        ascii_line_offsets = NULL;
-    }
+    ascii_map_close(&ascii_map);
+    gricbin_close(&ascii_bin);
+    ascii_use_bin = 0;
     is_ascii_mode = 0;
 }
 
 /**
- * reset_ascii() - Reset the ASCII file pointer to the beginning.
+ * reset_ascii() - Reset the ASCII reader to the first frame.
+ *
+ * Frames are read by index from the mapping, so there is no file position to rewind.
  */
 void reset_ascii(void)
 {
-    if (ascii_ptr != NULL)
-    {
-        rewind(ascii_ptr);
-    }
 }
@@ -245,7 +245,7 @@ int getframe_mp4(
         uint8_t *src = rgb_data[0];
         for (long ii = 0; ii < nelements; ii++)
         {
-            frame_struct->data[ii] = (double)src[ii];
+            frame_set(frame_struct, ii, (double)src[ii]);
         }
 
         free(rgb_data[0]);
@@ -10,6 +10,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+/* Pixels read per batch when converting to an integer frame type */
+#define FITS_READ_BATCH 256
+
 /**
  * init_fits() - Initialize the FITS format frame reader.
  * @filename: Path to the FITS image/cube file.
@@ -71,7 +74,10 @@ int init_fits(
  * @index:        Zero-based index of the frame to retrieve.
  *
  * Reads pixel values from the FITS file at the given frame index and converts them to
- * double-precision floats in the frame data buffer.
+ * the frame storage type (see -dtype) in the frame data buffer. Integer types are read
+ * as doubles in batches and narrowed with frame_store_doubles(), so out-of-range and
+ * fractional pixels are rounded and clamped like the other readers do; CFITSIO's own
+ * conversion would fail with NUM_OVERFLOW on them and truncate fractions.
  *
  * Return: 0 on success, or -1 on failure.
  */
@@ -83,11 +89,33 @@ int getframe_fits(
     long nelements = frame_width * frame_height;
     long fpixel[3] = {1, 1, index + 1};
 
-    if (fits_read_pix(fptr, TDOUBLE, fpixel, nelements, NULL, frame_struct->data, NULL,
-                      &status))
+    if (frame_struct->dtype == FRAME_DTYPE_F64 || frame_struct->dtype == FRAME_DTYPE_F32)
     {
-        fits_report_error(stderr, status);
-        return -1;
+        /* Let CFITSIO convert straight into the storage type */
+        int datatype = (frame_struct->dtype == FRAME_DTYPE_F32) ? TFLOAT : TDOUBLE;
+        if (fits_read_pix(fptr, datatype, fpixel, nelements, NULL, frame_struct->data, NULL,
+                          &status))
+        {
+            fits_report_error(stderr, status);
+            return -1;
+        }
+        return 0;
+    }
+
+    /* First pixel of the frame, 1-based over the whole cube */
+    LONGLONG first = (LONGLONG)index * nelements + 1;
+    size_t esize = frame_dtype_size(frame_struct->dtype);
+    for (long ii = 0; ii < nelements; ii += FITS_READ_BATCH)
+    {
+        double vals[FITS_READ_BATCH];
+        long n = (nelements - ii < FITS_READ_BATCH) ? nelements - ii : FITS_READ_BATCH;
+        if (fits_read_img(fptr, TDOUBLE, first + ii, n, NULL, vals, NULL, &status))
+        {
+            fits_report_error(stderr, status);
+            return -1;
+        }
+        frame_store_doubles((char *)frame_struct->data + ii * esize, frame_struct->dtype, vals,
+                            n);
     }
 
     return 0;
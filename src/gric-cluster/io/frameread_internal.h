@@ -2,6 +2,9 @@
 #define FRAMEREAD_INTERNAL_H
 
 #include "common.h"
+#include "frame_dtype.h"
+#include "shared/gricbin.h"
+#include <pthread.h>
 #include <stdio.h>
 
 #ifdef USE_CFITSIO
@@ -25,8 +28,10 @@
 extern fitsfile *fptr;
 #endif
 
-extern FILE *ascii_ptr;
-extern long *ascii_line_offsets;
+extern AsciiMap ascii_map;
+extern GricBin ascii_bin;
+extern int ascii_use_bin;
+extern int ascii_write_bin;
 extern int is_ascii_mode;
 
 extern char **file_list;
@@ -56,16 +61,26 @@ extern long stream_read_counter;
 extern int is_3d;
 extern double cumulative_wait_time_sec;
 extern int cnt2sync_enabled;
+extern int stream_zerocopy;             /* Frames borrow stream slices */
+extern uint64_t *stream_borrow_seq;     /* Per slice: counter of the frame that borrowed it */
+extern uint64_t stream_overrun_seq;     /* Counter of a frame overwritten in use, 0 if none */
 #endif
 
 extern long num_frames;
 extern long frame_width;
 extern long frame_height;
 extern int current_frame_idx;
+extern FrameDType frame_dtype;
 
 #define FRAME_DATA_POOL_SIZE 64
-extern double *frame_data_pool[FRAME_DATA_POOL_SIZE];
+extern void *frame_data_pool[FRAME_DATA_POOL_SIZE];
 extern int frame_data_pool_count;
+extern pthread_mutex_t frame_pool_lock; /* Guards the pool (reader thread and OpenMP workers) */
+
+/**
+ * @brief Read the frame at the current index synchronously and advance the index.
+ */
+Frame *getframe_sequential(void);
 
 /* Format-specific helper prototypes */
 
@@ -165,6 +180,12 @@ void close_stream(void);
  * @brief Reset the ImageStreamIO frame reader position/counter.
  */
 void reset_stream(void);
+
+/**
+ * @brief Check a borrowed (zero-copy) frame for overwrites when it is released.
+ */
+void release_stream_slice(
+    const Frame *frame_struct);
 #endif // USE_IMAGESTREAMIO
 
 #endif // FRAMEREAD_INTERNAL_H
@@ -0,0 +1,256 @@
+/**
+ * @file frameread_prefetch.c
+ * @brief Background reader thread that decodes frames ahead of the clustering loop.
+ *
+ * While active, getframe() pops decoded frames from a bounded ring filled by a
+ * producer thread that owns the format reader (FITS, MP4, ASCII, stream).
+ * Frames are handed over by pointer; their buffers come from frame_data_pool
+ * and return to it through free_frame(), so no pixel data is copied.
+ *
+ * Main Functions:
+ * - frameread_prefetch_start: Spawn the producer thread.
+ * - frameread_prefetch_pop:   Consumer side of getframe().
+ * - frameread_prefetch_stop:  Join the producer and rewind the read position.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "frameread.h"
+#include "frameread_internal.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static Frame         **pf_ring = NULL;    /* Decoded frames, pf_count starting at pf_head */
+static int             pf_depth = 0;
+static int             pf_head = 0;
+static int             pf_count = 0;
+static int             pf_active = 0;
+static int             pf_stop = 0;       /* Set by the consumer to end the producer */
+static int             pf_eof = 0;        /* Set by the producer after the last frame */
+static long            pf_limit = 0;      /* Frames the producer may read */
+static long            pf_start_idx = 0;  /* current_frame_idx when the thread started */
+static long            pf_consumed = 0;
+static long            pf_fill_sum = 0;   /* Sum of ring occupancy seen by each pop */
+static long            pf_stalls = 0;
+static long            pf_full_waits = 0;
+static double          pf_stall_ms = 0.0;
+static pthread_t       pf_thread;
+static pthread_mutex_t pf_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  pf_not_empty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  pf_not_full = PTHREAD_COND_INITIALIZER;
+
+/**
+ * prefetch_main() - Producer loop: read frames until EOF, the limit, or stop.
+ * @arg: Unused.
+ *
+ * Return: NULL.
+ */
+static void *prefetch_main(
+    void *arg)
+{
+    (void)arg;
+
+    for (long nread = 0; nread < pf_limit; nread++)
+    {
+        pthread_mutex_lock(&pf_lock);
+        if (pf_count == pf_depth && !pf_stop)
+        {
+            pf_full_waits++;
+        }
+        while (pf_count == pf_depth && !pf_stop)
+        {
+            pthread_cond_wait(&pf_not_full, &pf_lock);
+        }
+        int stop = pf_stop;
+        pthread_mutex_unlock(&pf_lock);
+        if (stop)
+        {
+            break;
+        }
+
+        /* Decode outside the lock: only this thread touches the reader state */
+        Frame *fr = getframe_sequential();
+        if (fr == NULL)
+        {
+            break;
+        }
+
+        pthread_mutex_lock(&pf_lock);
+        pf_ring[(pf_head + pf_count) % pf_depth] = fr;
+        pf_count++;
+        pthread_cond_signal(&pf_not_empty);
+        pthread_mutex_unlock(&pf_lock);
+    }
+
+    pthread_mutex_lock(&pf_lock);
+    pf_eof = 1;
+    pthread_cond_signal(&pf_not_empty);
+    pthread_mutex_unlock(&pf_lock);
+    return NULL;
+}
+
+/**
+ * frameread_prefetch_start() - Start decoding frames ahead of getframe().
+ * @depth:      Ring capacity in frames (1..FRAMEREAD_PREFETCH_MAX).
+ * @max_frames: Number of frames the producer may read from the current position.
+ *
+ * Pre-fills frame_data_pool with one buffer per ring slot so that the producer
+ * does not allocate in steady state. On failure the reader stays synchronous.
+ *
+ * Return: 0 on success, -1 if the thread could not be started.
+ */
+int frameread_prefetch_start(
+    int  depth,
+    long max_frames)
+{
+    if (pf_active || depth < 1 || depth > FRAMEREAD_PREFETCH_MAX || max_frames < 1)
+    {
+        return -1;
+    }
+
+    pf_ring = (Frame **)malloc((size_t)depth * sizeof(Frame *));
+    if (pf_ring == NULL)
+    {
+        return -1;
+    }
+
+    if (!is_filelist_mode)
+    {
+        /* PNG lists allocate their own buffers; every other reader draws from the pool */
+        size_t nbytes = (size_t)frame_width * frame_height * frame_dtype_size(frame_dtype);
+        pthread_mutex_lock(&frame_pool_lock);
+        for (int ii = 0; ii <= depth && frame_data_pool_count < FRAME_DATA_POOL_SIZE; ii++)
+        {
+            void *buf = malloc(nbytes);
+            if (buf == NULL)
+            {
+                break;
+            }
+            frame_data_pool[frame_data_pool_count++] = buf;
+        }
+        pthread_mutex_unlock(&frame_pool_lock);
+    }
+
+    pf_depth = depth;
+    pf_head = 0;
+    pf_count = 0;
+    pf_stop = 0;
+    pf_eof = 0;
+    pf_limit = max_frames;
+    pf_start_idx = current_frame_idx;
+    pf_consumed = 0;
+    pf_fill_sum = 0;
+    pf_stalls = 0;
+    pf_full_waits = 0;
+    pf_stall_ms = 0.0;
+
+    if (pthread_create(&pf_thread, NULL, prefetch_main, NULL) != 0)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] cannot start prefetch thread, reading synchronously\n",
+                __FILE__, __LINE__);
+        free(pf_ring);
+        pf_ring = NULL;
+        return -1;
+    }
+    pf_active = 1;
+    return 0;
+}
+
+/**
+ * frameread_prefetch_active() - Query whether getframe() is served by the ring.
+ *
+ * Return: 1 while the producer thread is running, 0 otherwise.
+ */
+int frameread_prefetch_active(void)
+{
+    return pf_active;
+}
+
+/**
+ * frameread_prefetch_pop() - Take the next decoded frame, waiting if the ring is empty.
+ *
+ * A wait is counted as a consumer stall.
+ *
+ * Return: The frame (owned by the caller, release with free_frame()), or NULL at EOF.
+ */
+Frame *frameread_prefetch_pop(void)
+{
+    Frame *fr = NULL;
+
+    pthread_mutex_lock(&pf_lock);
+    if (pf_count == 0 && !pf_eof)
+    {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        while (pf_count == 0 && !pf_eof)
+        {
+            pthread_cond_wait(&pf_not_empty, &pf_lock);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        pf_stalls++;
+        pf_stall_ms += (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1.0e6;
+    }
+    if (pf_count > 0)
+    {
+        pf_fill_sum += pf_count;
+        fr = pf_ring[pf_head];
+        pf_head = (pf_head + 1) % pf_depth;
+        pf_count--;
+        pf_consumed++;
+        pthread_cond_signal(&pf_not_full);
+    }
+    pthread_mutex_unlock(&pf_lock);
+    return fr;
+}
+
+/**
+ * frameread_prefetch_stop() - Stop the producer and drop frames not yet consumed.
+ *
+ * The read position is rewound to the first unconsumed frame, so getframe()
+ * and getframe_at() are safe to call afterwards. Frames dropped from a live
+ * stream are not re-read. Statistics remain readable until the next start.
+ */
+void frameread_prefetch_stop(void)
+{
+    if (!pf_active)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pf_lock);
+    pf_stop = 1;
+    pthread_cond_signal(&pf_not_full);
+    pthread_mutex_unlock(&pf_lock);
+    pthread_join(pf_thread, NULL);
+
+    while (pf_count > 0)
+    {
+        free_frame(pf_ring[pf_head]);
+        pf_head = (pf_head + 1) % pf_depth;
+        pf_count--;
+    }
+    free(pf_ring);
+    pf_ring = NULL;
+    pf_active = 0;
+    current_frame_idx = (int)(pf_start_idx + pf_consumed);
+}
+
+/**
+ * frameread_prefetch_get_stats() - Snapshot ring occupancy and stall counters.
+ * @stats: Output statistics; all zero if prefetching was never started.
+ */
+void frameread_prefetch_get_stats(
+    FramePrefetchStats *stats)
+{
+    pthread_mutex_lock(&pf_lock);
+    stats->depth = pf_depth;
+    stats->fill = pf_count;
+    stats->avg_fill = (pf_consumed > 0) ? (double)pf_fill_sum / pf_consumed : 0.0;
+    stats->frames = pf_consumed;
+    stats->stalls = pf_stalls;
+    stats->stall_ms = pf_stall_ms;
+    stats->full_waits = pf_full_waits;
+    pthread_mutex_unlock(&pf_lock);
+}
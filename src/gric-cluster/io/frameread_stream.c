@@ -13,8 +13,37 @@
 #include <semaphore.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+#define _DATATYPE_UINT8 1
+#define _DATATYPE_INT8 2
+#define _DATATYPE_UINT16 3
+#define _DATATYPE_INT16 4
+#define _DATATYPE_UINT32 5
+#define _DATATYPE_INT32 6
+#define _DATATYPE_UINT64 7
+#define _DATATYPE_INT64 8
+#define _DATATYPE_FLOAT 9
+#define _DATATYPE_DOUBLE 10
+
+/**
+ * stream_dtype_matches() - Check if a stream datatype is stored as-is in @dtype frames.
+ * @datatype: ImageStreamIO datatype code.
+ * @dtype:    Frame storage type.
+ *
+ * Return: 1 if the stream slice can be used (copied or borrowed) without conversion.
+ */
+static int stream_dtype_matches(
+    int        datatype,
+    FrameDType dtype)
+{
+    return (datatype == _DATATYPE_FLOAT && dtype == FRAME_DTYPE_F32) ||
+           (datatype == _DATATYPE_DOUBLE && dtype == FRAME_DTYPE_F64) ||
+           (datatype == _DATATYPE_UINT16 && dtype == FRAME_DTYPE_U16) ||
+           (datatype == _DATATYPE_UINT8 && dtype == FRAME_DTYPE_U8);
+}
+
 /**
  * init_stream() - Initialize the ImageStreamIO shared memory frame reader.
  * @stream_name: Name of the shared memory stream to connect to.
@@ -47,6 +76,27 @@ int init_stream(
         is_3d = 0;
     }
 
+    if (stream_zerocopy)
+    {
+        /* A slice must survive while the frame is clustered: needs a circular buffer */
+        if (!is_3d || stream_depth < 3 ||
+            !stream_dtype_matches(stream_image.md[0].datatype, frame_dtype))
+        {
+            fprintf(stderr, "Warning: zero-copy ingest needs a 3D stream of depth >= 3 "
+                    "stored as -dtype %s; copying frames.\n", frame_dtype_name(frame_dtype));
+            stream_zerocopy = 0;
+        }
+        else
+        {
+            stream_borrow_seq = (uint64_t *)calloc((size_t)stream_depth, sizeof(uint64_t));
+            if (stream_borrow_seq == NULL)
+            {
+                stream_zerocopy = 0;
+            }
+        }
+    }
+    stream_overrun_seq = 0;
+
     num_frames = LONG_MAX; /* Stream is effectively infinite */
     is_stream_mode = 1;
 
@@ -86,6 +136,14 @@ int getframe_stream(
         return -1;
     }
 
+    if (stream_overrun_seq != 0)
+    {
+        fprintf(stderr,
+                "\nError: Circular buffer overrun. Frame %llu was overwritten while in use "
+                "(zero-copy). Stopping.\n", (unsigned long long)stream_overrun_seq);
+        return -1;
+    }
+
     if (cnt2sync_enabled)
     {
         stream_image.md[0].cnt2++;
@@ -166,66 +224,72 @@ int getframe_stream(
         long offset = current_read_slice * nelements;
         int dtype = stream_image.md[0].datatype;
 
-#define _DATATYPE_UINT8 1
-#define _DATATYPE_INT8 2
-#define _DATATYPE_UINT16 3
-#define _DATATYPE_INT16 4
-#define _DATATYPE_UINT32 5
-#define _DATATYPE_INT32 6
-#define _DATATYPE_UINT64 7
-#define _DATATYPE_INT64 8
-#define _DATATYPE_FLOAT 9
-#define _DATATYPE_DOUBLE 10
+        /* Source already in the storage type: reference the slice, or plain copy */
+        size_t esize = frame_dtype_size(frame_struct->dtype);
+        if (stream_dtype_matches(dtype, frame_struct->dtype))
+        {
+            if (stream_zerocopy)
+            {
+                frame_struct->data = (char *)stream_image.array.raw + (size_t)offset * esize;
+                frame_struct->borrowed = FRAME_BORROW_STREAM;
+                stream_borrow_seq[current_read_slice] = last_cnt0;
+                return 0;
+            }
+            memcpy(frame_struct->data,
+                   (const char *)stream_image.array.raw + (size_t)offset * esize,
+                   (size_t)nelements * esize);
+            return 0;
+        }
 
         switch (dtype)
         {
         case _DATATYPE_FLOAT:
             for (long ii = 0; ii < nelements; ii++)
             {
-                frame_struct->data[ii] =
-                    (double)((float *)stream_image.array.F)[offset + ii];
+                frame_set(frame_struct, ii,
+                    (double)((float *)stream_image.array.F)[offset + ii]);
             }
             break;
         case _DATATYPE_DOUBLE:
             for (long ii = 0; ii < nelements; ii++)
             {
-                frame_struct->data[ii] =
-                    ((double *)stream_image.array.D)[offset + ii];
+                frame_set(frame_struct, ii,
+                    ((double *)stream_image.array.D)[offset + ii]);
             }
             break;
         case _DATATYPE_UINT8:
             for (long ii = 0; ii < nelements; ii++)
             {
-                frame_struct->data[ii] =
-                    (double)((uint8_t *)stream_image.array.UI8)[offset + ii];
+                frame_set(frame_struct, ii,
+                    (double)((uint8_t *)stream_image.array.UI8)[offset + ii]);
             }
             break;
         case _DATATYPE_UINT16:
             for (long ii = 0; ii < nelements; ii++)
             {
-                frame_struct->data[ii] =
-                    (double)((uint16_t *)stream_image.array.UI16)[offset + ii];
+                frame_set(frame_struct, ii,
+                    (double)((uint16_t *)stream_image.array.UI16)[offset + ii]);
             }
             break;
         case _DATATYPE_INT16:
             for (long ii = 0; ii < nelements; ii++)
             {
-                frame_struct->data[ii] =
-                    (double)((int16_t *)stream_image.array.SI16)[offset + ii];
+                frame_set(frame_struct, ii,
+                    (double)((int16_t *)stream_image.array.SI16)[offset + ii]);
             }
             break;
         case _DATATYPE_UINT32:
             for (long ii = 0; ii < nelements; ii++)
             {
-                frame_struct->data[ii] =
-                    (double)((uint32_t *)stream_image.array.UI32)[offset + ii];
+                frame_set(frame_struct, ii,
+                    (double)((uint32_t *)stream_image.array.UI32)[offset + ii]);
             }
             break;
         case _DATATYPE_INT32:
             for (long ii = 0; ii < nelements; ii++)
             {
-                frame_struct->data[ii] =
-                    (double)((int32_t *)stream_image.array.SI32)[offset + ii];
+                frame_set(frame_struct, ii,
+                    (double)((int32_t *)stream_image.array.SI32)[offset + ii]);
             }
             break;
         default:
@@ -243,6 +307,8 @@ int getframe_stream(
 void close_stream(void)
 {
     is_stream_mode = 0;
+    free(stream_borrow_seq);
+    stream_borrow_seq = NULL;
 }
 
 /**
@@ -253,4 +319,29 @@ void reset_stream(void)
     /* Stream mode is real-time and doesn't support rewinding */
 }
 
+/**
+ * release_stream_slice() - Check a zero-copy frame for overwrites when it is released.
+ * @frame_struct: Borrowed frame; its data points into the stream buffer.
+ *
+ * The writer starts overwriting the slice of frame counter s once cnt0
+ * reaches s + depth - 1. If that happened while the frame was in use, its
+ * pixels (and any distances or anchor copied from them) may be torn; the
+ * counter is recorded and the next getframe_stream() stops the run, like
+ * the overrun check at read time.
+ */
+void release_stream_slice(
+    const Frame *frame_struct)
+{
+    size_t slice_bytes =
+        (size_t)frame_width * frame_height * frame_dtype_size(frame_struct->dtype);
+    long   slot = (long)(((const char *)frame_struct->data -
+                          (const char *)stream_image.array.raw) / slice_bytes);
+    uint64_t seq = stream_borrow_seq[slot];
+
+    if ((long)(stream_image.md[0].cnt0 - seq) >= stream_depth - 1 && stream_overrun_seq == 0)
+    {
+        stream_overrun_seq = seq;
+    }
+}
+
 #endif // USE_IMAGESTREAMIO
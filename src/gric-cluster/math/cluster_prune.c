@@ -12,6 +12,7 @@
 #include "cluster_prune.h"
 #include "cluster_core.h"
 #include "cluster_math.h"
+#include "cluster_mgmt.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -32,6 +33,13 @@
  * which cluster followed each match.  The top candidates
  * are returned sorted by frequency.
  *
+ * Candidate matches are enumerated from the occurrence chains
+ * of the pattern's last cluster (see occ_index_record()), so the
+ * cost follows the occurrences of that cluster within the
+ * horizon instead of the horizon length.  The linear scan
+ * remains as a fallback when the index does not cover the
+ * history.
+ *
  * Return: Number of candidates written (0 if none found).
  */
 int get_prediction_candidates(
@@ -52,7 +60,13 @@ int get_prediction_candidates(
     if (search_start > search_limit)
         search_start = search_limit;
 
-    int *pattern = &state->assignments[total - len];
+    /* A rolling history only holds frames from history_base on */
+    long base = state->history_base;
+    if (search_start < base)
+        search_start = base;
+
+    resolve_assignments(state, search_start);
+    int *pattern = &state->assignments[total - len - base];
 
     /* Thread-local pre-allocated buffers to avoid heap allocations inside the loop */
     static __thread int *counts = NULL;
@@ -74,16 +88,61 @@ int get_prediction_candidates(
 
     memset(counts, 0, (size_t)state->num_clusters * sizeof(int));
 
-    for (long i = search_start; i < search_limit; i++)
+    OccurrenceIndex *occ = &state->occ_index;
+    int last = (len > 0) ? pattern[len - 1] : -1;
+    if (!occ->broken && occ->num_frames == total && last >= 0 && last < occ->clusters_cap)
     {
-        if (state->assignments[i] == pattern[0])
+        /* Matches end on an occurrence of the last symbol in [lo, total - 1) */
+        long lo = search_start + len - 1;
+        int first = occ->serial_of[last];
+        int prev_member = -1;
+        for (int sr = first; sr >= 0;)
         {
-            if (memcmp(&state->assignments[i], pattern, (size_t)len * sizeof(int)) == 0)
+            int next = occ->next_member[sr];
+            long f = occ->head[sr];
+            if (sr != first && f < lo)
             {
-                int next_cluster = state->assignments[i + len];
-                if (next_cluster >= 0 && next_cluster < state->num_clusters)
+                /* Merged serials get no new frames and lo never decreases: retire */
+                occ->next_member[prev_member] = next;
+                if (occ->tail_member[first] == sr)
                 {
-                    counts[next_cluster]++;
+                    occ->tail_member[first] = prev_member;
+                }
+                sr = next;
+                continue;
+            }
+            for (; f >= lo; f = occ->prev[f - base])
+            {
+                long i = f - len + 1;
+                if (f < total - 1 &&
+                    memcmp(&state->assignments[i - base], pattern,
+                           (size_t)len * sizeof(int)) == 0)
+                {
+                    int next_cluster = state->assignments[f + 1 - base];
+                    if (next_cluster >= 0 && next_cluster < state->num_clusters)
+                    {
+                        counts[next_cluster]++;
+                    }
+                }
+            }
+            prev_member = sr;
+            sr = next;
+        }
+    }
+    else
+    {
+        for (long i = search_start; i < search_limit; i++)
+        {
+            if (state->assignments[i - base] == pattern[0])
+            {
+                if (memcmp(&state->assignments[i - base], pattern,
+                           (size_t)len * sizeof(int)) == 0)
+                {
+                    int next_cluster = state->assignments[i + len - base];
+                    if (next_cluster >= 0 && next_cluster < state->num_clusters)
+                    {
+                        counts[next_cluster]++;
+                    }
                 }
             }
         }
@@ -139,7 +198,8 @@ int get_prediction_candidates(
  * from the current frame to each remaining candidate
  * cluster using the 5-point triangle inequality.  If the
  * bound exceeds rlim the candidate is pruned (clmembflag
- * set to 0).
+ * set to 0).  Early-abandon lower bounds (flagged in
+ * scratch.dist_lower_bound) are never used as references.
  *
  * Requires at least 3 measured clusters (temp_count >= 3).
  */
@@ -153,6 +213,10 @@ void prune_candidates_te5(
     if (!config->optim.te5_mode || temp_count < 3)
         return;
 
+    /* Early-abandon lower bounds (-abandon) cannot serve as 5-point references */
+    if (state->scratch.dist_lower_bound[temp_count - 1])
+        return;
+
     int c3 = temp_indices[temp_count - 1]; // Current cluster (newest anchor)
     double d_f_c3 = temp_dists[temp_count - 1];
 
@@ -160,6 +224,9 @@ void prune_candidates_te5(
     {
         for (int q = p + 1; q < temp_count - 1; q++)
         {
+            if (state->scratch.dist_lower_bound[p] || state->scratch.dist_lower_bound[q])
+                continue;
+
             int c1 = temp_indices[p];
             double d_f_c1 = temp_dists[p];
             int c2 = temp_indices[q];
@@ -172,55 +239,40 @@ void prune_candidates_te5(
 
             if (config->optim.sparse_dcc_mode)
             {
-                if (!state->scratch.dcc_measured[c1 * config->algo.maxnbclust + c2] ||
-                    !state->scratch.dcc_measured[c1 * config->algo.maxnbclust + c3] ||
-                    !state->scratch.dcc_measured[c2 * config->algo.maxnbclust + c3])
+                if (!dcc_get_measured(&state->scratch.dcc, c1, c2) ||
+                    !dcc_get_measured(&state->scratch.dcc, c1, c3) ||
+                    !dcc_get_measured(&state->scratch.dcc, c2, c3))
                 {
                     continue;
                 }
-                d_c1_c2 = state->scratch.dcc_min[c1 * config->algo.maxnbclust + c2];
-                d_c1_c3 = state->scratch.dcc_min[c1 * config->algo.maxnbclust + c3];
-                d_c2_c3 = state->scratch.dcc_min[c2 * config->algo.maxnbclust + c3];
+                d_c1_c2 = dcc_get_min(&state->scratch.dcc, c1, c2);
+                d_c1_c3 = dcc_get_min(&state->scratch.dcc, c1, c3);
+                d_c2_c3 = dcc_get_min(&state->scratch.dcc, c2, c3);
             }
             else
             {
-                d_c1_c2 = state->scratch.dcc_min[c1 * config->algo.maxnbclust + c2];
+                d_c1_c2 = dcc_get_min(&state->scratch.dcc, c1, c2);
                 if (d_c1_c2 < 0.0)
                 {
                     d_c1_c2 = get_dist(&state->clusters[c1].anchor, &state->clusters[c2].anchor, -1,
                                        -1.0, -1.0, config, state);
-                    state->scratch.dcc_min[c1 * config->algo.maxnbclust + c2] = d_c1_c2;
-                    state->scratch.dcc_min[c2 * config->algo.maxnbclust + c1] = d_c1_c2;
-                    state->scratch.dcc_max[c1 * config->algo.maxnbclust + c2] = d_c1_c2;
-                    state->scratch.dcc_max[c2 * config->algo.maxnbclust + c1] = d_c1_c2;
-                    state->scratch.dcc_measured[c1 * config->algo.maxnbclust + c2] = 1;
-                    state->scratch.dcc_measured[c2 * config->algo.maxnbclust + c1] = 1;
+                    dcc_set_exact(&state->scratch.dcc, c1, c2, d_c1_c2);
                 }
 
-                d_c1_c3 = state->scratch.dcc_min[c1 * config->algo.maxnbclust + c3];
+                d_c1_c3 = dcc_get_min(&state->scratch.dcc, c1, c3);
                 if (d_c1_c3 < 0.0)
                 {
                     d_c1_c3 = get_dist(&state->clusters[c1].anchor, &state->clusters[c3].anchor, -1,
                                        -1.0, -1.0, config, state);
-                    state->scratch.dcc_min[c1 * config->algo.maxnbclust + c3] = d_c1_c3;
-                    state->scratch.dcc_min[c3 * config->algo.maxnbclust + c1] = d_c1_c3;
-                    state->scratch.dcc_max[c1 * config->algo.maxnbclust + c3] = d_c1_c3;
-                    state->scratch.dcc_max[c3 * config->algo.maxnbclust + c1] = d_c1_c3;
-                    state->scratch.dcc_measured[c1 * config->algo.maxnbclust + c3] = 1;
-                    state->scratch.dcc_measured[c3 * config->algo.maxnbclust + c1] = 1;
+                    dcc_set_exact(&state->scratch.dcc, c1, c3, d_c1_c3);
                 }
 
-                d_c2_c3 = state->scratch.dcc_min[c2 * config->algo.maxnbclust + c3];
+                d_c2_c3 = dcc_get_min(&state->scratch.dcc, c2, c3);
                 if (d_c2_c3 < 0.0)
                 {
                     d_c2_c3 = get_dist(&state->clusters[c2].anchor, &state->clusters[c3].anchor, -1,
                                        -1.0, -1.0, config, state);
-                    state->scratch.dcc_min[c2 * config->algo.maxnbclust + c3] = d_c2_c3;
-                    state->scratch.dcc_min[c3 * config->algo.maxnbclust + c2] = d_c2_c3;
-                    state->scratch.dcc_max[c2 * config->algo.maxnbclust + c3] = d_c2_c3;
-                    state->scratch.dcc_max[c3 * config->algo.maxnbclust + c2] = d_c2_c3;
-                    state->scratch.dcc_measured[c2 * config->algo.maxnbclust + c3] = 1;
-                    state->scratch.dcc_measured[c3 * config->algo.maxnbclust + c2] = 1;
+                    dcc_set_exact(&state->scratch.dcc, c2, c3, d_c2_c3);
                 }
             }
 
@@ -241,86 +293,71 @@ void prune_candidates_te5(
 
                 if (config->optim.sparse_dcc_mode)
                 {
-                    if (!state->scratch.dcc_measured[cl_idx * config->algo.maxnbclust + c1] ||
-                        !state->scratch.dcc_measured[cl_idx * config->algo.maxnbclust + c2] ||
-                        !state->scratch.dcc_measured[cl_idx * config->algo.maxnbclust + c3])
+                    if (!dcc_get_measured(&state->scratch.dcc, cl_idx, c1) ||
+                        !dcc_get_measured(&state->scratch.dcc, cl_idx, c2) ||
+                        !dcc_get_measured(&state->scratch.dcc, cl_idx, c3))
                     {
                         continue;
                     }
-                    d_k_c1 = state->scratch.dcc_min[cl_idx * config->algo.maxnbclust + c1];
-                    d_k_c2 = state->scratch.dcc_min[cl_idx * config->algo.maxnbclust + c2];
-                    d_k_c3 = state->scratch.dcc_min[cl_idx * config->algo.maxnbclust + c3];
+                    d_k_c1 = dcc_get_min(&state->scratch.dcc, cl_idx, c1);
+                    d_k_c2 = dcc_get_min(&state->scratch.dcc, cl_idx, c2);
+                    d_k_c3 = dcc_get_min(&state->scratch.dcc, cl_idx, c3);
                 }
                 else
                 {
-                    d_k_c1 = state->scratch.dcc_min[cl_idx * config->algo.maxnbclust + c1];
+                    d_k_c1 = dcc_get_min(&state->scratch.dcc, cl_idx, c1);
                     if (d_k_c1 < 0.0)
                     {
 #ifdef _OPENMP
 #pragma omp critical(dcc_cache)
 #endif
                         {
-                            d_k_c1 = state->scratch.dcc_min[cl_idx * config->algo.maxnbclust + c1];
+                            d_k_c1 = dcc_get_min(&state->scratch.dcc, cl_idx, c1);
                             if (d_k_c1 < 0.0)
                             {
                                 d_k_c1 = get_dist(
                                     &state->clusters[cl_idx].anchor,
                                     &state->clusters[c1].anchor, -1, -1.0, -1.0,
                                     config, state);
-                                state->scratch.dcc_min[cl_idx * config->algo.maxnbclust + c1] = d_k_c1;
-                                state->scratch.dcc_min[c1 * config->algo.maxnbclust + cl_idx] = d_k_c1;
-                                state->scratch.dcc_max[cl_idx * config->algo.maxnbclust + c1] = d_k_c1;
-                                state->scratch.dcc_max[c1 * config->algo.maxnbclust + cl_idx] = d_k_c1;
-                                state->scratch.dcc_measured[cl_idx * config->algo.maxnbclust + c1] = 1;
-                                state->scratch.dcc_measured[c1 * config->algo.maxnbclust + cl_idx] = 1;
+                                dcc_set_exact(&state->scratch.dcc, cl_idx, c1, d_k_c1);
                             }
                         }
                     }
 
-                    d_k_c2 = state->scratch.dcc_min[cl_idx * config->algo.maxnbclust + c2];
+                    d_k_c2 = dcc_get_min(&state->scratch.dcc, cl_idx, c2);
                     if (d_k_c2 < 0.0)
                     {
 #ifdef _OPENMP
 #pragma omp critical(dcc_cache)
 #endif
                         {
-                            d_k_c2 = state->scratch.dcc_min[cl_idx * config->algo.maxnbclust + c2];
+                            d_k_c2 = dcc_get_min(&state->scratch.dcc, cl_idx, c2);
                             if (d_k_c2 < 0.0)
                             {
                                 d_k_c2 = get_dist(
                                     &state->clusters[cl_idx].anchor,
                                     &state->clusters[c2].anchor, -1, -1.0, -1.0,
                                     config, state);
-                                state->scratch.dcc_min[cl_idx * config->algo.maxnbclust + c2] = d_k_c2;
-                                state->scratch.dcc_min[c2 * config->algo.maxnbclust + cl_idx] = d_k_c2;
-                                state->scratch.dcc_max[cl_idx * config->algo.maxnbclust + c2] = d_k_c2;
-                                state->scratch.dcc_max[c2 * config->algo.maxnbclust + cl_idx] = d_k_c2;
-                                state->scratch.dcc_measured[cl_idx * config->algo.maxnbclust + c2] = 1;
-                                state->scratch.dcc_measured[c2 * config->algo.maxnbclust + cl_idx] = 1;
+                                dcc_set_exact(&state->scratch.dcc, cl_idx, c2, d_k_c2);
                             }
                         }
                     }
 
-                    d_k_c3 = state->scratch.dcc_min[cl_idx * config->algo.maxnbclust + c3];
+                    d_k_c3 = dcc_get_min(&state->scratch.dcc, cl_idx, c3);
                     if (d_k_c3 < 0.0)
                     {
 #ifdef _OPENMP
 #pragma omp critical(dcc_cache)
 #endif
                         {
-                            d_k_c3 = state->scratch.dcc_min[cl_idx * config->algo.maxnbclust + c3];
+                            d_k_c3 = dcc_get_min(&state->scratch.dcc, cl_idx, c3);
                             if (d_k_c3 < 0.0)
                             {
                                 d_k_c3 = get_dist(
                                     &state->clusters[cl_idx].anchor,
                                     &state->clusters[c3].anchor, -1, -1.0, -1.0,
                                     config, state);
-                                state->scratch.dcc_min[cl_idx * config->algo.maxnbclust + c3] = d_k_c3;
-                                state->scratch.dcc_min[c3 * config->algo.maxnbclust + cl_idx] = d_k_c3;
-                                state->scratch.dcc_max[cl_idx * config->algo.maxnbclust + c3] = d_k_c3;
-                                state->scratch.dcc_max[c3 * config->algo.maxnbclust + cl_idx] = d_k_c3;
-                                state->scratch.dcc_measured[cl_idx * config->algo.maxnbclust + c3] = 1;
-                                state->scratch.dcc_measured[c3 * config->algo.maxnbclust + cl_idx] = 1;
+                                dcc_set_exact(&state->scratch.dcc, cl_idx, c3, d_k_c3);
                             }
                         }
                     }
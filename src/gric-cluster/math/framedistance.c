@@ -3,19 +3,426 @@
  * @brief Euclidean distance calculation between frames.
  *
  * Implements the standard Euclidean distance metric between two multi-dimensional
- * frame coordinate vectors.
+ * frame coordinate vectors, for every supported frame storage type.
  *
  * Main Functions:
  * - framedist: Computes the Euclidean distance between two frames.
+ * - framedist_bounded: Early-abandon variant returning a lower bound once the
+ *   partial distance exceeds a threshold.
+ * - frame_norm_sq: Squared L2 norm of a frame (cached per cluster anchor).
+ * - framedist_batch: One frame against several anchors in a single pass.
+ * - framedist_set_threads: Size of the thread team splitting large frames.
+ * - framedist_first_touch: Place an anchor's pages near the threads reading them.
+ *
+ * Tile views (frame_is_view()) are read in place, span by span, against
+ * compact frames; no gathered copy of the tile is made.
+ *
+ * Compact same-dtype frames of at least DIST_TEAM_MIN_PIXELS pixels are
+ * summed segment by segment (DIST_TEAM_SEGMENT pixels), the segments being
+ * spread over a team of OpenMP threads. Segment sums are added in segment
+ * order whatever the team size, so results do not depend on -ncpu.
  */
 #include "framedistance.h"
 #include "common.h"
+#include "frame_dtype.h"
+#include "shared/dist_kernels.h"
+#include <float.h>
 #include <math.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/** Segments per thread evaluated between two early-abandon checks of a team. */
+#define DIST_TEAM_ROUND 4
+
+/* Largest distance team (framedist_set_threads()); 1 = no intra-distance threads */
+static int dist_team_max = 1;
+
+/**
+ * sqdist_u16() - Squared L2 distance between two uint16 buffers.
+ * @da:   First buffer.
+ * @db:   Second buffer.
+ * @size: Number of elements.
+ *
+ * Differences and squares are exact in integer arithmetic; the 64-bit
+ * accumulator cannot overflow below 2^31 pixels.
+ *
+ * Return: Sum of squared differences.
+ */
+static double sqdist_u16(
+    const uint16_t *restrict da,
+    const uint16_t *restrict db,
+    long                     size)
+{
+    uint64_t sum = 0;
+
+    for (long i = 0; i < size; i++)
+    {
+        int32_t diff = (int32_t)da[i] - (int32_t)db[i];
+        sum += (uint64_t)((int64_t)diff * diff);
+    }
+
+    return (double)sum;
+}
+
+/**
+ * sqdist_u8() - Squared L2 distance between two uint8 buffers.
+ * @da:   First buffer.
+ * @db:   Second buffer.
+ * @size: Number of elements.
+ *
+ * Return: Sum of squared differences (exact).
+ */
+static double sqdist_u8(
+    const uint8_t *restrict da,
+    const uint8_t *restrict db,
+    long                    size)
+{
+    uint64_t sum = 0;
+
+    /* 255^2 * 65536 < 2^32: 32-bit block sums keep the loop vectorizable */
+    for (long i0 = 0; i0 < size; i0 += 65536)
+    {
+        long     i1    = (size - i0 < 65536) ? size : i0 + 65536;
+        uint32_t block = 0;
+        for (long i = i0; i < i1; i++)
+        {
+            int32_t diff = (int32_t)da[i] - (int32_t)db[i];
+            block += (uint32_t)(diff * diff);
+        }
+        sum += block;
+    }
+
+    return (double)sum;
+}
+
+/**
+ * sqdist_mixed() - Squared L2 distance between frames of different dtypes.
+ * @a:    First frame.
+ * @b:    Second frame.
+ * @size: Number of elements.
+ *
+ * Slow path; only reached when frames from different sources are compared.
+ *
+ * Return: Sum of squared differences.
+ */
+static double sqdist_mixed(
+    const Frame *a,
+    const Frame *b,
+    long         size)
+{
+    double sum = 0.0;
+
+    for (long i = 0; i < size; i++)
+    {
+        double diff = frame_get(a, i) - frame_get(b, i);
+        sum += diff * diff;
+    }
+
+    return sum;
+}
+
+/**
+ * sqdist_span() - Squared L2 distance between two same-dtype pixel runs.
+ * @dtype: Storage type of both runs.
+ * @da:    First run.
+ * @db:    Second run.
+ * @len:   Number of pixels.
+ *
+ * Return: Sum of squared differences.
+ */
+static double sqdist_span(
+    FrameDType  dtype,
+    const void *da,
+    const void *db,
+    long        len)
+{
+    switch (dtype)
+    {
+    case FRAME_DTYPE_F32:
+        return dist_sq_f32((const float *)da, (const float *)db, len);
+    case FRAME_DTYPE_U16:
+        return sqdist_u16((const uint16_t *)da, (const uint16_t *)db, len);
+    case FRAME_DTYPE_U8:
+        return sqdist_u8((const uint8_t *)da, (const uint8_t *)db, len);
+    default:
+        return dist_sq_f64((const double *)da, (const double *)db, len);
+    }
+}
+
+/**
+ * sqdist_view() - Squared L2 distance between a tile view and a compact frame.
+ * @v:        Tile view (frame_is_view()).
+ * @b:        Compact frame of the same dtype, one pixel per view pixel.
+ * @limit_sq: Abandon threshold on the partial sum, or <= 0 for none.
+ * @exact:    Output; 1 if the full sum was computed, 0 if abandoned.
+ *
+ * Each span is compared in place against the matching run of @b. Without a
+ * limit every span is one kernel call, so a single-span view gives the same
+ * sum as a contiguous copy; with a limit, spans are cut into
+ * DIST_BOUNDED_BLOCK runs like the contiguous bounded kernels.
+ *
+ * Return: Full sum, or a partial sum greater than @limit_sq.
+ */
+static double sqdist_view(
+    const Frame *v,
+    const Frame *b,
+    double       limit_sq,
+    int         *exact)
+{
+    size_t      esize = frame_dtype_size(v->dtype);
+    const char *src   = (const char *)v->data;
+    const char *cb    = (const char *)b->data;
+    double      sum   = 0.0;
+    long        pos   = 0;
+    long        size  = b->width * b->height;
+
+    *exact = 1;
+    for (int ss = 0; ss < v->num_spans; ss++)
+    {
+        const char *ca  = src + (size_t)v->spans[ss].offset * esize;
+        long        len = v->spans[ss].len;
+        if (limit_sq <= 0.0)
+        {
+            sum += sqdist_span(v->dtype, ca, cb + (size_t)pos * esize, len);
+            pos += len;
+            continue;
+        }
+        for (long off = 0; off < len; off += DIST_BOUNDED_BLOCK)
+        {
+            long blen = (len - off < DIST_BOUNDED_BLOCK) ? len - off : DIST_BOUNDED_BLOCK;
+            sum += sqdist_span(v->dtype, ca + (size_t)off * esize,
+                               cb + (size_t)(pos + off) * esize, blen);
+            if (sum > limit_sq && pos + off + blen < size)
+            {
+                *exact = 0;
+                return sum;
+            }
+        }
+        pos += len;
+    }
+    return sum;
+}
 
-#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
-#include <immintrin.h>
+/**
+ * sqdist_view_generic() - Squared L2 distance when views meet other views or dtypes.
+ * @a:    First frame (view or compact).
+ * @b:    Second frame (view or compact).
+ * @size: Number of pixels.
+ *
+ * Slow path, like sqdist_mixed(); not reached by the tile pipeline, which
+ * only compares views against compact anchors of the same dtype.
+ *
+ * Return: Sum of squared differences.
+ */
+static double sqdist_view_generic(
+    const Frame *a,
+    const Frame *b,
+    long         size)
+{
+    const Frame *fr[2] = {a, b};
+    int          span[2] = {0, 0};
+    long         left[2];
+    long         raw[2];
+    double       sum = 0.0;
+
+    for (int kk = 0; kk < 2; kk++)
+    {
+        left[kk] = frame_is_view(fr[kk]) ? fr[kk]->spans[0].len : size;
+        raw[kk]  = frame_is_view(fr[kk]) ? fr[kk]->spans[0].offset : 0;
+    }
+    for (long ii = 0; ii < size; ii++)
+    {
+        double diff = frame_get(a, raw[0]) - frame_get(b, raw[1]);
+        sum += diff * diff;
+        for (int kk = 0; kk < 2; kk++)
+        {
+            raw[kk]++;
+            if (--left[kk] == 0 && ii + 1 < size)
+            {
+                span[kk]++;
+                left[kk] = fr[kk]->spans[span[kk]].len;
+                raw[kk]  = fr[kk]->spans[span[kk]].offset;
+            }
+        }
+    }
+    return sum;
+}
+
+/**
+ * framedist_set_threads() - Set the largest team splitting one distance.
+ * @nthreads: Thread count (-ncpu); values below 2 disable the team.
+ */
+void framedist_set_threads(
+    int nthreads)
+{
+    dist_team_max = (nthreads > 1) ? nthreads : 1;
+}
+
+/**
+ * framedist_team_size() - Threads splitting a distance over @size pixels.
+ * @size: Pixels per frame.
+ *
+ * One thread per DIST_TEAM_MIN_PIXELS pixels, up to the framedist_set_threads()
+ * limit. A distance evaluated inside a parallel region (pruning loops,
+ * speculative batches) is not split again.
+ *
+ * Return: Team size, 1 for a sequential evaluation.
+ */
+int framedist_team_size(
+    long size)
+{
+    long team = size / DIST_TEAM_MIN_PIXELS;
+    if (team > dist_team_max)
+    {
+        team = dist_team_max;
+    }
+#ifdef _OPENMP
+    if (team > 1 && omp_in_parallel())
+    {
+        team = 1;
+    }
+#else
+    team = 1;
+#endif
+    return (team > 1) ? (int)team : 1;
+}
+
+/**
+ * sqdist_segmented() - Squared L2 distance of large frames, segment by segment.
+ * @a:        First frame (compact).
+ * @b:        Second frame (compact, same dtype as @a).
+ * @size:     Number of pixels (at least DIST_TEAM_MIN_PIXELS).
+ * @limit_sq: Abandon threshold on the partial sum, or <= 0 for none.
+ * @exact:    Output; 1 if the full sum was computed, 0 if abandoned.
+ *
+ * Segment sums are added in order and the abandon test follows each segment,
+ * so the result is the same for every team size. A team evaluates
+ * DIST_TEAM_ROUND segments per thread at a time (static schedule, the
+ * placement framedist_first_touch() uses) before testing the partial sums;
+ * the segments of the last round beyond the abandon point are wasted.
+ *
+ * Return: Full sum, or a partial sum greater than @limit_sq.
+ */
+static double sqdist_segmented(
+    const Frame *a,
+    const Frame *b,
+    long         size,
+    double       limit_sq,
+    int         *exact)
+{
+    size_t      esize = frame_dtype_size(a->dtype);
+    const char *ca    = (const char *)a->data;
+    const char *cb    = (const char *)b->data;
+    long        nseg  = (size + DIST_TEAM_SEGMENT - 1) / DIST_TEAM_SEGMENT;
+    int         team  = framedist_team_size(size);
+    double      sum   = 0.0;
+
+    *exact = 1;
+    if (team == 1)
+    {
+        for (long ss = 0; ss < nseg; ss++)
+        {
+            long off = ss * DIST_TEAM_SEGMENT;
+            long len = (size - off < DIST_TEAM_SEGMENT) ? size - off : DIST_TEAM_SEGMENT;
+            sum += sqdist_span(a->dtype, ca + (size_t)off * esize, cb + (size_t)off * esize, len);
+            if (limit_sq > 0.0 && sum > limit_sq && ss + 1 < nseg)
+            {
+                *exact = 0;
+                return sum;
+            }
+        }
+        return sum;
+    }
+
+    long   round = (long)team * DIST_TEAM_ROUND;
+    double part[round];
+    int    stop = 0;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(team)
+#endif
+    for (long r0 = 0; r0 < nseg && !stop; r0 += round)
+    {
+        long r1 = (nseg - r0 < round) ? nseg : r0 + round;
+#ifdef _OPENMP
+#pragma omp for schedule(static)
 #endif
+        for (long ss = r0; ss < r1; ss++)
+        {
+            long off = ss * DIST_TEAM_SEGMENT;
+            long len = (size - off < DIST_TEAM_SEGMENT) ? size - off : DIST_TEAM_SEGMENT;
+            part[ss - r0] = sqdist_span(a->dtype, ca + (size_t)off * esize,
+                                        cb + (size_t)off * esize, len);
+        }
+#ifdef _OPENMP
+#pragma omp single
+#endif
+        for (long ss = r0; ss < r1 && !stop; ss++)
+        {
+            sum += part[ss - r0];
+            if (limit_sq > 0.0 && sum > limit_sq && ss + 1 < nseg)
+            {
+                *exact = 0;
+                stop   = 1;
+            }
+        }
+    }
+    return sum;
+}
+
+/**
+ * framedist_first_touch() - Move a frame's pixels to pages placed for its team.
+ * @f: Frame owning its (compact) pixel buffer, typically a new cluster anchor.
+ *
+ * Anchors are read by every later distance. On NUMA systems a page lives on
+ * the node of the thread that first wrote it, and the buffer handed over by
+ * the reader was written by the reader thread. When distances over frames
+ * of this size are split across a team, the pixels are copied into a fresh
+ * buffer by the same team with the same segment placement as
+ * sqdist_segmented(), so each thread later reads segments from its own node.
+ * Other frames, or @f if the new buffer cannot be allocated, are left alone.
+ */
+void framedist_first_touch(
+    Frame *f)
+{
+    long size = f->width * f->height;
+    int  team = (size >= DIST_TEAM_MIN_PIXELS) ? framedist_team_size(size) : 1;
+    if (team == 1 || f->borrowed || frame_is_view(f) || f->data == NULL)
+    {
+        return;
+    }
+
+    size_t esize = frame_dtype_size(f->dtype);
+    char  *dst   = (char *)malloc((size_t)size * esize);
+    if (dst == NULL)
+    {
+        return;
+    }
+    const char *src   = (const char *)f->data;
+    long        nseg  = (size + DIST_TEAM_SEGMENT - 1) / DIST_TEAM_SEGMENT;
+    long        round = (long)team * DIST_TEAM_ROUND;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(team)
+#endif
+    for (long r0 = 0; r0 < nseg; r0 += round)
+    {
+        long r1 = (nseg - r0 < round) ? nseg : r0 + round;
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for (long ss = r0; ss < r1; ss++)
+        {
+            long off = ss * DIST_TEAM_SEGMENT;
+            long len = (size - off < DIST_TEAM_SEGMENT) ? size - off : DIST_TEAM_SEGMENT;
+            memcpy(dst + (size_t)off * esize, src + (size_t)off * esize, (size_t)len * esize);
+        }
+    }
+    free(f->data);
+    f->data = dst;
+}
 
 /**
  * framedist() - Computes the Euclidean distance between two frames.
@@ -24,7 +431,11 @@
  *
  * Checks that the frames have matching dimensions (width and height),
  * and then computes the L2 Euclidean distance between their pixel data.
- * Utilizes SIMD/AVX2 vectorization when compiled on supporting x86 architectures.
+ * Dispatches on the frame storage type; all kernels accumulate in double
+ * (or exact 64-bit integers for u8/u16).  The f64/f32 paths use the
+ * runtime-dispatched kernels of shared/dist_kernels.c (AVX-512, AVX2,
+ * NEON or scalar, chosen from CPUID). Tile views are read in place; large
+ * frames go through sqdist_segmented().
  *
  * Return: The Euclidean distance, or -1.0 if the frame dimensions mismatch.
  */
@@ -37,44 +448,344 @@ double framedist(
         return -1.0;
     }
 
-    double sum = 0.0;
     long size = a->width * a->height;
+    double sum;
 
-    const double *restrict da = a->data;
-    const double *restrict db = b->data;
+    if (frame_is_view(b) && !frame_is_view(a))
+    {
+        Frame *t = a;
+        a = b;
+        b = t;
+    }
+    if (frame_is_view(a))
+    {
+        int exact;
+        sum = (frame_is_view(b) || a->dtype != b->dtype)
+                  ? sqdist_view_generic(a, b, size)
+                  : sqdist_view(a, b, 0.0, &exact);
+    }
+    else if (a->dtype != b->dtype)
+    {
+        sum = sqdist_mixed(a, b, size);
+    }
+    else if (size >= DIST_TEAM_MIN_PIXELS)
+    {
+        int exact;
+        sum = sqdist_segmented(a, b, size, 0.0, &exact);
+    }
+    else
+    {
+        switch (a->dtype)
+        {
+        case FRAME_DTYPE_F32:
+            sum = dist_sq_f32((const float *)a->data, (const float *)b->data, size);
+            break;
+        case FRAME_DTYPE_U16:
+            sum = sqdist_u16((const uint16_t *)a->data, (const uint16_t *)b->data, size);
+            break;
+        case FRAME_DTYPE_U8:
+            sum = sqdist_u8((const uint8_t *)a->data, (const uint8_t *)b->data, size);
+            break;
+        default:
+            sum = dist_sq_f64((const double *)a->data, (const double *)b->data, size);
+            break;
+        }
+    }
 
-    long i = 0;
+    return sqrt(sum);
+}
 
-// Use AVX2 if supported and on x86
-#if defined(__AVX__) && \
-    (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
-    // Process 4 doubles at a time
-    if (size >= 4)
+/**
+ * sqdist_int_bounded() - Blocked u16/u8 squared distance with early abandon.
+ * @a:        First frame.
+ * @b:        Second frame (same integer dtype as @a).
+ * @size:     Number of elements.
+ * @limit_sq: Abandon threshold on the partial sum.
+ * @exact:    Output; 1 if the full sum was computed, 0 if abandoned.
+ *
+ * Integer block sums are exact, so a completed sum equals framedist()'s.
+ *
+ * Return: Full sum, or a partial sum greater than @limit_sq.
+ */
+static double sqdist_int_bounded(
+    const Frame *a,
+    const Frame *b,
+    long         size,
+    double       limit_sq,
+    int         *exact)
+{
+    double sum = 0.0;
+
+    for (long off = 0; off < size; off += DIST_BOUNDED_BLOCK)
     {
-        __m256d sum_vec = _mm256_setzero_pd();
-        for (; i <= size - 4; i += 4)
+        long len = (size - off < DIST_BOUNDED_BLOCK) ? size - off : DIST_BOUNDED_BLOCK;
+        if (a->dtype == FRAME_DTYPE_U16)
         {
-            __m256d va = _mm256_loadu_pd(&da[i]);
-            __m256d vb = _mm256_loadu_pd(&db[i]);
-            __m256d diff = _mm256_sub_pd(va, vb);
-#ifdef __FMA__
-            sum_vec = _mm256_fmadd_pd(diff, diff, sum_vec);
-#else
-            sum_vec = _mm256_add_pd(sum_vec, _mm256_mul_pd(diff, diff));
-#endif
+            sum += sqdist_u16((const uint16_t *)a->data + off,
+                              (const uint16_t *)b->data + off, len);
+        }
+        else
+        {
+            sum += sqdist_u8((const uint8_t *)a->data + off,
+                             (const uint8_t *)b->data + off, len);
+        }
+        if (sum > limit_sq && off + len < size)
+        {
+            *exact = 0;
+            return sum;
         }
-        // Horizontal add
-        __m256d hsum = _mm256_hadd_pd(sum_vec, sum_vec);
-        sum += ((double *)&hsum)[0] + ((double *)&hsum)[2];
     }
-#endif
+    *exact = 1;
+    return sum;
+}
 
-    // Handle tail or scalar fallback
-    for (; i < size; i++)
+/**
+ * framedist_bounded() - Euclidean distance with early abandon.
+ * @a:     Pointer to the first Frame.
+ * @b:     Pointer to the second Frame.
+ * @limit: Distance above which the exact value is not needed.
+ * @exact: Output; 1 if the returned value is the exact distance, 0 if it is
+ *         a lower bound.
+ *
+ * Accumulates squared differences block by block and stops as soon as the
+ * partial sum exceeds @limit^2; the square root of that partial sum is
+ * then a lower bound greater than @limit. A @limit <= 0 disables the
+ * abandon and is equivalent to framedist(). Mixed-dtype pairs are always
+ * evaluated in full. Large frames are tested after each DIST_TEAM_SEGMENT
+ * segment rather than each block.
+ *
+ * Return: Exact distance or lower bound (see @exact), or -1.0 if the frame
+ * dimensions mismatch.
+ */
+double framedist_bounded(
+    Frame  *a,
+    Frame  *b,
+    double  limit,
+    int    *exact)
+{
+    *exact = 1;
+    if (limit <= 0.0 || a->dtype != b->dtype || (frame_is_view(a) && frame_is_view(b)))
     {
-        double diff = da[i] - db[i];
-        sum += diff * diff;
+        return framedist(a, b);
+    }
+    if (a->width != b->width || a->height != b->height)
+    {
+        return -1.0;
+    }
+
+    long   size     = a->width * a->height;
+    double limit_sq = limit * limit;
+    double sum;
+
+    if (frame_is_view(a) || frame_is_view(b))
+    {
+        return sqrt(frame_is_view(a) ? sqdist_view(a, b, limit_sq, exact)
+                                     : sqdist_view(b, a, limit_sq, exact));
+    }
+    if (size >= DIST_TEAM_MIN_PIXELS)
+    {
+        return sqrt(sqdist_segmented(a, b, size, limit_sq, exact));
+    }
+
+    switch (a->dtype)
+    {
+    case FRAME_DTYPE_F32:
+        sum = dist_sq_f32_bounded((const float *)a->data, (const float *)b->data, size,
+                                  limit_sq, exact);
+        break;
+    case FRAME_DTYPE_U16:
+    case FRAME_DTYPE_U8:
+        sum = sqdist_int_bounded(a, b, size, limit_sq, exact);
+        break;
+    default:
+        sum = dist_sq_f64_bounded((const double *)a->data, (const double *)b->data, size,
+                                  limit_sq, exact);
+        break;
     }
 
     return sqrt(sum);
 }
+
+/**
+ * frame_norm_sq() - Squared L2 norm of a frame.
+ * @f: Frame.
+ *
+ * Computed once per anchor at cluster creation and cached in
+ * Cluster.norm_sq for framedist_batch().
+ *
+ * Return: Sum of squared pixel values.
+ */
+double frame_norm_sq(
+    const Frame *f)
+{
+    long   size = f->width * f->height;
+    double sum  = 0.0;
+
+    if (frame_is_view(f))
+    {
+        for (int ss = 0; ss < f->num_spans; ss++)
+        {
+            long end = f->spans[ss].offset + f->spans[ss].len;
+            for (long ii = f->spans[ss].offset; ii < end; ii++)
+            {
+                double v = frame_get(f, ii);
+                sum += v * v;
+            }
+        }
+        return sum;
+    }
+
+    for (long ii = 0; ii < size; ii++)
+    {
+        double v = frame_get(f, ii);
+        sum += v * v;
+    }
+    return sum;
+}
+
+/**
+ * dot_batch_view() - Dot products of a f64/f32 tile view with compact anchors.
+ * @f:       Tile view.
+ * @anchors: @na compact anchors of the same dtype and size.
+ * @na:      Number of anchors.
+ * @dot:     Output; @na dot products.
+ *
+ * Runs the batched kernels once per span, offsetting the anchor pointers to
+ * the matching run, and accumulates the partial products.
+ *
+ * Return: f.f.
+ */
+static double dot_batch_view(
+    const Frame  *f,
+    Frame *const *anchors,
+    int           na,
+    double       *dot)
+{
+    double part[na];
+    double ff  = 0.0;
+    long   pos = 0;
+
+    for (int kk = 0; kk < na; kk++)
+    {
+        dot[kk] = 0.0;
+    }
+    for (int ss = 0; ss < f->num_spans; ss++)
+    {
+        long len = f->spans[ss].len;
+        if (f->dtype == FRAME_DTYPE_F32)
+        {
+            const float *ptrs[na];
+            for (int kk = 0; kk < na; kk++)
+            {
+                ptrs[kk] = (const float *)anchors[kk]->data + pos;
+            }
+            ff += dist_dot_batch_f32((const float *)f->data + f->spans[ss].offset, ptrs, na,
+                                     len, part);
+        }
+        else
+        {
+            const double *ptrs[na];
+            for (int kk = 0; kk < na; kk++)
+            {
+                ptrs[kk] = (const double *)anchors[kk]->data + pos;
+            }
+            ff += dist_dot_batch_f64((const double *)f->data + f->spans[ss].offset, ptrs, na,
+                                     len, part);
+        }
+        for (int kk = 0; kk < na; kk++)
+        {
+            dot[kk] += part[kk];
+        }
+        pos += len;
+    }
+    return ff;
+}
+
+/**
+ * framedist_batch() - Distances from one frame to several anchors.
+ * @f:          Frame.
+ * @anchors:    @na anchor frames.
+ * @anchor_nsq: Cached squared norms of @anchors (Cluster.norm_sq).
+ * @na:         Number of anchors.
+ * @guard:      Decision radius (rlim); results near or below it are exact.
+ * @out:        Output; @na distances.
+ *
+ * For f64/f32 frames the distances are evaluated in the dot-product form
+ * ||f||^2 + ||a||^2 - 2 f.a with the register-blocked kernels of
+ * shared/dist_kernels.c, so the frame is streamed once per group of four
+ * anchors instead of once per anchor. That form loses absolute accuracy
+ * to cancellation (error ~ n * eps * (||f||^2 + ||a||^2)), so any result
+ * whose square lies below @guard^2 plus that error margin is recomputed
+ * with framedist(): matches and near-misses are always exact, only clear
+ * mismatches carry the (relative ~eps) dot-product error. Other dtypes,
+ * mixed dtypes or mismatched dimensions fall back to framedist() per anchor.
+ */
+void framedist_batch(
+    Frame        *f,
+    Frame *const *anchors,
+    const double *anchor_nsq,
+    int           na,
+    double        guard,
+    double       *out)
+{
+    long size    = f->width * f->height;
+    int  batched = (f->dtype == FRAME_DTYPE_F64 || f->dtype == FRAME_DTYPE_F32);
+
+    for (int kk = 0; kk < na && batched; kk++)
+    {
+        if (anchors[kk]->dtype != f->dtype || anchors[kk]->width != f->width ||
+            anchors[kk]->height != f->height)
+        {
+            batched = 0;
+        }
+    }
+
+    if (!batched || na < 2)
+    {
+        for (int kk = 0; kk < na; kk++)
+        {
+            out[kk] = framedist(f, anchors[kk]);
+        }
+        return;
+    }
+
+    /* out[] holds the dot products until they are turned into distances */
+    double ff;
+    if (frame_is_view(f))
+    {
+        ff = dot_batch_view(f, anchors, na, out);
+    }
+    else if (f->dtype == FRAME_DTYPE_F32)
+    {
+        const float *ptrs[na];
+        for (int kk = 0; kk < na; kk++)
+        {
+            ptrs[kk] = (const float *)anchors[kk]->data;
+        }
+        ff = dist_dot_batch_f32((const float *)f->data, ptrs, na, size, out);
+    }
+    else
+    {
+        const double *ptrs[na];
+        for (int kk = 0; kk < na; kk++)
+        {
+            ptrs[kk] = (const double *)anchors[kk]->data;
+        }
+        ff = dist_dot_batch_f64((const double *)f->data, ptrs, na, size, out);
+    }
+
+    double guard_sq = guard * guard;
+    for (int kk = 0; kk < na; kk++)
+    {
+        double d_sq = ff + anchor_nsq[kk] - 2.0 * out[kk];
+        double tol  = 4.0 * (double)size * DBL_EPSILON * (ff + anchor_nsq[kk]);
+        if (d_sq <= guard_sq + tol)
+        {
+            out[kk] = framedist(f, anchors[kk]);
+        }
+        else
+        {
+            out[kk] = sqrt(d_sq);
+        }
+    }
+}
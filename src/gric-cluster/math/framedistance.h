@@ -3,12 +3,18 @@
 
 #include "common.h"
 
+/** Pixels per thread of a distance team; smaller frames are never split. */
+#define DIST_TEAM_MIN_PIXELS 131072
+
+/** Pixels per segment of a large-frame distance (unit of work of the team). */
+#define DIST_TEAM_SEGMENT 16384
+
 /**
  * @brief Computes the Euclidean distance between two frames.
  *
  * Checks that the frames have matching dimensions (width and height),
  * and then computes the L2 Euclidean distance between their pixel data.
- * Utilizes SIMD/AVX2 vectorization when compiled on supporting x86 architectures.
+ * Uses the runtime-dispatched SIMD kernels of shared/dist_kernels.c.
  *
  * @param a Pointer to the first Frame.
  * @param b Pointer to the second Frame.
@@ -18,4 +24,74 @@ double framedist(
     Frame *a,
     Frame *b);
 
+/**
+ * @brief Euclidean distance that stops early once it exceeds @limit.
+ *
+ * When the partial distance passes @limit the evaluation is abandoned and
+ * the partial value (a lower bound on the true distance) is returned with
+ * *@exact set to 0. A @limit <= 0 computes the full distance.
+ *
+ * @param a     Pointer to the first Frame.
+ * @param b     Pointer to the second Frame.
+ * @param limit Distance above which the exact value is not needed.
+ * @param exact Output; 1 if the result is exact, 0 if it is a lower bound.
+ * @return Distance or lower bound, or -1.0 if the frame dimensions mismatch.
+ */
+double framedist_bounded(
+    Frame  *a,
+    Frame  *b,
+    double  limit,
+    int    *exact);
+
+/**
+ * @brief Squared L2 norm of a frame's pixels.
+ */
+double frame_norm_sq(
+    const Frame *f);
+
+/**
+ * @brief Distances from one frame to @na anchors, streaming the frame once.
+ *
+ * Uses the dot-product form with cached anchor norms for f64/f32 frames;
+ * results whose square falls within the rounding margin of @guard^2 (or
+ * below it) are recomputed exactly with framedist().
+ *
+ * @param f          Frame.
+ * @param anchors    Anchor frames.
+ * @param anchor_nsq Cached ||anchor||^2 values (Cluster.norm_sq).
+ * @param na         Number of anchors.
+ * @param guard      Decision radius (rlim).
+ * @param out        Output distances.
+ */
+void framedist_batch(
+    Frame        *f,
+    Frame *const *anchors,
+    const double *anchor_nsq,
+    int           na,
+    double        guard,
+    double       *out);
+
+/**
+ * @brief Allow up to @nthreads threads to split one large-frame distance (-ncpu).
+ */
+void framedist_set_threads(
+    int nthreads);
+
+/**
+ * @brief Threads splitting one distance over @size pixels (1 = sequential).
+ *
+ * One thread per DIST_TEAM_MIN_PIXELS pixels, up to the framedist_set_threads()
+ * limit; 1 inside a parallel region.
+ */
+int framedist_team_size(
+    long size);
+
+/**
+ * @brief Copy a large frame's pixels into pages first touched by its distance team.
+ *
+ * For new cluster anchors on NUMA systems; other frames are left alone.
+ */
+void framedist_first_touch(
+    Frame *f);
+
 #endif // FRAMEDISTANCE_H
@@ -415,14 +415,14 @@ void predict_joint_tuples(
                 double dcc_best = 0.0;
                 if (q_best != C)
                 {
-                    int idx = q_best * max_clusters + C;
-                    if (ts_best->state.scratch.dcc_measured[idx])
+                    const DccStore *bounds = &ts_best->state.scratch.dcc;
+                    if (dcc_get_measured(bounds, q_best, C))
                     {
-                        dcc_best = ts_best->state.scratch.dcc_min[idx];
+                        dcc_best = dcc_get_min(bounds, q_best, C);
                     }
                     else
                     {
-                        dcc_best = ts_best->state.scratch.dcc_max[idx];
+                        dcc_best = dcc_get_max(bounds, q_best, C);
                     }
                     if (dcc_best < 0.0)
                     {
@@ -467,14 +467,14 @@ void predict_joint_tuples(
                                 double dcc = 0.0;
                                 if (q_m != cB)
                                 {
-                                    int idx = q_m * max_clusters + cB;
-                                    if (ts->state.scratch.dcc_measured[idx])
+                                    const DccStore *bounds = &ts->state.scratch.dcc;
+                                    if (dcc_get_measured(bounds, q_m, cB))
                                     {
-                                        dcc = ts->state.scratch.dcc_min[idx];
+                                        dcc = dcc_get_min(bounds, q_m, cB);
                                     }
                                     else
                                     {
-                                        dcc = ts->state.scratch.dcc_max[idx];
+                                        dcc = dcc_get_max(bounds, q_m, cB);
                                     }
                                     if (dcc < 0.0)
                                     {
@@ -512,15 +512,14 @@ void predict_joint_tuples(
                                         double dcc = 0.0;
                                         if (cA != cB)
                                         {
-                                            int maxcl = ts->config.algo.maxnbclust;
-                                            int idx = cA * maxcl + cB;
-                                            if (ts->state.scratch.dcc_measured[idx])
+                                            const DccStore *bounds = &ts->state.scratch.dcc;
+                                            if (dcc_get_measured(bounds, cA, cB))
                                             {
-                                                dcc = ts->state.scratch.dcc_min[idx];
+                                                dcc = dcc_get_min(bounds, cA, cB);
                                             }
                                             else
                                             {
-                                                dcc = ts->state.scratch.dcc_max[idx];
+                                                dcc = dcc_get_max(bounds, cA, cB);
                                             }
                                             if (dcc < 0.0)
                                             {
@@ -585,15 +584,14 @@ void predict_joint_tuples(
                     double dcc = 0.0;
                     if (cA != cB)
                     {
-                        int maxcl = ts->config.algo.maxnbclust;
-                        int idx = cA * maxcl + cB;
-                        if (ts->state.scratch.dcc_measured[idx])
+                        const DccStore *bounds = &ts->state.scratch.dcc;
+                        if (dcc_get_measured(bounds, cA, cB))
                         {
-                            dcc = ts->state.scratch.dcc_min[idx];
+                            dcc = dcc_get_min(bounds, cA, cB);
                         }
                         else
                         {
-                            dcc = ts->state.scratch.dcc_max[idx];
+                            dcc = dcc_get_max(bounds, cA, cB);
                         }
                         if (dcc < 0.0)
                         {
@@ -743,8 +741,8 @@ void cpt_update_incremental(
  * @state: Running state of the clustering execution.
  * @ctx:   Opaque callback context (pointer to the current TileState).
  *
- * Reads neighbor tile assignments from the shared board. If a neighbor tile has resolved
- * to a cluster index (>= 0), extracts the conditional row from the CPT and multiplies it
+ * Reads neighbor tile assignments posted for the current frame from the shared board. If a
+ * neighbor tile has resolved to a cluster index (>= 0), extracts the conditional row from the CPT and multiplies it
  * into entropy_p_current. Renormalizes entropy_p_current.
  */
 void inject_cross_tile_priors(
@@ -758,7 +756,7 @@ void inject_cross_tile_priors(
         return;
     }
 
-    volatile int *board = ts->xtile_board;
+    volatile int64_t *board = ts->xtile_board;
     double *cpt = ts->cpt;
     int *last_injected = ts->last_injected_assignment;
     int M = ts->num_tiles;
@@ -776,7 +774,7 @@ void inject_cross_tile_priors(
             continue;
         }
 
-        int j = __atomic_load_n(&board[mp], __ATOMIC_ACQUIRE);
+        int j = xtile_board_read(&board[mp], ts->cur_frame);
         if (j < 0 || j >= max_clusters)
         {
             continue;
@@ -884,7 +882,7 @@ void inject_cross_tile_priors_st(
         {
             continue;
         }
-        int j = __atomic_load_n(&ts->xtile_board[mp], __ATOMIC_ACQUIRE);
+        int j = xtile_board_read(&ts->xtile_board[mp], ts->cur_frame);
         if (j >= 0 && j < max_clusters)
         {
             if (ts->last_injected_assignment[mp] != j)
@@ -926,7 +924,7 @@ void inject_cross_tile_priors_st(
             continue;
         }
 
-        int j = __atomic_load_n(&ts->xtile_board[mp], __ATOMIC_ACQUIRE);
+        int j = xtile_board_read(&ts->xtile_board[mp], ts->cur_frame);
         if (j >= 0 && j < max_clusters)
         {
             spatial_key[mp] = j;
@@ -1008,7 +1006,7 @@ void inject_cross_tile_priors_st(
     {
         if (mp != tile_m)
         {
-            int j = __atomic_load_n(&ts->xtile_board[mp], __ATOMIC_ACQUIRE);
+            int j = xtile_board_read(&ts->xtile_board[mp], ts->cur_frame);
             ts->last_injected_assignment[mp] = j;
         }
     }
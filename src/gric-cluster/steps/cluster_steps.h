@@ -40,20 +40,73 @@ int select_next_measurement_target(
     int            meas_idx);
 
 /**
- * @brief Recompute the consistency bitmask for all cluster pairs.
+ * @brief Prepare an empty consistency-mask cache for @n clusters.
  */
-void recompute_consistency_mask(
-    ClusterConfig *config,
-    ClusterState  *state);
+int consistency_cache_init(
+    ConsistencyCache *cc,
+    int               n);
+
+/**
+ * @brief Release a consistency-mask cache.
+ */
+void consistency_cache_free(
+    ConsistencyCache *cc);
+
+/**
+ * @brief Drop all cached consistency masks (state reset).
+ */
+void invalidate_consistency_masks(
+    ClusterState *state);
 
 /**
- * @brief Update the consistency bitmask when a new cluster is added.
+ * @brief Remap cached consistency masks after cluster @r was removed.
+ */
+void consistency_remove_cluster(
+    ClusterState *state,
+    int           r);
+
+/**
+ * @brief Extend the cached consistency masks when a new cluster is added.
  */
 void update_consistency_mask_for_new_cluster(
     ClusterConfig *config,
     ClusterState  *state,
     int            new_cl);
 
+/**
+ * @brief Start a group of row acquisitions that must not evict each other.
+ */
+void consistency_begin_pass(
+    ClusterState *state);
+
+/**
+ * @brief Get (or build) the cached consistency row of @target; -1 on failure.
+ */
+int consistency_acquire_row(
+    ClusterConfig *config,
+    ClusterState  *state,
+    int            target);
+
+/**
+ * @brief Consistency mask of (row target, hypothesis @j), built on demand.
+ */
+const uint64_t *consistency_mask_get(
+    ClusterConfig *config,
+    ClusterState  *state,
+    int            r,
+    int            j);
+
+/**
+ * @brief Evaluate the distances to several candidate clusters in one batch and
+ *        cache them for measure_distance_to_cluster().
+ */
+void prefetch_candidate_distances(
+    const int     *candidates,
+    int            n,
+    Frame         *current_frame,
+    ClusterConfig *config,
+    ClusterState  *state);
+
 /**
  * @brief Measure the distance from the current frame to a target cluster anchor.
  */
@@ -6,9 +6,11 @@
 #define _POSIX_C_SOURCE 200809L
 #include "cluster_steps.h"
 #include "cluster_math.h"
+#include "cluster_mgmt.h"
 #include "framedistance.h"
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include "../trace/cluster_trace.h"
 
 /**
@@ -52,31 +54,25 @@ static double calculate_sequence_match_metric(
             continue;
         }
 
-        int idx = clA * config->algo.maxnbclust + clB;
         double dcc = 0.0;
         if (config->optim.sparse_dcc_mode)
         {
-            if (state->scratch.dcc_measured[idx])
+            if (dcc_get_measured(&state->scratch.dcc, clA, clB))
             {
-                dcc = state->scratch.dcc_min[idx];
+                dcc = dcc_get_min(&state->scratch.dcc, clA, clB);
             }
             else
             {
-                dcc = state->scratch.dcc_max[idx];
+                dcc = dcc_get_max(&state->scratch.dcc, clA, clB);
             }
         }
         else
         {
-            dcc = state->scratch.dcc_min[idx];
+            dcc = dcc_get_min(&state->scratch.dcc, clA, clB);
             if (dcc < 0.0)
             {
                 dcc = framedist(&state->clusters[clA].anchor, &state->clusters[clB].anchor);
-                state->scratch.dcc_min[idx] = dcc;
-                state->scratch.dcc_min[clB * config->algo.maxnbclust + clA] = dcc;
-                state->scratch.dcc_max[idx] = dcc;
-                state->scratch.dcc_max[clB * config->algo.maxnbclust + clA] = dcc;
-                state->scratch.dcc_measured[idx] = 1;
-                state->scratch.dcc_measured[clB * config->algo.maxnbclust + clA] = 1;
+                dcc_set_exact(&state->scratch.dcc, clA, clB, dcc);
             }
         }
 
@@ -138,8 +134,27 @@ void compute_priors_and_mixing(
         int K = state->num_clusters;
         double rc = config->algo.rlim;
 
-        double *p_seq = (double *)malloc(K * sizeof(double));
-        if (!p_seq)
+        /* Sequences below read assignments back to frame t - nl - np */
+        resolve_assignments(state, t - nl - np);
+
+        /* Thread-local scratch, grown on demand: no allocation per frame */
+        static __thread double *p_seq = NULL;
+        static __thread double *match_scores = NULL;
+        static __thread int     k_cap = 0;
+        static __thread int    *hist_cl = NULL;
+        static __thread double *hist_d = NULL;
+        static __thread long    hist_cap = 0;
+
+        if (K > k_cap)
+        {
+            free(p_seq);
+            free(match_scores);
+            p_seq = (double *)malloc((size_t)K * sizeof(double));
+            match_scores = (double *)malloc((size_t)K * sizeof(double));
+            k_cap = (p_seq != NULL && match_scores != NULL) ? K : 0;
+        }
+
+        if (k_cap == 0)
         {
             for (int i = 0; i < K; i++)
             {
@@ -154,79 +169,61 @@ void compute_priors_and_mixing(
             }
             if (t >= np)
             {
-                double *match_scores = (double *)calloc(K, sizeof(double));
-                if (match_scores)
+                long start_s = t - nl;
+                if (start_s < np)
                 {
-                    int *seq_A_cl = (int *)malloc(np * sizeof(int));
-                    double *seq_A_d = (double *)malloc(np * sizeof(double));
-                    if (seq_A_cl && seq_A_d)
+                    start_s = np;
+                }
+
+                /*
+                 * hist_*[k] describe frame t - 1 - k, newest first, so the
+                 * sequence ending before frame s is hist_* + (t - s) and
+                 * sequence A is hist_* + 0. Each frame's distance to its
+                 * cluster is looked up once instead of once per window.
+                 */
+                long nhist = t - start_s + np;
+                if (nhist > hist_cap)
+                {
+                    free(hist_cl);
+                    free(hist_d);
+                    hist_cl = (int *)malloc((size_t)nhist * sizeof(int));
+                    hist_d = (double *)malloc((size_t)nhist * sizeof(double));
+                    hist_cap = (hist_cl != NULL && hist_d != NULL) ? nhist : 0;
+                }
+
+                if (hist_cap > 0)
+                {
+                    for (long k = 0; k < nhist; k++)
                     {
-                        for (int j = 0; j < np; j++)
+                        long idx = t - 1 - k - state->history_base;
+                        const FrameInfo *fi = &state->frame_infos[idx];
+                        int cl = state->assignments[idx];
+                        double d = -1.0;
+                        for (int d_idx = 0; d_idx < fi->num_dists; d_idx++)
                         {
-                            long idxA = t - 1 - j;
-                            seq_A_cl[j] = state->assignments[idxA];
-                            double d = -1.0;
-                            for (int d_idx = 0;
-                                 d_idx < state->frame_infos[idxA].num_dists;
-                                 d_idx++)
+                            if (fi->cluster_indices[d_idx] == cl)
                             {
-                                if (state->frame_infos[idxA].cluster_indices[d_idx] ==
-                                    seq_A_cl[j])
-                                {
-                                    d = state->frame_infos[idxA].distances[d_idx];
-                                    break;
-                                }
+                                d = fi->distances[d_idx];
+                                break;
                             }
-                            seq_A_d[j] = (d >= 0.0) ? d : 0.0;
                         }
+                        hist_cl[k] = cl;
+                        hist_d[k] = (d >= 0.0) ? d : 0.0;
+                    }
 
-                        long start_s = t - nl;
-                        if (start_s < np)
+                    memset(match_scores, 0, (size_t)K * sizeof(double));
+                    for (long s = start_s; s < t; s++)
+                    {
+                        int target_cl = state->assignments[s - state->history_base];
+                        if (target_cl < 0 || target_cl >= K)
                         {
-                            start_s = np;
+                            continue;
                         }
 
-                        int *seq_B_cl = (int *)malloc(np * sizeof(int));
-                        double *seq_B_d = (double *)malloc(np * sizeof(double));
-                        if (seq_B_cl && seq_B_d)
-                        {
-                            for (long s = start_s; s < t; s++)
-                            {
-                                int target_cl = state->assignments[s];
-                                if (target_cl < 0 || target_cl >= K)
-                                {
-                                    continue;
-                                }
-
-                                for (int j = 0; j < np; j++)
-                                {
-                                    long idxB = s - 1 - j;
-                                    seq_B_cl[j] = state->assignments[idxB];
-                                    double d = -1.0;
-                                    for (int d_idx = 0;
-                                         d_idx < state->frame_infos[idxB].num_dists;
-                                         d_idx++)
-                                    {
-                                        if (state->frame_infos[idxB].cluster_indices[d_idx] ==
-                                            seq_B_cl[j])
-                                        {
-                                            d = state->frame_infos[idxB].distances[d_idx];
-                                            break;
-                                        }
-                                    }
-                                    seq_B_d[j] = (d >= 0.0) ? d : 0.0;
-                                }
-
-                                double mAB = calculate_sequence_match_metric(
-                                    seq_A_cl, seq_A_d, seq_B_cl, seq_B_d,
-                                    np, rc, state, config);
-                                match_scores[target_cl] += mAB;
-                            }
-                            free(seq_B_cl);
-                            free(seq_B_d);
-                        }
-                        free(seq_A_cl);
-                        free(seq_A_d);
+                        double mAB = calculate_sequence_match_metric(
+                            hist_cl, hist_d, hist_cl + (t - s), hist_d + (t - s),
+                            np, rc, state, config);
+                        match_scores[target_cl] += mAB;
                     }
 
                     double total_score = 0.0;
@@ -241,14 +238,6 @@ void compute_priors_and_mixing(
                             p_seq[i] = match_scores[i] / total_score;
                         }
                     }
-                    else
-                    {
-                        for (int i = 0; i < K; i++)
-                        {
-                            p_seq[i] = 1.0 / K;
-                        }
-                    }
-                    free(match_scores);
                 }
             }
 
@@ -284,7 +273,6 @@ void compute_priors_and_mixing(
                     state->scratch.mixed_probs[i] = 1.0 / K;
                 }
             }
-            free(p_seq);
         }
     }
     else
@@ -294,8 +282,7 @@ void compute_priors_and_mixing(
         {
             for (int i = 0; i < state->num_clusters; i++)
             {
-                trans_prob_sum += (double)state->transition_matrix[
-                    prev_assigned_cluster * config->algo.maxnbclust + i];
+                trans_prob_sum += (double)*transition_cell(state, prev_assigned_cluster, i);
             }
         }
 
@@ -306,8 +293,7 @@ void compute_priors_and_mixing(
             if (config->algo.tm_mixing_coeff > 0.0 && prev_assigned_cluster != -1 &&
                 trans_prob_sum > 0.0)
             {
-                tp = (double)state->transition_matrix[
-                    prev_assigned_cluster * config->algo.maxnbclust + i] / trans_prob_sum;
+                tp = (double)*transition_cell(state, prev_assigned_cluster, i) / trans_prob_sum;
                 state->scratch.mixed_probs[i] =
                     (1.0 - config->algo.tm_mixing_coeff) * prior +
                     config->algo.tm_mixing_coeff * tp;
@@ -7,8 +7,10 @@
 #include "cluster_steps.h"
 #include "cluster_mgmt.h"
 #include "cluster_core.h"
+#include "frame_dtype.h"
 #include "frameread.h"
 #include "cluster_bounds.h"
+#include "framedistance.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -30,7 +32,9 @@
  * Uses exact distance computations for clusters that were visited
  * during the search (recorded in temp_indices/temp_dists), and
  * triangle-inequality bound propagation for the remaining
- * unvisited clusters.
+ * unvisited clusters. In sparse mode, early-abandon lower bounds
+ * (scratch.dist_lower_bound, see -abandon) only raise dcc_min and
+ * are not propagated.
  */
 static void init_new_cluster_distances(
     ClusterConfig *config,
@@ -40,25 +44,16 @@ static void init_new_cluster_distances(
     double        *temp_dists,
     int            temp_count)
 {
-    int N = config->algo.maxnbclust;
+    DccStore *dcc = &state->scratch.dcc;
 
     if (config->optim.sparse_dcc_mode)
     {
-        // 1. Initialize bounds to [0, infinity] and measured flag to 0
+        // 1. Reset bounds to [0, infinity] and measured flag to 0
         for (int r = 0; r < new_cl; r++)
         {
-            state->scratch.dcc_min[new_cl * N + r] = 0.0;
-            state->scratch.dcc_min[r * N + new_cl] = 0.0;
-            state->scratch.dcc_max[new_cl * N + r] = 1e19;
-            state->scratch.dcc_max[r * N + new_cl] = 1e19;
-            state->scratch.dcc_measured[new_cl * N + r] = 0;
-            state->scratch.dcc_measured[r * N + new_cl] = 0;
+            dcc_clear_pair(dcc, new_cl, r);
         }
 
-        state->scratch.dcc_min[new_cl * N + new_cl] = 0.0;
-        state->scratch.dcc_max[new_cl * N + new_cl] = 0.0;
-        state->scratch.dcc_measured[new_cl * N + new_cl] = 1;
-
         // 2. Populate exact distances from the search loop
         char is_temp_index[new_cl];
         memset(is_temp_index, 0, new_cl * sizeof(char));
@@ -66,37 +61,31 @@ static void init_new_cluster_distances(
         for (int idx = 0; idx < temp_count; idx++)
         {
             int j = temp_indices[idx];
-            if (j >= 0 && j < new_cl)
+            if (j >= 0 && j < new_cl && !state->scratch.dist_lower_bound[idx])
             {
-                double d = temp_dists[idx];
-                state->scratch.dcc_min[new_cl * N + j] = d;
-                state->scratch.dcc_min[j * N + new_cl] = d;
-                state->scratch.dcc_max[new_cl * N + j] = d;
-                state->scratch.dcc_max[j * N + new_cl] = d;
-                state->scratch.dcc_measured[new_cl * N + j] = 1;
-                state->scratch.dcc_measured[j * N + new_cl] = 1;
+                dcc_set_exact(dcc, new_cl, j, temp_dists[idx]);
                 is_temp_index[j] = 1;
             }
         }
 
         // 3. Propagate bounds to unvisited clusters
-        double *dcc_max_rows[temp_count];
-        double *dcc_min_rows[temp_count];
-        double  d_new_j_arr[temp_count];
-        int     valid_count = 0;
+        int    j_arr[temp_count];
+        double d_new_j_arr[temp_count];
+        int    valid_count = 0;
 
         for (int idx = 0; idx < temp_count; idx++)
         {
             int j = temp_indices[idx];
-            if (j >= 0 && j < new_cl)
+            if (j >= 0 && j < new_cl && !state->scratch.dist_lower_bound[idx])
             {
-                dcc_max_rows[valid_count] = &state->scratch.dcc_max[j * N];
-                dcc_min_rows[valid_count] = &state->scratch.dcc_min[j * N];
+                j_arr[valid_count] = j;
                 d_new_j_arr[valid_count] = temp_dists[idx];
                 valid_count++;
             }
         }
 
+        /* Iteration k only writes pair (k, new_cl), stored in row k, and
+         * only reads rows of k and of visited clusters (never written). */
         #pragma omp parallel for if(new_cl >= OMP_MIN_CLUSTERS)
         for (int k = 0; k < new_cl; k++)
         {
@@ -105,41 +94,54 @@ static void init_new_cluster_distances(
                 continue;
             }
 
-            double *max_new_row = &state->scratch.dcc_max[new_cl * N];
-            double *min_new_row = &state->scratch.dcc_min[new_cl * N];
+            double max_new = DCC_UNBOUNDED;
+            double min_new = 0.0;
 
             for (int idx = 0; idx < valid_count; idx++)
             {
-                double  d_new_j = d_new_j_arr[idx];
-                double *max_j_row = dcc_max_rows[idx];
-                double *min_j_row = dcc_min_rows[idx];
+                double d_new_j = d_new_j_arr[idx];
+                double max_jk  = dcc_get_max(dcc, j_arr[idx], k);
+                double min_jk  = dcc_get_min(dcc, j_arr[idx], k);
 
-                if (max_j_row[k] < 1e18)
+                if (max_jk < 1e18)
                 {
-                    double new_max = d_new_j + max_j_row[k];
-                    if (new_max < max_new_row[k])
+                    double new_max = d_new_j + max_jk;
+                    if (new_max < max_new)
                     {
-                        max_new_row[k] = new_max;
-                        state->scratch.dcc_max[k * N + new_cl] = new_max;
+                        max_new = new_max;
                     }
-                }
-
-                if (max_j_row[k] < 1e18)
-                {
-                    double l1 = d_new_j - max_j_row[k];
-                    if (l1 > min_new_row[k])
+                    double l1 = d_new_j - max_jk;
+                    if (l1 > min_new)
                     {
-                        min_new_row[k] = l1;
-                        state->scratch.dcc_min[k * N + new_cl] = l1;
+                        min_new = l1;
                     }
                 }
-                double l2 = min_j_row[k] - d_new_j;
-                if (l2 > min_new_row[k])
+                double l2 = min_jk - d_new_j;
+                if (l2 > min_new)
                 {
-                    min_new_row[k] = l2;
-                    state->scratch.dcc_min[k * N + new_cl] = l2;
+                    min_new = l2;
                 }
             }
+
+            if (max_new < DCC_UNBOUNDED)
+            {
+                dcc_set_max(dcc, new_cl, k, max_new);
+            }
+            if (min_new > 0.0)
+            {
+                dcc_set_min(dcc, new_cl, k, min_new);
+            }
+        }
+
+        // 4. Early-abandon lower bounds tighten dcc_min only
+        for (int idx = 0; idx < temp_count; idx++)
+        {
+            int j = temp_indices[idx];
+            if (j >= 0 && j < new_cl && state->scratch.dist_lower_bound[idx] &&
+                temp_dists[idx] > dcc_get_min(dcc, new_cl, j))
+            {
+                dcc_set_min(dcc, new_cl, j, temp_dists[idx]);
+            }
         }
     }
     else
@@ -149,17 +151,10 @@ static void init_new_cluster_distances(
             double d = get_dist(&state->clusters[new_cl].anchor,
                                 &state->clusters[i].anchor, -1, -1.0, -1.0,
                                 config, state);
-            state->scratch.dcc_min[new_cl * N + i] = d;
-            state->scratch.dcc_min[i * N + new_cl] = d;
-            state->scratch.dcc_max[new_cl * N + i] = d;
-            state->scratch.dcc_max[i * N + new_cl] = d;
-            state->scratch.dcc_measured[new_cl * N + i] = 1;
-            state->scratch.dcc_measured[i * N + new_cl] = 1;
+            dcc_set_exact(dcc, new_cl, i, d);
         }
-        state->scratch.dcc_min[new_cl * N + new_cl] = 0.0;
-        state->scratch.dcc_max[new_cl * N + new_cl] = 0.0;
-        state->scratch.dcc_measured[new_cl * N + new_cl] = 1;
     }
+    dcc_set_exact(dcc, new_cl, new_cl, 0.0);
 }
 
 /**
@@ -189,10 +184,17 @@ int handle_new_cluster_creation(
     if (state->num_clusters < config->algo.maxnbclust)
     {
         int assigned_cluster = state->num_clusters;
-        state->clusters[state->num_clusters].anchor = *current_frame;
-        current_frame->data = NULL;
+        if (frame_take(&state->clusters[state->num_clusters].anchor, current_frame) != 0)
+        {
+            fprintf(stderr, "ERROR: [%s:%d] cannot allocate anchor\n", __FILE__, __LINE__);
+            free_frame(current_frame);
+            return -2;
+        }
         state->clusters[state->num_clusters].id = state->num_clusters;
         state->clusters[state->num_clusters].prob = 1.0;
+        framedist_first_touch(&state->clusters[state->num_clusters].anchor);
+        state->clusters[state->num_clusters].norm_sq =
+            frame_norm_sq(&state->clusters[state->num_clusters].anchor);
 
         init_new_cluster_distances(config, state, state->num_clusters,
                                    temp_indices, temp_dists, *temp_count);
@@ -208,12 +210,13 @@ int handle_new_cluster_creation(
         }
 
         add_visitor(&state->cluster_visitors[state->num_clusters],
-                    state->telemetry.total_frames_processed);
+                    state->telemetry.total_frames_processed, 0.0);
 
         if (*temp_count < config->algo.maxnbclust)
         {
             temp_indices[*temp_count] = state->num_clusters;
             temp_dists[*temp_count] = 0.0;
+            state->scratch.dist_lower_bound[*temp_count] = 0;
             (*temp_count)++;
         }
         update_consistency_mask_for_new_cluster(config, state, state->num_clusters);
@@ -282,21 +285,29 @@ int handle_new_cluster_creation(
                 (*prev_assigned_cluster)--;
             }
             int assigned_cluster = state->num_clusters;
-            state->clusters[state->num_clusters].anchor = *current_frame;
-            current_frame->data = NULL;
+            if (frame_take(&state->clusters[state->num_clusters].anchor, current_frame) != 0)
+            {
+                fprintf(stderr, "ERROR: [%s:%d] cannot allocate anchor\n", __FILE__, __LINE__);
+                free_frame(current_frame);
+                return -2;
+            }
             state->clusters[state->num_clusters].id = state->num_clusters;
             state->clusters[state->num_clusters].prob = 1.0;
+            framedist_first_touch(&state->clusters[state->num_clusters].anchor);
+            state->clusters[state->num_clusters].norm_sq =
+                frame_norm_sq(&state->clusters[state->num_clusters].anchor);
 
             init_new_cluster_distances(config, state, state->num_clusters,
                                        temp_indices, temp_dists, *temp_count);
 
             add_visitor(&state->cluster_visitors[state->num_clusters],
-                        state->telemetry.total_frames_processed);
+                        state->telemetry.total_frames_processed, 0.0);
 
             if (*temp_count < config->algo.maxnbclust)
             {
                 temp_indices[*temp_count] = state->num_clusters;
                 temp_dists[*temp_count] = 0.0;
+                state->scratch.dist_lower_bound[*temp_count] = 0;
                 (*temp_count)++;
             }
             update_consistency_mask_for_new_cluster(config, state, state->num_clusters);
@@ -317,8 +328,8 @@ int handle_new_cluster_creation(
         {
             for (int j = i + 1; j < state->num_clusters; j++)
             {
-                double d = state->scratch.dcc_min[i * config->algo.maxnbclust + j];
-                if (state->scratch.dcc_measured[i * config->algo.maxnbclust + j] &&
+                double d = dcc_get_min(&state->scratch.dcc, i, j);
+                if (dcc_get_measured(&state->scratch.dcc, i, j) &&
                     d >= 0.0 && (min_d < 0.0 || d < min_d))
                 {
                     min_d = d;
@@ -370,21 +381,29 @@ int handle_new_cluster_creation(
             }
 
             int assigned_cluster = state->num_clusters;
-            state->clusters[state->num_clusters].anchor = *current_frame;
-            current_frame->data = NULL;
+            if (frame_take(&state->clusters[state->num_clusters].anchor, current_frame) != 0)
+            {
+                fprintf(stderr, "ERROR: [%s:%d] cannot allocate anchor\n", __FILE__, __LINE__);
+                free_frame(current_frame);
+                return -2;
+            }
             state->clusters[state->num_clusters].id = state->num_clusters;
             state->clusters[state->num_clusters].prob = 1.0;
+            framedist_first_touch(&state->clusters[state->num_clusters].anchor);
+            state->clusters[state->num_clusters].norm_sq =
+                frame_norm_sq(&state->clusters[state->num_clusters].anchor);
 
             init_new_cluster_distances(config, state, state->num_clusters,
                                        temp_indices, temp_dists, *temp_count);
 
             add_visitor(&state->cluster_visitors[state->num_clusters],
-                        state->telemetry.total_frames_processed);
+                        state->telemetry.total_frames_processed, 0.0);
 
             if (*temp_count < config->algo.maxnbclust)
             {
                 temp_indices[*temp_count] = state->num_clusters;
                 temp_dists[*temp_count] = 0.0;
+                state->scratch.dist_lower_bound[*temp_count] = 0;
                 (*temp_count)++;
             }
             update_consistency_mask_for_new_cluster(config, state, state->num_clusters);
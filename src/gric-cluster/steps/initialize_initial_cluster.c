@@ -1,6 +1,8 @@
 #define _POSIX_C_SOURCE 200809L
 #include "cluster_steps.h"
 #include "cluster_mgmt.h"
+#include "frame_dtype.h"
+#include "framedistance.h"
 #include <stdio.h>
 #include "cluster_trace.h"
 
@@ -16,6 +18,7 @@
  *
  * Configures the first ingested frame as the anchor for cluster index 0,
  * and sets up its initial frequency probability to 1.0. Registers the frame visitor.
+ * Sets @assigned_cluster to -2 if the anchor cannot be allocated.
  */
 void initialize_initial_cluster(
     ClusterConfig *config,
@@ -23,16 +26,20 @@ void initialize_initial_cluster(
     Frame         *current_frame,
     int           *assigned_cluster)
 {
-    state->clusters[0].anchor = *current_frame;
-    current_frame->data = NULL;
+    if (frame_take(&state->clusters[0].anchor, current_frame) != 0)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] cannot allocate anchor\n", __FILE__, __LINE__);
+        *assigned_cluster = -2;
+        return;
+    }
     state->clusters[0].id = 0;
     state->clusters[0].prob = 1.0;
+    framedist_first_touch(&state->clusters[0].anchor);
+    state->clusters[0].norm_sq = frame_norm_sq(&state->clusters[0].anchor);
     state->num_clusters = 1;
-    state->scratch.dcc_min[0] = 0.0;
-    state->scratch.dcc_max[0] = 0.0;
-    state->scratch.dcc_measured[0] = 1;
+    dcc_set_exact(&state->scratch.dcc, 0, 0, 0.0);
 
-    add_visitor(&state->cluster_visitors[0], state->telemetry.total_frames_processed);
+    add_visitor(&state->cluster_visitors[0], state->telemetry.total_frames_processed, 0.0);
     *assigned_cluster = 0;
 
     if (state->trace)
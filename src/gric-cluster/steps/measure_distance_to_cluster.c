@@ -4,10 +4,43 @@
 #include "cluster_core.h"
 #include <stdio.h>
 #include "cluster_trace.h"
+#include "spec_batch.h"
 
 #define ANSI_COLOR_GREEN  "\x1b[32m"
 #define ANSI_COLOR_RESET  "\x1b[0m"
 
+/**
+ * prefetch_candidate_distances - Batch-evaluate distances to candidate clusters.
+ * @candidates: Cluster indices to evaluate.
+ * @n: Number of candidates.
+ * @current_frame: The frame being clustered.
+ * @config: Config parameters of the clustering execution.
+ * @state: Running state of the clustering execution.
+ *
+ * Computes all @n distances with get_dist_batch(), which streams the frame
+ * once per group of anchors, and stores them in scratch.dfc_cache stamped
+ * with the current frame index. Later measure_distance_to_cluster() calls for
+ * these clusters in the same frame reuse the cached values; candidates that
+ * get pruned or are never reached are the cost of the speculation.
+ */
+void prefetch_candidate_distances(
+    const int     *candidates,
+    int            n,
+    Frame         *current_frame,
+    ClusterConfig *config,
+    ClusterState  *state)
+{
+    double dists[n];
+    long   stamp = state->telemetry.total_frames_processed + 1;
+
+    get_dist_batch(current_frame, candidates, n, config, state, dists);
+    for (int ii = 0; ii < n; ii++)
+    {
+        state->scratch.dfc_cache[candidates[ii]] = dists[ii];
+        state->scratch.dfc_cache_stamp[candidates[ii]] = stamp;
+    }
+}
+
 /**
  * measure_distance_to_cluster - Calculate distance from current frame to target cluster.
  * @cj: Cluster index being targeted.
@@ -19,8 +52,14 @@
  * @temp_count: Pointer to total measurement count in this step.
  * @is_prediction: Flag indicating if this candidate is a prediction shortcut.
  *
- * Computes distance via get_dist(), increments telemetry counts, adds visitor entries,
- * and increments cluster probability if matched within the threshold `rlim`.
+ * Computes distance via get_dist_bounded(), increments telemetry counts, adds visitor
+ * entries, and increments cluster probability if matched within the threshold `rlim`.
+ * With -abandon f the evaluation stops once the distance exceeds f*rlim (f >= 1, so
+ * matches are always exact); the returned value is then a lower bound and the
+ * corresponding scratch.dist_lower_bound slot is set. A distance already
+ * evaluated for this frame by prefetch_candidate_distances() is taken from
+ * scratch.dfc_cache instead, and one evaluated ahead by a speculative batch
+ * (-specbatch) from the batch.
  *
  * Return: Calculated distance to the target cluster.
  */
@@ -49,19 +88,47 @@ double measure_distance_to_cluster(
         state->telemetry.step_counts[*temp_count]++;
     }
 
-    double dfc = get_dist(current_frame, &state->clusters[cj].anchor,
-                          state->clusters[cj].id, state->clusters[cj].prob,
-                          state->scratch.current_gprobs[cj], config, state);
+    int    exact = 1;
+    double dfc;
+    if (state->scratch.dfc_cache_stamp[cj] == state->telemetry.total_frames_processed + 1)
+    {
+        dfc = state->scratch.dfc_cache[cj];
+    }
+    else
+    {
+        double limit = config->optim.abandon_factor * config->algo.rlim;
+        if (state->spec != NULL &&
+            spec_batch_take(state->spec, current_frame, &state->clusters[cj], limit,
+                            &dfc, &exact))
+        {
+            account_dist(current_frame, &state->clusters[cj].anchor,
+                         state->clusters[cj].id, state->clusters[cj].prob,
+                         state->scratch.current_gprobs[cj], dfc, exact, config, state);
+        }
+        else
+        {
+            dfc = get_dist_bounded(current_frame, &state->clusters[cj].anchor,
+                                   state->clusters[cj].id, state->clusters[cj].prob,
+                                   state->scratch.current_gprobs[cj], limit, &exact,
+                                   config, state);
+        }
+    }
+    if (state->spec != NULL)
+    {
+        spec_batch_note(state->spec, state, cj);
+    }
 
     if (*temp_count < config->algo.maxnbclust)
     {
         temp_indices[*temp_count] = cj;
         temp_dists[*temp_count] = dfc;
+        state->scratch.dist_lower_bound[*temp_count] = (char)!exact;
         (*temp_count)++;
     }
 
     add_visitor(
-        &state->cluster_visitors[cj], state->telemetry.total_frames_processed
+        &state->cluster_visitors[cj], state->telemetry.total_frames_processed,
+        exact ? dfc : -1.0
     );
 
     if (state->trace)
@@ -2,9 +2,10 @@
 #include "cluster_steps.h"
 #include "cluster_core.h"
 #include "frameread.h"
+#include "knn_online.h"
+#include "shared/gricres.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
 
 /**
  * record_step_assignment - Record telemetry and write cluster results.
@@ -19,8 +20,12 @@
  * @temp_count: Number of measurements recorded in this step.
  * @start_pruned_val: Pruning counter before beginning this step.
  *
- * Increments the transition matrix count, saves assignments, logs distance outputs,
- * applies predictive probability reward/decay functions, and frees current_frame.
+ * Increments the transition matrix count, stores the assignment in the frame's
+ * visitor entries, saves assignments (and links them into the
+ * occurrence index in prediction mode), appends the frame's measurements to the
+ * frame log (-gprob / -predf), logs distance outputs (and the results
+ * bundle columns with -gricres), searches and indexes the frame's past
+ * neighbors with -knn, applies predictive probability reward/decay functions, and frees current_frame.
  */
 void record_step_assignment(
     ClusterConfig *config,
@@ -37,37 +42,64 @@ void record_step_assignment(
     if (state->telemetry.total_frames_processed > 0 && *prev_assigned_cluster != -1 &&
         assigned_cluster != -1)
     {
-        state->transition_matrix[*prev_assigned_cluster * config->algo.maxnbclust +
-                                 assigned_cluster]++;
+        (*transition_cell(state, *prev_assigned_cluster, assigned_cluster))++;
     }
     *prev_assigned_cluster = assigned_cluster;
 
     long frame_idx = state->telemetry.total_frames_processed;
-    if (frame_idx < config->input.maxnbfr)
+    visitors_set_assignment(state, frame_idx, assigned_cluster, temp_indices, temp_count);
+    if (state->history_cap > 0)
     {
-        state->assignments[frame_idx] = assigned_cluster;
-        state->frame_infos[frame_idx].assignment = assigned_cluster;
-        state->frame_infos[frame_idx].num_dists = temp_count;
+        history_slide(state, frame_idx);
+    }
+    if (state->history_cap > 0 || frame_idx < config->input.maxnbfr)
+    {
+        long slot = frame_idx - state->history_base;
+        state->assignments[slot] = assigned_cluster;
+        state->frame_infos[slot].assignment = assigned_cluster;
+        state->frame_infos[slot].num_dists = temp_count;
+        if (config->optim.pred_mode)
+        {
+            occ_index_record(state, frame_idx, assigned_cluster);
+        }
 
+        FrameInfo *fi = &state->frame_infos[slot];
+        fi->cluster_indices = NULL;
+        fi->distances = NULL;
         if ((config->optim.gprob_mode || config->optim.pred_mode == 2) && temp_count > 0)
         {
-            state->frame_infos[frame_idx].cluster_indices =
-                (int *)malloc((size_t)temp_count * sizeof(int));
-            state->frame_infos[frame_idx].distances =
-                (double *)malloc((size_t)temp_count * sizeof(double));
-            if (state->frame_infos[frame_idx].cluster_indices &&
-                state->frame_infos[frame_idx].distances)
+            /* Keep exact distances only; early-abandon lower bounds are dropped */
+            int n_exact = 0;
+            for (int ii = 0; ii < temp_count; ii++)
             {
-                memcpy(state->frame_infos[frame_idx].cluster_indices,
-                       temp_indices, (size_t)temp_count * sizeof(int));
-                memcpy(state->frame_infos[frame_idx].distances,
-                       temp_dists, (size_t)temp_count * sizeof(double));
+                n_exact += !state->scratch.dist_lower_bound[ii];
+            }
+            fi->num_dists = 0;
+            if (frame_log_append(&state->frame_log, fi, frame_idx, n_exact) == 0)
+            {
+                for (int ii = 0; ii < temp_count; ii++)
+                {
+                    if (!state->scratch.dist_lower_bound[ii])
+                    {
+                        fi->cluster_indices[fi->num_dists] = temp_indices[ii];
+                        fi->distances[fi->num_dists] = temp_dists[ii];
+                        fi->num_dists++;
+                    }
+                }
+            }
+
+            long keep = config->optim.framelog_keep;
+            if (keep > 0)
+            {
+                /* -predf reads the measurements of the last pred_h + pred_len frames */
+                if (config->optim.pred_mode == 2 &&
+                    keep < (long)config->optim.pred_h + config->optim.pred_len + 1)
+                {
+                    keep = (long)config->optim.pred_h + config->optim.pred_len + 1;
+                }
+                frame_log_retire(&state->frame_log, state->frame_infos,
+                                 state->history_base, frame_idx + 1 - keep);
             }
-        }
-        else
-        {
-            state->frame_infos[frame_idx].cluster_indices = NULL;
-            state->frame_infos[frame_idx].distances = NULL;
         }
     }
 
@@ -89,6 +121,17 @@ void record_step_assignment(
                     assigned_cluster, state->telemetry.last_assignment_dist);
         }
     }
+    if (state->gricres)
+    {
+        gricres_writer_frame(state->gricres, (uint64_t)state->telemetry.total_frames_processed,
+                             assigned_cluster, state->telemetry.last_assignment_dist);
+    }
+    if (state->knn)
+    {
+        knn_online_frame(state->knn, state, frame_idx, current_frame, assigned_cluster,
+                         state->telemetry.last_assignment_dist, temp_indices, temp_dists,
+                         temp_count);
+    }
 
     if (config->optim.pred_mode)
     {
@@ -361,6 +361,19 @@ static int select_next_measurement_target_entropy(
     uint8_t *visited = state->scratch.entropy_visited;
     memset(visited, 0, nc * sizeof(uint8_t));
 
+    /*
+     * Consistency rows are acquired serially so that each thread below
+     * owns the rows of its targets and can build their masks lazily.
+     */
+    consistency_begin_pass(state);
+    int prune_rows[M > 0 ? M : 1];
+    for (int idx_p = 0; idx_p < M; idx_p++)
+    {
+        int i = prob_scores[idx_p].id;
+        prune_rows[idx_p] = (p_current[i] >= dynamic_min_prob)
+                          ? consistency_acquire_row(config, state, i) : -1;
+    }
+
     #pragma omp parallel for if(M >= 16)
     for (int idx_p = 0; idx_p < M; idx_p++)
     {
@@ -369,18 +382,19 @@ static int select_next_measurement_target_entropy(
         prune_scores[idx_p].score = 1e30;
         visited[i] = 1;
 
-        if (p_current[i] >= dynamic_min_prob)
+        if (p_current[i] >= dynamic_min_prob && prune_rows[idx_p] >= 0)
         {
             uint64_t total_pop = 0;
-            uint64_t *base_mask_i =
-                &state->scratch.consistency_mask[
-                    i * N * words];
             for (int idx = 0;
                  idx < sampled_count; idx++)
             {
                 int cj = sampled_indices[idx];
-                uint64_t *mask =
-                    base_mask_i + cj * words;
+                const uint64_t *mask = consistency_mask_get(
+                    config, state, prune_rows[idx_p], cj);
+                if (mask == NULL)
+                {
+                    continue;
+                }
                 for (int w = 0; w < words; w++)
                 {
                     total_pop +=
@@ -555,15 +569,22 @@ static int select_next_measurement_target_entropy(
         }
     }
 
+    int eval_rows[num_targets > 0 ? num_targets : 1];
+    for (int tc_idx = 0; tc_idx < num_targets; tc_idx++)
+    {
+        eval_rows[tc_idx] = consistency_acquire_row(config, state, candidates[tc_idx].id);
+    }
+
     #pragma omp parallel for
     for (int tc_idx = 0; tc_idx < num_targets; tc_idx++)
     {
         int target_ci = candidates[tc_idx].id;
         double expected_entropy_for_ci = 0.0;
 
-        uint64_t *base_mask_tc =
-            &state->scratch.consistency_mask[
-                target_ci * N * words];
+        if (eval_rows[tc_idx] < 0)
+        {
+            continue;
+        }
 
         double cur_min = 1e30;
         int early_exit = 0;
@@ -585,8 +606,12 @@ static int select_next_measurement_target_entropy(
 
             double hypo_sum = 0.0;
             double plogp_sum = 0.0;
-            uint64_t *mask =
-                base_mask_tc + hypothesis_cj * words;
+            const uint64_t *mask = consistency_mask_get(
+                config, state, eval_rows[tc_idx], hypothesis_cj);
+            if (mask == NULL)
+            {
+                continue;
+            }
 
             for (int w = 0; w < words; w++)
             {
@@ -2,6 +2,11 @@
  * @file update_consistency_mask.c
  * @brief Consistency mask maintenance using
  *        triangle inequality bounds.
+ *
+ * Masks are built on demand for the (target, hypothesis) pairs that the
+ * entropy search actually evaluates, and kept in a small LRU of target rows
+ * (ConsistencyCache). Nothing is allocated per cluster pair up front, adding
+ * a cluster costs O(cached rows), and removing one remaps the cached masks.
  */
 #define _POSIX_C_SOURCE 200809L
 #include "cluster_steps.h"
@@ -9,278 +14,492 @@
 #include <stdlib.h>
 #include <string.h>
 
+/** Memory budget that sets how many rows the LRU keeps between passes. */
+#define CONSISTENCY_CACHE_BYTES (128L * 1024 * 1024)
+
+/** Minimum rows kept by the LRU (a pass may temporarily use more). */
+#define CONSISTENCY_MIN_ROWS 32
+
+/** Initial mask slots per row. */
+#define CONSISTENCY_ROW_SLOTS 16
+
 /**
- * recompute_consistency_mask - Rebuild the entire geometric consistency mask from scratch.
- * @config: Config parameters of the clustering execution.
+ * consistency_cache_init - Prepare an empty mask cache.
+ * @cc: Cache to initialize.
+ * @n: Cluster capacity (maxnbclust).
+ *
+ * Return: 0 on success, -1 on allocation failure.
+ */
+int consistency_cache_init(
+    ConsistencyCache *cc,
+    int               n)
+{
+    memset(cc, 0, sizeof(*cc));
+    cc->n = n;
+    cc->words = (n + 63) / 64;
+
+    /* A fully built row holds n bounds, n slot indices and n masks */
+    long row_bytes = (long)n * (2 * sizeof(double) + 3 * sizeof(int)
+                                + (long)cc->words * sizeof(uint64_t));
+    long max_rows  = CONSISTENCY_CACHE_BYTES / (row_bytes > 0 ? row_bytes : 1);
+    cc->max_rows = (int)((max_rows < CONSISTENCY_MIN_ROWS) ? CONSISTENCY_MIN_ROWS
+                         : (max_rows > n) ? n : max_rows);
+    cc->row_of = (int *)malloc((size_t)n * sizeof(int));
+    if (cc->row_of == NULL)
+    {
+        return -1;
+    }
+    for (int ii = 0; ii < n; ii++)
+    {
+        cc->row_of[ii] = -1;
+    }
+    return 0;
+}
+
+/**
+ * consistency_cache_free - Release a mask cache.
+ * @cc: Cache to release; may be zero-initialized.
+ */
+void consistency_cache_free(
+    ConsistencyCache *cc)
+{
+    for (int ii = 0; ii < cc->nrows; ii++)
+    {
+        ConsistencyRow *row = &cc->rows[ii];
+        free(row->d_min);
+        free(row->d_max);
+        free(row->slot_of);
+        free(row->slot_cover);
+        free(row->slot_j);
+        free(row->bits);
+    }
+    free(cc->rows);
+    free(cc->row_of);
+    memset(cc, 0, sizeof(*cc));
+}
+
+/**
+ * invalidate_consistency_masks - Drop every cached consistency mask.
  * @state: Running state of the clustering execution.
  *
- * Scans all active cluster triplets (i, j, k) to determine geometric consistency,
- * clearing and rebuilding the entire bitmask. Called during cluster eviction/merges.
+ * Used when the whole clustering state is reset. Rows are rebuilt lazily
+ * from the current bounds on their next use.
  */
-void recompute_consistency_mask(
-    ClusterConfig *config,
-    ClusterState  *state)
+void invalidate_consistency_masks(
+    ClusterState *state)
 {
-    int N = config->algo.maxnbclust;
-    int words = (N + 63) / 64;
-    double rc = config->algo.rlim;
+    ConsistencyCache *cc = &state->scratch.consistency;
+
+    for (int ii = 0; ii < cc->nrows; ii++)
+    {
+        ConsistencyRow *row = &cc->rows[ii];
+        if (row->target >= 0)
+        {
+            cc->row_of[row->target] = -1;
+            row->target = -1;
+        }
+    }
+}
 
-    size_t clear_bytes = (size_t)N * (size_t)N * (size_t)words * sizeof(uint64_t);
-    memset(state->scratch.consistency_mask, 0, clear_bytes);
+/**
+ * mask_remove_bit - Delete bit @r of a mask and shift higher bits down by one.
+ * @mask: Mask of @words words.
+ * @words: Mask length.
+ * @r: Bit to delete.
+ */
+static void mask_remove_bit(
+    uint64_t *mask,
+    int       words,
+    int       r)
+{
+    int      w0   = r / 64;
+    int      b    = r % 64;
+    uint64_t low  = mask[w0] & ((1ULL << b) - 1);
+    uint64_t high = (b == 63) ? 0 : (mask[w0] >> (b + 1)) << b;
 
-    #pragma omp parallel for if(state->num_clusters >= OMP_MIN_CLUSTERS)
-    for (int i = 0; i < state->num_clusters; i++)
+    mask[w0] = low | high;
+    for (int w = w0 + 1; w < words; w++)
     {
-        for (int j = 0; j < state->num_clusters; j++)
+        mask[w - 1] |= mask[w] << 63;
+        mask[w] >>= 1;
+    }
+}
+
+/**
+ * consistency_remove_cluster - Remap cached masks after a cluster removal.
+ * @state: Running state of the clustering execution.
+ * @r: Index of the removed cluster; higher indices shift down by one.
+ *
+ * Follows the index shift of remove_cluster(): the row of @r is dropped,
+ * and every other row loses its bound, hypothesis slot and mask bit for
+ * @r. Costs O(cached masks * words) instead of an O(K^3) rebuild.
+ */
+void consistency_remove_cluster(
+    ClusterState *state,
+    int           r)
+{
+    ConsistencyCache *cc = &state->scratch.consistency;
+
+    for (int ii = 0; ii < cc->nrows; ii++)
+    {
+        ConsistencyRow *row = &cc->rows[ii];
+        if (row->target < 0)
+        {
+            continue;
+        }
+        if (row->target == r)
         {
-            uint64_t *mask = &state->scratch.consistency_mask[(i * N + j) * words];
+            row->target = -1;
+            continue;
+        }
+        if (row->target > r)
+        {
+            row->target--;
+        }
+        if (r >= row->nk)
+        {
+            continue;
+        }
 
-            if (config->optim.sparse_dcc_mode)
+        /* Release the slot of hypothesis r by moving the last slot into it */
+        int s = row->slot_of[r];
+        if (s >= 0)
+        {
+            int last = row->nslots - 1;
+            if (s != last)
             {
-                double d_min_ij = state->scratch.dcc_min[i * N + j];
-                double d_max_ij = state->scratch.dcc_max[i * N + j];
+                memcpy(&row->bits[(size_t)s * cc->words],
+                       &row->bits[(size_t)last * cc->words],
+                       cc->words * sizeof(uint64_t));
+                row->slot_cover[s] = row->slot_cover[last];
+                row->slot_j[s] = row->slot_j[last];
+                row->slot_of[row->slot_j[s]] = s;
+            }
+            row->nslots--;
+        }
 
-                for (int k = 0; k < state->num_clusters; k++)
-                {
-                    double d_min_ik = state->scratch.dcc_min[i * N + k];
-                    double d_max_ik = state->scratch.dcc_max[i * N + k];
-
-                    double diff1 = d_min_ik - d_max_ij;
-                    double diff2 = d_min_ij - d_max_ik;
-                    double delta_min = 0.0;
-                    if (diff1 > delta_min) delta_min = diff1;
-                    if (diff2 > delta_min) delta_min = diff2;
-
-                    /*
-                     * Geometric consistency criterion:
-                     * a target-hypothesis pair is
-                     * consistent if the minimum possible
-                     * distance between them (from
-                     * triangle inequality bounds) is
-                     * within twice the radius limit,
-                     * meaning the measurement could
-                     * still change the cluster
-                     * assignment.
-                     */
-                    if (delta_min <= 2.0 * rc)
-                    {
-                        mask[k / 64] |= (1ULL << (k % 64));
-                    }
-                }
+        int tail = row->nk - r - 1;
+        memmove(&row->d_min[r], &row->d_min[r + 1], tail * sizeof(double));
+        memmove(&row->d_max[r], &row->d_max[r + 1], tail * sizeof(double));
+        memmove(&row->slot_of[r], &row->slot_of[r + 1], tail * sizeof(int));
+        row->slot_of[row->nk - 1] = -1;
+        row->nk--;
+
+        for (int ss = 0; ss < row->nslots; ss++)
+        {
+            if (row->slot_j[ss] > r)
+            {
+                row->slot_j[ss]--;
             }
-            else
+            if (row->slot_cover[ss] > r)
             {
-                double measured_dist = state->scratch.dcc_min[i * N + j];
-                if (measured_dist < 0.0)
-                {
-                    continue;
-                }
-
-                for (int k = 0; k < state->num_clusters; k++)
-                {
-                    double dist_ti_k = state->scratch.dcc_min[i * N + k];
-                    if (dist_ti_k < 0.0)
-                    {
-                        continue;
-                    }
-
-                    if (dist_ti_k >= (measured_dist - 2.0 * rc) &&
-                        dist_ti_k <= (measured_dist + 2.0 * rc))
-                    {
-                        mask[k / 64] |= (1ULL << (k % 64));
-                    }
-                }
+                mask_remove_bit(&row->bits[(size_t)ss * cc->words], cc->words, r);
+                row->slot_cover[ss]--;
             }
         }
     }
+
+    memmove(&cc->row_of[r], &cc->row_of[r + 1], (cc->n - r - 1) * sizeof(int));
+    cc->row_of[cc->n - 1] = -1;
+}
+
+/**
+ * snapshot_bounds - Copy bounds (target, k) for k in [row->nk, nk) into a row.
+ * @state: Running state of the clustering execution.
+ * @row: Cached row.
+ * @nk: New number of covered clusters.
+ */
+static void snapshot_bounds(
+    ClusterState   *state,
+    ConsistencyRow *row,
+    int             nk)
+{
+    for (int k = row->nk; k < nk; k++)
+    {
+        row->d_min[k] = dcc_get_min(&state->scratch.dcc, row->target, k);
+        row->d_max[k] = dcc_get_max(&state->scratch.dcc, row->target, k);
+    }
+    if (nk > row->nk)
+    {
+        row->nk = nk;
+    }
 }
 
 /**
- * update_consistency_mask_for_new_cluster - Compute consistency relations for a new cluster.
+ * update_consistency_mask_for_new_cluster - Extend cached rows with a new cluster.
  * @config: Config parameters of the clustering execution.
  * @state: Running state of the clustering execution.
  * @new_cl: Index of the newly added cluster.
  *
- * Computes and sets consistency bitmask flags involving the new cluster, avoiding full recalculations.
- * Handles cases where the new cluster is the target (target_ci), hypothesis (hypothesis_cj), or candidate k.
+ * Snapshots the bounds between each cached target and the new cluster, so
+ * that masks extended later see the bounds known at creation time. Costs
+ * O(cached rows); the masks themselves are extended on their next use.
  */
 void update_consistency_mask_for_new_cluster(
     ClusterConfig *config,
     ClusterState  *state,
     int            new_cl)
 {
-    int N = config->algo.maxnbclust;
-    int words = (N + 63) / 64;
-    double rc = config->algo.rlim;
+    (void)config;
+    ConsistencyCache *cc = &state->scratch.consistency;
 
-    // 1. Clear new rows/cols of the consistency mask
-    memset(&state->scratch.consistency_mask[(size_t)new_cl * (size_t)N * (size_t)words], 0,
-           (size_t)(new_cl + 1) * (size_t)words * sizeof(uint64_t));
-
-    #pragma omp parallel for if(new_cl >= OMP_MIN_CLUSTERS)
-    for (int j = 0; j <= new_cl; j++)
+    for (int ii = 0; ii < cc->nrows; ii++)
     {
-        memset(&state->scratch.consistency_mask[(j * N + new_cl) * words], 0, words * sizeof(uint64_t));
+        ConsistencyRow *row = &cc->rows[ii];
+        if (row->target >= 0 && row->nk <= new_cl)
+        {
+            snapshot_bounds(state, row, new_cl + 1);
+        }
     }
+}
 
-    // Pre-load the row of new_cl into heap-allocated arrays to avoid stack overflow
-    double *d_min_new_k = (double *)malloc((new_cl + 1) * sizeof(double));
-    double *d_max_new_k = (double *)malloc((new_cl + 1) * sizeof(double));
-    if (d_min_new_k == NULL || d_max_new_k == NULL)
+/**
+ * consistency_begin_pass - Start a new group of row acquisitions.
+ * @state: Running state of the clustering execution.
+ *
+ * Rows acquired during the same pass are never evicted by each other.
+ */
+void consistency_begin_pass(
+    ClusterState *state)
+{
+    state->scratch.consistency.pass++;
+}
+
+/**
+ * alloc_row - Allocate the per-cluster arrays of a fresh row.
+ * @cc: Mask cache.
+ * @row: Zero-initialized row.
+ *
+ * Return: 0 on success, -1 on allocation failure.
+ */
+static int alloc_row(
+    ConsistencyCache *cc,
+    ConsistencyRow   *row)
+{
+    row->target = -1;
+    row->d_min = (double *)malloc((size_t)cc->n * sizeof(double));
+    row->d_max = (double *)malloc((size_t)cc->n * sizeof(double));
+    row->slot_of = (int *)malloc((size_t)cc->n * sizeof(int));
+    row->slot_cover = (int *)malloc(CONSISTENCY_ROW_SLOTS * sizeof(int));
+    row->slot_j = (int *)malloc(CONSISTENCY_ROW_SLOTS * sizeof(int));
+    row->bits = (uint64_t *)malloc(
+        (size_t)CONSISTENCY_ROW_SLOTS * cc->words * sizeof(uint64_t));
+    row->cap = CONSISTENCY_ROW_SLOTS;
+    if (row->d_min == NULL || row->d_max == NULL || row->slot_of == NULL ||
+        row->slot_cover == NULL || row->slot_j == NULL || row->bits == NULL)
     {
-        free(d_min_new_k);
-        free(d_max_new_k);
-        return;
+        return -1;
     }
-    for (int k = 0; k <= new_cl; k++)
+    for (int ii = 0; ii < cc->n; ii++)
     {
-        d_min_new_k[k] = state->scratch.dcc_min[new_cl * N + k];
-        d_max_new_k[k] = state->scratch.dcc_max[new_cl * N + k];
+        row->slot_of[ii] = -1;
     }
+    return 0;
+}
+
+/**
+ * consistency_acquire_row - Get the cached row of a target cluster.
+ * @config: Config parameters of the clustering execution.
+ * @state: Running state of the clustering execution.
+ * @target: Target cluster i.
+ *
+ * Reuses the cached row of @target or recycles the least recently used row
+ * not acquired in the current pass (the row table grows if all are pinned).
+ * Must be called outside parallel regions; consistency_mask_get() may then
+ * be called concurrently for distinct rows.
+ *
+ * Return: Row index, or -1 on allocation failure.
+ */
+int consistency_acquire_row(
+    ClusterConfig *config,
+    ClusterState  *state,
+    int            target)
+{
+    (void)config;
+    ConsistencyCache *cc = &state->scratch.consistency;
+    int               r  = cc->row_of[target];
 
-    // 2. Compute for target_ci = new_cl
-    #pragma omp parallel for if(new_cl >= OMP_MIN_CLUSTERS)
-    for (int j = 0; j <= new_cl; j++)
+    if (r < 0)
     {
-        uint64_t *mask = &state->scratch.consistency_mask[(new_cl * N + j) * words];
-        if (config->optim.sparse_dcc_mode)
+        int lru = -1;
+        for (int ii = 0; ii < cc->nrows; ii++)
         {
-            double d_min_ij = state->scratch.dcc_min[new_cl * N + j];
-            double d_max_ij = state->scratch.dcc_max[new_cl * N + j];
-
-            for (int k = 0; k <= new_cl; k++)
+            const ConsistencyRow *row = &cc->rows[ii];
+            if (row->target < 0)
             {
-                double d_min_ik = d_min_new_k[k];
-                double d_max_ik = d_max_new_k[k];
-
-                double diff1 = d_min_ik - d_max_ij;
-                double diff2 = d_min_ij - d_max_ik;
-                double delta_min = 0.0;
-                if (diff1 > delta_min) delta_min = diff1;
-                if (diff2 > delta_min) delta_min = diff2;
-
-                if (delta_min <= 2.0 * rc)
-                {
-                    mask[k / 64] |= (1ULL << (k % 64));
-                }
+                r = ii;
+                break;
             }
+            if (row->last_pass < cc->pass &&
+                (lru < 0 || row->last_pass < cc->rows[lru].last_pass))
+            {
+                lru = ii;
+            }
+        }
+
+        if (r < 0 && lru >= 0 && cc->nrows >= cc->max_rows)
+        {
+            r = lru;
         }
-        else
+        if (r < 0)
         {
-            double measured_dist = state->scratch.dcc_min[new_cl * N + j];
-            if (measured_dist >= 0.0)
+            ConsistencyRow *rows = (ConsistencyRow *)realloc(
+                cc->rows, (size_t)(cc->nrows + 1) * sizeof(ConsistencyRow));
+            if (rows == NULL)
             {
-                for (int k = 0; k <= new_cl; k++)
-                {
-                    double dist_ti_k = d_min_new_k[k];
-                    if (dist_ti_k >= 0.0 &&
-                        dist_ti_k >= (measured_dist - 2.0 * rc) &&
-                        dist_ti_k <= (measured_dist + 2.0 * rc))
-                    {
-                        mask[k / 64] |= (1ULL << (k % 64));
-                    }
-                }
+                return -1;
+            }
+            cc->rows = rows;
+            memset(&cc->rows[cc->nrows], 0, sizeof(ConsistencyRow));
+            if (alloc_row(cc, &cc->rows[cc->nrows]) != 0)
+            {
+                ConsistencyRow *row = &cc->rows[cc->nrows];
+                free(row->d_min);
+                free(row->d_max);
+                free(row->slot_of);
+                free(row->slot_cover);
+                free(row->slot_j);
+                free(row->bits);
+                return -1;
             }
+            r = cc->nrows++;
+        }
+
+        ConsistencyRow *row = &cc->rows[r];
+        if (row->target >= 0)
+        {
+            cc->row_of[row->target] = -1;
+        }
+        for (int ii = 0; ii < row->nk; ii++)
+        {
+            row->slot_of[ii] = -1;
         }
+        row->target = target;
+        row->nk = 0;
+        row->nslots = 0;
+        cc->row_of[target] = r;
     }
 
-    // 3. Compute for hypothesis_cj = new_cl (with target_ci < new_cl)
-    #pragma omp parallel for if(new_cl >= OMP_MIN_CLUSTERS)
-    for (int i = 0; i < new_cl; i++)
+    ConsistencyRow *row = &cc->rows[r];
+    row->last_pass = cc->pass;
+    if (row->nk < state->num_clusters)
     {
-        uint64_t *mask = &state->scratch.consistency_mask[(i * N + new_cl) * words];
-        double *d_min_i = &state->scratch.dcc_min[i * N];
-        double *d_max_i = &state->scratch.dcc_max[i * N];
+        snapshot_bounds(state, row, state->num_clusters);
+    }
+    return r;
+}
 
-        if (config->optim.sparse_dcc_mode)
-        {
-            double d_min_inew = d_min_i[new_cl];
-            double d_max_inew = d_max_i[new_cl];
+/**
+ * consistency_mask_get - Consistency mask of (row target, hypothesis j).
+ * @config: Config parameters of the clustering execution.
+ * @state: Running state of the clustering execution.
+ * @r: Row index from consistency_acquire_row().
+ * @j: Hypothesis cluster.
+ *
+ * Builds the mask on first use and extends it to clusters added since.
+ * The returned pointer is valid until the next call on the same row.
+ *
+ * Return: Mask of cc->words words, or NULL on allocation failure.
+ */
+const uint64_t *consistency_mask_get(
+    ClusterConfig *config,
+    ClusterState  *state,
+    int            r,
+    int            j)
+{
+    ConsistencyCache *cc    = &state->scratch.consistency;
+    ConsistencyRow   *row   = &cc->rows[r];
+    int               words = cc->words;
+    int               s     = row->slot_of[j];
 
-            for (int k = 0; k <= new_cl; k++)
+    if (s < 0)
+    {
+        if (row->nslots == row->cap)
+        {
+            int       cap   = 2 * row->cap;
+            int      *cover = (int *)realloc(row->slot_cover, (size_t)cap * sizeof(int));
+            if (cover == NULL)
             {
-                double d_min_ik = d_min_i[k];
-                double d_max_ik = d_max_i[k];
-
-                double diff1 = d_min_ik - d_max_inew;
-                double diff2 = d_min_inew - d_max_ik;
-                double delta_min = 0.0;
-                if (diff1 > delta_min) delta_min = diff1;
-                if (diff2 > delta_min) delta_min = diff2;
-
-                if (delta_min <= 2.0 * rc)
-                {
-                    mask[k / 64] |= (1ULL << (k % 64));
-                }
+                return NULL;
             }
-        }
-        else
-        {
-            double measured_dist = d_min_i[new_cl];
-            if (measured_dist >= 0.0)
+            row->slot_cover = cover;
+            int *owner = (int *)realloc(row->slot_j, (size_t)cap * sizeof(int));
+            if (owner == NULL)
             {
-                for (int k = 0; k <= new_cl; k++)
-                {
-                    double dist_ti_k = d_min_i[k];
-                    if (dist_ti_k >= 0.0 &&
-                        dist_ti_k >= (measured_dist - 2.0 * rc) &&
-                        dist_ti_k <= (measured_dist + 2.0 * rc))
-                    {
-                        mask[k / 64] |= (1ULL << (k % 64));
-                    }
-                }
+                return NULL;
+            }
+            row->slot_j = owner;
+            uint64_t *bits = (uint64_t *)realloc(
+                row->bits, (size_t)cap * words * sizeof(uint64_t));
+            if (bits == NULL)
+            {
+                return NULL;
             }
+            row->bits = bits;
+            row->cap = cap;
         }
+        s = row->nslots++;
+        row->slot_of[j] = s;
+        row->slot_cover[s] = 0;
+        row->slot_j[s] = j;
+        memset(&row->bits[(size_t)s * words], 0, words * sizeof(uint64_t));
     }
 
-    // 4. Compute for candidate k = new_cl (with target_ci < new_cl and hypothesis_cj < new_cl)
-    int word_offset = new_cl / 64;
-    uint64_t bit_mask = 1ULL << (new_cl % 64);
+    uint64_t *mask = &row->bits[(size_t)s * words];
+    int       k0   = row->slot_cover[s];
+    if (k0 >= row->nk)
+    {
+        return mask;
+    }
 
-    #pragma omp parallel for if(new_cl >= OMP_MIN_CLUSTERS)
-    for (int i = 0; i < new_cl; i++)
+    double rc = config->algo.rlim;
+    if (config->optim.sparse_dcc_mode)
     {
-        double d_min_inew = state->scratch.dcc_min[i * N + new_cl];
-        double d_max_inew = state->scratch.dcc_max[i * N + new_cl];
-        double *dcc_min_i = &state->scratch.dcc_min[i * N];
-        double *dcc_max_i = &state->scratch.dcc_max[i * N];
-        uint64_t *mask_row = &state->scratch.consistency_mask[i * N * words];
+        double d_min_ij = row->d_min[j];
+        double d_max_ij = row->d_max[j];
 
-        for (int j = 0; j < new_cl; j++)
+        for (int k = k0; k < row->nk; k++)
         {
-            if (config->optim.sparse_dcc_mode)
-            {
-                double d_min_ij = dcc_min_i[j];
-                double d_max_ij = dcc_max_i[j];
+            double diff1 = row->d_min[k] - d_max_ij;
+            double diff2 = d_min_ij - row->d_max[k];
+            double delta_min = 0.0;
+            if (diff1 > delta_min) delta_min = diff1;
+            if (diff2 > delta_min) delta_min = diff2;
 
-                double diff1 = d_min_inew - d_max_ij;
-                double diff2 = d_min_ij - d_max_inew;
-                double delta_min = 0.0;
-                if (diff1 > delta_min) delta_min = diff1;
-                if (diff2 > delta_min) delta_min = diff2;
-
-                if (delta_min <= 2.0 * rc)
-                {
-                    mask_row[j * words + word_offset] |= bit_mask;
-                }
+            /*
+             * Geometric consistency criterion:
+             * a target-hypothesis pair is
+             * consistent if the minimum possible
+             * distance between them (from
+             * triangle inequality bounds) is
+             * within twice the radius limit,
+             * meaning the measurement could
+             * still change the cluster
+             * assignment.
+             */
+            if (delta_min <= 2.0 * rc)
+            {
+                mask[k / 64] |= (1ULL << (k % 64));
             }
-            else
+        }
+    }
+    else
+    {
+        double measured_dist = row->d_min[j];
+        if (measured_dist >= 0.0)
+        {
+            for (int k = k0; k < row->nk; k++)
             {
-                double measured_dist = dcc_min_i[j];
-                if (measured_dist >= 0.0)
+                double dist_ti_k = row->d_min[k];
+                if (dist_ti_k >= 0.0 &&
+                    dist_ti_k >= (measured_dist - 2.0 * rc) &&
+                    dist_ti_k <= (measured_dist + 2.0 * rc))
                 {
-                    double dist_ti_new = d_min_inew;
-                    if (dist_ti_new >= 0.0 &&
-                        dist_ti_new >= (measured_dist - 2.0 * rc) &&
-                        dist_ti_new <= (measured_dist + 2.0 * rc))
-                    {
-                        mask_row[j * words + word_offset] |= bit_mask;
-                    }
+                    mask[k / 64] |= (1ULL << (k % 64));
                 }
             }
         }
     }
-
-    free(d_min_new_k);
-    free(d_max_new_k);
+    row->slot_cover[s] = row->nk;
+    return mask;
 }
@@ -8,6 +8,36 @@
 #define ANSI_BG_GREEN     "\x1b[42m"
 #define ANSI_COLOR_BLACK  "\x1b[30m"
 
+/**
+ * print_visitor() - Verbose report of one visitor entry of cluster @cj.
+ * @state:     Running state of the clustering execution.
+ * @cj:        Cluster being updated.
+ * @e:         Visitor entry.
+ * @is_active: Whether the entry's cluster is still a candidate.
+ */
+static void print_visitor(
+    const ClusterState *state,
+    int                 cj,
+    const VisitorEntry *e,
+    int                 is_active)
+{
+    if (is_active)
+    {
+        printf(ANSI_BG_GREEN ANSI_COLOR_BLACK
+               "  [VV]   Frame %5d also had distance measurement to "
+               "Cluster %4d (Anchor Frame %5d). Frame %5d cluster "
+               "membership is %4d. " ANSI_COLOR_RESET "\n",
+               e->frame, cj, state->clusters[cj].anchor.id, e->frame, e->cluster);
+    }
+    else
+    {
+        printf("  [VV]   Frame %5d also had distance measurement to "
+               "Cluster %4d (Anchor Frame %5d). Frame %5d cluster "
+               "membership is %4d.\n",
+               e->frame, cj, state->clusters[cj].anchor.id, e->frame, e->cluster);
+    }
+}
+
 /**
  * update_geometric_probabilities - Update geometric priorities of candidate clusters.
  * @config: Config parameters of the clustering execution.
@@ -17,6 +47,10 @@
  *
  * Loops through visitor history to retrieve co-measured frames. Multiplies
  * the running geometric match probabilities with match metric scaling factor.
+ * Each visitor entry carries its distance to cj and its assigned cluster, so
+ * no per-frame measurement lookup is needed. fmatch() is zero beyond
+ * 2 * rlim, where it vetoes the visitor's cluster, so every entry in the
+ * window is visited.
  */
 void update_geometric_probabilities(
     ClusterConfig *config,
@@ -24,99 +58,59 @@ void update_geometric_probabilities(
     int            cj,
     double         dfc)
 {
-    int match_count = state->cluster_visitors[cj].count;
-    if (match_count > 0)
-    {
-        match_count--;
-    }
+    const VisitorList *vl = &state->cluster_visitors[cj];
+    int verbose = (config->output.verbose_level >= 2);
 
-    if (config->output.verbose_level >= 2)
+    if (verbose)
     {
+        int match_count = (vl->count > 0) ? vl->count - 1 : 0;
         printf("  [VV] Distance > rlim. Found %d matches in distinfo for Cluster "
                "%4d (Frame %5d).\n",
                match_count, cj, state->clusters[cj].anchor.id);
     }
 
     int start_idx = 0;
-    if (state->cluster_visitors[cj].count > config->optim.max_gprob_visitors)
+    if (vl->count > config->optim.max_gprob_visitors)
     {
-        start_idx = state->cluster_visitors[cj].count -
-                    config->optim.max_gprob_visitors;
+        start_idx = vl->count - config->optim.max_gprob_visitors;
     }
-    for (int i = start_idx; i < state->cluster_visitors[cj].count; i++)
+    long    cur_frame = state->telemetry.total_frames_processed;
+    double *gprobs    = state->scratch.current_gprobs;
+    double *entropy_p = state->scratch.entropy_p_current;
+    for (int i = start_idx; i < vl->count; i++)
     {
-        int k_idx = state->cluster_visitors[cj].frames[i];
-        if (k_idx == state->telemetry.total_frames_processed)
-        {
-            continue;
-        }
-
-        /* Skip visitor entries beyond frame_infos capacity */
-        if (k_idx >= config->input.maxnbfr)
-        {
-            continue;
-        }
-
-        int target_cl = state->frame_infos[k_idx].assignment;
-        if (target_cl < 0 || target_cl >= state->num_clusters)
+        const VisitorEntry *e = &vl->entries[i];
+        int target_cl = e->cluster;
+        if (e->frame == cur_frame || target_cl < 0 || target_cl >= state->num_clusters)
         {
             continue;
         }
         int is_active = state->scratch.clmembflag[target_cl];
 
-        if (config->output.verbose_level >= 2)
+        if (verbose)
         {
-            if (is_active)
-            {
-                printf(ANSI_BG_GREEN ANSI_COLOR_BLACK
-                       "  [VV]   Frame %5d also had distance measurement to "
-                       "Cluster %4d (Anchor Frame %5d). Frame %5d cluster "
-                       "membership is %4d. " ANSI_COLOR_RESET "\n",
-                       k_idx, cj, state->clusters[cj].anchor.id, k_idx, target_cl);
-            }
-            else
-            {
-                printf("  [VV]   Frame %5d also had distance measurement to "
-                       "Cluster %4d (Anchor Frame %5d). Frame %5d cluster "
-                       "membership is %4d.\n",
-                       k_idx, cj, state->clusters[cj].anchor.id, k_idx, target_cl);
-            }
+            print_visitor(state, cj, e, is_active);
         }
 
-        if (!is_active)
+        if (!is_active || e->distance < 0)
         {
             continue;
         }
 
-        double dist_k = -1.0;
-        for (int d_idx = 0; d_idx < state->frame_infos[k_idx].num_dists; d_idx++)
-        {
-            if (state->frame_infos[k_idx].cluster_indices[d_idx] == cj)
-            {
-                dist_k = state->frame_infos[k_idx].distances[d_idx];
-                break;
-            }
-        }
+        double dr = fabs(dfc - e->distance) / config->algo.rlim;
+        double val = fmatch(dr, config->optim.fmatch_a, config->optim.fmatch_b);
 
-        if (dist_k >= 0)
+        if (verbose)
         {
-            double dr = fabs(dfc - dist_k) / config->algo.rlim;
-            double val = fmatch(dr, config->optim.fmatch_a, config->optim.fmatch_b);
-
-            if (config->output.verbose_level >= 2)
-            {
-                printf("    dist %5ld-%-5d = %12.5e  dist %5d-%-5d = %12.5e, "
-                       "fmatch=%12.5e, updating GProb(Cluster %4d) from %12.5e to "
-                       "%12.5e\n",
-                       state->telemetry.total_frames_processed,
-                       state->clusters[cj].anchor.id,
-                       dfc, k_idx, state->clusters[cj].anchor.id, dist_k, val,
-                       target_cl, state->scratch.current_gprobs[target_cl],
-                       state->scratch.current_gprobs[target_cl] * val);
-            }
-
-            state->scratch.current_gprobs[target_cl] *= val;
-            state->scratch.entropy_p_current[target_cl] *= val;
+            printf("    dist %5ld-%-5d = %12.5e  dist %5d-%-5d = %12.5e, "
+                   "fmatch=%12.5e, updating GProb(Cluster %4d) from %12.5e to "
+                   "%12.5e\n",
+                   cur_frame, state->clusters[cj].anchor.id,
+                   dfc, e->frame, state->clusters[cj].anchor.id, e->distance, val,
+                   target_cl, gprobs[target_cl], gprobs[target_cl] * val);
         }
+
+        gprobs[target_cl] *= val;
+        entropy_p[target_cl] *= val;
     }
 }
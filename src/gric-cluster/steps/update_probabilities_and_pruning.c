@@ -25,6 +25,11 @@
  *
  * Employs Multi-Point Triangle Inequality heuristics (TE4/TE5) to prune distant
  * cluster candidates (setting clmembflag[cl] = 0). Updates geometric probabilities.
+ *
+ * When @dfc is an early-abandon lower bound (scratch.dist_lower_bound of the
+ * last measurement, see -abandon), only the one-sided test dfc - dcc > rlim
+ * remains valid; TE4, gprob and soft Bayesian updates are skipped for it, and
+ * earlier lower-bound entries are not used as TE4 references.
  */
 void update_probabilities_and_pruning(
     int            cj,
@@ -36,6 +41,7 @@ void update_probabilities_and_pruning(
     int            temp_count)
 {
     long local_pruned = 0;
+    int  dfc_is_bound = (temp_count > 0) && state->scratch.dist_lower_bound[temp_count - 1];
 #ifdef _OPENMP
 #pragma omp parallel for reduction(+ : local_pruned) if(state->num_clusters >= OMP_MIN_CLUSTERS)
 #endif
@@ -48,10 +54,10 @@ void update_probabilities_and_pruning(
 
         if (config->optim.sparse_dcc_mode)
         {
-            double d_min = state->scratch.dcc_min[cj * config->algo.maxnbclust + cl];
-            double d_max = state->scratch.dcc_max[cj * config->algo.maxnbclust + cl];
+            double d_min = dcc_get_min(&state->scratch.dcc, cj, cl);
+            double d_max = dcc_get_max(&state->scratch.dcc, cj, cl);
 
-            if (d_min - dfc > config->algo.rlim)
+            if (!dfc_is_bound && d_min - dfc > config->algo.rlim)
             {
                 state->scratch.clmembflag[cl] = 0;
                 local_pruned++;
@@ -64,20 +70,15 @@ void update_probabilities_and_pruning(
         }
         else
         {
-            double dcc = state->scratch.dcc_min[cj * config->algo.maxnbclust + cl];
+            double dcc = dcc_get_min(&state->scratch.dcc, cj, cl);
             if (dcc < 0.0)
             {
                 dcc = get_dist(&state->clusters[cj].anchor, &state->clusters[cl].anchor, -1,
                                -1.0, -1.0, config, state);
-                state->scratch.dcc_min[cj * config->algo.maxnbclust + cl] = dcc;
-                state->scratch.dcc_min[cl * config->algo.maxnbclust + cj] = dcc;
-                state->scratch.dcc_max[cj * config->algo.maxnbclust + cl] = dcc;
-                state->scratch.dcc_max[cl * config->algo.maxnbclust + cj] = dcc;
-                state->scratch.dcc_measured[cj * config->algo.maxnbclust + cl] = 1;
-                state->scratch.dcc_measured[cl * config->algo.maxnbclust + cj] = 1;
+                dcc_set_exact(&state->scratch.dcc, cj, cl, dcc);
             }
 
-            if (dcc - dfc > config->algo.rlim)
+            if (!dfc_is_bound && dcc - dfc > config->algo.rlim)
             {
                 state->scratch.clmembflag[cl] = 0;
                 local_pruned++;
@@ -107,36 +108,35 @@ void update_probabilities_and_pruning(
         }
     }
 
-    if (config->optim.te4_mode && temp_count > 1)
+    if (config->optim.te4_mode && temp_count > 1 && !dfc_is_bound)
     {
         for (int p = 0; p < temp_count - 1; p++)
         {
+            if (state->scratch.dist_lower_bound[p])
+            {
+                continue;
+            }
             int    cprev = temp_indices[p];
             double d_m_cprev = temp_dists[p];
             double d_ci_cprev = 0.0;
 
             if (config->optim.sparse_dcc_mode)
             {
-                if (!state->scratch.dcc_measured[cj * config->algo.maxnbclust + cprev])
+                if (!dcc_get_measured(&state->scratch.dcc, cj, cprev))
                 {
                     continue;
                 }
-                d_ci_cprev = state->scratch.dcc_min[cj * config->algo.maxnbclust + cprev];
+                d_ci_cprev = dcc_get_min(&state->scratch.dcc, cj, cprev);
             }
             else
             {
-                d_ci_cprev = state->scratch.dcc_min[cj * config->algo.maxnbclust + cprev];
+                d_ci_cprev = dcc_get_min(&state->scratch.dcc, cj, cprev);
                 if (d_ci_cprev < 0.0)
                 {
                     d_ci_cprev = get_dist(&state->clusters[cj].anchor,
                                           &state->clusters[cprev].anchor, -1, -1.0, -1.0,
                                           config, state);
-                    state->scratch.dcc_min[cj * config->algo.maxnbclust + cprev] = d_ci_cprev;
-                    state->scratch.dcc_min[cprev * config->algo.maxnbclust + cj] = d_ci_cprev;
-                    state->scratch.dcc_max[cj * config->algo.maxnbclust + cprev] = d_ci_cprev;
-                    state->scratch.dcc_max[cprev * config->algo.maxnbclust + cj] = d_ci_cprev;
-                    state->scratch.dcc_measured[cj * config->algo.maxnbclust + cprev] = 1;
-                    state->scratch.dcc_measured[cprev * config->algo.maxnbclust + cj] = 1;
+                    dcc_set_exact(&state->scratch.dcc, cj, cprev, d_ci_cprev);
                 }
             }
 
@@ -160,42 +160,32 @@ void update_probabilities_and_pruning(
 
                 if (config->optim.sparse_dcc_mode)
                 {
-                    if (!state->scratch.dcc_measured[cj * config->algo.maxnbclust + k] ||
-                        !state->scratch.dcc_measured[cprev * config->algo.maxnbclust + k])
+                    if (!dcc_get_measured(&state->scratch.dcc, cj, k) ||
+                        !dcc_get_measured(&state->scratch.dcc, cprev, k))
                     {
                         continue;
                     }
-                    d_ci_ck = state->scratch.dcc_min[cj * config->algo.maxnbclust + k];
-                    d_cprev_ck = state->scratch.dcc_min[cprev * config->algo.maxnbclust + k];
+                    d_ci_ck = dcc_get_min(&state->scratch.dcc, cj, k);
+                    d_cprev_ck = dcc_get_min(&state->scratch.dcc, cprev, k);
                 }
                 else
                 {
-                    d_ci_ck = state->scratch.dcc_min[cj * config->algo.maxnbclust + k];
+                    d_ci_ck = dcc_get_min(&state->scratch.dcc, cj, k);
                     if (d_ci_ck < 0.0)
                     {
                         d_ci_ck = get_dist(&state->clusters[cj].anchor,
                                            &state->clusters[k].anchor, -1, -1.0, -1.0,
                                            config, state);
-                        state->scratch.dcc_min[cj * config->algo.maxnbclust + k] = d_ci_ck;
-                        state->scratch.dcc_min[k * config->algo.maxnbclust + cj] = d_ci_ck;
-                        state->scratch.dcc_max[cj * config->algo.maxnbclust + k] = d_ci_ck;
-                        state->scratch.dcc_max[k * config->algo.maxnbclust + cj] = d_ci_ck;
-                        state->scratch.dcc_measured[cj * config->algo.maxnbclust + k] = 1;
-                        state->scratch.dcc_measured[k * config->algo.maxnbclust + cj] = 1;
+                        dcc_set_exact(&state->scratch.dcc, cj, k, d_ci_ck);
                     }
 
-                    d_cprev_ck = state->scratch.dcc_min[cprev * config->algo.maxnbclust + k];
+                    d_cprev_ck = dcc_get_min(&state->scratch.dcc, cprev, k);
                     if (d_cprev_ck < 0.0)
                     {
                         d_cprev_ck = get_dist(
                             &state->clusters[cprev].anchor, &state->clusters[k].anchor,
                             -1, -1.0, -1.0, config, state);
-                        state->scratch.dcc_min[cprev * config->algo.maxnbclust + k] = d_cprev_ck;
-                        state->scratch.dcc_min[k * config->algo.maxnbclust + cprev] = d_cprev_ck;
-                        state->scratch.dcc_max[cprev * config->algo.maxnbclust + k] = d_cprev_ck;
-                        state->scratch.dcc_max[k * config->algo.maxnbclust + cprev] = d_cprev_ck;
-                        state->scratch.dcc_measured[cprev * config->algo.maxnbclust + k] = 1;
-                        state->scratch.dcc_measured[k * config->algo.maxnbclust + cprev] = 1;
+                        dcc_set_exact(&state->scratch.dcc, cprev, k, d_cprev_ck);
                     }
                 }
 
@@ -266,7 +256,7 @@ void update_probabilities_and_pruning(
 
     if ((config->optim.gprob_mode || (config->output.distall_mode && state->distall_out) ||
          config->output.verbose_level >= 2) &&
-        active_cluster_count > 1)
+        active_cluster_count > 1 && !dfc_is_bound)
     {
         update_geometric_probabilities(config, state, cj, dfc);
     }
@@ -274,11 +264,10 @@ void update_probabilities_and_pruning(
     /* Apply pruning and soft Bayesian updates to the posterior */
     double sum_p = 0.0;
 
-    if (config->optim.soft_bayesian_mode)
+    if (config->optim.soft_bayesian_mode && !dfc_is_bound)
     {
         double sigma = config->optim.soft_bayesian_sigma_coeff * config->algo.rlim;
         double two_sigma_sq = 2.0 * sigma * sigma;
-        int N = config->algo.maxnbclust;
 
         for (int i = 0; i < state->num_clusters; i++)
         {
@@ -288,17 +277,12 @@ void update_probabilities_and_pruning(
             }
             else
             {
-                double dcc = state->scratch.dcc_min[cj * N + i];
+                double dcc = dcc_get_min(&state->scratch.dcc, cj, i);
                 if (dcc < 0.0)
                 {
                     dcc = get_dist(&state->clusters[cj].anchor, &state->clusters[i].anchor, -1,
                                    -1.0, -1.0, config, state);
-                    state->scratch.dcc_min[cj * N + i] = dcc;
-                    state->scratch.dcc_min[i * N + cj] = dcc;
-                    state->scratch.dcc_max[cj * N + i] = dcc;
-                    state->scratch.dcc_max[i * N + cj] = dcc;
-                    state->scratch.dcc_measured[cj * N + i] = 1;
-                    state->scratch.dcc_measured[i * N + cj] = 1;
+                    dcc_set_exact(&state->scratch.dcc, cj, i, dcc);
                 }
                 double diff = dfc - dcc;
                 double x = (diff * diff) / two_sigma_sq;
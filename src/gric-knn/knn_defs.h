@@ -13,6 +13,8 @@
 #include <stdlib.h>
 #include <time.h>
 
+#include "shared/gricres.h"
+
 /** Output format selection */
 typedef enum
 {
@@ -67,6 +69,12 @@ typedef struct
     double          epsilon;          /**< Slack factor for (1+eps)-ANN pruning */
     double          rlim_cutoff;      /**< Optional max distance cutoff */
     int             nthreads;         /**< Number of OpenMP worker threads */
+    long            block_mem_mb;     /**< Block caches and dot tiles, all threads, in MiB */
+    long            query_begin;      /**< First query frame (-query-range, -shard) */
+    long            query_end;        /**< End of the query frames (exclusive), -1 = all */
+    int             shard_index;      /**< -shard i/n: shard i ... */
+    int             shard_count;      /**< ... of n (0 = no sharding) */
+    long            chunk_frames;     /**< Queries per written chunk and checkpoint */
     KnnOutputFormat output_format;    /**< Output format choice */
     int             progress_mode;    /**< 1 to show live progress bar */
     int             verbose_level;    /**< 0 = quiet, 1 = normal, 2 = verbose */
@@ -82,6 +90,10 @@ typedef struct
     uint64_t level3_annular_pruned;
     uint64_t temporal_pruned;
     uint64_t framedist_calls;
+    uint64_t frames_read;   /**< Frames read from the dataset */
+    uint64_t tile_pairs;    /**< Pairs evaluated in dot-product form by the tiled kernel */
+    uint64_t tile_exact;    /**< Tiled pairs recomputed exactly (possible neighbors) */
+    double   pairs_per_sec; /**< Query-candidate distances per second of search */
     double   time_load_ms;
     double   time_search_ms;
     double   time_write_ms;
@@ -100,6 +112,8 @@ typedef struct
     int        *frame_cluster_map;   /**< Cluster ID for each frame index [0..N-1] */
     float      *frame_r_anchor;      /**< Distance to anchor for each frame [0..N-1] */
     int         is_fits_input;       /**< 1 if input dataset is FITS, 0 if ASCII */
+    GricRes     results;             /**< Mapped results.gricres (hdr NULL if text outputs) */
+    int         anchors_mapped;      /**< 1 if anchor_data points into results */
 } KnnModel;
 
 /** Per-query result structure containing top-k neighbors */
@@ -7,6 +7,8 @@
 #include "knn_engine.h"
 #include "knn_heap.h"
 #include "knn_reader.h"
+#include "shared/dist_kernels.h"
+#include <float.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,10 +19,6 @@
 #include <omp.h>
 #endif
 
-#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
-#include <immintrin.h>
-#endif
-
 /** Cluster candidate record for sorting by ascending lower bound */
 typedef struct
 {
@@ -52,52 +50,6 @@ static int compare_cluster_scores(
     return 0;
 }
 
-/**
- * compute_euclidean_distance() - Vectorized Euclidean distance between frames.
- * @da:   Pointer to first pixel array.
- * @db:   Pointer to second pixel array.
- * @size: Number of elements in frame.
- *
- * Return: Euclidean L2 distance.
- */
-static inline double compute_euclidean_distance(
-    const double *restrict da,
-    const double *restrict db,
-    long                   size)
-{
-    double sum = 0.0;
-    long i = 0;
-
-#if defined(__AVX__) && \
-    (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
-    if (size >= 4)
-    {
-        __m256d sum_vec = _mm256_setzero_pd();
-        for (; i <= size - 4; i += 4)
-        {
-            __m256d va = _mm256_loadu_pd(&da[i]);
-            __m256d vb = _mm256_loadu_pd(&db[i]);
-            __m256d diff = _mm256_sub_pd(va, vb);
-#ifdef __FMA__
-            sum_vec = _mm256_fmadd_pd(diff, diff, sum_vec);
-#else
-            sum_vec = _mm256_add_pd(sum_vec, _mm256_mul_pd(diff, diff));
-#endif
-        }
-        __m256d hsum = _mm256_hadd_pd(sum_vec, sum_vec);
-        sum += ((double *)&hsum)[0] + ((double *)&hsum)[2];
-    }
-#endif
-
-    for (; i < size; i++)
-    {
-        double diff = da[i] - db[i];
-        sum += diff * diff;
-    }
-
-    return sqrt(sum);
-}
-
 /**
  * check_temporal_separation() - Verify if candidate satisfies temporal criteria.
  * @query_id:     Frame ID of query.
@@ -140,6 +92,488 @@ static inline int check_temporal_separation(
     return 1;
 }
 
+/** Queries of a home cluster that share dot-product tiles */
+#define KNN_QUERY_GROUP 64
+
+/** Candidate members per panel of the tiled kernel */
+#define KNN_PANEL_ROWS 32
+
+/** Elements per panel of the tiled kernel */
+#define KNN_PANEL_DEPTH 512
+
+/**
+ * Member frames of the resident clusters, bounded in size (-blockmem), and
+ * the dot-product tiles of the query group being searched.
+ */
+typedef struct
+{
+    double  **block;        /**< Per cluster: member frames then their squared norms, or NULL */
+    uint64_t *last_use;     /**< Per cluster: access stamp of its block */
+    char     *uncacheable;  /**< Per cluster: 1 if its block cannot be held */
+    int      *resident;     /**< Clusters with a block */
+    int       num_resident;
+    size_t    budget;       /**< Bytes the blocks may take */
+    size_t    used;         /**< Bytes the blocks take */
+    uint64_t  clock;        /**< Access counter */
+    int       pinned;       /**< Cluster whose block is never evicted, -1 if none */
+
+    double   *dots;         /**< Tile arena, dots_budget bytes */
+    size_t    dots_budget;  /**< Bytes of the tile arena */
+    size_t    dots_used;    /**< Doubles of the arena in use */
+    long     *dot_off;      /**< Per cluster: tile offset in the arena, -1 if none */
+    int      *dot_list;     /**< Clusters with a tile */
+    int       num_dot;
+    int       q0;           /**< First home member of the query group */
+    int       q1;           /**< End of the query group (exclusive) */
+    int       row;          /**< Query's row in the tiles, -1 outside a group */
+} KnnBlockCache;
+
+/**
+ * knn_block_cache_init() - Allocate an empty block cache.
+ * @cache:  Cache to initialize.
+ * @M:      Number of clusters.
+ * @budget: Bytes the cache may take, blocks and tile arena together.
+ *
+ * Half of @budget goes to the blocks and the rest to the tile arena.
+ *
+ * Return: 0 on success, -1 on allocation failure.
+ */
+static int knn_block_cache_init(
+    KnnBlockCache *cache,
+    int            M,
+    size_t         budget)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->block = (double **)calloc((size_t)M, sizeof(double *));
+    cache->last_use = (uint64_t *)calloc((size_t)M, sizeof(uint64_t));
+    cache->uncacheable = (char *)calloc((size_t)M, 1);
+    cache->resident = (int *)malloc((size_t)M * sizeof(int));
+    cache->dots_budget = budget - budget / 2;
+    cache->dots = (double *)malloc(cache->dots_budget > 0 ? cache->dots_budget : 1);
+    cache->dot_off = (long *)malloc((size_t)M * sizeof(long));
+    cache->dot_list = (int *)malloc((size_t)M * sizeof(int));
+    cache->budget = budget / 2;
+    cache->pinned = -1;
+    cache->row = -1;
+    if (cache->block == NULL || cache->last_use == NULL || cache->uncacheable == NULL
+        || cache->resident == NULL || cache->dots == NULL || cache->dot_off == NULL
+        || cache->dot_list == NULL)
+    {
+        return -1;
+    }
+    for (int c = 0; c < M; c++)
+    {
+        cache->dot_off[c] = -1;
+    }
+    return 0;
+}
+
+/**
+ * knn_block_cache_free() - Release a block cache and its blocks.
+ * @cache: Cache to release.
+ */
+static void knn_block_cache_free(
+    KnnBlockCache *cache)
+{
+    for (int ii = 0; ii < cache->num_resident; ii++)
+    {
+        free(cache->block[cache->resident[ii]]);
+    }
+    free(cache->block);
+    free(cache->last_use);
+    free(cache->uncacheable);
+    free(cache->resident);
+    free(cache->dots);
+    free(cache->dot_off);
+    free(cache->dot_list);
+    memset(cache, 0, sizeof(*cache));
+}
+
+/**
+ * block_bytes() - Size of the block of cluster @c.
+ * @model: Active KnnModel.
+ * @c:     Cluster.
+ *
+ * Return: Bytes of the cluster's member frames and their squared norms.
+ */
+static inline size_t block_bytes(
+    const KnnModel *model,
+    int             c)
+{
+    return (size_t)model->clusters[c].num_members * ((size_t)model->frame_elements + 1)
+           * sizeof(double);
+}
+
+/**
+ * knn_block_evict() - Drop the least recently used block that is not pinned.
+ * @cache: Block cache.
+ * @model: Active KnnModel.
+ *
+ * Return: 1 if a block was dropped, 0 if none can be.
+ */
+static int knn_block_evict(
+    KnnBlockCache  *cache,
+    const KnnModel *model)
+{
+    int victim = -1;
+    for (int ii = 0; ii < cache->num_resident; ii++)
+    {
+        int c = cache->resident[ii];
+        if (c != cache->pinned
+            && (victim < 0 || cache->last_use[c] < cache->last_use[cache->resident[victim]]))
+        {
+            victim = ii;
+        }
+    }
+    if (victim < 0)
+    {
+        return 0;
+    }
+    int c = cache->resident[victim];
+    free(cache->block[c]);
+    cache->block[c] = NULL;
+    cache->used -= block_bytes(model, c);
+    cache->resident[victim] = cache->resident[--cache->num_resident];
+    return 1;
+}
+
+/**
+ * knn_block_get() - Member frames of a cluster, loaded into the cache on first use.
+ * @cache:  Block cache.
+ * @reader: Thread-local KnnFrameReader.
+ * @model:  Active KnnModel.
+ * @c:      Cluster.
+ * @telem:  Thread-local KnnTelemetry (frames read).
+ *
+ * A block is the cluster's members read one after the other, once, followed
+ * by their squared norms for the tiled kernel (see knn_dot_tile()). Blocks
+ * that do not fit the budget, or whose frames cannot all be read, are not
+ * cached; their frames are then read one by one by the caller.
+ *
+ * Return: Frame of member m at m * frame_elements, or NULL if not cached.
+ */
+static const double *knn_block_get(
+    KnnBlockCache  *cache,
+    KnnFrameReader *reader,
+    const KnnModel *model,
+    int             c,
+    KnnTelemetry   *telem)
+{
+    cache->clock++;
+    if (cache->block[c] != NULL)
+    {
+        cache->last_use[c] = cache->clock;
+        return cache->block[c];
+    }
+    if (cache->uncacheable[c])
+    {
+        return NULL;
+    }
+
+    const KnnCluster *cl = &model->clusters[c];
+    size_t bytes = block_bytes(model, c);
+    if (bytes > cache->budget)
+    {
+        cache->uncacheable[c] = 1;
+        return NULL;
+    }
+    while (cache->used + bytes > cache->budget)
+    {
+        if (!knn_block_evict(cache, model))
+        {
+            return NULL; /* Only the pinned block is left and both do not fit */
+        }
+    }
+
+    double *block = (double *)malloc(bytes);
+    if (block == NULL)
+    {
+        cache->uncacheable[c] = 1;
+        return NULL;
+    }
+    for (int m = 0; m < cl->num_members; m++)
+    {
+        if (knn_reader_read_frame(reader, (long)cl->members[m].frame_id,
+                                  block + (size_t)m * model->frame_elements) != 0)
+        {
+            free(block);
+            cache->uncacheable[c] = 1;
+            return NULL;
+        }
+        telem->frames_read++;
+    }
+    double *norm_sq = block + (size_t)cl->num_members * model->frame_elements;
+    for (int m = 0; m < cl->num_members; m++)
+    {
+        const double *v = block + (size_t)m * model->frame_elements;
+        double sum = 0.0;
+        for (long ii = 0; ii < model->frame_elements; ii++)
+        {
+            sum += v[ii] * v[ii];
+        }
+        norm_sq[m] = sum;
+    }
+    cache->block[c] = block;
+    cache->last_use[c] = cache->clock;
+    cache->resident[cache->num_resident++] = c;
+    cache->used += bytes;
+    return block;
+}
+
+/**
+ * candidate_frame() - Frame of member @m of cluster @c.
+ * @cache:       Block cache, or NULL to read the frame.
+ * @reader:      Thread-local KnnFrameReader.
+ * @model:       Active KnnModel.
+ * @c:           Cluster.
+ * @m:           Member index in the cluster.
+ * @cand_buffer: Scratch buffer the frame is read into when not cached.
+ * @telem:       Thread-local KnnTelemetry (frames read).
+ *
+ * Return: Frame data, or NULL if it could not be read.
+ */
+static const double *candidate_frame(
+    KnnBlockCache  *cache,
+    KnnFrameReader *reader,
+    const KnnModel *model,
+    int             c,
+    int             m,
+    double         *cand_buffer,
+    KnnTelemetry   *telem)
+{
+    if (cache != NULL)
+    {
+        const double *block = knn_block_get(cache, reader, model, c, telem);
+        if (block != NULL)
+        {
+            return block + (size_t)m * model->frame_elements;
+        }
+    }
+    if (knn_reader_read_frame(reader, (long)model->clusters[c].members[m].frame_id,
+                              cand_buffer) != 0)
+    {
+        return NULL;
+    }
+    telem->frames_read++;
+    return cand_buffer;
+}
+
+/**
+ * knn_dot_group() - Start the query group of home members [@q0, @q1).
+ * @cache: Block cache.
+ * @q0:    First home member of the group.
+ * @q1:    End of the group (exclusive).
+ *
+ * Drops the tiles of the previous group.
+ */
+static void knn_dot_group(
+    KnnBlockCache *cache,
+    int            q0,
+    int            q1)
+{
+    for (int ii = 0; ii < cache->num_dot; ii++)
+    {
+        cache->dot_off[cache->dot_list[ii]] = -1;
+    }
+    cache->num_dot = 0;
+    cache->dots_used = 0;
+    cache->q0 = q0;
+    cache->q1 = q1;
+}
+
+/**
+ * knn_dot_tile() - Dot products of the query group with the members of cluster @c.
+ * @cache:  Block cache (pinned home block holds the queries).
+ * @reader: Thread-local KnnFrameReader.
+ * @model:  Active KnnModel.
+ * @c:      Cluster.
+ * @telem:  Thread-local KnnTelemetry (tile pairs).
+ *
+ * Computed on the first request of the group and kept until the next
+ * knn_dot_group(). The tile is (q1 - q0) rows of num_members dot products.
+ * It is cache blocked: KNN_PANEL_ROWS members by KNN_PANEL_DEPTH elements
+ * stay in cache while every query of the group runs through them with the
+ * vectorized 1 x 4 kernel of dist_dot_batch_f64(), so each candidate panel is
+ * loaded once per group rather than once per query.
+ *
+ * Return: Tile, or NULL if either block cannot be held or the arena is full.
+ */
+static const double *knn_dot_tile(
+    KnnBlockCache  *cache,
+    KnnFrameReader *reader,
+    const KnnModel *model,
+    int             c,
+    KnnTelemetry   *telem)
+{
+    /* The candidate block may have been evicted since its tile was made */
+    const double *cblock = knn_block_get(cache, reader, model, c, telem);
+    const double *hblock = cache->block[cache->pinned];
+    if (cblock == NULL || hblock == NULL)
+    {
+        return NULL;
+    }
+    if (cache->dot_off[c] >= 0)
+    {
+        return cache->dots + cache->dot_off[c];
+    }
+
+    int nm = model->clusters[c].num_members;
+    int nq = cache->q1 - cache->q0;
+    size_t need = (size_t)nq * (size_t)nm;
+    if ((cache->dots_used + need) * sizeof(double) > cache->dots_budget)
+    {
+        return NULL;
+    }
+
+    long n = model->frame_elements;
+    double *tile = cache->dots + cache->dots_used;
+    for (int m0 = 0; m0 < nm; m0 += KNN_PANEL_ROWS)
+    {
+        int nb = (nm - m0 < KNN_PANEL_ROWS) ? nm - m0 : KNN_PANEL_ROWS;
+        for (long k0 = 0; k0 < n; k0 += KNN_PANEL_DEPTH)
+        {
+            long klen = (n - k0 < KNN_PANEL_DEPTH) ? n - k0 : KNN_PANEL_DEPTH;
+            const double *rows[KNN_PANEL_ROWS];
+            double part[KNN_PANEL_ROWS];
+            for (int jj = 0; jj < nb; jj++)
+            {
+                rows[jj] = cblock + (size_t)(m0 + jj) * n + k0;
+            }
+            for (int qi = 0; qi < nq; qi++)
+            {
+                const double *qrow = hblock + (size_t)(cache->q0 + qi) * n + k0;
+                double *out = tile + (size_t)qi * nm + m0;
+                dist_dot_batch_f64(qrow, rows, nb, klen, part);
+                for (int jj = 0; jj < nb; jj++)
+                {
+                    out[jj] = (k0 == 0) ? part[jj] : out[jj] + part[jj];
+                }
+            }
+        } // for (long k0 = 0; ...)
+    } // for (int m0 = 0; ...)
+
+    cache->dot_off[c] = (long)cache->dots_used;
+    cache->dot_list[cache->num_dot++] = c;
+    cache->dots_used += need;
+    telem->tile_pairs += (uint64_t)need;
+    return tile;
+}
+
+/**
+ * scan_members() - Levels 3 and 4 over the members of one cluster.
+ * @query_id:    Index of query frame.
+ * @query_data:  Pixel buffer of query frame.
+ * @model:       Active KnnModel.
+ * @config:      Active KnnConfig.
+ * @reader:      Thread-local KnnFrameReader.
+ * @cache:       Thread-local block cache, or NULL to read candidates one by one.
+ * @c:           Cluster.
+ * @r_center:    Query distance to the cluster's anchor (annular bound center).
+ * @rlim_bound:  1 to also skip members whose annular bound reaches -rlim.
+ * @cand_buffer: Scratch buffer for candidate frame pixels.
+ * @heap:        Thread-local KnnMaxHeap.
+ * @telem:       Thread-local KnnTelemetry.
+ *
+ * Members are taken in order against the current tau. Inside a query group
+ * (see search_blocked()) the distance of a member is first formed from the
+ * group's dot-product tile as ||q||^2 + ||c||^2 - 2 q.c. That form loses
+ * accuracy to cancellation, so, as in framedist_batch(), any member that may
+ * still enter the heap (below tau or -rlim, plus the error margin) is
+ * recomputed with dist_l2_f64(); the others cannot enter it and are dropped.
+ * The heap therefore only sees exact distances and the result and counters
+ * are those of the plain scan.
+ */
+static void scan_members(
+    long                   query_id,
+    const double *restrict query_data,
+    const KnnModel        *model,
+    const KnnConfig       *config,
+    KnnFrameReader        *reader,
+    KnnBlockCache         *cache,
+    int                    c,
+    double                 r_center,
+    int                    rlim_bound,
+    double       *restrict cand_buffer,
+    KnnMaxHeap            *heap,
+    KnnTelemetry *restrict telem)
+{
+    const KnnCluster *cl = &model->clusters[c];
+    long frame_elem = model->frame_elements;
+    double eps_factor = 1.0 + config->epsilon;
+    const double *dots = NULL;
+    const double *cnorm = NULL;
+    double qq = 0.0;
+
+    for (int m = 0; m < cl->num_members; m++)
+    {
+        long cand_id = (long)cl->members[m].frame_id;
+        telem->total_candidates_considered++;
+
+        if (!check_temporal_separation(query_id, cand_id, config))
+        {
+            telem->temporal_pruned++;
+            continue;
+        }
+
+        double current_tau = knn_heap_peek_max_dist(heap);
+        double r_cand = (double)cl->members[m].r_anchor;
+        double lb_annular = fabs(r_center - r_cand);
+
+        if (lb_annular >= current_tau / eps_factor)
+        {
+            telem->level3_annular_pruned++;
+            continue;
+        }
+
+        if (rlim_bound && config->rlim_cutoff > 0.0 && lb_annular >= config->rlim_cutoff)
+        {
+            telem->level3_annular_pruned++;
+            continue;
+        }
+
+        // Level 4: Exact Distance Evaluation
+        if (dots == NULL && cache != NULL && cache->row >= 0)
+        {
+            dots = knn_dot_tile(cache, reader, model, c, telem);
+            if (dots != NULL)
+            {
+                dots += (size_t)cache->row * cl->num_members;
+                cnorm = cache->block[c] + (size_t)cl->num_members * frame_elem;
+                const double *hblock = cache->block[cache->pinned];
+                qq = hblock[(size_t)model->clusters[cache->pinned].num_members * frame_elem
+                            + cache->q0 + cache->row];
+            }
+        }
+        if (dots != NULL && heap->count >= heap->k)
+        {
+            double guard = current_tau;
+            if (config->rlim_cutoff > 0.0 && config->rlim_cutoff < guard)
+            {
+                guard = config->rlim_cutoff;
+            }
+            double d_sq = qq + cnorm[m] - 2.0 * dots[m];
+            double tol = 4.0 * (double)frame_elem * DBL_EPSILON * (qq + cnorm[m]);
+            if (d_sq > guard * guard + tol)
+            {
+                telem->framedist_calls++;
+                continue; // exact distance > tau: the heap would reject it
+            }
+            telem->tile_exact++;
+        }
+
+        const double *cand = candidate_frame(cache, reader, model, c, m, cand_buffer, telem);
+        if (cand != NULL)
+        {
+            telem->framedist_calls++;
+            double d = dist_l2_f64(query_data, cand, frame_elem);
+            if (config->rlim_cutoff <= 0.0 || d <= config->rlim_cutoff)
+            {
+                knn_heap_push(heap, (int)cand_id, d);
+            }
+        }
+    } // for (int m = 0; ...)
+}
+
 /**
  * knn_search_single_frame() - Execute 3-level pruning search for one query frame.
  * @query_id:       Index of query frame.
@@ -147,6 +581,7 @@ static inline int check_temporal_separation(
  * @model:          Active KnnModel.
  * @config:         Active KnnConfig.
  * @reader:         Thread-local KnnFrameReader.
+ * @cache:          Thread-local block cache, or NULL to read candidates one by one.
  * @cand_buffer:    Scratch buffer for candidate frame pixels.
  * @scores_buffer:  Scratch buffer for cluster sorting.
  * @heap:           Thread-local KnnMaxHeap.
@@ -160,6 +595,7 @@ static void knn_search_single_frame(
     const KnnModel       *model,
     const KnnConfig      *config,
     KnnFrameReader       *reader,
+    KnnBlockCache        *cache,
     double       *restrict cand_buffer,
     ClusterScore *restrict scores_buffer,
     KnnMaxHeap           *heap,
@@ -170,7 +606,7 @@ static void knn_search_single_frame(
     knn_heap_reset(heap);
 
     int home_cluster_id = model->frame_cluster_map[query_id];
-    double r_home = (double)model->frame_r_anchor[query_id];
+    double r_home = (home_cluster_id >= 0) ? (double)model->frame_r_anchor[query_id] : 0.0;
     int M = model->num_clusters;
     long frame_elem = model->frame_elements;
     double eps_factor = 1.0 + config->epsilon;
@@ -178,38 +614,8 @@ static void knn_search_single_frame(
     // Step 1: Intra-Cluster Search (Home cluster c_p)
     if (home_cluster_id >= 0 && home_cluster_id < M)
     {
-        const KnnCluster *home_cl = &model->clusters[home_cluster_id];
-        for (int m = 0; m < home_cl->num_members; m++)
-        {
-            long cand_id = (long)home_cl->members[m].frame_id;
-            telem->total_candidates_considered++;
-
-            if (!check_temporal_separation(query_id, cand_id, config))
-            {
-                telem->temporal_pruned++;
-                continue;
-            }
-
-            double current_tau = knn_heap_peek_max_dist(heap);
-            double r_cand = (double)home_cl->members[m].r_anchor;
-            double lb_annular = fabs(r_home - r_cand);
-
-            if (lb_annular >= current_tau / eps_factor)
-            {
-                telem->level3_annular_pruned++;
-                continue;
-            }
-
-            if (knn_reader_read_frame(reader, cand_id, cand_buffer) == 0)
-            {
-                telem->framedist_calls++;
-                double d = compute_euclidean_distance(query_data, cand_buffer, frame_elem);
-                if (config->rlim_cutoff <= 0.0 || d <= config->rlim_cutoff)
-                {
-                    knn_heap_push(heap, (int)cand_id, d);
-                }
-            }
-        } // for (int m = 0; ...)
+        scan_members(query_id, query_data, model, config, reader, cache, home_cluster_id,
+                     r_home, 0, cand_buffer, heap, telem);
     } // Intra-Cluster Search
 
     // Step 2: Rank and Sort other candidate clusters
@@ -221,7 +627,8 @@ static void knn_search_single_frame(
             continue;
         }
 
-        double dcc = model->dcc_matrix[home_cluster_id * M + q];
+        /* Frames without a cluster (-1 in a results bundle) have no DCC bound */
+        double dcc = (home_cluster_id >= 0) ? model->dcc_matrix[home_cluster_id * M + q] : 0.0;
         double r_q = model->clusters[q].radius;
         double lb = dcc - r_home - r_q;
         if (lb < 0.0)
@@ -254,7 +661,7 @@ static void knn_search_single_frame(
         // Level 2: Query-to-Anchor evaluation
         const KnnCluster *cl = &model->clusters[q];
         telem->framedist_calls++;
-        double d_anchor = compute_euclidean_distance(query_data, cl->anchor_data, frame_elem);
+        double d_anchor = dist_l2_f64(query_data, cl->anchor_data, frame_elem);
         double lb_anchor = d_anchor - cl->radius;
         if (lb_anchor < 0.0)
         {
@@ -267,177 +674,366 @@ static void knn_search_single_frame(
             continue;
         }
 
-        // Level 3: 1D Annular Member Filter
-        for (int m = 0; m < cl->num_members; m++)
-        {
-            long cand_id = (long)cl->members[m].frame_id;
-            telem->total_candidates_considered++;
+        // Levels 3 and 4: 1D annular member filter, then exact distances
+        scan_members(query_id, query_data, model, config, reader, cache, q, d_anchor, 1,
+                     cand_buffer, heap, telem);
+    } // for (int idx = 0; ...)
 
-            if (!check_temporal_separation(query_id, cand_id, config))
-            {
-                telem->temporal_pruned++;
-                continue;
-            }
+    // Extract sorted results
+    knn_heap_extract_sorted(heap, out_indices, out_distances, config->k);
+}
 
-            current_tau = knn_heap_peek_max_dist(heap);
-            double r_cand = (double)cl->members[m].r_anchor;
-            double lb_annular = fabs(d_anchor - r_cand);
+/**
+ * telemetry_add() - Accumulate thread telemetry into the run totals.
+ * @dst: Run totals.
+ * @src: Thread-local KnnTelemetry.
+ */
+static void telemetry_add(
+    KnnTelemetry       *dst,
+    const KnnTelemetry *src)
+{
+    dst->framedist_calls += src->framedist_calls;
+    dst->frames_read += src->frames_read;
+    dst->tile_pairs += src->tile_pairs;
+    dst->tile_exact += src->tile_exact;
+    dst->level1_clusters_pruned += src->level1_clusters_pruned;
+    dst->level2_anchors_pruned += src->level2_anchors_pruned;
+    dst->level3_annular_pruned += src->level3_annular_pruned;
+    dst->temporal_pruned += src->temporal_pruned;
+    dst->total_candidates_considered += src->total_candidates_considered;
+}
 
-            if (lb_annular >= current_tau / eps_factor)
-            {
-                telem->level3_annular_pruned++;
-                continue;
-            }
+/**
+ * print_progress() - Draw the progress bar.
+ * @done:  Queries completed.
+ * @total: Total queries.
+ */
+static void print_progress(
+    long done,
+    long total)
+{
+    double pct = 100.0 * (double)done / (double)total;
+    printf("\rSearching k-NN: [%-40s] %5.1f%% (%ld / %ld frames)",
+           "========================================" + (40 - (int)(pct * 0.4)), pct, done,
+           total);
+    fflush(stdout);
+}
+
+/**
+ * search_per_query() - Search every frame of a query chunk on its own, in frame order.
+ * @config:       Active KnnConfig.
+ * @model:        Active KnnModel.
+ * @master:       Opened KnnFrameReader, cloned per thread.
+ * @begin:        First query of the chunk.
+ * @end:          End of the chunk (exclusive).
+ * @base:         Queries of the run searched before this chunk (progress).
+ * @total:        Queries of the run (progress).
+ * @results:      Output KnnResults, row i - @begin for query i.
+ * @telemetry:    Run totals to accumulate into.
+ *
+ * Each candidate frame that survives pruning is read for each query.
+ */
+static void search_per_query(
+    const KnnConfig      *config,
+    const KnnModel       *model,
+    const KnnFrameReader *master,
+    long                  begin,
+    long                  end,
+    long                  base,
+    long                  total,
+    KnnResults           *results,
+    KnnTelemetry         *telemetry)
+{
+    int k = config->k;
+    long progress_step = total / 100;
+    if (progress_step < 1)
+    {
+        progress_step = 1;
+    }
 
-            if (config->rlim_cutoff > 0.0 && lb_annular >= config->rlim_cutoff)
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        KnnFrameReader thread_reader;
+        knn_reader_clone_thread(master, &thread_reader);
+
+        KnnMaxHeap thread_heap;
+        knn_heap_init(&thread_heap, k);
+
+        double *query_buffer = (double *)malloc((size_t)model->frame_elements * sizeof(double));
+        double *cand_buffer = (double *)malloc((size_t)model->frame_elements * sizeof(double));
+        ClusterScore *scores_buf =
+            (ClusterScore *)malloc((size_t)model->num_clusters * sizeof(ClusterScore));
+
+        KnnTelemetry thread_telem;
+        memset(&thread_telem, 0, sizeof(KnnTelemetry));
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 32)
+#endif
+        for (long i = begin; i < end; i++)
+        {
+            size_t row = (size_t)(i - begin) * (size_t)k;
+            if (knn_reader_read_frame(&thread_reader, i, query_buffer) == 0)
             {
-                telem->level3_annular_pruned++;
-                continue;
+                thread_telem.frames_read++;
+                knn_search_single_frame(
+                    i, query_buffer, model, config, &thread_reader, NULL,
+                    cand_buffer, scores_buf, &thread_heap, &thread_telem,
+                    &results->indices[row], &results->distances[row]);
             }
 
-            // Level 4: Exact Distance Evaluation
-            if (knn_reader_read_frame(reader, cand_id, cand_buffer) == 0)
+            if (config->progress_mode && (base + i - begin) % progress_step == 0)
             {
-                telem->framedist_calls++;
-                double d = compute_euclidean_distance(query_data, cand_buffer, frame_elem);
-                if (config->rlim_cutoff <= 0.0 || d <= config->rlim_cutoff)
+#ifdef _OPENMP
+                if (omp_get_thread_num() == 0)
+#endif
                 {
-                    knn_heap_push(heap, (int)cand_id, d);
+                    print_progress(base + i - begin, total);
                 }
             }
-        } // for (int m = 0; ...)
-    } // for (int idx = 0; ...)
+        } // for (long i = begin; ...)
 
-    // Extract sorted results
-    knn_heap_extract_sorted(heap, out_indices, out_distances, config->k);
+#ifdef _OPENMP
+#pragma omp critical(knn_telemetry)
+#endif
+        telemetry_add(telemetry, &thread_telem);
+
+        free(scores_buf);
+        free(cand_buffer);
+        free(query_buffer);
+        knn_heap_free(&thread_heap);
+        knn_reader_close_thread(&thread_reader);
+    } // OpenMP parallel block
 }
 
 /**
- * knn_run_search() - Multi-threaded driver executing k-NN search across all frames.
- * @config:    Active KnnConfig.
- * @model:     Active KnnModel.
- * @results:   Output KnnResults structure to populate.
- * @telemetry: Output aggregated KnnTelemetry structure.
+ * compare_cluster_size() - Sort cluster indices by descending member count.
+ * @a: Pointer to first cluster index.
+ * @b: Pointer to second cluster index.
  *
- * Return: 0 on success, -1 on error.
+ * The model is taken from sort_model (qsort() has no context argument).
+ *
+ * Return: Negative if a has more members than b.
  */
-int knn_run_search(
-    const KnnConfig *config,
-    const KnnModel  *model,
-    KnnResults      *results,
-    KnnTelemetry    *telemetry)
+static const KnnModel *sort_model;
+static int compare_cluster_size(
+    const void *a,
+    const void *b)
 {
-    if (config == NULL || model == NULL || results == NULL || telemetry == NULL)
+    int na = sort_model->clusters[*(const int *)a].num_members;
+    int nb = sort_model->clusters[*(const int *)b].num_members;
+    if (na != nb)
     {
-        return -1;
+        return (na > nb) ? -1 : 1;
     }
+    return *(const int *)a - *(const int *)b;
+}
 
-    memset(telemetry, 0, sizeof(KnnTelemetry));
-
-    long N = model->total_dataset_frames;
-    int k = config->k;
-
-    results->indices = (int *)malloc((size_t)N * (size_t)k * sizeof(int));
-    results->distances = (double *)malloc((size_t)N * (size_t)k * sizeof(double));
-
-    if (results->indices == NULL || results->distances == NULL)
+/**
+ * member_lower_bound() - First member of a cluster whose frame is at least @frame.
+ * @cl:    Cluster (members in increasing frame order).
+ * @frame: Frame index.
+ *
+ * Return: Member index, num_members if none.
+ */
+static int member_lower_bound(
+    const KnnCluster *cl,
+    long              frame)
+{
+    int lo = 0;
+    int hi = cl->num_members;
+    while (lo < hi)
     {
-        fprintf(stderr, "Error: Memory allocation failed for results buffer\n");
-        return -1;
+        int mid = lo + (hi - lo) / 2;
+        if ((long)cl->members[mid].frame_id < frame)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
     }
+    return lo;
+}
 
-    KnnFrameReader master_reader;
-    if (knn_reader_open(&master_reader, config->input_data_path, N,
-                        model->frame_width, model->frame_height) != 0)
-    {
-        knn_results_free(results);
-        return -1;
-    }
+/**
+ * search_blocked() - Search a query chunk cluster by cluster with a block cache (-blockmem).
+ * @config:       Active KnnConfig.
+ * @model:        Active KnnModel.
+ * @master:       Opened KnnFrameReader, cloned per thread.
+ * @caches:       One block cache per thread, kept from chunk to chunk.
+ * @begin:        First query of the chunk.
+ * @end:          End of the chunk (exclusive).
+ * @base:         Queries of the run searched before this chunk (progress).
+ * @total:        Queries of the run (progress).
+ * @results:      Output KnnResults, row i - @begin for query i.
+ * @telemetry:    Run totals to accumulate into.
+ *
+ * Queries are taken home cluster by home cluster (largest first, one cluster
+ * per thread at a time). The home cluster's members are read once into the
+ * thread's block cache and stay pinned while its queries run; every other
+ * cluster whose members are needed is read whole on first use and kept until
+ * the budget forces it out. Queries of one home cluster mostly reach the same
+ * candidate clusters, so each block serves many (query, candidate) pairs
+ * instead of one frame read per pair. Within a home cluster, queries go in
+ * groups of KNN_QUERY_GROUP that share dot-product tiles with each candidate
+ * cluster (knn_dot_tile()). The search of each query is unchanged (same
+ * bounds, same order), so results are identical to search_per_query().
+ * Members are in frame order, so the queries of the chunk are a run of
+ * members in each home cluster. Frames without a cluster are searched last,
+ * still through the cache.
+ */
+static void search_blocked(
+    const KnnConfig      *config,
+    const KnnModel       *model,
+    const KnnFrameReader *master,
+    KnnBlockCache        *caches,
+    long                  begin,
+    long                  end,
+    long                  base,
+    long                  total,
+    KnnResults           *results,
+    KnnTelemetry         *telemetry)
+{
+    int M = model->num_clusters;
+    int k = config->k;
 
-    int nthreads = config->nthreads;
-#ifdef _OPENMP
-    if (nthreads > 0)
+    int *order = (int *)malloc((size_t)M * sizeof(int));
+    long *loose = (long *)malloc((size_t)(end - begin) * sizeof(long));
+    if (order == NULL || loose == NULL)
     {
-        omp_set_num_threads(nthreads);
+        /* Fall back to the plain scan rather than fail the chunk */
+        free(order);
+        free(loose);
+        search_per_query(config, model, master, begin, end, base, total, results, telemetry);
+        return;
     }
-    else
+    for (int c = 0; c < M; c++)
     {
-        nthreads = omp_get_max_threads();
+        order[c] = c;
     }
-#else
-    nthreads = 1;
-#endif
-
-    struct timespec start_time, end_time;
-    clock_gettime(CLOCK_MONOTONIC, &start_time);
-
-    long progress_step = N / 100;
-    if (progress_step < 1)
+    sort_model = model;
+    qsort(order, (size_t)M, sizeof(int), compare_cluster_size);
+    long num_loose = 0;
+    for (long i = begin; i < end; i++)
     {
-        progress_step = 1;
+        int c = model->frame_cluster_map[i];
+        if (c < 0 || c >= M)
+        {
+            loose[num_loose++] = i;
+        }
     }
 
-    uint64_t global_telem_calls = 0;
-    uint64_t global_telem_l1 = 0;
-    uint64_t global_telem_l2 = 0;
-    uint64_t global_telem_l3 = 0;
-    uint64_t global_telem_temp = 0;
-    uint64_t global_telem_cand = 0;
+    long done = base;
 
 #ifdef _OPENMP
-#pragma omp parallel reduction(+:global_telem_calls, global_telem_l1, global_telem_l2, \
-                                 global_telem_l3, global_telem_temp, global_telem_cand)
+#pragma omp parallel
 #endif
     {
         KnnFrameReader thread_reader;
-        knn_reader_clone_thread(&master_reader, &thread_reader);
+        knn_reader_clone_thread(master, &thread_reader);
 
         KnnMaxHeap thread_heap;
         knn_heap_init(&thread_heap, k);
 
+#ifdef _OPENMP
+        KnnBlockCache *cache = &caches[omp_get_thread_num()];
+#else
+        KnnBlockCache *cache = &caches[0];
+#endif
         double *query_buffer = (double *)malloc((size_t)model->frame_elements * sizeof(double));
         double *cand_buffer = (double *)malloc((size_t)model->frame_elements * sizeof(double));
         ClusterScore *scores_buf =
             (ClusterScore *)malloc((size_t)model->num_clusters * sizeof(ClusterScore));
+        int err = (query_buffer == NULL || cand_buffer == NULL || scores_buf == NULL);
 
         KnnTelemetry thread_telem;
         memset(&thread_telem, 0, sizeof(KnnTelemetry));
 
 #ifdef _OPENMP
-#pragma omp for schedule(dynamic, 32)
+#pragma omp for schedule(dynamic, 1)
 #endif
-        for (long i = 0; i < N; i++)
+        for (int idx = 0; idx < M; idx++)
         {
-            if (knn_reader_read_frame(&thread_reader, i, query_buffer) == 0)
+            int c = order[idx];
+            const KnnCluster *cl = &model->clusters[c];
+            int m0 = member_lower_bound(cl, begin);
+            int m1 = member_lower_bound(cl, end);
+            if (err || m0 == m1)
+            {
+                continue;
+            }
+
+            cache->pinned = c;
+            const double *home = knn_block_get(cache, &thread_reader, model, c, &thread_telem);
+            for (int m = m0; m < m1; m++)
             {
+                long i = (long)cl->members[m].frame_id;
+                if (home != NULL && (m - m0) % KNN_QUERY_GROUP == 0)
+                {
+                    int q1 = (m1 - m < KNN_QUERY_GROUP) ? m1 : m + KNN_QUERY_GROUP;
+                    knn_dot_group(cache, m, q1);
+                }
+                cache->row = (home != NULL) ? m - cache->q0 : -1;
+                const double *query = (home != NULL) ?
+                                      home + (size_t)m * model->frame_elements : query_buffer;
+                if (home == NULL)
+                {
+                    if (knn_reader_read_frame(&thread_reader, i, query_buffer) != 0)
+                    {
+                        continue;
+                    }
+                    thread_telem.frames_read++;
+                }
+                size_t row = (size_t)(i - begin) * (size_t)k;
                 knn_search_single_frame(
-                    i, query_buffer, model, config, &thread_reader,
+                    i, query, model, config, &thread_reader, cache,
                     cand_buffer, scores_buf, &thread_heap, &thread_telem,
-                    &results->indices[i * k], &results->distances[i * k]);
-                thread_telem.total_queries++;
-            }
+                    &results->indices[row], &results->distances[row]);
+            } // for (int m = m0; ...)
 
-            if (config->progress_mode && i % progress_step == 0)
+            long now;
+#ifdef _OPENMP
+#pragma omp atomic capture
+#endif
+            now = done += m1 - m0;
+            if (config->progress_mode)
             {
 #ifdef _OPENMP
                 if (omp_get_thread_num() == 0)
 #endif
                 {
-                    double pct = 100.0 * (double)i / (double)N;
-                    printf("\rSearching k-NN: [%-40s] %5.1f%% (%ld / %ld frames)",
-                           "========================================" +
-                           (40 - (int)(pct * 0.4)), pct, i, N);
-                    fflush(stdout);
+                    print_progress(now, total);
                 }
             }
-        } // for (long i = 0; ...)
+        } // for (int idx = 0; ...)
+        cache->pinned = -1;
+        cache->row = -1;
 
-        global_telem_calls += thread_telem.framedist_calls;
-        global_telem_l1 += thread_telem.level1_clusters_pruned;
-        global_telem_l2 += thread_telem.level2_anchors_pruned;
-        global_telem_l3 += thread_telem.level3_annular_pruned;
-        global_telem_temp += thread_telem.temporal_pruned;
-        global_telem_cand += thread_telem.total_candidates_considered;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 32)
+#endif
+        for (long jj = 0; jj < num_loose; jj++)
+        {
+            long i = loose[jj];
+            size_t row = (size_t)(i - begin) * (size_t)k;
+            if (!err && knn_reader_read_frame(&thread_reader, i, query_buffer) == 0)
+            {
+                thread_telem.frames_read++;
+                knn_search_single_frame(
+                    i, query_buffer, model, config, &thread_reader, cache,
+                    cand_buffer, scores_buf, &thread_heap, &thread_telem,
+                    &results->indices[row], &results->distances[row]);
+            }
+        } // for (long jj = 0; ...)
+
+#ifdef _OPENMP
+#pragma omp critical(knn_telemetry)
+#endif
+        telemetry_add(telemetry, &thread_telem);
 
         free(scores_buf);
         free(cand_buffer);
@@ -446,30 +1042,233 @@ int knn_run_search(
         knn_reader_close_thread(&thread_reader);
     } // OpenMP parallel block
 
+    free(order);
+    free(loose);
+}
+
+/**
+ * run_range() - Search queries [@begin, @end) chunk by chunk.
+ * @config:    Active KnnConfig.
+ * @model:     Active KnnModel.
+ * @begin:     First query.
+ * @end:       End of the queries (exclusive).
+ * @chunk:     Queries per chunk; @results holds that many rows.
+ * @results:   Allocated KnnResults, reused by every chunk.
+ * @fn:        Called after each chunk, or NULL.
+ * @ctx:       Context of @fn.
+ * @telemetry: Output aggregated KnnTelemetry structure.
+ *
+ * The reader and, with -blockmem, the per-thread block caches are opened
+ * once for the whole range.
+ *
+ * Return: 0 on success, -1 on error.
+ */
+static int run_range(
+    const KnnConfig *config,
+    const KnnModel  *model,
+    long             begin,
+    long             end,
+    long             chunk,
+    KnnResults      *results,
+    KnnChunkFn       fn,
+    void            *ctx,
+    KnnTelemetry    *telemetry)
+{
+    memset(telemetry, 0, sizeof(KnnTelemetry));
+
+    KnnFrameReader master_reader;
+    if (knn_reader_open(&master_reader, config->input_data_path, model->total_dataset_frames,
+                        model->frame_width, model->frame_height) != 0)
+    {
+        return -1;
+    }
+
+    int nthreads = config->nthreads;
+#ifdef _OPENMP
+    if (nthreads > 0)
+    {
+        omp_set_num_threads(nthreads);
+    }
+    else
+    {
+        nthreads = omp_get_max_threads();
+    }
+#else
+    nthreads = 1;
+#endif
+
+    KnnBlockCache *caches = NULL;
+    if (config->block_mem_mb > 0)
+    {
+        size_t budget = ((size_t)config->block_mem_mb << 20) / (size_t)nthreads;
+        caches = (KnnBlockCache *)calloc((size_t)nthreads, sizeof(KnnBlockCache));
+        int err = (caches == NULL);
+        for (int t = 0; !err && t < nthreads; t++)
+        {
+            err = knn_block_cache_init(&caches[t], model->num_clusters, budget);
+        }
+        if (err)
+        {
+            fprintf(stderr, "Error: Memory allocation failed for block cache\n");
+            for (int t = 0; caches != NULL && t < nthreads; t++)
+            {
+                knn_block_cache_free(&caches[t]);
+            }
+            free(caches);
+            knn_reader_close(&master_reader);
+            return -1;
+        }
+    }
+
+    struct timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    int ret = 0;
+    for (long c0 = begin; c0 < end && ret == 0; c0 += chunk)
+    {
+        long c1 = (end - c0 < chunk) ? end : c0 + chunk;
+        if (caches != NULL)
+        {
+            search_blocked(config, model, &master_reader, caches, c0, c1, c0 - begin,
+                           end - begin, results, telemetry);
+        }
+        else
+        {
+            search_per_query(config, model, &master_reader, c0, c1, c0 - begin, end - begin,
+                             results, telemetry);
+        }
+        if (fn != NULL && fn(ctx, results, c0, c1) != 0)
+        {
+            ret = -1;
+        }
+    } // for (long c0 = begin; ...)
+
     clock_gettime(CLOCK_MONOTONIC, &end_time);
+    for (int t = 0; caches != NULL && t < nthreads; t++)
+    {
+        knn_block_cache_free(&caches[t]);
+    }
+    free(caches);
     knn_reader_close(&master_reader);
 
+    if (ret != 0)
+    {
+        return -1;
+    }
+
     if (config->progress_mode)
     {
         printf("\rSearching k-NN: [========================================] "
                "100.0%% (%ld / %ld frames)\n",
-               N, N);
+               end - begin, end - begin);
         fflush(stdout);
     }
 
-    telemetry->total_queries = (uint64_t)N;
-    telemetry->framedist_calls = global_telem_calls;
-    telemetry->level1_clusters_pruned = global_telem_l1;
-    telemetry->level2_anchors_pruned = global_telem_l2;
-    telemetry->level3_annular_pruned = global_telem_l3;
-    telemetry->temporal_pruned = global_telem_temp;
-    telemetry->total_candidates_considered = global_telem_cand;
+    telemetry->total_queries = (uint64_t)(end - begin);
     telemetry->time_search_ms = (end_time.tv_sec - start_time.tv_sec) * 1000.0 +
                                 (end_time.tv_nsec - start_time.tv_nsec) / 1000000.0;
+    if (telemetry->time_search_ms > 0.0)
+    {
+        telemetry->pairs_per_sec =
+            (double)telemetry->framedist_calls / (telemetry->time_search_ms / 1000.0);
+    }
+
+    return 0;
+}
+
+/**
+ * knn_run_search() - Multi-threaded driver executing k-NN search across all frames.
+ * @config:    Active KnnConfig.
+ * @model:     Active KnnModel.
+ * @results:   Output KnnResults structure to populate.
+ * @telemetry: Output aggregated KnnTelemetry structure.
+ *
+ * Return: 0 on success, -1 on error.
+ */
+int knn_run_search(
+    const KnnConfig *config,
+    const KnnModel  *model,
+    KnnResults      *results,
+    KnnTelemetry    *telemetry)
+{
+    if (config == NULL || model == NULL || results == NULL || telemetry == NULL)
+    {
+        return -1;
+    }
+
+    long N = model->total_dataset_frames;
+    int k = config->k;
+
+    results->indices = (int *)malloc((size_t)N * (size_t)k * sizeof(int));
+    results->distances = (double *)malloc((size_t)N * (size_t)k * sizeof(double));
+
+    if (results->indices == NULL || results->distances == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for results buffer\n");
+        knn_results_free(results);
+        return -1;
+    }
 
+    if (run_range(config, model, 0, N, (N > 0) ? N : 1, results, NULL, NULL, telemetry) != 0)
+    {
+        knn_results_free(results);
+        return -1;
+    }
     return 0;
 }
 
+/**
+ * knn_run_search_range() - Search queries [@begin, @end) with bounded result memory.
+ * @config:    Active KnnConfig.
+ * @model:     Active KnnModel.
+ * @begin:     First query.
+ * @end:       End of the queries (exclusive).
+ * @chunk:     Queries per chunk.
+ * @fn:        Receives the results of each chunk, in query order.
+ * @ctx:       Context of @fn.
+ * @telemetry: Output aggregated KnnTelemetry structure.
+ *
+ * Only @chunk rows of results are held at a time; @fn is expected to write
+ * them out before the next chunk overwrites them.
+ *
+ * Return: 0 on success, -1 on error (including a failure of @fn).
+ */
+int knn_run_search_range(
+    const KnnConfig *config,
+    const KnnModel  *model,
+    long             begin,
+    long             end,
+    long             chunk,
+    KnnChunkFn       fn,
+    void            *ctx,
+    KnnTelemetry    *telemetry)
+{
+    if (config == NULL || model == NULL || fn == NULL || telemetry == NULL
+        || begin < 0 || end > model->total_dataset_frames || chunk <= 0)
+    {
+        return -1;
+    }
+
+    long rows = (end - begin < chunk) ? end - begin : chunk;
+    if (rows < 1)
+    {
+        rows = 1;
+    }
+    KnnResults results;
+    results.indices = (int *)malloc((size_t)rows * (size_t)config->k * sizeof(int));
+    results.distances = (double *)malloc((size_t)rows * (size_t)config->k * sizeof(double));
+    if (results.indices == NULL || results.distances == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for results buffer\n");
+        knn_results_free(&results);
+        return -1;
+    }
+
+    int ret = run_range(config, model, begin, end, rows, &results, fn, ctx, telemetry);
+    knn_results_free(&results);
+    return ret;
+}
+
 /**
  * knn_results_free() - Clean up KnnResults arrays.
  * @results: Pointer to KnnResults.
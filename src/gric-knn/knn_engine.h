@@ -9,12 +9,32 @@
 #include "knn_defs.h"
 #include "knn_reader.h"
 
+/**
+ * Receives the results of queries [begin, end), row i - begin for query i;
+ * returns 0 to go on, non-zero to stop the search.
+ */
+typedef int (*KnnChunkFn)(
+    void             *ctx,
+    const KnnResults *results,
+    long              begin,
+    long              end);
+
 int knn_run_search(
     const KnnConfig *config,
     const KnnModel  *model,
     KnnResults      *results,
     KnnTelemetry    *telemetry);
 
+int knn_run_search_range(
+    const KnnConfig *config,
+    const KnnModel  *model,
+    long             begin,
+    long             end,
+    long             chunk,
+    KnnChunkFn       fn,
+    void            *ctx,
+    KnnTelemetry    *telemetry);
+
 void knn_results_free(
     KnnResults *results);
 
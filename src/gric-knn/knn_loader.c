@@ -5,6 +5,8 @@
 
 #define _POSIX_C_SOURCE 200809L
 #include "knn_loader.h"
+#include "shared/gricbin.h"
+#include "shared/gricres.h"
 #include <ctype.h>
 #include <math.h>
 #include <stdio.h>
@@ -180,6 +182,132 @@ static int parse_membership_file(
     return 0;
 }
 
+/**
+ * load_results_bundle() - Take membership, radii, DCC and anchors from results.gricres.
+ * @path:  Path to results.gricres.
+ * @model: Pointer to KnnModel.
+ *
+ * The bundle stays mapped: the membership column is used in place as
+ * frame_cluster_map, and so are the anchors when the bundle holds them. Cluster
+ * ids, radii and the DCC matrix follow the text loaders (clusters up to the
+ * largest id assigned; radius from the bundle, else the largest member
+ * distance).
+ *
+ * Return: 0 on success, -1 if there is no usable bundle (nothing loaded).
+ */
+static int load_results_bundle(
+    const char *path,
+    KnnModel   *model)
+{
+    if (gricres_open(&model->results, path) != 0)
+    {
+        return -1;
+    }
+    uint64_t nframes = 0;
+    uint64_t ndist = 0;
+    uint64_t ncl = 0;
+    uint64_t ndcc = 0;
+    uint64_t nanchor = 0;
+    const int32_t *memb = gricres_section(&model->results, GRICRES_SEC_MEMBERSHIP, &nframes);
+    const double *dist = gricres_section(&model->results, GRICRES_SEC_DIST, &ndist);
+    const GricResCluster *cls = gricres_section(&model->results, GRICRES_SEC_CLUSTERS, &ncl);
+    const GricResDcc *dcc = gricres_section(&model->results, GRICRES_SEC_DCC, &ndcc);
+    const double *anchors = gricres_section(&model->results, GRICRES_SEC_ANCHORS, &nanchor);
+
+    int max_cluster_id = -1;
+    for (uint64_t f = 0; memb != NULL && f < nframes; f++)
+    {
+        if (memb[f] > max_cluster_id)
+        {
+            max_cluster_id = memb[f];
+        }
+    }
+    if (memb == NULL || dist == NULL || ndist != nframes || max_cluster_id < 0)
+    {
+        gricres_close(&model->results);
+        return -1;
+    }
+
+    int M = max_cluster_id + 1;
+    model->total_dataset_frames = (long)nframes;
+    model->num_clusters = M;
+    model->frame_cluster_map = (int *)memb;
+    model->frame_r_anchor = (float *)malloc((size_t)nframes * sizeof(float));
+    model->clusters = (KnnCluster *)calloc((size_t)M, sizeof(KnnCluster));
+    model->dcc_matrix = (double *)calloc((size_t)M * (size_t)M, sizeof(double));
+    if (model->frame_r_anchor == NULL || model->clusters == NULL || model->dcc_matrix == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for membership metadata\n");
+        return -1;
+    }
+
+    for (uint64_t f = 0; f < nframes; f++)
+    {
+        model->frame_r_anchor[f] = (float)dist[f];
+        if (memb[f] >= 0)
+        {
+            model->clusters[memb[f]].capacity++;
+        }
+    }
+    for (int c = 0; c < M; c++)
+    {
+        KnnCluster *cl = &model->clusters[c];
+        cl->cluster_id = c;
+        cl->members = (MemberMeta *)malloc((size_t)(cl->capacity > 0 ? cl->capacity : 1)
+                                           * sizeof(MemberMeta));
+        if (cl->members == NULL)
+        {
+            return -1;
+        }
+    }
+    for (uint64_t f = 0; f < nframes; f++)
+    {
+        if (memb[f] >= 0)
+        {
+            KnnCluster *cl = &model->clusters[memb[f]];
+            cl->members[cl->num_members].frame_id = (uint32_t)f;
+            cl->members[cl->num_members].r_anchor = model->frame_r_anchor[f];
+            cl->num_members++;
+            if (model->frame_r_anchor[f] > cl->radius)
+            {
+                cl->radius = model->frame_r_anchor[f];
+            }
+        }
+    }
+    for (uint64_t c = 0; cls != NULL && c < ncl && c < (uint64_t)M; c++)
+    {
+        model->clusters[c].radius = cls[c].radius;
+    }
+
+    for (uint64_t e = 0; dcc != NULL && e < ndcc; e++)
+    {
+        int c1 = dcc[e].i;
+        int c2 = dcc[e].j;
+        if (c1 >= 0 && c1 < M && c2 >= 0 && c2 < M)
+        {
+            model->dcc_matrix[c1 * M + c2] = dcc[e].d;
+            model->dcc_matrix[c2 * M + c1] = dcc[e].d;
+        }
+    }
+
+    /* Anchors are used in place (read-only) when the bundle holds all of them */
+    const GricResHeader *hdr = model->results.hdr;
+    uint64_t elements = hdr->frame_width * hdr->frame_height;
+    if (anchors != NULL && elements > 0 && hdr->num_clusters >= (uint64_t)M
+        && nanchor == hdr->num_clusters * elements)
+    {
+        model->frame_width = (long)hdr->frame_width;
+        model->frame_height = (long)hdr->frame_height;
+        model->frame_elements = (long)elements;
+        for (int c = 0; c < M; c++)
+        {
+            model->clusters[c].anchor_data = (double *)(anchors + (size_t)c * elements);
+        }
+        model->anchors_mapped = 1;
+    }
+    return 0;
+}
+
 /**
  * parse_radii_file() - Parse cluster_radii.txt if available.
  * @path:  Path to cluster_radii.txt.
@@ -325,43 +453,32 @@ static int reconstruct_anchors_from_input(
     }
 #endif // USE_CFITSIO
 
-    FILE *f = fopen(input_data_path, "r");
-    if (f == NULL)
-    {
-        return -1;
+    /* ASCII: the .gricbin sidecar if present, else the mapped text (width from the
+     * first non-comment line) */
+    GricBin bin;
+    AsciiMap map;
+    memset(&map, 0, sizeof(map));
+    long elements_detected;
+    long rows;
+    if (gricbin_open(&bin, input_data_path) == 0)
+    {
+        elements_detected = (long)bin.hdr->width;
+        rows = (long)bin.hdr->num_frames;
     }
-
-    char line_buf[65536];
-    long elements_detected = 0;
-    while (fgets(line_buf, sizeof(line_buf), f) != NULL)
+    else
     {
-        if (line_buf[0] == '#' || line_buf[0] == '\n' || line_buf[0] == '\0')
+        if (ascii_map_open(&map, input_data_path, 1) != 0)
         {
-            continue;
+            return -1;
         }
-        char *ptr = line_buf;
-        while (*ptr != '\0')
-        {
-            while (isspace((unsigned char)*ptr))
-            {
-                ptr++;
-            }
-            if (*ptr == '\0')
-            {
-                break;
-            }
-            elements_detected++;
-            while (*ptr != '\0' && !isspace((unsigned char)*ptr))
-            {
-                ptr++;
-            }
-        } // while (*ptr != '\0')
-        break;
-    } // while detecting dimension
+        elements_detected = ascii_map_count_columns(&map, 0);
+        rows = map.num_lines;
+    }
 
     if (elements_detected <= 0)
     {
-        fclose(f);
+        gricbin_close(&bin);
+        ascii_map_close(&map);
         return -1;
     }
 
@@ -369,52 +486,35 @@ static int reconstruct_anchors_from_input(
     model->frame_height = 1;
     model->frame_elements = elements_detected;
 
-    rewind(f);
-    uint64_t *offsets =
-        (uint64_t *)malloc((size_t)model->total_dataset_frames * sizeof(uint64_t));
-    if (offsets == NULL)
-    {
-        fclose(f);
-        return -1;
-    }
-
-    long frame_idx = 0;
-    off_t cur_offset = ftello(f);
-    while (fgets(line_buf, sizeof(line_buf), f) != NULL
-           && frame_idx < model->total_dataset_frames)
-    {
-        if (line_buf[0] != '#' && line_buf[0] != '\n' && line_buf[0] != '\0')
-        {
-            offsets[frame_idx++] = (uint64_t)cur_offset;
-        }
-        cur_offset = ftello(f);
-    }
-
+    int ret = 0;
     for (int c = 0; c < model->num_clusters; c++)
     {
-        model->clusters[c].anchor_data =
-            (double *)malloc((size_t)model->frame_elements * sizeof(double));
-        if (model->clusters[c].anchor_data == NULL)
+        double *anchor = (double *)calloc((size_t)model->frame_elements, sizeof(double));
+        model->clusters[c].anchor_data = anchor;
+        if (anchor == NULL)
         {
-            free(offsets);
-            fclose(f);
-            return -1;
+            ret = -1;
+            break;
         }
         long f_anchor = (model->clusters[c].num_members > 0) ?
                         (long)model->clusters[c].members[0].frame_id : 0;
-        fseeko(f, (off_t)offsets[f_anchor], SEEK_SET);
-        for (long k = 0; k < model->frame_elements; k++)
+        if (f_anchor < 0 || f_anchor >= rows)
         {
-            if (fscanf(f, "%lf", &model->clusters[c].anchor_data[k]) != 1)
-            {
-                model->clusters[c].anchor_data[k] = 0.0;
-            }
+            continue;
+        }
+        if (bin.hdr != NULL)
+        {
+            gricbin_read_row(&bin, f_anchor, anchor);
+        }
+        else
+        {
+            ascii_map_read_line(&map, f_anchor, anchor, model->frame_elements);
         }
     } // for (int c = 0; ...)
 
-    free(offsets);
-    fclose(f);
-    return 0;
+    gricbin_close(&bin);
+    ascii_map_close(&map);
+    return ret;
 }
 
 /**
@@ -562,26 +662,38 @@ int knn_model_load(
     memset(model, 0, sizeof(KnnModel));
     model->is_fits_input = check_is_fits(input_data_path);
 
-    char memb_path[2048];
-    snprintf(memb_path, sizeof(memb_path), "%s/frame_membership.txt", cluster_dir);
-    if (parse_membership_file(memb_path, model) != 0)
+    /* Binary results bundle (-gricres) first, text outputs otherwise */
+    char res_path[2048];
+    snprintf(res_path, sizeof(res_path), "%s/%s", cluster_dir, GRICRES_FILE);
+    if (load_results_bundle(res_path, model) != 0)
     {
-        return -1;
-    }
+        if (model->results.hdr != NULL)
+        {
+            knn_model_free(model);
+            return -1;
+        }
 
-    char radii_path[2048];
-    snprintf(radii_path, sizeof(radii_path), "%s/cluster_radii.txt", cluster_dir);
-    parse_radii_file(radii_path, model);
+        char memb_path[2048];
+        snprintf(memb_path, sizeof(memb_path), "%s/frame_membership.txt", cluster_dir);
+        if (parse_membership_file(memb_path, model) != 0)
+        {
+            return -1;
+        }
 
-    char dcc_path[2048];
-    snprintf(dcc_path, sizeof(dcc_path), "%s/dcc.txt", cluster_dir);
-    if (parse_dcc_file(dcc_path, model) != 0)
-    {
-        knn_model_free(model);
-        return -1;
+        char radii_path[2048];
+        snprintf(radii_path, sizeof(radii_path), "%s/cluster_radii.txt", cluster_dir);
+        parse_radii_file(radii_path, model);
+
+        char dcc_path[2048];
+        snprintf(dcc_path, sizeof(dcc_path), "%s/dcc.txt", cluster_dir);
+        if (parse_dcc_file(dcc_path, model) != 0)
+        {
+            knn_model_free(model);
+            return -1;
+        }
     }
 
-    if (load_anchors(cluster_dir, input_data_path, model) != 0)
+    if (!model->anchors_mapped && load_anchors(cluster_dir, input_data_path, model) != 0)
     {
         knn_model_free(model);
         return -1;
@@ -606,7 +718,7 @@ void knn_model_free(
     {
         for (int c = 0; c < model->num_clusters; c++)
         {
-            if (model->clusters[c].anchor_data != NULL)
+            if (model->clusters[c].anchor_data != NULL && !model->anchors_mapped)
             {
                 free(model->clusters[c].anchor_data);
                 model->clusters[c].anchor_data = NULL;
@@ -627,15 +739,18 @@ void knn_model_free(
         model->dcc_matrix = NULL;
     }
 
-    if (model->frame_cluster_map != NULL)
+    if (model->frame_cluster_map != NULL && model->results.hdr == NULL)
     {
         free(model->frame_cluster_map);
-        model->frame_cluster_map = NULL;
     }
+    model->frame_cluster_map = NULL;
 
     if (model->frame_r_anchor != NULL)
     {
         free(model->frame_r_anchor);
         model->frame_r_anchor = NULL;
     }
+
+    gricres_close(&model->results);
+    model->anchors_mapped = 0;
 }
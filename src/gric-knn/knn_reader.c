@@ -40,55 +40,37 @@ static int check_is_fits_path(
 }
 
 /**
- * build_ascii_index() - Build 64-bit line offset seek table for ASCII files.
+ * map_ascii_dataset() - Map the .gricbin sidecar, or the ASCII file and its line index.
  * @reader: Pointer to KnnFrameReader.
  *
+ * A sidecar is used only if its rows have the expected width and cover all
+ * frames. Comment and empty lines of the text file are not indexed.
+ *
  * Return: 0 on success, -1 on error.
  */
-static int build_ascii_index(
+static int map_ascii_dataset(
     KnnFrameReader *reader)
 {
-    FILE *f = fopen(reader->input_path, "r");
-    if (f == NULL)
+    if (gricbin_open(&reader->bin, reader->input_path) == 0)
     {
-        fprintf(stderr, "Error: Could not open ASCII dataset '%s'\n", reader->input_path);
-        return -1;
+        if ((long)reader->bin.hdr->width == reader->frame_elements
+            && (long)reader->bin.hdr->num_frames >= reader->total_frames)
+        {
+            return 0;
+        }
+        gricbin_close(&reader->bin);
     }
 
-    reader->line_offsets = (uint64_t *)malloc((size_t)reader->total_frames * sizeof(uint64_t));
-    if (reader->line_offsets == NULL)
+    if (ascii_map_open(&reader->ascii, reader->input_path, 1) != 0)
     {
-        fclose(f);
+        fprintf(stderr, "Error: Could not open ASCII dataset '%s'\n", reader->input_path);
         return -1;
     }
-
-    char line_buf[65536];
-    long frame_idx = 0;
-    off_t offset = ftello(f);
-
-    while (fgets(line_buf, sizeof(line_buf), f) != NULL && frame_idx < reader->total_frames)
-    {
-        if (line_buf[0] != '#' && line_buf[0] != '\n' && line_buf[0] != '\0')
-        {
-            reader->line_offsets[frame_idx++] = (uint64_t)offset;
-        }
-        offset = ftello(f);
-    } // while indexing
-
-    fclose(f);
-
-    if (frame_idx < reader->total_frames)
+    if (reader->ascii.num_lines < reader->total_frames)
     {
         fprintf(stderr, "Warning: Expected %ld ASCII frames, indexed %ld\n",
-                reader->total_frames, frame_idx);
+                reader->total_frames, reader->ascii.num_lines);
     }
-
-    reader->ascii_file = fopen(reader->input_path, "r");
-    if (reader->ascii_file == NULL)
-    {
-        return -1;
-    }
-
     return 0;
 }
 
@@ -141,7 +123,7 @@ int knn_reader_open(
     }
     else
     {
-        return build_ascii_index(reader);
+        return map_ascii_dataset(reader);
     }
 }
 
@@ -161,9 +143,9 @@ int knn_reader_clone_thread(
         return -1;
     }
 
+    /* ASCII clones share the read-only mapping; only knn_reader_close() unmaps it */
     memcpy(dst, src, sizeof(KnnFrameReader));
     dst->input_path = strdup(src->input_path);
-    dst->ascii_file = NULL;
 
     if (src->is_fits)
     {
@@ -182,14 +164,6 @@ int knn_reader_clone_thread(
         }
 #endif
     }
-    else
-    {
-        dst->ascii_file = fopen(dst->input_path, "r");
-        if (dst->ascii_file == NULL)
-        {
-            return -1;
-        }
-    }
 
     return 0;
 }
@@ -226,23 +200,16 @@ int knn_reader_read_frame(
     }
     else
     {
-        if (reader->ascii_file == NULL || reader->line_offsets == NULL)
+        if (reader->bin.hdr != NULL)
         {
-            return -1;
+            gricbin_read_row(&reader->bin, frame_id, out_data);
+            return 0;
         }
 
-        off_t offset = (off_t)reader->line_offsets[frame_id];
-        if (fseeko(reader->ascii_file, offset, SEEK_SET) != 0)
+        long n = ascii_map_read_line(&reader->ascii, frame_id, out_data, reader->frame_elements);
+        for (long k = n; k < reader->frame_elements; k++)
         {
-            return -1;
-        }
-
-        for (long k = 0; k < reader->frame_elements; k++)
-        {
-            if (fscanf(reader->ascii_file, "%lf", &out_data[k]) != 1)
-            {
-                out_data[k] = 0.0;
-            }
+            out_data[k] = 0.0;
         }
         return 0;
     }
@@ -276,14 +243,6 @@ void knn_reader_close_thread(
         }
 #endif
     }
-    else
-    {
-        if (reader->ascii_file != NULL)
-        {
-            fclose(reader->ascii_file);
-            reader->ascii_file = NULL;
-        }
-    }
 
     if (reader->input_path != NULL)
     {
@@ -306,9 +265,6 @@ void knn_reader_close(
 
     knn_reader_close_thread(reader);
 
-    if (reader->line_offsets != NULL)
-    {
-        free(reader->line_offsets);
-        reader->line_offsets = NULL;
-    }
+    ascii_map_close(&reader->ascii);
+    gricbin_close(&reader->bin);
 }
@@ -7,6 +7,7 @@
  */
 
 #include "knn_defs.h"
+#include "shared/gricbin.h"
 
 #ifdef USE_CFITSIO
 #include <fitsio.h>
@@ -21,8 +22,8 @@ typedef struct
     long       frame_width;
     long       frame_height;
     long       frame_elements;
-    uint64_t  *line_offsets; /**< 64-bit file byte offsets for ASCII lines */
-    FILE      *ascii_file;
+    AsciiMap   ascii;        /**< Mapped ASCII dataset and line index (shared by clones) */
+    GricBin    bin;          /**< Mapped .gricbin sidecar, used instead of the text if valid */
 #ifdef USE_CFITSIO
     fitsfile  *fits_ptr;
 #endif
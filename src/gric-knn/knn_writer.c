@@ -1,19 +1,181 @@
 /**
  * @file knn_writer.c
  * @brief Output serialization for gric-knn results into FITS or ASCII formats.
+ *
+ * Query ranges (-shard, -query-range) are written as text chunk by chunk.
+ * After each chunk the output is synced and a checkpoint records the next
+ * query and the output size, so an interrupted range resumes where its last
+ * chunk ended. Range outputs are joined with knn_merge_outputs() (-merge).
+ *
+ * Text outputs carry a "# run:" header line naming the input, the model and
+ * the search options the rows depend on; checkpoints and merges require it
+ * to match, so rows of different runs are never joined.
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include "knn_writer.h"
+#include <inttypes.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <unistd.h>
 
 #ifdef USE_CFITSIO
 #include <fitsio.h>
 #endif
 
+/** FNV-1a 64-bit offset basis */
+#define KNN_FNV_OFFSET 14695981039346656037ULL
+/** FNV-1a 64-bit prime */
+#define KNN_FNV_PRIME 1099511628211ULL
+/** Bytes of the input digested at each end of the file */
+#define KNN_INPUT_SAMPLE 65536
+
+/**
+ * fnv1a() - Extend an FNV-1a 64-bit hash with @n bytes.
+ * @h:    Hash so far (KNN_FNV_OFFSET to start).
+ * @data: Bytes to add.
+ * @n:    Number of bytes.
+ *
+ * Return: Updated hash.
+ */
+static uint64_t fnv1a(
+    uint64_t    h,
+    const void *data,
+    size_t      n)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t ii = 0; ii < n; ii++)
+    {
+        h = (h ^ p[ii]) * KNN_FNV_PRIME;
+    }
+    return h;
+}
+
+/**
+ * model_digest() - Hash of the cluster model the search ran against.
+ * @model: Active KnnModel.
+ *
+ * Covers the frame memberships, their anchor distances and the anchors, so
+ * the same clustering gives the same digest wherever its files are.
+ *
+ * Return: Digest.
+ */
+static uint64_t model_digest(
+    const KnnModel *model)
+{
+    size_t N = (size_t)model->total_dataset_frames;
+    uint64_t h = fnv1a(KNN_FNV_OFFSET, model->frame_cluster_map, N * sizeof(int));
+    h = fnv1a(h, model->frame_r_anchor, N * sizeof(float));
+    for (int c = 0; c < model->num_clusters; c++)
+    {
+        h = fnv1a(h, model->clusters[c].anchor_data,
+                  (size_t)model->frame_elements * sizeof(double));
+    }
+    return h;
+}
+
+/**
+ * input_digest() - Size and hash of the input dataset file.
+ * @path:   Input path.
+ * @size:   Output: file size in bytes, -1 if unreadable.
+ * @digest: Output: hash of the first and last KNN_INPUT_SAMPLE bytes.
+ *
+ * Cheap enough for any input size; it catches a replaced or regenerated
+ * dataset, not a change in the middle of an otherwise identical file.
+ */
+static void input_digest(
+    const char *path,
+    long       *size,
+    uint64_t   *digest)
+{
+    *size = -1;
+    *digest = KNN_FNV_OFFSET;
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        return;
+    }
+    char *buf = (char *)malloc(KNN_INPUT_SAMPLE);
+    if (buf != NULL && fseek(f, 0, SEEK_END) == 0)
+    {
+        *size = ftell(f);
+        long tail = (*size > KNN_INPUT_SAMPLE) ? *size - KNN_INPUT_SAMPLE : 0;
+        size_t n;
+        rewind(f);
+        n = fread(buf, 1, KNN_INPUT_SAMPLE, f);
+        *digest = fnv1a(*digest, buf, n);
+        if (tail > 0 && fseek(f, tail, SEEK_SET) == 0)
+        {
+            n = fread(buf, 1, KNN_INPUT_SAMPLE, f);
+            *digest = fnv1a(*digest, buf, n);
+        }
+    }
+    free(buf);
+    fclose(f);
+}
+
+/**
+ * knn_run_identity() - Describe the input, model and search options of a run.
+ * @config: Active KnnConfig.
+ * @model:  Active KnnModel.
+ * @buf:    Output line, without newline.
+ * @size:   Capacity of @buf.
+ *
+ * Outputs with the same identity hold rows of the same search and may be
+ * resumed or merged together; the query range is not part of it.
+ */
+static void knn_run_identity(
+    const KnnConfig *config,
+    const KnnModel  *model,
+    char            *buf,
+    size_t           size)
+{
+    long input_size;
+    uint64_t input_hash;
+    input_digest(config->input_data_path, &input_size, &input_hash);
+    snprintf(buf, size,
+             "input %ld:%016" PRIx64 " model %d:%016" PRIx64 " frames %ld k %d dtmin %d "
+             "past %d future %d eps %.17g rlim %.17g",
+             input_size, input_hash, model->num_clusters, model_digest(model),
+             model->total_dataset_frames, config->k, config->min_temporal_sep,
+             config->past_only, config->future_only, config->epsilon, config->rlim_cutoff);
+}
+
+/**
+ * write_ascii_row() - Write the neighbors of one query as a text row.
+ * @f:         Output stream.
+ * @query:     Query frame.
+ * @k:         Neighbors per row.
+ * @indices:   Neighbor frames (negative if missing).
+ * @distances: Neighbor distances (NaN if missing).
+ */
+static void write_ascii_row(
+    FILE         *f,
+    long          query,
+    int           k,
+    const int    *indices,
+    const double *distances)
+{
+    fprintf(f, "%-8ld", query);
+    for (int j = 0; j < k; j++)
+    {
+        int n_id = indices[j];
+        double d = distances[j];
+        if (n_id < 0 || isnan(d))
+        {
+            fprintf(f, "  %-8d %12.6f", -1, -1.0);
+        }
+        else
+        {
+            fprintf(f, "  %-8d %12.6f", n_id, d);
+        }
+    }
+    fprintf(f, "\n");
+}
+
 /**
  * write_ascii_results() - Write results as formatted ASCII table.
  * @path:    Output filename.
@@ -36,8 +198,11 @@ static int write_ascii_results(
         return -1;
     }
 
+    char run[KNN_RUN_MAX];
+    knn_run_identity(config, model, run, sizeof(run));
     fprintf(f, "# gric-knn results: k = %d, total_queries = %ld\n",
             config->k, model->total_dataset_frames);
+    fprintf(f, "# run: %s\n", run);
     fprintf(f, "# Columns: query_frame_id  [neighbor_1 dist_1  neighbor_2 dist_2 ...]\n");
 
     long N = model->total_dataset_frames;
@@ -45,22 +210,8 @@ static int write_ascii_results(
 
     for (long i = 0; i < N; i++)
     {
-        fprintf(f, "%-8ld", i);
-        for (int j = 0; j < k; j++)
-        {
-            int n_id = results->indices[i * k + j];
-            double d = results->distances[i * k + j];
-            if (n_id < 0 || isnan(d))
-            {
-                fprintf(f, "  %-8d %12.6f", -1, -1.0);
-            }
-            else
-            {
-                fprintf(f, "  %-8d %12.6f", n_id, d);
-            }
-        }
-        fprintf(f, "\n");
-    } // for (long i = 0; ...)
+        write_ascii_row(f, i, k, &results->indices[i * k], &results->distances[i * k]);
+    }
 
     fclose(f);
     return 0;
@@ -216,3 +367,418 @@ int knn_write_results(
         return write_ascii_results(final_out_path, config, model, results);
     }
 }
+
+/**
+ * write_checkpoint() - Record that the rows before w->next are in the output.
+ * @w:      Range writer.
+ * @offset: Output size after those rows.
+ *
+ * Written to a temporary file then renamed, so a checkpoint is either the
+ * previous one or the new one, never a partial one.
+ *
+ * Return: 0 on success, -1 on error.
+ */
+static int write_checkpoint(
+    const KnnStreamWriter *w,
+    long                   offset)
+{
+    char tmp[2100];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", w->ckpt);
+    FILE *f = fopen(tmp, "w");
+    if (f == NULL)
+    {
+        fprintf(stderr, "Error: Could not write checkpoint '%s'\n", tmp);
+        return -1;
+    }
+    fprintf(f, "# gric-knn checkpoint\n%s\nnext %ld offset %ld\n", w->options, w->next, offset);
+    int ok = (fflush(f) == 0 && fsync(fileno(f)) == 0);
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp, w->ckpt) != 0)
+    {
+        fprintf(stderr, "Error: Could not write checkpoint '%s'\n", w->ckpt);
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * read_checkpoint() - Load the checkpoint of a range, if there is one.
+ * @w:      Range writer (paths and options set).
+ * @next:   First query not yet written.
+ * @offset: Output size after the written rows.
+ *
+ * Return: 1 if found, 0 if there is none, -1 if it is unreadable or was
+ * written for another range, input, model or search options.
+ */
+static int read_checkpoint(
+    const KnnStreamWriter *w,
+    long                  *next,
+    long                  *offset)
+{
+    FILE *f = fopen(w->ckpt, "r");
+    if (f == NULL)
+    {
+        return 0;
+    }
+    char head[64];
+    char options[sizeof(w->options) + 2];
+    char line[128];
+    int ok = (fgets(head, sizeof(head), f) != NULL
+              && fgets(options, sizeof(options), f) != NULL
+              && fgets(line, sizeof(line), f) != NULL
+              && sscanf(line, "next %ld offset %ld", next, offset) == 2);
+    fclose(f);
+    if (!ok)
+    {
+        fprintf(stderr, "Error: Unreadable checkpoint '%s'\n", w->ckpt);
+        return -1;
+    }
+    options[strcspn(options, "\n")] = '\0';
+    if (strcmp(options, w->options) != 0)
+    {
+        fprintf(stderr, "Error: Checkpoint '%s' is for another run:\n  %s\n"
+                "Remove it to start this range over.\n", w->ckpt, options);
+        return -1;
+    }
+    return 1;
+}
+
+/**
+ * knn_stream_open() - Open the output of queries [@begin, @end).
+ * @w:      Range writer to initialize.
+ * @config: Active KnnConfig.
+ * @model:  Active KnnModel.
+ * @begin:  First query of the range.
+ * @end:    End of the range (exclusive).
+ *
+ * The output defaults to <cluster_dir>/knn_results.<begin>-<end>.txt. If its
+ * checkpoint exists and matches the range and run identity, the output is
+ * cut back to the checkpointed size (dropping rows of an unfinished chunk)
+ * and w->next is the first query after them.
+ *
+ * Return: 0 on success, -1 on error.
+ */
+int knn_stream_open(
+    KnnStreamWriter *w,
+    const KnnConfig *config,
+    const KnnModel  *model,
+    long             begin,
+    long             end)
+{
+    memset(w, 0, sizeof(*w));
+    w->begin = begin;
+    w->end = end;
+    w->next = begin;
+    w->k = config->k;
+    if (config->output_path != NULL)
+    {
+        snprintf(w->path, sizeof(w->path), "%s", config->output_path);
+    }
+    else
+    {
+        snprintf(w->path, sizeof(w->path), "%s/knn_results.%ld-%ld.txt",
+                 config->cluster_dir, begin, end);
+    }
+    snprintf(w->ckpt, sizeof(w->ckpt), "%s%s", w->path, KNN_CHECKPOINT_SUFFIX);
+    knn_run_identity(config, model, w->run, sizeof(w->run));
+    snprintf(w->options, sizeof(w->options), "%s range %ld:%ld", w->run, begin, end);
+
+    long next = begin;
+    long offset = 0;
+    int found = read_checkpoint(w, &next, &offset);
+    if (found < 0)
+    {
+        return -1;
+    }
+    if (found)
+    {
+        w->f = fopen(w->path, "r+");
+        if (w->f == NULL)
+        {
+            fprintf(stderr, "Error: Checkpoint '%s' has no output '%s'; remove it to restart\n",
+                    w->ckpt, w->path);
+            return -1;
+        }
+        if (fseek(w->f, 0, SEEK_END) != 0 || ftell(w->f) < offset
+            || ftruncate(fileno(w->f), (off_t)offset) != 0 || fseek(w->f, 0, SEEK_END) != 0)
+        {
+            fprintf(stderr, "Error: Output '%s' is shorter than its checkpoint\n", w->path);
+            fclose(w->f);
+            w->f = NULL;
+            return -1;
+        }
+        w->next = next;
+        return 0;
+    }
+
+    w->f = fopen(w->path, "w");
+    if (w->f == NULL)
+    {
+        fprintf(stderr, "Error: Could not open output file '%s' for writing\n", w->path);
+        return -1;
+    }
+    fprintf(w->f, "# gric-knn results: k = %d, queries = %ld:%ld of %ld\n",
+            config->k, begin, end, model->total_dataset_frames);
+    fprintf(w->f, "# run: %s\n", w->run);
+    fprintf(w->f, "# Columns: query_frame_id  [neighbor_1 dist_1  neighbor_2 dist_2 ...]\n");
+    if (fflush(w->f) != 0 || write_checkpoint(w, ftell(w->f)) != 0)
+    {
+        fclose(w->f);
+        w->f = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * knn_stream_write() - Append the rows of queries [@begin, @end) and checkpoint them.
+ * @w:       Range writer.
+ * @results: Rows of the queries, row i - @begin for query i.
+ * @begin:   First query (w->next).
+ * @end:     End of the queries (exclusive).
+ *
+ * The rows are synced to disk before the checkpoint moves past them.
+ *
+ * Return: 0 on success, -1 on error.
+ */
+int knn_stream_write(
+    KnnStreamWriter  *w,
+    const KnnResults *results,
+    long              begin,
+    long              end)
+{
+    if (w->f == NULL || begin != w->next)
+    {
+        return -1;
+    }
+    for (long i = begin; i < end; i++)
+    {
+        size_t row = (size_t)(i - begin) * (size_t)w->k;
+        write_ascii_row(w->f, i, w->k, &results->indices[row], &results->distances[row]);
+    }
+    if (fflush(w->f) != 0 || fsync(fileno(w->f)) != 0)
+    {
+        fprintf(stderr, "Error: Could not write output file '%s'\n", w->path);
+        return -1;
+    }
+    w->next = end;
+    return write_checkpoint(w, ftell(w->f));
+}
+
+/**
+ * knn_stream_close() - Close the output of a range.
+ * @w: Range writer.
+ */
+void knn_stream_close(
+    KnnStreamWriter *w)
+{
+    if (w->f != NULL)
+    {
+        fclose(w->f);
+        w->f = NULL;
+    }
+}
+
+/** Range output being merged */
+typedef struct
+{
+    const char *path;
+    FILE       *f;
+    int         k;
+    long        begin;
+    long        end;
+    long        total;
+    char        run[KNN_RUN_MAX]; /**< Run identity from the header */
+} KnnMergePart;
+
+/**
+ * compare_merge_parts() - Sort range outputs by first query.
+ * @a: Pointer to first KnnMergePart.
+ * @b: Pointer to second KnnMergePart.
+ *
+ * Return: Negative if a starts first.
+ */
+static int compare_merge_parts(
+    const void *a,
+    const void *b)
+{
+    long ba = ((const KnnMergePart *)a)->begin;
+    long bb = ((const KnnMergePart *)b)->begin;
+    return (ba > bb) - (ba < bb);
+}
+
+/**
+ * open_merge_part() - Open a range output and read its range and run from the header.
+ * @part: Part with path set.
+ *
+ * Outputs of whole runs (total_queries header) are taken as range 0:N.
+ * Outputs without a run line cannot be checked against the others and are
+ * refused.
+ *
+ * Return: 0 on success, -1 on error.
+ */
+static int open_merge_part(
+    KnnMergePart *part)
+{
+    char line[256];
+    part->f = fopen(part->path, "r");
+    if (part->f == NULL || fgets(line, sizeof(line), part->f) == NULL)
+    {
+        fprintf(stderr, "Error: Could not read '%s'\n", part->path);
+        return -1;
+    }
+    if (sscanf(line, "# gric-knn results: k = %d, total_queries = %ld",
+               &part->k, &part->total) == 2)
+    {
+        part->begin = 0;
+        part->end = part->total;
+    }
+    else if (sscanf(line, "# gric-knn results: k = %d, queries = %ld:%ld of %ld",
+                    &part->k, &part->begin, &part->end, &part->total) != 4)
+    {
+        fprintf(stderr, "Error: '%s' is not a gric-knn text output\n", part->path);
+        return -1;
+    }
+    if (fgets(part->run, sizeof(part->run), part->f) == NULL
+        || strncmp(part->run, "# run: ", 7) != 0)
+    {
+        fprintf(stderr, "Error: '%s' has no run line; rerun it with this gric-knn to merge it\n",
+                part->path);
+        return -1;
+    }
+    memmove(part->run, part->run + 7, strlen(part->run + 7) + 1);
+    part->run[strcspn(part->run, "\n")] = '\0';
+    return 0;
+}
+
+/**
+ * knn_merge_outputs() - Merge query range outputs into one file.
+ * @out_path:   Merged output.
+ * @inputs:     Range outputs, in any order.
+ * @num_inputs: Number of inputs.
+ *
+ * Every input must hold one row per query of its range, in order; an
+ * interrupted range is reported rather than merged. All inputs must have
+ * the same run line (input, model and search options). The merged file is
+ * written under @out_path.tmp and renamed once complete.
+ *
+ * Return: 0 on success, -1 on error.
+ */
+int knn_merge_outputs(
+    const char *out_path,
+    char      **inputs,
+    int         num_inputs)
+{
+    KnnMergePart *parts = (KnnMergePart *)calloc((size_t)num_inputs, sizeof(KnnMergePart));
+    if (parts == NULL || num_inputs < 1)
+    {
+        free(parts);
+        return -1;
+    }
+    int err = 0;
+    for (int ii = 0; ii < num_inputs && !err; ii++)
+    {
+        parts[ii].path = inputs[ii];
+        err = open_merge_part(&parts[ii]);
+    }
+    if (!err)
+    {
+        qsort(parts, (size_t)num_inputs, sizeof(KnnMergePart), compare_merge_parts);
+    }
+    for (int ii = 1; ii < num_inputs && !err; ii++)
+    {
+        if (parts[ii].k != parts[0].k || parts[ii].total != parts[0].total
+            || strcmp(parts[ii].run, parts[0].run) != 0)
+        {
+            fprintf(stderr, "Error: '%s' and '%s' are outputs of different runs:\n  %s\n  %s\n",
+                    parts[0].path, parts[ii].path, parts[0].run, parts[ii].run);
+            err = -1;
+        }
+        else if (parts[ii].begin != parts[ii - 1].end)
+        {
+            fprintf(stderr, "Error: '%s' ends at query %ld but '%s' starts at %ld\n",
+                    parts[ii - 1].path, parts[ii - 1].end, parts[ii].path, parts[ii].begin);
+            err = -1;
+        }
+    }
+
+    char tmp[2100];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", out_path);
+    FILE *out = NULL;
+    if (!err)
+    {
+        out = fopen(tmp, "w");
+        if (out == NULL)
+        {
+            fprintf(stderr, "Error: Could not open output file '%s' for writing\n", tmp);
+            err = -1;
+        }
+    }
+    if (!err)
+    {
+        long begin = parts[0].begin;
+        long end = parts[num_inputs - 1].end;
+        if (begin == 0 && end == parts[0].total)
+        {
+            fprintf(out, "# gric-knn results: k = %d, total_queries = %ld\n",
+                    parts[0].k, parts[0].total);
+        }
+        else
+        {
+            fprintf(out, "# gric-knn results: k = %d, queries = %ld:%ld of %ld\n",
+                    parts[0].k, begin, end, parts[0].total);
+        }
+        fprintf(out, "# run: %s\n", parts[0].run);
+        fprintf(out, "# Columns: query_frame_id  [neighbor_1 dist_1  neighbor_2 dist_2 ...]\n");
+    }
+
+    char *line = NULL;
+    size_t cap = 0;
+    for (int ii = 0; ii < num_inputs && !err; ii++)
+    {
+        long expect = parts[ii].begin;
+        ssize_t len;
+        while ((len = getline(&line, &cap, parts[ii].f)) > 0)
+        {
+            if (line[0] == '#')
+            {
+                continue;
+            }
+            if (line[len - 1] != '\n' || expect >= parts[ii].end
+                || strtol(line, NULL, 10) != expect)
+            {
+                break;
+            }
+            fwrite(line, 1, (size_t)len, out);
+            expect++;
+        }
+        if (expect != parts[ii].end)
+        {
+            fprintf(stderr, "Error: '%s' holds queries %ld to %ld of %ld:%ld "
+                    "(unfinished range?)\n", parts[ii].path, parts[ii].begin, expect - 1,
+                    parts[ii].begin, parts[ii].end);
+            err = -1;
+        }
+    } // for (int ii = 0; ...)
+    free(line);
+
+    for (int ii = 0; ii < num_inputs; ii++)
+    {
+        if (parts[ii].f != NULL)
+        {
+            fclose(parts[ii].f);
+        }
+    }
+    free(parts);
+    if (out != NULL)
+    {
+        err = (fclose(out) != 0) ? -1 : err;
+        if (err || rename(tmp, out_path) != 0)
+        {
+            remove(tmp);
+            err = -1;
+        }
+    }
+    return err ? -1 : 0;
+}
@@ -8,9 +8,70 @@
 
 #include "knn_defs.h"
 
+/** Checkpoint file suffix appended to the output path of a query range. */
+#define KNN_CHECKPOINT_SUFFIX ".ckpt"
+
+/** Capacity of a run identity line (input, model and search options). */
+#define KNN_RUN_MAX 384
+
+/** Query range written chunk by chunk, with a checkpoint after each chunk. */
+typedef struct
+{
+    FILE *f;                /**< Output text file */
+    char  path[2048];       /**< Output path */
+    char  ckpt[2080];       /**< Checkpoint path */
+    char  run[KNN_RUN_MAX]; /**< Input, model and search options the rows depend on */
+    char  options[512];     /**< Run identity and range, as in the checkpoint */
+    long  begin;            /**< First query of the range */
+    long  end;              /**< End of the range (exclusive) */
+    long  next;             /**< First query not yet written */
+    int   k;                /**< Neighbors per row */
+} KnnStreamWriter;
+
 int knn_write_results(
     const KnnConfig  *config,
     const KnnModel   *model,
     const KnnResults *results);
 
+/**
+ * @brief Open the output of queries [@begin, @end), resuming from its checkpoint.
+ *
+ * Returns 0 on success with w->next set to the first query left to search
+ * (w->end if the range is complete), -1 on error.
+ */
+int knn_stream_open(
+    KnnStreamWriter *w,
+    const KnnConfig *config,
+    const KnnModel  *model,
+    long             begin,
+    long             end);
+
+/**
+ * @brief Append the rows of queries [@begin, @end) (row i - @begin of @results)
+ *        and checkpoint them; returns 0 on success, -1 on error.
+ */
+int knn_stream_write(
+    KnnStreamWriter  *w,
+    const KnnResults *results,
+    long              begin,
+    long              end);
+
+/**
+ * @brief Close the output (the checkpoint stays to mark the range done).
+ */
+void knn_stream_close(
+    KnnStreamWriter *w);
+
+/**
+ * @brief Merge the query range outputs @inputs into @out_path.
+ *
+ * The ranges must follow each other without gap or overlap once sorted.
+ * When they cover every frame the result is the output of a single run.
+ * Returns 0 on success, -1 on error.
+ */
+int knn_merge_outputs(
+    const char *out_path,
+    char      **inputs,
+    int         num_inputs);
+
 #endif // KNN_WRITER_H
@@ -9,15 +9,51 @@
 #include "knn_loader.h"
 #include "knn_writer.h"
 #include "shared/cli_colors.h"
+#include "shared/dist_kernels.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+/** Default queries per written chunk and checkpoint of a query range */
+#define KNN_CHUNK_DEFAULT 262144
+
 static void print_usage(
     const char *progname)
 {
     fprintf(stderr, "Usage: %s <input_data> <cluster_dir> [options]\n", progname);
+    fprintf(stderr, "       %s -merge <output> <range_output>...\n", progname);
+}
+
+/** Range output and write-time total handed to each chunk of a query range */
+typedef struct
+{
+    KnnStreamWriter *writer;
+    double           write_ms;
+} StreamCtx;
+
+/**
+ * stream_chunk() - Write and checkpoint one chunk of a query range (KnnChunkFn).
+ * @ctx:     StreamCtx.
+ * @results: Rows of the chunk.
+ * @begin:   First query of the chunk.
+ * @end:     End of the chunk (exclusive).
+ *
+ * Return: 0 on success, -1 on write error.
+ */
+static int stream_chunk(
+    void             *ctx,
+    const KnnResults *results,
+    long              begin,
+    long              end)
+{
+    StreamCtx *sc = (StreamCtx *)ctx;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int ret = knn_stream_write(sc->writer, results, begin, end);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    sc->write_ms += (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1000000.0;
+    return ret;
 }
 
 static void print_help(
@@ -68,6 +104,23 @@ static void print_help(
            "(%sdefault:%s all CPU cores)\n",
            ansi_color_green, ansi_reset, ansi_color_magenta, ansi_reset,
            ansi_color_cyan, ansi_reset);
+    printf("  %s-blockmem%s %s<MiB>%s       Search cluster by cluster through a block cache "
+           "(%sdefault:%s 0 = per query)\n",
+           ansi_color_green, ansi_reset, ansi_color_magenta, ansi_reset,
+           ansi_color_cyan, ansi_reset);
+    printf("                        Bounds cached member frames plus dot-product tiles, "
+           "summed over threads\n");
+    printf("  %s-shard%s %s<i/n>%s          Search shard i of n (0-based): queries "
+           "[i*N/n, (i+1)*N/n)\n",
+           ansi_color_green, ansi_reset, ansi_color_magenta, ansi_reset);
+    printf("  %s-query-range%s %s<a:b>%s    Search queries a to b-1 only\n",
+           ansi_color_green, ansi_reset, ansi_color_magenta, ansi_reset);
+    printf("  %s-chunk%s %s<int>%s          Queries per written chunk and checkpoint of a "
+           "range (%sdefault:%s %d)\n",
+           ansi_color_green, ansi_reset, ansi_color_magenta, ansi_reset,
+           ansi_color_cyan, ansi_reset, KNN_CHUNK_DEFAULT);
+    printf("  %s-merge%s %s<out> <files>%s  Merge range outputs into one file, then exit\n",
+           ansi_color_green, ansi_reset, ansi_color_magenta, ansi_reset);
     printf("  %s-fits%s                 Force FITS output format\n",
            ansi_color_green, ansi_reset);
     printf("  %s-txt%s                  Force ASCII text output format\n",
@@ -82,8 +135,20 @@ static void print_help(
     printf("%sEXAMPLES%s\n", ansi_bold_cyan, ansi_reset);
     printf("  %s$%s %s%s%s dataset.fits cluster_out/ -k 10 -dtmin 5\n",
            ansi_color_grey, ansi_reset, ansi_bold_green, progname, ansi_reset);
-    printf("  %s$%s %s%s%s spiral.txt cluster_out/ -k 20 -eps 0.05 -progress\n\n",
+    printf("  %s$%s %s%s%s spiral.txt cluster_out/ -k 20 -eps 0.05 -progress\n",
+           ansi_color_grey, ansi_reset, ansi_bold_green, progname, ansi_reset);
+    printf("  %s$%s %s%s%s cube.fits cluster_out/ -k 10 -shard 0/4 -blockmem 4096\n",
            ansi_color_grey, ansi_reset, ansi_bold_green, progname, ansi_reset);
+    printf("  %s$%s %s%s%s -merge knn.txt cluster_out/knn_results.*-*.txt\n\n",
+           ansi_color_grey, ansi_reset, ansi_bold_green, progname, ansi_reset);
+    printf("%sQUERY RANGES%s\n", ansi_bold_cyan, ansi_reset);
+    printf("  With -shard or -query-range only part of the queries is searched (every\n");
+    printf("  frame remains a candidate). Rows are written as text to\n");
+    printf("  <cluster_dir>/knn_results.<a>-<b>.txt (or -o) one chunk at a time, so\n");
+    printf("  result memory stays bounded, and a checkpoint (<output>%s) is updated\n",
+           KNN_CHECKPOINT_SUFFIX);
+    printf("  after each chunk. Rerunning the same command resumes after the last\n");
+    printf("  checkpointed chunk. -merge joins the range outputs.\n\n");
     cli_print_color_mode();
 }
 
@@ -92,6 +157,7 @@ int main(
     char *argv[])
 {
     cli_colors_init();
+    dist_kernels_init();
 
     KnnConfig config;
     memset(&config, 0, sizeof(KnnConfig));
@@ -100,6 +166,25 @@ int main(
     config.output_format = KNN_FORMAT_AUTO;
     config.progress_mode = 0;
     config.verbose_level = 1;
+    config.query_end = -1;
+    config.chunk_frames = KNN_CHUNK_DEFAULT;
+
+    if (argc >= 2 && strcmp(argv[1], "-merge") == 0)
+    {
+        if (argc < 4)
+        {
+            fprintf(stderr, "Error: -merge requires an output and at least one input\n");
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (knn_merge_outputs(argv[2], &argv[3], argc - 3) != 0)
+        {
+            fprintf(stderr, "Error: Failed to merge range outputs\n");
+            return 1;
+        }
+        printf("Merged %d range outputs into %s\n", argc - 3, argv[2]);
+        return 0;
+    }
 
     int arg_idx = 1;
     while (arg_idx < argc)
@@ -189,6 +274,60 @@ int main(
                 return 1;
             }
         }
+        else if (strcmp(argv[arg_idx], "-blockmem") == 0)
+        {
+            if (arg_idx + 1 < argc)
+            {
+                config.block_mem_mb = atol(argv[++arg_idx]);
+            }
+            else
+            {
+                fprintf(stderr, "Error: -blockmem requires an integer argument (MiB)\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[arg_idx], "-shard") == 0)
+        {
+            if (arg_idx + 1 < argc
+                && sscanf(argv[arg_idx + 1], "%d/%d", &config.shard_index,
+                          &config.shard_count) == 2
+                && config.shard_index >= 0 && config.shard_index < config.shard_count)
+            {
+                arg_idx++;
+            }
+            else
+            {
+                fprintf(stderr, "Error: -shard requires i/n with 0 <= i < n\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[arg_idx], "-query-range") == 0)
+        {
+            if (arg_idx + 1 < argc
+                && sscanf(argv[arg_idx + 1], "%ld:%ld", &config.query_begin,
+                          &config.query_end) == 2
+                && config.query_begin >= 0 && config.query_end > config.query_begin)
+            {
+                arg_idx++;
+            }
+            else
+            {
+                fprintf(stderr, "Error: -query-range requires a:b with 0 <= a < b\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[arg_idx], "-chunk") == 0)
+        {
+            if (arg_idx + 1 < argc)
+            {
+                config.chunk_frames = atol(argv[++arg_idx]);
+            }
+            else
+            {
+                fprintf(stderr, "Error: -chunk requires an integer argument\n");
+                return 1;
+            }
+        }
         else if (strcmp(argv[arg_idx], "-fits") == 0)
         {
             config.output_format = KNN_FORMAT_FITS;
@@ -248,6 +387,19 @@ int main(
         return 1;
     }
 
+    if (config.chunk_frames <= 0)
+    {
+        fprintf(stderr, "Error: -chunk must be >= 1\n");
+        return 1;
+    }
+
+    int range_mode = (config.shard_count > 0 || config.query_end >= 0);
+    if (config.shard_count > 0 && config.query_end >= 0)
+    {
+        fprintf(stderr, "Error: -shard and -query-range are exclusive\n");
+        return 1;
+    }
+
     printf("%sStarting gric-knn: Out-of-Core Metric-Pruned k-NN Solver%s\n",
            ansi_bold_green, ansi_reset);
     printf("  Dataset:       %s\n", config.input_data_path);
@@ -274,6 +426,14 @@ int main(
     {
         printf("  Radius Cutoff: %.6f\n", config.rlim_cutoff);
     }
+    if (config.block_mem_mb > 0)
+    {
+        printf("  Block Cache:   %ld MiB\n", config.block_mem_mb);
+    }
+    if (config.shard_count > 0)
+    {
+        printf("  Shard:         %d of %d\n", config.shard_index, config.shard_count);
+    }
     printf("\n");
 
     struct timespec load_start, load_end;
@@ -300,34 +460,94 @@ int main(
     memset(&results, 0, sizeof(KnnResults));
     KnnTelemetry telemetry;
     memset(&telemetry, 0, sizeof(KnnTelemetry));
+    double write_time_ms = 0.0;
 
-    if (knn_run_search(&config, &model, &results, &telemetry) != 0)
+    if (range_mode)
     {
-        fprintf(stderr, "Error: k-NN search failed\n");
-        knn_model_free(&model);
-        return 1;
-    }
+        long N = model.total_dataset_frames;
+        long begin = config.query_begin;
+        long end = (config.query_end < N) ? config.query_end : N;
+        if (config.shard_count > 0)
+        {
+            begin = (long)((long long)N * config.shard_index / config.shard_count);
+            end = (long)((long long)N * (config.shard_index + 1) / config.shard_count);
+        }
+        if (begin >= end)
+        {
+            fprintf(stderr, "Error: Query range %ld:%ld is empty (%ld frames)\n", begin, end, N);
+            knn_model_free(&model);
+            return 1;
+        }
+        if (config.output_format == KNN_FORMAT_FITS
+            || (config.output_format == KNN_FORMAT_AUTO && model.is_fits_input))
+        {
+            printf("Note: query ranges are written as text\n");
+        }
 
-    struct timespec write_start, write_end;
-    clock_gettime(CLOCK_MONOTONIC, &write_start);
+        KnnStreamWriter writer;
+        if (knn_stream_open(&writer, &config, &model, begin, end) != 0)
+        {
+            knn_model_free(&model);
+            return 1;
+        }
+        printf("Query Range %ld:%ld -> %s\n", begin, end, writer.path);
+        if (writer.next > begin)
+        {
+            printf("  Resuming at query %ld (%ld done)\n", writer.next, writer.next - begin);
+        }
+        if (writer.next >= end)
+        {
+            printf("  Range already complete\n");
+            knn_stream_close(&writer);
+            knn_model_free(&model);
+            return 0;
+        }
+        printf("\n");
 
-    if (knn_write_results(&config, &model, &results) != 0)
+        StreamCtx sc = {&writer, 0.0};
+        int ret = knn_run_search_range(&config, &model, writer.next, end, config.chunk_frames,
+                                       stream_chunk, &sc, &telemetry);
+        knn_stream_close(&writer);
+        if (ret != 0)
+        {
+            fprintf(stderr, "Error: k-NN search failed (rerun to resume at query %ld)\n",
+                    writer.next);
+            knn_model_free(&model);
+            return 1;
+        }
+        write_time_ms = sc.write_ms;
+    }
+    else
     {
-        fprintf(stderr, "Error: Failed to write results\n");
+        if (knn_run_search(&config, &model, &results, &telemetry) != 0)
+        {
+            fprintf(stderr, "Error: k-NN search failed\n");
+            knn_model_free(&model);
+            return 1;
+        }
+
+        struct timespec write_start, write_end;
+        clock_gettime(CLOCK_MONOTONIC, &write_start);
+
+        if (knn_write_results(&config, &model, &results) != 0)
+        {
+            fprintf(stderr, "Error: Failed to write results\n");
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &write_end);
+        write_time_ms = (write_end.tv_sec - write_start.tv_sec) * 1000.0 +
+                        (write_end.tv_nsec - write_start.tv_nsec) / 1000000.0;
     }
 
-    clock_gettime(CLOCK_MONOTONIC, &write_end);
-    double write_time_ms = (write_end.tv_sec - write_start.tv_sec) * 1000.0 +
-                           (write_end.tv_nsec - write_start.tv_nsec) / 1000000.0;
-    uint64_t total_brute_force = (uint64_t)model.total_dataset_frames *
+    uint64_t total_brute_force = telemetry.total_queries *
                                  (uint64_t)model.total_dataset_frames;
     double prune_pct = 100.0 * (1.0 - (double)telemetry.framedist_calls /
                                        (double)total_brute_force);
     double fps = (telemetry.time_search_ms > 0.0) ?
-                 (double)model.total_dataset_frames / (telemetry.time_search_ms / 1000.0) : 0.0;
+                 (double)telemetry.total_queries / (telemetry.time_search_ms / 1000.0) : 0.0;
 
     printf("\n%sgric-knn Search Summary:%s\n", ansi_bold_cyan, ansi_reset);
-    printf("  Total Query Frames:        %ld\n", model.total_dataset_frames);
+    printf("  Total Query Frames:        %lu\n", (unsigned long)telemetry.total_queries);
     printf("  Framedist Computations:    %lu (vs %lu brute-force)\n",
            (unsigned long)telemetry.framedist_calls, (unsigned long)total_brute_force);
     printf("  Metric Pruning Efficiency: %s%.2f%%%s calls pruned!\n",
@@ -336,7 +556,14 @@ int main(
     printf("  Level 2 Anchors Pruned:    %lu\n", (unsigned long)telemetry.level2_anchors_pruned);
     printf("  Level 3 Annular Pruned:    %lu\n", (unsigned long)telemetry.level3_annular_pruned);
     printf("  Temporal Exclusions:       %lu\n", (unsigned long)telemetry.temporal_pruned);
+    printf("  Frames Read:               %lu\n", (unsigned long)telemetry.frames_read);
+    if (telemetry.tile_pairs > 0)
+    {
+        printf("  Tiled Kernel Pairs:        %lu (%lu recomputed exactly)\n",
+               (unsigned long)telemetry.tile_pairs, (unsigned long)telemetry.tile_exact);
+    }
     printf("  Search Wall Time:          %.2f ms (%.1f fps)\n", telemetry.time_search_ms, fps);
+    printf("  Distance Throughput:       %.3e pairs/s\n", telemetry.pairs_per_sec);
     printf("  Output Write Time:         %.2f ms\n", write_time_ms);
     printf("%sCompleted successfully.%s\n", ansi_bold_green, ansi_reset);
 
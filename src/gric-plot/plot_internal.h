@@ -6,6 +6,9 @@
 #ifndef PLOT_INTERNAL_H
 #define PLOT_INTERNAL_H
 
+#include <stdio.h>
+#include "shared/gricres.h"
+
 typedef struct
 {
     int    id;
@@ -41,6 +44,45 @@ typedef struct
     int        num_stats;
 } PlotData;
 
+/**
+ * @brief Frame membership source: the results.gricres column if present, else
+ *        frame_membership.txt.
+ */
+typedef struct
+{
+    GricRes        res;        /**< Mapped bundle (hdr NULL when reading text) */
+    const int32_t *col;        /**< Membership column of the bundle */
+    uint64_t       count;      /**< Rows of the column */
+    uint64_t       next;       /**< Next row of the column */
+    FILE          *f;          /**< frame_membership.txt */
+    char           path[8192]; /**< File the membership is read from */
+} PlotMembership;
+
+/**
+ * @brief Open the frame membership of output directory @output_dir ("" for the current
+ *        directory).
+ *
+ * @return 0 on success, 1 on failure (message printed).
+ */
+int plot_membership_open(
+    PlotMembership *memb,
+    const char     *output_dir);
+
+/**
+ * @brief Read the membership record of the next frame.
+ *
+ * @return 1 with the cluster in *cid, 0 for a line without a record, -1 at the end.
+ */
+int plot_membership_next(
+    PlotMembership *memb,
+    int            *cid);
+
+/**
+ * @brief Close a membership source.
+ */
+void plot_membership_close(
+    PlotMembership *memb);
+
 /**
  * @brief Parse the coordinate clustering log and membership files.
  *
@@ -8,6 +8,105 @@
 #include <string.h>
 #include "plot_internal.h"
 
+/**
+ * @brief Open the frame membership of an output directory.
+ *
+ * The membership column of results.gricres is used in place when the bundle
+ * exists; frame_membership.txt is read otherwise.
+ *
+ * @param memb       Membership source to open.
+ * @param output_dir Output directory of the run ("" for the current directory).
+ *
+ * @return 0 on success, 1 on failure.
+ */
+int plot_membership_open(
+    PlotMembership *memb,
+    const char     *output_dir)
+{
+    memset(memb, 0, sizeof(*memb));
+
+    if (output_dir[0] != '\0')
+    {
+        snprintf(memb->path, sizeof(memb->path), "%s/%s", output_dir, GRICRES_FILE);
+    }
+    else
+    {
+        strcpy(memb->path, GRICRES_FILE);
+    }
+    if (gricres_open(&memb->res, memb->path) == 0)
+    {
+        memb->col = gricres_section(&memb->res, GRICRES_SEC_MEMBERSHIP, &memb->count);
+        if (memb->col != NULL)
+        {
+            return 0;
+        }
+        gricres_close(&memb->res);
+    }
+
+    if (output_dir[0] != '\0')
+    {
+        snprintf(memb->path, sizeof(memb->path), "%s/frame_membership.txt", output_dir);
+    }
+    else
+    {
+        strcpy(memb->path, "frame_membership.txt");
+    }
+    memb->f = fopen(memb->path, "r");
+    if (memb->f == NULL)
+    {
+        fprintf(stderr, "Error: Could not open membership file %s\n", memb->path);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read the membership record of the next frame.
+ *
+ * @param memb Membership source.
+ * @param cid  Output cluster index.
+ *
+ * @return 1 with the cluster in *cid, 0 for a line without a record, -1 at the end.
+ */
+int plot_membership_next(
+    PlotMembership *memb,
+    int            *cid)
+{
+    if (memb->col != NULL)
+    {
+        if (memb->next >= memb->count)
+        {
+            return -1;
+        }
+        *cid = memb->col[memb->next++];
+        return 1;
+    }
+
+    char lm[1024];
+    if (fgets(lm, sizeof(lm), memb->f) == NULL)
+    {
+        return -1;
+    }
+    long idx;
+    return (sscanf(lm, "%ld %d", &idx, cid) == 2) ? 1 : 0;
+}
+
+/**
+ * @brief Close a membership source.
+ *
+ * @param memb Membership source.
+ */
+void plot_membership_close(
+    PlotMembership *memb)
+{
+    if (memb->f != NULL)
+    {
+        fclose(memb->f);
+    }
+    gricres_close(&memb->res);
+    memset(memb, 0, sizeof(*memb));
+}
+
 /**
  * @brief Parse the coordinate clustering log and membership files.
  *
@@ -212,20 +311,7 @@ int parse_input_data(
         data->num_stats = 2;
     } // Construct the stats lines
 
-    /* Build the membership file name */
-    char memb_filename[8192];
-    if (data->output_dir[0] != '\0')
-    {
-        snprintf(memb_filename, sizeof(memb_filename), "%s/frame_membership.txt",
-                 data->output_dir);
-    }
-    else
-    {
-        strcpy(memb_filename, "frame_membership.txt");
-    }
-
     printf("Reading points: %s\n", points_filename);
-    printf("Reading membership: %s\n", memb_filename);
 
     /* Process points and membership to populate anchors and samples per cluster */
     {
@@ -236,36 +322,36 @@ int parse_input_data(
             return 1;
         }
 
-        FILE *f_memb = fopen(memb_filename, "r");
-        if (f_memb == NULL)
+        PlotMembership memb;
+        if (plot_membership_open(&memb, data->output_dir) != 0)
         {
-            fprintf(stderr, "Error: Could not open membership file %s\n", memb_filename);
             fclose(f_pts);
             return 1;
         }
+        printf("Reading membership: %s\n", memb.path);
 
         char *cluster_seen = calloc(10000, 1);
         if (cluster_seen == NULL)
         {
             fprintf(stderr, "Error: Memory allocation failed for cluster_seen\n");
             fclose(f_pts);
-            fclose(f_memb);
+            plot_membership_close(&memb);
             return 1;
         }
 
         char lp[4096];
-        char lm[1024];
         long frame_count = 0;
+        int  cid;
+        int  rec;
 
-        while (fgets(lp, sizeof(lp), f_pts) != NULL && fgets(lm, sizeof(lm), f_memb) != NULL)
+        while (fgets(lp, sizeof(lp), f_pts) != NULL
+               && (rec = plot_membership_next(&memb, &cid)) >= 0)
         {
             if (lp[0] == '#')
             {
                 continue;
             }
-            long idx;
-            int cid;
-            if (sscanf(lm, "%ld %d", &idx, &cid) == 2 && cid >= 0 && cid < 10000)
+            if (rec == 1 && cid >= 0 && cid < 10000)
             {
                 data->samples_per_cluster[cid]++;
                 if (cluster_seen[cid] == 0)
@@ -288,7 +374,7 @@ int parse_input_data(
 
         free(cluster_seen);
         fclose(f_pts);
-        fclose(f_memb);
+        plot_membership_close(&memb);
     } // Process points and membership
 
     return 0;
@@ -138,17 +138,6 @@ int render_plots(
     canvas_set_font_scale(png_font_scale);
 #endif
 
-    char memb_filename[8192];
-    if (data->output_dir[0] != '\0')
-    {
-        snprintf(memb_filename, sizeof(memb_filename), "%s/frame_membership.txt",
-                 data->output_dir);
-    }
-    else
-    {
-        strcpy(memb_filename, "frame_membership.txt");
-    }
-
     FILE *f_pts = fopen(points_filename, "r");
     if (f_pts == NULL)
     {
@@ -156,10 +145,9 @@ int render_plots(
         return 1;
     }
 
-    FILE *f_memb = fopen(memb_filename, "r");
-    if (f_memb == NULL)
+    PlotMembership memb;
+    if (plot_membership_open(&memb, data->output_dir) != 0)
     {
-        fprintf(stderr, "Error: Could not open membership file %s\n", memb_filename);
         fclose(f_pts);
         return 1;
     }
@@ -169,7 +157,7 @@ int render_plots(
     {
         fprintf(stderr, "Error: Could not open output file %s\n", output_filename);
         fclose(f_pts);
-        fclose(f_memb);
+        plot_membership_close(&memb);
         return 1;
     }
 
@@ -182,7 +170,7 @@ int render_plots(
             fclose(svg_out);
         }
         fclose(f_pts);
-        fclose(f_memb);
+        plot_membership_close(&memb);
         return 1;
     }
 
@@ -223,18 +211,18 @@ int render_plots(
     /* First pass: read files to plot coordinate points */
     {
         char lp[4096];
-        char lm[1024];
         long frame_count = 0;
+        int  cid;
+        int  rec;
 
-        while (fgets(lp, sizeof(lp), f_pts) != NULL && fgets(lm, sizeof(lm), f_memb) != NULL)
+        while (fgets(lp, sizeof(lp), f_pts) != NULL
+               && (rec = plot_membership_next(&memb, &cid)) >= 0)
         {
             if (lp[0] == '#')
             {
                 continue;
             }
-            long idx;
-            int cid;
-            if (sscanf(lm, "%ld %d", &idx, &cid) == 2)
+            if (rec == 1)
             {
                 double x, y;
                 if (sscanf(lp, "%lf %lf", &x, &y) == 2)
@@ -270,7 +258,7 @@ int render_plots(
                         }
                     }
                 }
-            } // if sscanf
+            } // if (rec == 1)
             frame_count++;
             if (frame_count % 10000 == 0)
             {
@@ -539,6 +527,6 @@ int render_plots(
     }
 
     fclose(f_pts);
-    fclose(f_memb);
+    plot_membership_close(&memb);
     return 0;
 }
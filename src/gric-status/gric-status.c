@@ -97,6 +97,13 @@ static void print_status_classic(
            status->time_io_ms, status->time_step_1, status->time_step_2, status->time_step_3a,
            status->time_step_3b, status->time_step_3c, status->time_step_4, status->time_step_5,
            status->time_step_refine);
+    if (status->prefetch_depth > 0)
+    {
+        printf("Prefetch Ring:        fill=%u/%u (avg %.2f), stalls=%" PRIu64
+               " (%.2f ms), full waits=%" PRIu64 "\n",
+               status->prefetch_fill, status->prefetch_depth, status->prefetch_avg_fill,
+               status->prefetch_stalls, status->prefetch_stall_ms, status->prefetch_full_waits);
+    }
 
     time_t sec = (time_t)(status->last_update_time / 1000000000ULL);
     struct tm tm_info;
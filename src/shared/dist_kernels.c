@@ -0,0 +1,1111 @@
+/**
+ * @file dist_kernels.c
+ * @brief Runtime-dispatched squared-L2 distance kernels shared by all tools.
+ *
+ * framedist() (gric-cluster), the gric-knn engine, gric-cluster-analysis and
+ * gric-NDmodel all reduce to a sum of squared differences over contiguous
+ * arrays. This module provides one implementation per instruction set and
+ * picks the widest one the running CPU supports, so a binary built for a
+ * generic x86-64 baseline (GRIC_PORTABLE) runs as fast as a -march=native
+ * build.
+ *
+ * Every SIMD variant keeps four independent accumulators to hide FMA
+ * latency, and reduces lanes with shuffles rather than pointer casts.
+ * Results may differ from the scalar path in the last bits because the
+ * summation order differs.
+ *
+ * The GRIC_DIST_ISA environment variable (scalar|neon|avx2|avx512) caps the
+ * selection, e.g. for benchmarking or reproducing results across hosts.
+ *
+ * Main Functions:
+ * - dist_kernels_init: CPUID-based kernel selection.
+ * - dist_sq_f64 / dist_sq_f32: Dispatched sum of squared differences.
+ * - dist_sq_f64_bounded / dist_sq_f32_bounded: Early-abandon variants that
+ *   stop once the partial sum exceeds a caller threshold.
+ * - dist_dot_batch_f64 / dist_dot_batch_f32: One frame against many anchors
+ *   in a single pass over the frame (dot-product form).
+ */
+#include "dist_kernels.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define DIST_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define DIST_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+typedef double (*DistSqF64Fn)(const double *, const double *, long);
+typedef double (*DistSqF32Fn)(const float *, const float *, long);
+typedef void (*DistDot4F64Fn)(const double *, const double *const[4], long, double *);
+typedef void (*DistDot4F32Fn)(const float *, const float *const[4], long, double *);
+
+/* ------------------------------------------------------------------ */
+/* Scalar                                                              */
+/* ------------------------------------------------------------------ */
+
+/**
+ * dist_sq_f64_scalar() - Portable sum of squared differences (double).
+ * @a: First array.
+ * @b: Second array.
+ * @n: Number of elements.
+ *
+ * Return: Sum of (a[i] - b[i])^2.
+ */
+static double dist_sq_f64_scalar(
+    const double *restrict a,
+    const double *restrict b,
+    long                   n)
+{
+    double s0 = 0.0;
+    double s1 = 0.0;
+    double s2 = 0.0;
+    double s3 = 0.0;
+    long ii = 0;
+
+    for (; ii + 4 <= n; ii += 4)
+    {
+        double d0 = a[ii] - b[ii];
+        double d1 = a[ii + 1] - b[ii + 1];
+        double d2 = a[ii + 2] - b[ii + 2];
+        double d3 = a[ii + 3] - b[ii + 3];
+        s0 += d0 * d0;
+        s1 += d1 * d1;
+        s2 += d2 * d2;
+        s3 += d3 * d3;
+    }
+    for (; ii < n; ii++)
+    {
+        double d = a[ii] - b[ii];
+        s0 += d * d;
+    }
+
+    return (s0 + s1) + (s2 + s3);
+}
+
+/**
+ * dist_sq_f32_scalar() - Portable sum of squared differences (float in, double sum).
+ * @a: First array.
+ * @b: Second array.
+ * @n: Number of elements.
+ *
+ * Return: Sum of (a[i] - b[i])^2 computed in double.
+ */
+static double dist_sq_f32_scalar(
+    const float *restrict a,
+    const float *restrict b,
+    long                  n)
+{
+    double s0 = 0.0;
+    double s1 = 0.0;
+    double s2 = 0.0;
+    double s3 = 0.0;
+    long ii = 0;
+
+    for (; ii + 4 <= n; ii += 4)
+    {
+        double d0 = (double)a[ii] - (double)b[ii];
+        double d1 = (double)a[ii + 1] - (double)b[ii + 1];
+        double d2 = (double)a[ii + 2] - (double)b[ii + 2];
+        double d3 = (double)a[ii + 3] - (double)b[ii + 3];
+        s0 += d0 * d0;
+        s1 += d1 * d1;
+        s2 += d2 * d2;
+        s3 += d3 * d3;
+    }
+    for (; ii < n; ii++)
+    {
+        double d = (double)a[ii] - (double)b[ii];
+        s0 += d * d;
+    }
+
+    return (s0 + s1) + (s2 + s3);
+}
+
+/* ------------------------------------------------------------------ */
+/* x86: AVX2 + FMA, AVX-512F                                           */
+/* ------------------------------------------------------------------ */
+
+#ifdef DIST_HAVE_X86
+
+/**
+ * hsum256_pd() - Horizontal sum of a 256-bit double vector.
+ * @v: Vector to reduce.
+ *
+ * Return: v[0] + v[1] + v[2] + v[3].
+ */
+__attribute__((target("avx2,fma")))
+static inline double hsum256_pd(
+    __m256d v)
+{
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    __m128d sh = _mm_unpackhi_pd(lo, lo);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, sh));
+}
+
+/**
+ * dist_sq_f64_avx2() - AVX2/FMA sum of squared differences (double).
+ * @a: First array.
+ * @b: Second array.
+ * @n: Number of elements.
+ *
+ * Return: Sum of (a[i] - b[i])^2.
+ */
+__attribute__((target("avx2,fma")))
+static double dist_sq_f64_avx2(
+    const double *restrict a,
+    const double *restrict b,
+    long                   n)
+{
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd();
+    __m256d acc3 = _mm256_setzero_pd();
+    long ii = 0;
+
+    for (; ii + 16 <= n; ii += 16)
+    {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + ii), _mm256_loadu_pd(b + ii));
+        __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(a + ii + 4), _mm256_loadu_pd(b + ii + 4));
+        __m256d d2 = _mm256_sub_pd(_mm256_loadu_pd(a + ii + 8), _mm256_loadu_pd(b + ii + 8));
+        __m256d d3 = _mm256_sub_pd(_mm256_loadu_pd(a + ii + 12),
+                                   _mm256_loadu_pd(b + ii + 12));
+        acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+        acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+        acc2 = _mm256_fmadd_pd(d2, d2, acc2);
+        acc3 = _mm256_fmadd_pd(d3, d3, acc3);
+    }
+    for (; ii + 4 <= n; ii += 4)
+    {
+        __m256d d = _mm256_sub_pd(_mm256_loadu_pd(a + ii), _mm256_loadu_pd(b + ii));
+        acc0 = _mm256_fmadd_pd(d, d, acc0);
+    }
+
+    double sum = hsum256_pd(_mm256_add_pd(_mm256_add_pd(acc0, acc1),
+                                          _mm256_add_pd(acc2, acc3)));
+    for (; ii < n; ii++)
+    {
+        double d = a[ii] - b[ii];
+        sum += d * d;
+    }
+
+    return sum;
+}
+
+/**
+ * dist_sq_f32_avx2() - AVX2/FMA sum of squared differences (float in, double sum).
+ * @a: First array.
+ * @b: Second array.
+ * @n: Number of elements.
+ *
+ * Return: Sum of (a[i] - b[i])^2 computed in double.
+ */
+__attribute__((target("avx2,fma")))
+static double dist_sq_f32_avx2(
+    const float *restrict a,
+    const float *restrict b,
+    long                  n)
+{
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd();
+    __m256d acc3 = _mm256_setzero_pd();
+    long ii = 0;
+
+    for (; ii + 16 <= n; ii += 16)
+    {
+        __m256d d0 = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + ii)),
+                                   _mm256_cvtps_pd(_mm_loadu_ps(b + ii)));
+        __m256d d1 = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + ii + 4)),
+                                   _mm256_cvtps_pd(_mm_loadu_ps(b + ii + 4)));
+        __m256d d2 = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + ii + 8)),
+                                   _mm256_cvtps_pd(_mm_loadu_ps(b + ii + 8)));
+        __m256d d3 = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + ii + 12)),
+                                   _mm256_cvtps_pd(_mm_loadu_ps(b + ii + 12)));
+        acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+        acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+        acc2 = _mm256_fmadd_pd(d2, d2, acc2);
+        acc3 = _mm256_fmadd_pd(d3, d3, acc3);
+    }
+    for (; ii + 4 <= n; ii += 4)
+    {
+        __m256d d = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + ii)),
+                                  _mm256_cvtps_pd(_mm_loadu_ps(b + ii)));
+        acc0 = _mm256_fmadd_pd(d, d, acc0);
+    }
+
+    double sum = hsum256_pd(_mm256_add_pd(_mm256_add_pd(acc0, acc1),
+                                          _mm256_add_pd(acc2, acc3)));
+    for (; ii < n; ii++)
+    {
+        double d = (double)a[ii] - (double)b[ii];
+        sum += d * d;
+    }
+
+    return sum;
+}
+
+/**
+ * dist_sq_f64_avx512() - AVX-512F sum of squared differences (double).
+ * @a: First array.
+ * @b: Second array.
+ * @n: Number of elements.
+ *
+ * Return: Sum of (a[i] - b[i])^2.
+ */
+__attribute__((target("avx512f")))
+static double dist_sq_f64_avx512(
+    const double *restrict a,
+    const double *restrict b,
+    long                   n)
+{
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    __m512d acc2 = _mm512_setzero_pd();
+    __m512d acc3 = _mm512_setzero_pd();
+    long ii = 0;
+
+    for (; ii + 32 <= n; ii += 32)
+    {
+        __m512d d0 = _mm512_sub_pd(_mm512_loadu_pd(a + ii), _mm512_loadu_pd(b + ii));
+        __m512d d1 = _mm512_sub_pd(_mm512_loadu_pd(a + ii + 8), _mm512_loadu_pd(b + ii + 8));
+        __m512d d2 = _mm512_sub_pd(_mm512_loadu_pd(a + ii + 16),
+                                   _mm512_loadu_pd(b + ii + 16));
+        __m512d d3 = _mm512_sub_pd(_mm512_loadu_pd(a + ii + 24),
+                                   _mm512_loadu_pd(b + ii + 24));
+        acc0 = _mm512_fmadd_pd(d0, d0, acc0);
+        acc1 = _mm512_fmadd_pd(d1, d1, acc1);
+        acc2 = _mm512_fmadd_pd(d2, d2, acc2);
+        acc3 = _mm512_fmadd_pd(d3, d3, acc3);
+    }
+    for (; ii + 8 <= n; ii += 8)
+    {
+        __m512d d = _mm512_sub_pd(_mm512_loadu_pd(a + ii), _mm512_loadu_pd(b + ii));
+        acc0 = _mm512_fmadd_pd(d, d, acc0);
+    }
+    if (ii < n)
+    {
+        /* Masked tail: inactive lanes load as zero on both sides */
+        __mmask8 m = (__mmask8)((1u << (n - ii)) - 1u);
+        __m512d d = _mm512_sub_pd(_mm512_maskz_loadu_pd(m, a + ii),
+                                  _mm512_maskz_loadu_pd(m, b + ii));
+        acc1 = _mm512_fmadd_pd(d, d, acc1);
+    }
+
+    return _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(acc0, acc1),
+                                              _mm512_add_pd(acc2, acc3)));
+}
+
+/**
+ * dist_sq_f32_avx512() - AVX-512F sum of squared differences (float in, double sum).
+ * @a: First array.
+ * @b: Second array.
+ * @n: Number of elements.
+ *
+ * Return: Sum of (a[i] - b[i])^2 computed in double.
+ */
+__attribute__((target("avx512f")))
+static double dist_sq_f32_avx512(
+    const float *restrict a,
+    const float *restrict b,
+    long                  n)
+{
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    __m512d acc2 = _mm512_setzero_pd();
+    __m512d acc3 = _mm512_setzero_pd();
+    long ii = 0;
+
+    for (; ii + 32 <= n; ii += 32)
+    {
+        __m512d d0 = _mm512_sub_pd(_mm512_cvtps_pd(_mm256_loadu_ps(a + ii)),
+                                   _mm512_cvtps_pd(_mm256_loadu_ps(b + ii)));
+        __m512d d1 = _mm512_sub_pd(_mm512_cvtps_pd(_mm256_loadu_ps(a + ii + 8)),
+                                   _mm512_cvtps_pd(_mm256_loadu_ps(b + ii + 8)));
+        __m512d d2 = _mm512_sub_pd(_mm512_cvtps_pd(_mm256_loadu_ps(a + ii + 16)),
+                                   _mm512_cvtps_pd(_mm256_loadu_ps(b + ii + 16)));
+        __m512d d3 = _mm512_sub_pd(_mm512_cvtps_pd(_mm256_loadu_ps(a + ii + 24)),
+                                   _mm512_cvtps_pd(_mm256_loadu_ps(b + ii + 24)));
+        acc0 = _mm512_fmadd_pd(d0, d0, acc0);
+        acc1 = _mm512_fmadd_pd(d1, d1, acc1);
+        acc2 = _mm512_fmadd_pd(d2, d2, acc2);
+        acc3 = _mm512_fmadd_pd(d3, d3, acc3);
+    }
+    for (; ii + 8 <= n; ii += 8)
+    {
+        __m512d d = _mm512_sub_pd(_mm512_cvtps_pd(_mm256_loadu_ps(a + ii)),
+                                  _mm512_cvtps_pd(_mm256_loadu_ps(b + ii)));
+        acc0 = _mm512_fmadd_pd(d, d, acc0);
+    }
+
+    double sum = _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(acc0, acc1),
+                                                    _mm512_add_pd(acc2, acc3)));
+    for (; ii < n; ii++)
+    {
+        double d = (double)a[ii] - (double)b[ii];
+        sum += d * d;
+    }
+
+    return sum;
+}
+
+#endif // DIST_HAVE_X86
+
+/* ------------------------------------------------------------------ */
+/* AArch64 NEON                                                        */
+/* ------------------------------------------------------------------ */
+
+#ifdef DIST_HAVE_NEON
+
+/**
+ * dist_sq_f64_neon() - NEON sum of squared differences (double).
+ * @a: First array.
+ * @b: Second array.
+ * @n: Number of elements.
+ *
+ * Return: Sum of (a[i] - b[i])^2.
+ */
+static double dist_sq_f64_neon(
+    const double *restrict a,
+    const double *restrict b,
+    long                   n)
+{
+    float64x2_t acc0 = vdupq_n_f64(0.0);
+    float64x2_t acc1 = vdupq_n_f64(0.0);
+    float64x2_t acc2 = vdupq_n_f64(0.0);
+    float64x2_t acc3 = vdupq_n_f64(0.0);
+    long ii = 0;
+
+    for (; ii + 8 <= n; ii += 8)
+    {
+        float64x2_t d0 = vsubq_f64(vld1q_f64(a + ii), vld1q_f64(b + ii));
+        float64x2_t d1 = vsubq_f64(vld1q_f64(a + ii + 2), vld1q_f64(b + ii + 2));
+        float64x2_t d2 = vsubq_f64(vld1q_f64(a + ii + 4), vld1q_f64(b + ii + 4));
+        float64x2_t d3 = vsubq_f64(vld1q_f64(a + ii + 6), vld1q_f64(b + ii + 6));
+        acc0 = vfmaq_f64(acc0, d0, d0);
+        acc1 = vfmaq_f64(acc1, d1, d1);
+        acc2 = vfmaq_f64(acc2, d2, d2);
+        acc3 = vfmaq_f64(acc3, d3, d3);
+    }
+
+    double sum = vaddvq_f64(vaddq_f64(vaddq_f64(acc0, acc1), vaddq_f64(acc2, acc3)));
+    for (; ii < n; ii++)
+    {
+        double d = a[ii] - b[ii];
+        sum += d * d;
+    }
+
+    return sum;
+}
+
+/**
+ * dist_sq_f32_neon() - NEON sum of squared differences (float in, double sum).
+ * @a: First array.
+ * @b: Second array.
+ * @n: Number of elements.
+ *
+ * Return: Sum of (a[i] - b[i])^2 computed in double.
+ */
+static double dist_sq_f32_neon(
+    const float *restrict a,
+    const float *restrict b,
+    long                  n)
+{
+    float64x2_t acc0 = vdupq_n_f64(0.0);
+    float64x2_t acc1 = vdupq_n_f64(0.0);
+    float64x2_t acc2 = vdupq_n_f64(0.0);
+    float64x2_t acc3 = vdupq_n_f64(0.0);
+    long ii = 0;
+
+    for (; ii + 8 <= n; ii += 8)
+    {
+        float32x4_t va0 = vld1q_f32(a + ii);
+        float32x4_t vb0 = vld1q_f32(b + ii);
+        float32x4_t va1 = vld1q_f32(a + ii + 4);
+        float32x4_t vb1 = vld1q_f32(b + ii + 4);
+        float64x2_t d0 = vsubq_f64(vcvt_f64_f32(vget_low_f32(va0)),
+                                   vcvt_f64_f32(vget_low_f32(vb0)));
+        float64x2_t d1 = vsubq_f64(vcvt_high_f64_f32(va0), vcvt_high_f64_f32(vb0));
+        float64x2_t d2 = vsubq_f64(vcvt_f64_f32(vget_low_f32(va1)),
+                                   vcvt_f64_f32(vget_low_f32(vb1)));
+        float64x2_t d3 = vsubq_f64(vcvt_high_f64_f32(va1), vcvt_high_f64_f32(vb1));
+        acc0 = vfmaq_f64(acc0, d0, d0);
+        acc1 = vfmaq_f64(acc1, d1, d1);
+        acc2 = vfmaq_f64(acc2, d2, d2);
+        acc3 = vfmaq_f64(acc3, d3, d3);
+    }
+
+    double sum = vaddvq_f64(vaddq_f64(vaddq_f64(acc0, acc1), vaddq_f64(acc2, acc3)));
+    for (; ii < n; ii++)
+    {
+        double d = (double)a[ii] - (double)b[ii];
+        sum += d * d;
+    }
+
+    return sum;
+}
+
+#endif // DIST_HAVE_NEON
+
+/* ------------------------------------------------------------------ */
+/* Batched dot products (one frame vs. four anchors)                   */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Each kernel streams the frame once while accumulating its dot product
+ * with four anchors and with itself; dist_dot_batch_*() walks the anchor
+ * list four at a time. NEON builds use the scalar kernels.
+ */
+
+/**
+ * dist_dot4_f64_scalar() - Portable f.a[k] (k < 4) and f.f (double).
+ * @f:   Frame.
+ * @a:   Four anchors.
+ * @n:   Number of elements.
+ * @out: Output; out[0..3] = f.a[k], out[4] = f.f.
+ */
+static void dist_dot4_f64_scalar(
+    const double *restrict f,
+    const double *const    a[4],
+    long                   n,
+    double                *out)
+{
+    double s0 = 0.0;
+    double s1 = 0.0;
+    double s2 = 0.0;
+    double s3 = 0.0;
+    double sf = 0.0;
+
+    for (long ii = 0; ii < n; ii++)
+    {
+        double v = f[ii];
+        s0 += v * a[0][ii];
+        s1 += v * a[1][ii];
+        s2 += v * a[2][ii];
+        s3 += v * a[3][ii];
+        sf += v * v;
+    }
+    out[0] = s0;
+    out[1] = s1;
+    out[2] = s2;
+    out[3] = s3;
+    out[4] = sf;
+}
+
+/**
+ * dist_dot4_f32_scalar() - Portable f.a[k] (k < 4) and f.f (float in, double sum).
+ * @f:   Frame.
+ * @a:   Four anchors.
+ * @n:   Number of elements.
+ * @out: Output; out[0..3] = f.a[k], out[4] = f.f.
+ */
+static void dist_dot4_f32_scalar(
+    const float *restrict f,
+    const float *const    a[4],
+    long                  n,
+    double               *out)
+{
+    double s0 = 0.0;
+    double s1 = 0.0;
+    double s2 = 0.0;
+    double s3 = 0.0;
+    double sf = 0.0;
+
+    for (long ii = 0; ii < n; ii++)
+    {
+        double v = (double)f[ii];
+        s0 += v * (double)a[0][ii];
+        s1 += v * (double)a[1][ii];
+        s2 += v * (double)a[2][ii];
+        s3 += v * (double)a[3][ii];
+        sf += v * v;
+    }
+    out[0] = s0;
+    out[1] = s1;
+    out[2] = s2;
+    out[3] = s3;
+    out[4] = sf;
+}
+
+#ifdef DIST_HAVE_X86
+
+/**
+ * dist_dot4_f64_avx2() - AVX2/FMA f.a[k] (k < 4) and f.f (double).
+ * @f:   Frame.
+ * @a:   Four anchors.
+ * @n:   Number of elements.
+ * @out: Output; out[0..3] = f.a[k], out[4] = f.f.
+ */
+__attribute__((target("avx2,fma")))
+static void dist_dot4_f64_avx2(
+    const double *restrict f,
+    const double *const    a[4],
+    long                   n,
+    double                *out)
+{
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+    __m256d s2 = _mm256_setzero_pd();
+    __m256d s3 = _mm256_setzero_pd();
+    __m256d sf = _mm256_setzero_pd();
+    long ii = 0;
+
+    for (; ii + 4 <= n; ii += 4)
+    {
+        __m256d v = _mm256_loadu_pd(f + ii);
+        s0 = _mm256_fmadd_pd(v, _mm256_loadu_pd(a[0] + ii), s0);
+        s1 = _mm256_fmadd_pd(v, _mm256_loadu_pd(a[1] + ii), s1);
+        s2 = _mm256_fmadd_pd(v, _mm256_loadu_pd(a[2] + ii), s2);
+        s3 = _mm256_fmadd_pd(v, _mm256_loadu_pd(a[3] + ii), s3);
+        sf = _mm256_fmadd_pd(v, v, sf);
+    }
+
+    out[0] = hsum256_pd(s0);
+    out[1] = hsum256_pd(s1);
+    out[2] = hsum256_pd(s2);
+    out[3] = hsum256_pd(s3);
+    out[4] = hsum256_pd(sf);
+    for (; ii < n; ii++)
+    {
+        double v = f[ii];
+        out[0] += v * a[0][ii];
+        out[1] += v * a[1][ii];
+        out[2] += v * a[2][ii];
+        out[3] += v * a[3][ii];
+        out[4] += v * v;
+    }
+}
+
+/**
+ * dist_dot4_f32_avx2() - AVX2/FMA f.a[k] (k < 4) and f.f (float in, double sum).
+ * @f:   Frame.
+ * @a:   Four anchors.
+ * @n:   Number of elements.
+ * @out: Output; out[0..3] = f.a[k], out[4] = f.f.
+ */
+__attribute__((target("avx2,fma")))
+static void dist_dot4_f32_avx2(
+    const float *restrict f,
+    const float *const    a[4],
+    long                  n,
+    double               *out)
+{
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+    __m256d s2 = _mm256_setzero_pd();
+    __m256d s3 = _mm256_setzero_pd();
+    __m256d sf = _mm256_setzero_pd();
+    long ii = 0;
+
+    for (; ii + 4 <= n; ii += 4)
+    {
+        __m256d v = _mm256_cvtps_pd(_mm_loadu_ps(f + ii));
+        s0 = _mm256_fmadd_pd(v, _mm256_cvtps_pd(_mm_loadu_ps(a[0] + ii)), s0);
+        s1 = _mm256_fmadd_pd(v, _mm256_cvtps_pd(_mm_loadu_ps(a[1] + ii)), s1);
+        s2 = _mm256_fmadd_pd(v, _mm256_cvtps_pd(_mm_loadu_ps(a[2] + ii)), s2);
+        s3 = _mm256_fmadd_pd(v, _mm256_cvtps_pd(_mm_loadu_ps(a[3] + ii)), s3);
+        sf = _mm256_fmadd_pd(v, v, sf);
+    }
+
+    out[0] = hsum256_pd(s0);
+    out[1] = hsum256_pd(s1);
+    out[2] = hsum256_pd(s2);
+    out[3] = hsum256_pd(s3);
+    out[4] = hsum256_pd(sf);
+    for (; ii < n; ii++)
+    {
+        double v = (double)f[ii];
+        out[0] += v * (double)a[0][ii];
+        out[1] += v * (double)a[1][ii];
+        out[2] += v * (double)a[2][ii];
+        out[3] += v * (double)a[3][ii];
+        out[4] += v * v;
+    }
+}
+
+/**
+ * dist_dot4_f64_avx512() - AVX-512F f.a[k] (k < 4) and f.f (double).
+ * @f:   Frame.
+ * @a:   Four anchors.
+ * @n:   Number of elements.
+ * @out: Output; out[0..3] = f.a[k], out[4] = f.f.
+ */
+__attribute__((target("avx512f")))
+static void dist_dot4_f64_avx512(
+    const double *restrict f,
+    const double *const    a[4],
+    long                   n,
+    double                *out)
+{
+    __m512d s0 = _mm512_setzero_pd();
+    __m512d s1 = _mm512_setzero_pd();
+    __m512d s2 = _mm512_setzero_pd();
+    __m512d s3 = _mm512_setzero_pd();
+    __m512d sf = _mm512_setzero_pd();
+    long ii = 0;
+
+    for (; ii + 8 <= n; ii += 8)
+    {
+        __m512d v = _mm512_loadu_pd(f + ii);
+        s0 = _mm512_fmadd_pd(v, _mm512_loadu_pd(a[0] + ii), s0);
+        s1 = _mm512_fmadd_pd(v, _mm512_loadu_pd(a[1] + ii), s1);
+        s2 = _mm512_fmadd_pd(v, _mm512_loadu_pd(a[2] + ii), s2);
+        s3 = _mm512_fmadd_pd(v, _mm512_loadu_pd(a[3] + ii), s3);
+        sf = _mm512_fmadd_pd(v, v, sf);
+    }
+    if (ii < n)
+    {
+        /* Masked tail: inactive lanes load as zero */
+        __mmask8 m = (__mmask8)((1u << (n - ii)) - 1u);
+        __m512d  v = _mm512_maskz_loadu_pd(m, f + ii);
+        s0 = _mm512_fmadd_pd(v, _mm512_maskz_loadu_pd(m, a[0] + ii), s0);
+        s1 = _mm512_fmadd_pd(v, _mm512_maskz_loadu_pd(m, a[1] + ii), s1);
+        s2 = _mm512_fmadd_pd(v, _mm512_maskz_loadu_pd(m, a[2] + ii), s2);
+        s3 = _mm512_fmadd_pd(v, _mm512_maskz_loadu_pd(m, a[3] + ii), s3);
+        sf = _mm512_fmadd_pd(v, v, sf);
+    }
+
+    out[0] = _mm512_reduce_add_pd(s0);
+    out[1] = _mm512_reduce_add_pd(s1);
+    out[2] = _mm512_reduce_add_pd(s2);
+    out[3] = _mm512_reduce_add_pd(s3);
+    out[4] = _mm512_reduce_add_pd(sf);
+}
+
+/**
+ * dist_dot4_f32_avx512() - AVX-512F f.a[k] (k < 4) and f.f (float in, double sum).
+ * @f:   Frame.
+ * @a:   Four anchors.
+ * @n:   Number of elements.
+ * @out: Output; out[0..3] = f.a[k], out[4] = f.f.
+ */
+__attribute__((target("avx512f")))
+static void dist_dot4_f32_avx512(
+    const float *restrict f,
+    const float *const    a[4],
+    long                  n,
+    double               *out)
+{
+    __m512d s0 = _mm512_setzero_pd();
+    __m512d s1 = _mm512_setzero_pd();
+    __m512d s2 = _mm512_setzero_pd();
+    __m512d s3 = _mm512_setzero_pd();
+    __m512d sf = _mm512_setzero_pd();
+    long ii = 0;
+
+    for (; ii + 8 <= n; ii += 8)
+    {
+        __m512d v = _mm512_cvtps_pd(_mm256_loadu_ps(f + ii));
+        s0 = _mm512_fmadd_pd(v, _mm512_cvtps_pd(_mm256_loadu_ps(a[0] + ii)), s0);
+        s1 = _mm512_fmadd_pd(v, _mm512_cvtps_pd(_mm256_loadu_ps(a[1] + ii)), s1);
+        s2 = _mm512_fmadd_pd(v, _mm512_cvtps_pd(_mm256_loadu_ps(a[2] + ii)), s2);
+        s3 = _mm512_fmadd_pd(v, _mm512_cvtps_pd(_mm256_loadu_ps(a[3] + ii)), s3);
+        sf = _mm512_fmadd_pd(v, v, sf);
+    }
+
+    out[0] = _mm512_reduce_add_pd(s0);
+    out[1] = _mm512_reduce_add_pd(s1);
+    out[2] = _mm512_reduce_add_pd(s2);
+    out[3] = _mm512_reduce_add_pd(s3);
+    out[4] = _mm512_reduce_add_pd(sf);
+    for (; ii < n; ii++)
+    {
+        double v = (double)f[ii];
+        out[0] += v * (double)a[0][ii];
+        out[1] += v * (double)a[1][ii];
+        out[2] += v * (double)a[2][ii];
+        out[3] += v * (double)a[3][ii];
+        out[4] += v * v;
+    }
+}
+
+#endif // DIST_HAVE_X86
+
+/* ------------------------------------------------------------------ */
+/* Dispatch                                                            */
+/* ------------------------------------------------------------------ */
+
+static double dist_sq_f64_resolve(const double *a, const double *b, long n);
+static double dist_sq_f32_resolve(const float *a, const float *b, long n);
+
+static DistSqF64Fn dist_sq_f64_impl = dist_sq_f64_resolve;
+static DistSqF32Fn dist_sq_f32_impl = dist_sq_f32_resolve;
+static DistDot4F64Fn dist_dot4_f64_impl = dist_dot4_f64_scalar;
+static DistDot4F32Fn dist_dot4_f32_impl = dist_dot4_f32_scalar;
+static DistIsa     dist_isa_active  = DIST_ISA_SCALAR;
+static int         dist_initialized = 0;
+
+/**
+ * cpu_supports_isa() - Check whether the running CPU can execute @isa.
+ * @isa: Candidate instruction set.
+ *
+ * Return: 1 if supported, 0 otherwise.
+ */
+static int cpu_supports_isa(
+    DistIsa isa)
+{
+    switch (isa)
+    {
+    case DIST_ISA_SCALAR:
+        return 1;
+#ifdef DIST_HAVE_NEON
+    case DIST_ISA_NEON:
+        return 1;
+#endif
+#ifdef DIST_HAVE_X86
+    case DIST_ISA_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case DIST_ISA_AVX512:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return 0;
+    }
+}
+
+/**
+ * dist_kernels_set_isa() - Install the kernels of one instruction set.
+ * @isa: Instruction set to use.
+ *
+ * Return: 0 on success, -1 if @isa is not available on this CPU or build.
+ */
+int dist_kernels_set_isa(
+    DistIsa isa)
+{
+    DistSqF64Fn f64 = dist_sq_f64_scalar;
+    DistSqF32Fn f32 = dist_sq_f32_scalar;
+    DistDot4F64Fn dot64 = dist_dot4_f64_scalar;
+    DistDot4F32Fn dot32 = dist_dot4_f32_scalar;
+
+    if (!cpu_supports_isa(isa))
+    {
+        return -1;
+    }
+
+    switch (isa)
+    {
+#ifdef DIST_HAVE_NEON
+    case DIST_ISA_NEON:
+        f64 = dist_sq_f64_neon;
+        f32 = dist_sq_f32_neon;
+        break;
+#endif
+#ifdef DIST_HAVE_X86
+    case DIST_ISA_AVX2:
+        f64 = dist_sq_f64_avx2;
+        f32 = dist_sq_f32_avx2;
+        dot64 = dist_dot4_f64_avx2;
+        dot32 = dist_dot4_f32_avx2;
+        break;
+    case DIST_ISA_AVX512:
+        f64 = dist_sq_f64_avx512;
+        f32 = dist_sq_f32_avx512;
+        dot64 = dist_dot4_f64_avx512;
+        dot32 = dist_dot4_f32_avx512;
+        break;
+#endif
+    default:
+        break;
+    }
+
+    __atomic_store_n(&dist_sq_f64_impl, f64, __ATOMIC_RELAXED);
+    __atomic_store_n(&dist_sq_f32_impl, f32, __ATOMIC_RELAXED);
+    __atomic_store_n(&dist_dot4_f64_impl, dot64, __ATOMIC_RELAXED);
+    __atomic_store_n(&dist_dot4_f32_impl, dot32, __ATOMIC_RELAXED);
+    __atomic_store_n(&dist_isa_active, isa, __ATOMIC_RELAXED);
+    __atomic_store_n(&dist_initialized, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * dist_kernels_init() - Select the widest kernels supported by this CPU.
+ *
+ * Honours the GRIC_DIST_ISA environment variable as an upper bound.
+ * Called at tool startup; the dispatched entry points also call it lazily
+ * on first use, so forgetting it only costs one extra branch.
+ */
+void dist_kernels_init(void)
+{
+    if (__atomic_load_n(&dist_initialized, __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+
+    DistIsa cap = DIST_ISA_AVX512;
+    const char *env = getenv("GRIC_DIST_ISA");
+    if (env != NULL)
+    {
+        for (int ii = DIST_ISA_SCALAR; ii <= DIST_ISA_AVX512; ii++)
+        {
+            if (strcmp(env, dist_isa_name((DistIsa)ii)) == 0)
+            {
+                cap = (DistIsa)ii;
+            }
+        }
+    }
+
+    for (int ii = cap; ii >= DIST_ISA_SCALAR; ii--)
+    {
+        if (dist_kernels_set_isa((DistIsa)ii) == 0)
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * dist_kernels_isa() - Instruction set currently in use.
+ *
+ * Return: Selected DistIsa.
+ */
+DistIsa dist_kernels_isa(void)
+{
+    dist_kernels_init();
+    return __atomic_load_n(&dist_isa_active, __ATOMIC_RELAXED);
+}
+
+/**
+ * dist_isa_name() - Short name of an instruction set.
+ * @isa: Instruction set.
+ *
+ * Return: Static string.
+ */
+const char *dist_isa_name(
+    DistIsa isa)
+{
+    switch (isa)
+    {
+    case DIST_ISA_NEON:
+        return "neon";
+    case DIST_ISA_AVX2:
+        return "avx2";
+    case DIST_ISA_AVX512:
+        return "avx512";
+    default:
+        return "scalar";
+    }
+}
+
+/**
+ * dist_sq_f64_resolve() - First-call stub: select kernels, then forward.
+ */
+static double dist_sq_f64_resolve(
+    const double *a,
+    const double *b,
+    long          n)
+{
+    dist_kernels_init();
+    return __atomic_load_n(&dist_sq_f64_impl, __ATOMIC_RELAXED)(a, b, n);
+}
+
+/**
+ * dist_sq_f32_resolve() - First-call stub: select kernels, then forward.
+ */
+static double dist_sq_f32_resolve(
+    const float *a,
+    const float *b,
+    long         n)
+{
+    dist_kernels_init();
+    return __atomic_load_n(&dist_sq_f32_impl, __ATOMIC_RELAXED)(a, b, n);
+}
+
+/**
+ * dist_sq_f64() - Dispatched sum of squared differences (double).
+ * @a: First array.
+ * @b: Second array.
+ * @n: Number of elements.
+ *
+ * Return: Sum of (a[i] - b[i])^2.
+ */
+double dist_sq_f64(
+    const double *a,
+    const double *b,
+    long          n)
+{
+    return __atomic_load_n(&dist_sq_f64_impl, __ATOMIC_RELAXED)(a, b, n);
+}
+
+/**
+ * dist_sq_f32() - Dispatched sum of squared differences (float in, double sum).
+ * @a: First array.
+ * @b: Second array.
+ * @n: Number of elements.
+ *
+ * Return: Sum of (a[i] - b[i])^2 computed in double.
+ */
+double dist_sq_f32(
+    const float *a,
+    const float *b,
+    long         n)
+{
+    return __atomic_load_n(&dist_sq_f32_impl, __ATOMIC_RELAXED)(a, b, n);
+}
+
+/**
+ * dist_sq_f64_bounded() - Sum of squared differences with early abandon.
+ * @a:        First array.
+ * @b:        Second array.
+ * @n:        Number of elements.
+ * @limit_sq: Abandon threshold on the partial sum.
+ * @exact:    Output; 1 if the full sum was computed, 0 if abandoned.
+ *
+ * Accumulates DIST_BOUNDED_BLOCK elements at a time with the dispatched
+ * kernel and returns as soon as the partial sum exceeds @limit_sq. Since
+ * every term is non-negative the partial sum is a lower bound on the full
+ * one. The block order changes the summation order, so exact results may
+ * differ from dist_sq_f64() in the last bits.
+ *
+ * Return: Full sum, or a partial sum greater than @limit_sq.
+ */
+double dist_sq_f64_bounded(
+    const double *a,
+    const double *b,
+    long          n,
+    double        limit_sq,
+    int          *exact)
+{
+    double sum = 0.0;
+
+    for (long off = 0; off < n; off += DIST_BOUNDED_BLOCK)
+    {
+        long len = (n - off < DIST_BOUNDED_BLOCK) ? n - off : DIST_BOUNDED_BLOCK;
+        sum += __atomic_load_n(&dist_sq_f64_impl, __ATOMIC_RELAXED)(a + off, b + off, len);
+        if (sum > limit_sq && off + len < n)
+        {
+            *exact = 0;
+            return sum;
+        }
+    }
+    *exact = 1;
+    return sum;
+}
+
+/**
+ * dist_sq_f32_bounded() - Float variant of dist_sq_f64_bounded().
+ * @a:        First array.
+ * @b:        Second array.
+ * @n:        Number of elements.
+ * @limit_sq: Abandon threshold on the partial sum.
+ * @exact:    Output; 1 if the full sum was computed, 0 if abandoned.
+ *
+ * Return: Full sum, or a partial sum greater than @limit_sq.
+ */
+double dist_sq_f32_bounded(
+    const float *a,
+    const float *b,
+    long         n,
+    double       limit_sq,
+    int         *exact)
+{
+    double sum = 0.0;
+
+    for (long off = 0; off < n; off += DIST_BOUNDED_BLOCK)
+    {
+        long len = (n - off < DIST_BOUNDED_BLOCK) ? n - off : DIST_BOUNDED_BLOCK;
+        sum += __atomic_load_n(&dist_sq_f32_impl, __ATOMIC_RELAXED)(a + off, b + off, len);
+        if (sum > limit_sq && off + len < n)
+        {
+            *exact = 0;
+            return sum;
+        }
+    }
+    *exact = 1;
+    return sum;
+}
+
+/**
+ * dist_dot_batch_f64() - Dot products of one frame with many anchors.
+ * @f:       Frame.
+ * @anchors: @na anchor arrays.
+ * @na:      Number of anchors (>= 1).
+ * @n:       Number of elements.
+ * @dot:     Output; dot[k] = f . anchors[k].
+ *
+ * Anchors are processed four at a time so that each block of the frame is
+ * loaded once per group; a short last group repeats its final anchor, whose
+ * extra results are discarded.
+ *
+ * Return: f . f (from the first group).
+ */
+double dist_dot_batch_f64(
+    const double        *f,
+    const double *const *anchors,
+    int                  na,
+    long                 n,
+    double              *dot)
+{
+    dist_kernels_init();
+    DistDot4F64Fn fn = __atomic_load_n(&dist_dot4_f64_impl, __ATOMIC_RELAXED);
+    double        ff = 0.0;
+
+    for (int k0 = 0; k0 < na; k0 += 4)
+    {
+        const double *grp[4];
+        double        out[5];
+        for (int jj = 0; jj < 4; jj++)
+        {
+            grp[jj] = anchors[(k0 + jj < na) ? k0 + jj : na - 1];
+        }
+        fn(f, grp, n, out);
+        for (int jj = 0; jj < 4 && k0 + jj < na; jj++)
+        {
+            dot[k0 + jj] = out[jj];
+        }
+        if (k0 == 0)
+        {
+            ff = out[4];
+        }
+    }
+    return ff;
+}
+
+/**
+ * dist_dot_batch_f32() - Float variant of dist_dot_batch_f64().
+ * @f:       Frame.
+ * @anchors: @na anchor arrays.
+ * @na:      Number of anchors (>= 1).
+ * @n:       Number of elements.
+ * @dot:     Output; dot[k] = f . anchors[k], accumulated in double.
+ *
+ * Return: f . f (from the first group).
+ */
+double dist_dot_batch_f32(
+    const float        *f,
+    const float *const *anchors,
+    int                 na,
+    long                n,
+    double             *dot)
+{
+    dist_kernels_init();
+    DistDot4F32Fn fn = __atomic_load_n(&dist_dot4_f32_impl, __ATOMIC_RELAXED);
+    double        ff = 0.0;
+
+    for (int k0 = 0; k0 < na; k0 += 4)
+    {
+        const float *grp[4];
+        double       out[5];
+        for (int jj = 0; jj < 4; jj++)
+        {
+            grp[jj] = anchors[(k0 + jj < na) ? k0 + jj : na - 1];
+        }
+        fn(f, grp, n, out);
+        for (int jj = 0; jj < 4 && k0 + jj < na; jj++)
+        {
+            dot[k0 + jj] = out[jj];
+        }
+        if (k0 == 0)
+        {
+            ff = out[4];
+        }
+    }
+    return ff;
+}
@@ -0,0 +1,114 @@
+#ifndef DIST_KERNELS_H
+#define DIST_KERNELS_H
+
+/**
+ * @file dist_kernels.h
+ * @brief Runtime-dispatched squared-L2 distance kernels shared by all tools.
+ */
+
+#include <math.h>
+
+/** Elements per block between early-abandon checks of the bounded kernels. */
+#define DIST_BOUNDED_BLOCK 2048
+
+/** Instruction set selected for the distance kernels. */
+typedef enum
+{
+    DIST_ISA_SCALAR = 0, /**< Portable C, 4 accumulators */
+    DIST_ISA_NEON,       /**< AArch64 Advanced SIMD */
+    DIST_ISA_AVX2,       /**< AVX2 + FMA, 4 x 256-bit accumulators */
+    DIST_ISA_AVX512      /**< AVX-512F, 4 x 512-bit accumulators */
+} DistIsa;
+
+/**
+ * @brief Select kernels from CPUID (or GRIC_DIST_ISA); safe to call repeatedly.
+ */
+void dist_kernels_init(void);
+
+/**
+ * @brief Force a kernel ISA; returns 0 on success, -1 if the CPU lacks it.
+ */
+int dist_kernels_set_isa(
+    DistIsa isa);
+
+/**
+ * @brief ISA currently selected.
+ */
+DistIsa dist_kernels_isa(void);
+
+/**
+ * @brief Short name ("scalar", "neon", "avx2", "avx512") of @isa.
+ */
+const char *dist_isa_name(
+    DistIsa isa);
+
+/**
+ * @brief Sum of squared differences of two double arrays.
+ */
+double dist_sq_f64(
+    const double *a,
+    const double *b,
+    long          n);
+
+/**
+ * @brief Sum of squared differences of two float arrays, accumulated in double.
+ */
+double dist_sq_f32(
+    const float *a,
+    const float *b,
+    long         n);
+
+/**
+ * @brief Squared distance that stops once the partial sum exceeds @limit_sq.
+ *
+ * Sets *@exact to 0 and returns the partial sum (a lower bound) when abandoned.
+ */
+double dist_sq_f64_bounded(
+    const double *a,
+    const double *b,
+    long          n,
+    double        limit_sq,
+    int          *exact);
+
+/**
+ * @brief Float variant of dist_sq_f64_bounded().
+ */
+double dist_sq_f32_bounded(
+    const float *a,
+    const float *b,
+    long         n,
+    double       limit_sq,
+    int         *exact);
+
+/**
+ * @brief Dot products of @f with @na anchors in one pass over @f; returns f.f.
+ */
+double dist_dot_batch_f64(
+    const double        *f,
+    const double *const *anchors,
+    int                  na,
+    long                 n,
+    double              *dot);
+
+/**
+ * @brief Float variant of dist_dot_batch_f64(); sums are accumulated in double.
+ */
+double dist_dot_batch_f32(
+    const float        *f,
+    const float *const *anchors,
+    int                 na,
+    long                n,
+    double             *dot);
+
+/**
+ * @brief Euclidean distance between two double arrays.
+ */
+static inline double dist_l2_f64(
+    const double *a,
+    const double *b,
+    long          n)
+{
+    return sqrt(dist_sq_f64(a, b, n));
+}
+
+#endif // DIST_KERNELS_H
@@ -0,0 +1,778 @@
+/**
+ * @file gricbin.c
+ * @brief Memory-mapped ASCII coordinate files and their binary .gricbin sidecars.
+ *
+ * ASCII coordinate logs (one frame per line, whitespace-separated values) are
+ * mapped read-only instead of being read through stdio. The line index is
+ * built by scanning the mapping in parallel chunks (count line starts per
+ * chunk, prefix-sum, then fill), and values are parsed straight from the
+ * mapping with a decimal fast path, so random access to frame i costs one
+ * index lookup and no system call.
+ *
+ * A sidecar (<file>.gricbin) stores the parsed values as a contiguous
+ * row-major matrix behind a 4 KiB header. Mapping it makes later runs skip
+ * text parsing entirely. The header records the size and modification time
+ * of the source, and a sidecar that no longer matches is ignored. Sidecar
+ * rows follow gric-cluster frame numbering (one row per line).
+ *
+ * Main Functions:
+ * - ascii_map_open / ascii_map_close: Map and index an ASCII file.
+ * - gric_parse_doubles: Fast whitespace-separated number parser.
+ * - gricbin_open / gricbin_close: Map a valid sidecar.
+ * - gricbin_write: Build a sidecar from a mapped ASCII file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#include "gricbin.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static const char gricbin_magic[8] = "GRICBIN";
+
+/* Powers of ten that are exact in binary64 */
+static const double pow10_exact[23] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/* Target size of one parse block of gricbin_write() */
+#define GRICBIN_BLOCK_BYTES (4L << 20)
+
+static inline int is_space(
+    char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/**
+ * parse_fast() - Convert a plain decimal literal whose value is exact to compute.
+ * @p:    Start of the token.
+ * @end:  End of the buffer.
+ * @v:    Output value.
+ * @next: Output position after the token.
+ *
+ * Handles [sign] digits [. digits] [e [sign] digits] with at most 19
+ * significant digits, a mantissa below 2^53 and a decimal exponent within
+ * +/-22: mantissa and power of ten are then both exact doubles and a single
+ * multiply or divide rounds correctly (Clinger's fast path).
+ *
+ * Return: 1 if converted, 0 if the caller must fall back to strtod().
+ */
+static int parse_fast(
+    const char  *p,
+    const char  *end,
+    double      *v,
+    const char **next)
+{
+    const char *s = p;
+    int neg = 0;
+    uint64_t mant = 0;
+    int sig = 0;
+    int exp10 = 0;
+    int ndigits = 0;
+
+    if (s < end && (*s == '-' || *s == '+'))
+    {
+        neg = (*s == '-');
+        s++;
+    }
+    for (; s < end && *s >= '0' && *s <= '9'; s++)
+    {
+        ndigits++;
+        if (mant != 0 || *s != '0')
+        {
+            if (++sig > 19)
+            {
+                return 0;
+            }
+            mant = mant * 10 + (uint64_t)(*s - '0');
+        }
+    }
+    if (s < end && *s == '.')
+    {
+        s++;
+        for (; s < end && *s >= '0' && *s <= '9'; s++)
+        {
+            ndigits++;
+            if (mant != 0 || *s != '0')
+            {
+                if (++sig > 19)
+                {
+                    return 0;
+                }
+                mant = mant * 10 + (uint64_t)(*s - '0');
+            }
+            exp10--;
+        }
+    }
+    if (ndigits == 0)
+    {
+        return 0;
+    }
+    if (s < end && (*s == 'e' || *s == 'E'))
+    {
+        s++;
+        int eneg = 0;
+        int e = 0;
+        if (s < end && (*s == '-' || *s == '+'))
+        {
+            eneg = (*s == '-');
+            s++;
+        }
+        if (s == end || *s < '0' || *s > '9')
+        {
+            return 0;
+        }
+        for (; s < end && *s >= '0' && *s <= '9'; s++)
+        {
+            if (e > 10000)
+            {
+                return 0;
+            }
+            e = e * 10 + (*s - '0');
+        }
+        exp10 += eneg ? -e : e;
+    }
+    if (s < end && !is_space(*s))
+    {
+        return 0;
+    }
+
+    double d;
+    if (mant == 0)
+    {
+        d = 0.0;
+    }
+    else if (mant > (1ULL << 53) || exp10 < -22 || exp10 > 22)
+    {
+        return 0;
+    }
+    else if (exp10 >= 0)
+    {
+        d = (double)mant * pow10_exact[exp10];
+    }
+    else
+    {
+        d = (double)mant / pow10_exact[-exp10];
+    }
+    *v = neg ? -d : d;
+    *next = s;
+    return 1;
+}
+
+/**
+ * parse_slow() - Convert one token with strtod().
+ * @p:    Start of the token.
+ * @end:  End of the buffer.
+ * @v:    Output value.
+ * @next: Output position after the consumed characters.
+ *
+ * Return: 1 if a number was read, 0 otherwise.
+ */
+static int parse_slow(
+    const char  *p,
+    const char  *end,
+    double      *v,
+    const char **next)
+{
+    char stackbuf[128];
+    size_t len = 0;
+    while (p + len < end && !is_space(p[len]))
+    {
+        len++;
+    }
+
+    char *buf = stackbuf;
+    if (len >= sizeof(stackbuf))
+    {
+        buf = (char *)malloc(len + 1);
+        if (buf == NULL)
+        {
+            return 0;
+        }
+    }
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+
+    char *stop;
+    *v = strtod(buf, &stop);
+    size_t used = (size_t)(stop - buf);
+    if (buf != stackbuf)
+    {
+        free(buf);
+    }
+    if (used == 0)
+    {
+        return 0;
+    }
+    *next = p + used;
+    return 1;
+}
+
+/**
+ * gric_parse_doubles() - Parse whitespace-separated numbers from a buffer.
+ * @p:    Start of the text.
+ * @end:  End of the text (no terminator needed).
+ * @out:  Output values.
+ * @n:    Maximum number of values.
+ * @stop: Output position after the last value parsed, or NULL.
+ *
+ * Whitespace, including newlines, is skipped like fscanf("%lf") does.
+ *
+ * Return: Number of values parsed; less than @n on a malformed token or end of text.
+ */
+long gric_parse_doubles(
+    const char  *p,
+    const char  *end,
+    double      *out,
+    long         n,
+    const char **stop)
+{
+    long count = 0;
+    while (count < n)
+    {
+        while (p < end && is_space(*p))
+        {
+            p++;
+        }
+        if (p == end)
+        {
+            break;
+        }
+        const char *next;
+        if (!parse_fast(p, end, &out[count], &next) && !parse_slow(p, end, &out[count], &next))
+        {
+            break;
+        }
+        p = next;
+        count++;
+    }
+    if (stop != NULL)
+    {
+        *stop = p;
+    }
+    return count;
+}
+
+/**
+ * is_line_start() - Check whether byte @pos of @map starts an indexed line.
+ * @map:           Mapped file.
+ * @pos:           Byte position (< map->size).
+ * @skip_comments: Ignore comment and empty lines.
+ *
+ * Return: 1 if a line to index starts at @pos.
+ */
+static inline int is_line_start(
+    const AsciiMap *map,
+    size_t          pos,
+    int             skip_comments)
+{
+    if (pos > 0 && map->data[pos - 1] != '\n')
+    {
+        return 0;
+    }
+    if (skip_comments)
+    {
+        char c = map->data[pos];
+        return c != '#' && c != '\n' && c != '\0';
+    }
+    return 1;
+}
+
+/**
+ * scan_chunk() - Count (and optionally record) line starts in [@lo, @hi).
+ * @map:           Mapped file.
+ * @lo:            First byte position.
+ * @hi:            End byte position.
+ * @skip_comments: Ignore comment and empty lines.
+ * @out:           Offsets output, or NULL to count only.
+ *
+ * Return: Number of line starts found.
+ */
+static long scan_chunk(
+    const AsciiMap *map,
+    size_t          lo,
+    size_t          hi,
+    int             skip_comments,
+    uint64_t       *out)
+{
+    long count = 0;
+    size_t pos = lo;
+
+    if (pos < hi && !is_line_start(map, pos, skip_comments))
+    {
+        /* Skip to the first candidate after a newline */
+        const char *nl = memchr(map->data + pos, '\n', hi - pos);
+        pos = (nl == NULL) ? hi : (size_t)(nl - map->data) + 1;
+    }
+    while (pos < hi)
+    {
+        if (is_line_start(map, pos, skip_comments))
+        {
+            if (out != NULL)
+            {
+                out[count] = pos;
+            }
+            count++;
+        }
+        const char *nl = memchr(map->data + pos, '\n', hi - pos);
+        if (nl == NULL)
+        {
+            break;
+        }
+        pos = (size_t)(nl - map->data) + 1;
+    }
+    return count;
+}
+
+/**
+ * ascii_map_open() - Map an ASCII coordinate file and index its lines.
+ * @map:           Output mapping.
+ * @path:          File path.
+ * @skip_comments: Do not index lines starting with '#' or empty lines.
+ *
+ * Return: 0 on success, -1 on failure (message printed).
+ */
+int ascii_map_open(
+    AsciiMap   *map,
+    const char *path,
+    int         skip_comments)
+{
+    memset(map, 0, sizeof(*map));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] cannot open '%s': %s\n", __FILE__, __LINE__, path,
+                strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    map->size = (size_t)st.st_size;
+    if (map->size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    void *addr = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] cannot map '%s': %s\n", __FILE__, __LINE__, path,
+                strerror(errno));
+        map->size = 0;
+        return -1;
+    }
+    map->data = (const char *)addr;
+    posix_madvise(addr, map->size, POSIX_MADV_SEQUENTIAL);
+
+    int nchunks = 1;
+#ifdef _OPENMP
+    if (map->size >= (1 << 20))
+    {
+        nchunks = omp_get_max_threads();
+    }
+#endif
+    long *counts = (long *)calloc((size_t)nchunks + 1, sizeof(long));
+    if (counts == NULL)
+    {
+        ascii_map_close(map);
+        return -1;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) if (nchunks > 1)
+#endif
+    for (int ii = 0; ii < nchunks; ii++)
+    {
+        size_t lo = map->size / nchunks * ii;
+        size_t hi = (ii == nchunks - 1) ? map->size : map->size / nchunks * (ii + 1);
+        counts[ii + 1] = scan_chunk(map, lo, hi, skip_comments, NULL);
+    }
+    for (int ii = 0; ii < nchunks; ii++)
+    {
+        counts[ii + 1] += counts[ii];
+    }
+
+    map->num_lines = counts[nchunks];
+    map->line_offsets = (uint64_t *)malloc((size_t)(map->num_lines + 1) * sizeof(uint64_t));
+    if (map->line_offsets == NULL)
+    {
+        free(counts);
+        ascii_map_close(map);
+        return -1;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) if (nchunks > 1)
+#endif
+    for (int ii = 0; ii < nchunks; ii++)
+    {
+        size_t lo = map->size / nchunks * ii;
+        size_t hi = (ii == nchunks - 1) ? map->size : map->size / nchunks * (ii + 1);
+        scan_chunk(map, lo, hi, skip_comments, map->line_offsets + counts[ii]);
+    }
+    free(counts);
+
+    posix_madvise(addr, map->size, POSIX_MADV_RANDOM);
+    return 0;
+}
+
+/**
+ * ascii_map_close() - Unmap an ASCII file and free its line index.
+ * @map: Mapping to release (may be zeroed).
+ */
+void ascii_map_close(
+    AsciiMap *map)
+{
+    if (map->data != NULL)
+    {
+        munmap((void *)map->data, map->size);
+    }
+    free(map->line_offsets);
+    memset(map, 0, sizeof(*map));
+}
+
+/**
+ * ascii_map_count_columns() - Count tokens on one indexed line.
+ * @map:  Mapped file.
+ * @line: Indexed line number.
+ *
+ * Return: Token count, 0 if @line is out of range.
+ */
+long ascii_map_count_columns(
+    const AsciiMap *map,
+    long            line)
+{
+    if (line < 0 || line >= map->num_lines)
+    {
+        return 0;
+    }
+
+    const char *p = map->data + map->line_offsets[line];
+    const char *end = map->data + map->size;
+    long cols = 0;
+    int in_num = 0;
+    for (; p < end && *p != '\n'; p++)
+    {
+        if (!is_space(*p))
+        {
+            if (!in_num)
+            {
+                cols++;
+                in_num = 1;
+            }
+        }
+        else
+        {
+            in_num = 0;
+        }
+    }
+    return cols;
+}
+
+/**
+ * ascii_map_read_line() - Parse the values of one indexed line.
+ * @map:  Mapped file.
+ * @line: Indexed line number.
+ * @out:  Output values.
+ * @n:    Number of values to read.
+ *
+ * Return: Number of values parsed.
+ */
+long ascii_map_read_line(
+    const AsciiMap *map,
+    long            line,
+    double         *out,
+    long            n)
+{
+    if (line < 0 || line >= map->num_lines)
+    {
+        return 0;
+    }
+    return gric_parse_doubles(map->data + map->line_offsets[line], map->data + map->size, out,
+                              n, NULL);
+}
+
+/**
+ * sidecar_path() - Build "<src_path>.gricbin".
+ * @src_path: ASCII file path.
+ *
+ * Return: Newly allocated path, or NULL on allocation failure.
+ */
+static char *sidecar_path(
+    const char *src_path)
+{
+    size_t len = strlen(src_path) + sizeof(GRICBIN_SUFFIX);
+    char *path = (char *)malloc(len);
+    if (path != NULL)
+    {
+        snprintf(path, len, "%s%s", src_path, GRICBIN_SUFFIX);
+    }
+    return path;
+}
+
+static size_t dtype_size(
+    uint32_t dtype)
+{
+    return (dtype == GRICBIN_F32) ? sizeof(float) : sizeof(double);
+}
+
+/**
+ * gricbin_open() - Map the sidecar of an ASCII file if it is current.
+ * @bin:      Output mapping.
+ * @src_path: ASCII file path.
+ *
+ * Return: 0 if a valid sidecar was mapped, -1 otherwise.
+ */
+int gricbin_open(
+    GricBin    *bin,
+    const char *src_path)
+{
+    memset(bin, 0, sizeof(*bin));
+
+    struct stat src_st;
+    if (stat(src_path, &src_st) != 0)
+    {
+        return -1;
+    }
+    char *path = sidecar_path(src_path);
+    if (path == NULL)
+    {
+        return -1;
+    }
+    int fd = open(path, O_RDONLY);
+    free(path);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < GRICBIN_DATA_OFFSET)
+    {
+        close(fd);
+        return -1;
+    }
+    void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    const GricBinHeader *hdr = (const GricBinHeader *)addr;
+    int64_t mtime_ns = (int64_t)src_st.st_mtim.tv_sec * 1000000000LL + src_st.st_mtim.tv_nsec;
+    size_t need = hdr->data_offset + hdr->num_frames * hdr->width * dtype_size(hdr->dtype);
+    if (memcmp(hdr->magic, gricbin_magic, sizeof(gricbin_magic)) != 0
+        || hdr->version != GRICBIN_VERSION
+        || (hdr->dtype != GRICBIN_F64 && hdr->dtype != GRICBIN_F32)
+        || hdr->src_size != (uint64_t)src_st.st_size || hdr->src_mtime_ns != mtime_ns
+        || hdr->data_offset < sizeof(GricBinHeader) || need > (size_t)st.st_size)
+    {
+        munmap(addr, (size_t)st.st_size);
+        return -1;
+    }
+
+    bin->hdr = hdr;
+    bin->rows = (const char *)addr + hdr->data_offset;
+    bin->size = (size_t)st.st_size;
+    return 0;
+}
+
+/**
+ * gricbin_close() - Unmap a sidecar.
+ * @bin: Mapping to release (may be zeroed).
+ */
+void gricbin_close(
+    GricBin *bin)
+{
+    if (bin->hdr != NULL)
+    {
+        munmap((void *)bin->hdr, bin->size);
+    }
+    memset(bin, 0, sizeof(*bin));
+}
+
+/**
+ * gricbin_read_row() - Copy one sidecar row as doubles.
+ * @bin: Mapped sidecar.
+ * @row: Row index (< num_frames).
+ * @out: Output values (width entries).
+ */
+void gricbin_read_row(
+    const GricBin *bin,
+    long           row,
+    double        *out)
+{
+    long width = (long)bin->hdr->width;
+    if (bin->hdr->dtype == GRICBIN_F32)
+    {
+        const float *src = (const float *)gricbin_row(bin, row);
+        for (long ii = 0; ii < width; ii++)
+        {
+            out[ii] = src[ii];
+        }
+    }
+    else
+    {
+        memcpy(out, gricbin_row(bin, row), (size_t)width * sizeof(double));
+    }
+}
+
+/**
+ * gricbin_write() - Parse a mapped ASCII file into its sidecar.
+ * @map:      Mapped file, indexed without skipping comments.
+ * @src_path: ASCII file path (the sidecar is written next to it).
+ * @width:    Values per line.
+ * @dtype:    Stored sample type.
+ *
+ * Lines are parsed in parallel one block at a time and appended to a
+ * temporary file that is renamed over the sidecar once complete, so readers
+ * never map a partial file.
+ *
+ * Return: Number of rows written, or -1 on failure.
+ */
+long gricbin_write(
+    const AsciiMap *map,
+    const char     *src_path,
+    long            width,
+    GricBinDType    dtype)
+{
+    struct stat src_st;
+    if (width < 1 || stat(src_path, &src_st) != 0)
+    {
+        return -1;
+    }
+
+    char *path = sidecar_path(src_path);
+    if (path == NULL)
+    {
+        return -1;
+    }
+    size_t tmplen = strlen(path) + 5;
+    char *tmp = (char *)malloc(tmplen);
+    if (tmp == NULL)
+    {
+        free(path);
+        return -1;
+    }
+    snprintf(tmp, tmplen, "%s.tmp", path);
+
+    long block = GRICBIN_BLOCK_BYTES / (long)(width * sizeof(double));
+    if (block < 1)
+    {
+        block = 1;
+    }
+    size_t esize = dtype_size(dtype);
+    double *vals = (double *)malloc((size_t)block * width * sizeof(double));
+    long *ok = (long *)malloc((size_t)block * sizeof(long));
+    float *fvals = (dtype == GRICBIN_F32) ? (float *)malloc((size_t)block * width * esize) : NULL;
+    FILE *f = fopen(tmp, "wb");
+    if (vals == NULL || ok == NULL || (dtype == GRICBIN_F32 && fvals == NULL) || f == NULL)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] cannot write sidecar '%s'\n", __FILE__, __LINE__, tmp);
+        if (f != NULL)
+        {
+            fclose(f);
+            remove(tmp);
+        }
+        free(vals);
+        free(ok);
+        free(fvals);
+        free(tmp);
+        free(path);
+        return -1;
+    }
+
+    GricBinHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, gricbin_magic, sizeof(gricbin_magic));
+    hdr.version = GRICBIN_VERSION;
+    hdr.dtype = (uint32_t)dtype;
+    hdr.width = (uint64_t)width;
+    hdr.src_size = (uint64_t)src_st.st_size;
+    hdr.src_mtime_ns = (int64_t)src_st.st_mtim.tv_sec * 1000000000LL + src_st.st_mtim.tv_nsec;
+    hdr.data_offset = GRICBIN_DATA_OFFSET;
+
+    int err = (fseeko(f, GRICBIN_DATA_OFFSET, SEEK_SET) != 0);
+    long rows = 0;
+    int done = 0;
+    for (long start = 0; start < map->num_lines && !done && !err; start += block)
+    {
+        long nb = (map->num_lines - start < block) ? map->num_lines - start : block;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (long ii = 0; ii < nb; ii++)
+        {
+            ok[ii] = ascii_map_read_line(map, start + ii, vals + ii * width, width);
+        }
+
+        long good = 0;
+        while (good < nb && ok[good] == width)
+        {
+            good++;
+        }
+        done = (good < nb);
+
+        const void *src = vals;
+        if (dtype == GRICBIN_F32)
+        {
+            for (long ii = 0; ii < good * width; ii++)
+            {
+                fvals[ii] = (float)vals[ii];
+            }
+            src = fvals;
+        }
+        if (good > 0 && fwrite(src, esize * width, (size_t)good, f) != (size_t)good)
+        {
+            err = 1;
+        }
+        rows += good;
+    }
+
+    hdr.num_frames = (uint64_t)rows;
+    if (!err)
+    {
+        err = (fseeko(f, 0, SEEK_SET) != 0 || fwrite(&hdr, sizeof(hdr), 1, f) != 1);
+    }
+    if (fclose(f) != 0)
+    {
+        err = 1;
+    }
+    if (!err && rename(tmp, path) != 0)
+    {
+        err = 1;
+    }
+    if (err)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] cannot write sidecar '%s': %s\n", __FILE__, __LINE__,
+                path, strerror(errno));
+        remove(tmp);
+        rows = -1;
+    }
+
+    free(vals);
+    free(ok);
+    free(fvals);
+    free(tmp);
+    free(path);
+    return rows;
+}
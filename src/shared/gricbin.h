@@ -0,0 +1,153 @@
+#ifndef GRICBIN_H
+#define GRICBIN_H
+
+/**
+ * @file gricbin.h
+ * @brief Memory-mapped ASCII coordinate files and their binary .gricbin sidecars.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Sidecar file name suffix appended to the ASCII path. */
+#define GRICBIN_SUFFIX ".gricbin"
+
+/** On-disk format version. */
+#define GRICBIN_VERSION 1
+
+/** Byte offset of the sample matrix (page aligned). */
+#define GRICBIN_DATA_OFFSET 4096
+
+/** Sample type of a sidecar matrix. */
+typedef enum
+{
+    GRICBIN_F64 = 0, /**< IEEE double */
+    GRICBIN_F32 = 1  /**< IEEE float */
+} GricBinDType;
+
+/** Sidecar header, stored in host byte order at offset 0. */
+typedef struct
+{
+    char     magic[8];     /**< "GRICBIN\0" */
+    uint32_t version;      /**< GRICBIN_VERSION */
+    uint32_t dtype;        /**< GricBinDType */
+    uint64_t num_frames;   /**< Rows (one per ASCII line) */
+    uint64_t width;        /**< Values per row */
+    uint64_t src_size;     /**< Size of the ASCII file the sidecar was built from */
+    int64_t  src_mtime_ns; /**< Modification time of that file */
+    uint64_t data_offset;  /**< Byte offset of row 0 */
+    uint64_t reserved;
+} GricBinHeader;
+
+/** Read-only mapping of an ASCII coordinate file with its line index. */
+typedef struct
+{
+    const char *data;         /**< Mapped file contents (not NUL-terminated) */
+    size_t      size;         /**< File size in bytes */
+    uint64_t   *line_offsets; /**< Byte offset of each indexed line */
+    long        num_lines;    /**< Indexed lines */
+} AsciiMap;
+
+/** Read-only mapping of a .gricbin sidecar. */
+typedef struct
+{
+    const GricBinHeader *hdr;  /**< Mapped header */
+    const char          *rows; /**< Row 0 of the sample matrix */
+    size_t               size; /**< Mapped bytes */
+} GricBin;
+
+/**
+ * @brief Map @path and index its lines in parallel; returns 0 on success, -1 on failure.
+ *
+ * With @skip_comments, lines starting with '#' and empty lines are not indexed.
+ */
+int ascii_map_open(
+    AsciiMap   *map,
+    const char *path,
+    int         skip_comments);
+
+/**
+ * @brief Unmap @map and free its index.
+ */
+void ascii_map_close(
+    AsciiMap *map);
+
+/**
+ * @brief Number of whitespace-separated tokens on indexed line @line.
+ */
+long ascii_map_count_columns(
+    const AsciiMap *map,
+    long            line);
+
+/**
+ * @brief Parse up to @n numbers of indexed line @line (continuing past its end like
+ *        fscanf); returns the count parsed.
+ */
+long ascii_map_read_line(
+    const AsciiMap *map,
+    long            line,
+    double         *out,
+    long            n);
+
+/**
+ * @brief Parse up to @n whitespace-separated numbers from [@p, @end).
+ *
+ * Decimal literals that fit a double exactly are converted directly; anything
+ * else goes through strtod(), so values match fscanf("%lf") bit for bit.
+ * Returns the count parsed; the position after the last value goes to @stop
+ * unless it is NULL.
+ */
+long gric_parse_doubles(
+    const char  *p,
+    const char  *end,
+    double      *out,
+    long         n,
+    const char **stop);
+
+/**
+ * @brief Map the sidecar of @src_path if it exists and matches the current source file.
+ *
+ * Returns 0 on success, -1 if there is no valid sidecar (not an error).
+ */
+int gricbin_open(
+    GricBin    *bin,
+    const char *src_path);
+
+/**
+ * @brief Unmap @bin.
+ */
+void gricbin_close(
+    GricBin *bin);
+
+/**
+ * @brief Copy row @row of @bin into @out as doubles.
+ */
+void gricbin_read_row(
+    const GricBin *bin,
+    long           row,
+    double        *out);
+
+/**
+ * @brief Address of row @row of @bin in its stored type.
+ */
+static inline const void *gricbin_row(
+    const GricBin *bin,
+    long           row)
+{
+    size_t esize = (bin->hdr->dtype == GRICBIN_F32) ? sizeof(float) : sizeof(double);
+    return bin->rows + (size_t)row * bin->hdr->width * esize;
+}
+
+/**
+ * @brief Parse every line of @map into @src_path's sidecar (atomically replaced).
+ *
+ * Rows from the first line that does not hold @width numbers onward are left
+ * out. Returns the number of rows written, or -1 on failure.
+ */
+long gricbin_write(
+    const AsciiMap *map,
+    const char     *src_path,
+    long            width,
+    GricBinDType    dtype);
+
+#endif // GRICBIN_H
@@ -0,0 +1,463 @@
+/**
+ * @file gricres.c
+ * @brief Binary results bundle of a gric-cluster run (results.gricres).
+ *
+ * The writer streams the membership column into the file as frames are
+ * assigned and spools the distance column to a temporary file, so the run
+ * never holds either in memory. When the first summary section starts, both
+ * columns are closed; the remaining sections (DCC, clusters, anchors) follow
+ * and the header with its section table is written last. The bundle is
+ * built under <path>.tmp and renamed into place once complete, so readers
+ * never see a partial file.
+ *
+ * Readers map the bundle read-only and use the columns in place.
+ *
+ * Main Functions:
+ * - gricres_open / gricres_close: Map and validate a bundle.
+ * - gricres_section: Locate a section in the mapping.
+ * - gricres_writer_open / gricres_writer_frame: Start a bundle, append frames.
+ * - gricres_writer_begin / gricres_writer_put: Append a summary section.
+ * - gricres_writer_finish / gricres_writer_abort: Complete or drop a bundle.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#include "gricres.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char gricres_magic[8] = "GRICRES";
+
+/* Element size expected for each known section (0: unknown id) */
+static uint32_t section_elem_size(
+    uint32_t id)
+{
+    switch (id)
+    {
+    case GRICRES_SEC_MEMBERSHIP:
+        return sizeof(int32_t);
+    case GRICRES_SEC_DIST:
+    case GRICRES_SEC_ANCHORS:
+        return sizeof(double);
+    case GRICRES_SEC_DCC:
+        return sizeof(GricResDcc);
+    case GRICRES_SEC_CLUSTERS:
+        return sizeof(GricResCluster);
+    default:
+        return 0;
+    }
+}
+
+/**
+ * gricres_open() - Map a results bundle.
+ * @res:  Output mapping.
+ * @path: Bundle path.
+ *
+ * Checks magic, version, section bounds and the element size of every known
+ * section; unknown sections are kept and ignored.
+ *
+ * Return: 0 on success, -1 if the file is missing or not a valid bundle.
+ */
+int gricres_open(
+    GricRes    *res,
+    const char *path)
+{
+    memset(res, 0, sizeof(*res));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < GRICRES_HEADER_BYTES)
+    {
+        close(fd);
+        return -1;
+    }
+    void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    const GricResHeader *hdr = (const GricResHeader *)addr;
+    uint64_t size = (uint64_t)st.st_size;
+    int valid = memcmp(hdr->magic, gricres_magic, sizeof(gricres_magic)) == 0
+                && hdr->version == GRICRES_VERSION
+                && hdr->num_sections <= GRICRES_MAX_SECTIONS;
+    for (uint32_t ii = 0; valid && ii < hdr->num_sections; ii++)
+    {
+        const GricResSection *s = &hdr->sections[ii];
+        uint32_t expect = section_elem_size(s->id);
+        valid = s->elem_size > 0 && (expect == 0 || s->elem_size == expect)
+                && s->offset >= GRICRES_HEADER_BYTES && s->offset % GRICRES_ALIGN == 0
+                && s->offset <= size && s->count <= (size - s->offset) / s->elem_size;
+    }
+    if (!valid)
+    {
+        munmap(addr, (size_t)st.st_size);
+        return -1;
+    }
+
+    res->hdr = hdr;
+    res->size = (size_t)st.st_size;
+    return 0;
+}
+
+/**
+ * gricres_close() - Unmap a results bundle.
+ * @res: Mapping; zeroed on return.
+ */
+void gricres_close(
+    GricRes *res)
+{
+    if (res->hdr != NULL)
+    {
+        munmap((void *)res->hdr, res->size);
+    }
+    memset(res, 0, sizeof(*res));
+}
+
+/**
+ * gricres_section() - Locate a section of a mapped bundle.
+ * @res:   Mapping.
+ * @id:    Section identifier (GricResSectionId).
+ * @count: Output element count, or NULL.
+ *
+ * Return: Start of the section in the mapping, or NULL if the bundle has none.
+ */
+const void *gricres_section(
+    const GricRes *res,
+    uint32_t       id,
+    uint64_t      *count)
+{
+    if (res->hdr == NULL)
+    {
+        return NULL;
+    }
+    for (uint32_t ii = 0; ii < res->hdr->num_sections; ii++)
+    {
+        const GricResSection *s = &res->hdr->sections[ii];
+        if (s->id == id)
+        {
+            if (count != NULL)
+            {
+                *count = s->count;
+            }
+            return (const char *)res->hdr + s->offset;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * put_bytes() - Append raw bytes to the bundle.
+ * @w:    Writer.
+ * @data: Bytes, or NULL for zeros.
+ * @n:    Byte count.
+ */
+static void put_bytes(
+    GricResWriter *w,
+    const void    *data,
+    size_t         n)
+{
+    static const char zeros[GRICRES_ALIGN] = {0};
+    if (w->err || n == 0)
+    {
+        return;
+    }
+    if (data != NULL)
+    {
+        if (fwrite(data, 1, n, w->f) != n)
+        {
+            w->err = 1;
+        }
+    }
+    else
+    {
+        for (size_t left = n; left > 0 && !w->err;)
+        {
+            size_t chunk = left < sizeof(zeros) ? left : sizeof(zeros);
+            if (fwrite(zeros, 1, chunk, w->f) != chunk)
+            {
+                w->err = 1;
+            }
+            left -= chunk;
+        }
+    }
+    w->pos += n;
+}
+
+/**
+ * close_section() - Set the element count of the section still growing, if any.
+ * @w: Writer.
+ */
+static void close_section(
+    GricResWriter *w)
+{
+    if (w->section_open)
+    {
+        GricResSection *s = &w->sections[w->num_sections - 1];
+        s->count = (w->pos - s->offset) / s->elem_size;
+        w->section_open = 0;
+    }
+}
+
+/**
+ * open_section() - Start a section at the next aligned position.
+ * @w:         Writer.
+ * @id:        Section identifier.
+ * @elem_size: Bytes per element.
+ */
+static void open_section(
+    GricResWriter *w,
+    uint32_t       id,
+    uint32_t       elem_size)
+{
+    close_section(w);
+    if (w->num_sections >= GRICRES_MAX_SECTIONS)
+    {
+        w->err = 1;
+        return;
+    }
+    put_bytes(w, NULL, (size_t)((GRICRES_ALIGN - w->pos % GRICRES_ALIGN) % GRICRES_ALIGN));
+
+    GricResSection *s = &w->sections[w->num_sections++];
+    s->id = id;
+    s->elem_size = elem_size;
+    s->offset = w->pos;
+    s->count = 0;
+    w->section_open = 1;
+}
+
+/**
+ * end_frames() - Close the membership column and write the distance column.
+ * @w: Writer.
+ *
+ * The spooled distances are copied behind the membership column.
+ */
+static void end_frames(
+    GricResWriter *w)
+{
+    if (w->frames_done)
+    {
+        return;
+    }
+    w->frames_done = 1;
+
+    open_section(w, GRICRES_SEC_DIST, sizeof(double));
+    if (w->spool == NULL)
+    {
+        w->err = 1;
+        return;
+    }
+    char buf[1 << 16];
+    size_t n;
+    rewind(w->spool);
+    while (!w->err && (n = fread(buf, 1, sizeof(buf), w->spool)) > 0)
+    {
+        put_bytes(w, buf, n);
+    }
+    if (ferror(w->spool))
+    {
+        w->err = 1;
+    }
+    fclose(w->spool);
+    w->spool = NULL;
+}
+
+/**
+ * gricres_writer_open() - Start a results bundle.
+ * @w:    Writer; overwritten.
+ * @path: Final bundle path; the bundle is built in @path.tmp.
+ *
+ * Return: 0 on success, -1 on failure (message printed).
+ */
+int gricres_writer_open(
+    GricResWriter *w,
+    const char    *path)
+{
+    memset(w, 0, sizeof(*w));
+
+    size_t len = strlen(path);
+    w->path = (char *)malloc(len + 1);
+    w->tmp = (char *)malloc(len + 5);
+    if (w->path == NULL || w->tmp == NULL)
+    {
+        gricres_writer_abort(w);
+        return -1;
+    }
+    memcpy(w->path, path, len + 1);
+    snprintf(w->tmp, len + 5, "%s.tmp", path);
+
+    w->f = fopen(w->tmp, "wb");
+    w->spool = tmpfile();
+    if (w->f == NULL || w->spool == NULL)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] cannot write results bundle '%s': %s\n", __FILE__,
+                __LINE__, w->tmp, strerror(errno));
+        gricres_writer_abort(w);
+        return -1;
+    }
+
+    /* Header is written last; the membership column starts behind it */
+    put_bytes(w, NULL, GRICRES_HEADER_BYTES);
+    open_section(w, GRICRES_SEC_MEMBERSHIP, sizeof(int32_t));
+    if (w->err)
+    {
+        gricres_writer_abort(w);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * gricres_writer_frame() - Record one frame in the membership columns.
+ * @w:       Writer.
+ * @frame:   Frame number; frames come in increasing order.
+ * @cluster: Cluster assigned to the frame (-1 if none).
+ * @dist:    Distance of the frame to that cluster's anchor.
+ *
+ * Frames skipped since the last one recorded (discarded or not clustered)
+ * get cluster -1 and distance NaN, so row i of each column is frame i.
+ */
+void gricres_writer_frame(
+    GricResWriter *w,
+    uint64_t       frame,
+    int32_t        cluster,
+    double         dist)
+{
+    if (w->frames_done || frame < w->num_frames)
+    {
+        return;
+    }
+    while (w->num_frames <= frame && !w->err)
+    {
+        int32_t c = (w->num_frames == frame) ? cluster : -1;
+        double  d = (w->num_frames == frame) ? dist : NAN;
+        put_bytes(w, &c, sizeof(c));
+        if (!w->err && fwrite(&d, sizeof(d), 1, w->spool) != 1)
+        {
+            w->err = 1;
+        }
+        w->num_frames++;
+    }
+}
+
+/**
+ * gricres_writer_begin() - Start a summary section.
+ * @w:         Writer.
+ * @id:        Section identifier (GricResSectionId).
+ * @elem_size: Bytes per element.
+ *
+ * Ends the frame columns on first use; frames appended afterwards are ignored.
+ */
+void gricres_writer_begin(
+    GricResWriter *w,
+    uint32_t       id,
+    uint32_t       elem_size)
+{
+    end_frames(w);
+    open_section(w, id, elem_size);
+}
+
+/**
+ * gricres_writer_put() - Append elements to the current summary section.
+ * @w:    Writer.
+ * @data: Elements, in the section's element layout.
+ * @n:    Element count.
+ */
+void gricres_writer_put(
+    GricResWriter *w,
+    const void    *data,
+    size_t         n)
+{
+    if (!w->section_open)
+    {
+        w->err = 1;
+        return;
+    }
+    put_bytes(w, data, n * w->sections[w->num_sections - 1].elem_size);
+}
+
+/**
+ * gricres_writer_finish() - Complete a bundle and move it into place.
+ * @w:    Writer; its resources are released.
+ * @info: Scalar header fields (run parameters, telemetry); magic, version,
+ *        num_frames and the section table are filled in here.
+ *
+ * Return: 0 on success, -1 on failure (message printed, temporary file removed).
+ */
+int gricres_writer_finish(
+    GricResWriter       *w,
+    const GricResHeader *info)
+{
+    end_frames(w);
+    close_section(w);
+
+    GricResHeader hdr = *info;
+    memcpy(hdr.magic, gricres_magic, sizeof(gricres_magic));
+    hdr.version = GRICRES_VERSION;
+    hdr.num_frames = w->num_frames;
+    hdr.num_sections = (uint32_t)w->num_sections;
+    memset(hdr.sections, 0, sizeof(hdr.sections));
+    memcpy(hdr.sections, w->sections, (size_t)w->num_sections * sizeof(GricResSection));
+
+    if (!w->err
+        && (fseek(w->f, 0, SEEK_SET) != 0 || fwrite(&hdr, sizeof(hdr), 1, w->f) != 1))
+    {
+        w->err = 1;
+    }
+    if (fclose(w->f) != 0)
+    {
+        w->err = 1;
+    }
+    w->f = NULL;
+    if (!w->err && rename(w->tmp, w->path) != 0)
+    {
+        w->err = 1;
+    }
+    int err = w->err;
+    if (err)
+    {
+        fprintf(stderr, "ERROR: [%s:%d] cannot write results bundle '%s'\n", __FILE__,
+                __LINE__, w->path);
+    }
+    gricres_writer_abort(w);
+    return err ? -1 : 0;
+}
+
+/**
+ * gricres_writer_abort() - Drop an unfinished bundle.
+ * @w: Writer; its resources are released and its temporary file removed.
+ */
+void gricres_writer_abort(
+    GricResWriter *w)
+{
+    if (w->f != NULL)
+    {
+        fclose(w->f);
+        w->f = NULL;
+    }
+    if (w->spool != NULL)
+    {
+        fclose(w->spool);
+        w->spool = NULL;
+    }
+    if (w->tmp != NULL)
+    {
+        remove(w->tmp); /* No-op once renamed */
+    }
+    free(w->path);
+    free(w->tmp);
+    w->path = NULL;
+    w->tmp = NULL;
+}
@@ -0,0 +1,189 @@
+#ifndef GRICRES_H
+#define GRICRES_H
+
+/**
+ * @file gricres.h
+ * @brief Binary results bundle of a gric-cluster run (results.gricres).
+ *
+ * One file holding what the text outputs hold, in a form downstream tools
+ * map and read in place: per-frame membership and distance columns, the
+ * measured inter-cluster distances, per-cluster counts and radii, the anchor
+ * frames and the run's parameters and telemetry. A 4 KiB header with a
+ * section table is followed by the sections, each 64-byte aligned, in host
+ * byte order.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** Bundle file name inside the output directory. */
+#define GRICRES_FILE "results.gricres"
+
+/** On-disk format version. */
+#define GRICRES_VERSION 1
+
+/** Bytes reserved for the header; the first section starts here. */
+#define GRICRES_HEADER_BYTES 4096
+
+/** Alignment of every section. */
+#define GRICRES_ALIGN 64
+
+/** Entries of the section table. */
+#define GRICRES_MAX_SECTIONS 16
+
+/** Section identifiers. */
+typedef enum
+{
+    GRICRES_SEC_MEMBERSHIP = 1, /**< int32_t cluster of each frame (-1 if none) */
+    GRICRES_SEC_DIST       = 2, /**< double distance of each frame to its anchor */
+    GRICRES_SEC_DCC        = 3, /**< GricResDcc per measured cluster pair (as dcc.txt) */
+    GRICRES_SEC_CLUSTERS   = 4, /**< GricResCluster per cluster */
+    GRICRES_SEC_ANCHORS    = 5  /**< double, num_clusters x frame_width x frame_height */
+} GricResSectionId;
+
+/** Section table entry. */
+typedef struct
+{
+    uint32_t id;        /**< GricResSectionId */
+    uint32_t elem_size; /**< Bytes per element */
+    uint64_t offset;    /**< Byte offset in the file */
+    uint64_t count;     /**< Elements */
+} GricResSection;
+
+/** One measured inter-cluster distance. */
+typedef struct
+{
+    int32_t i; /**< First cluster */
+    int32_t j; /**< Second cluster */
+    double  d; /**< Smallest distance measured between their anchors */
+} GricResDcc;
+
+/** Per-cluster summary. */
+typedef struct
+{
+    int64_t count;  /**< Member frames */
+    double  radius; /**< Largest member-to-anchor distance */
+} GricResCluster;
+
+/** Bundle header, stored at offset 0. */
+typedef struct
+{
+    char           magic[8];           /**< "GRICRES\0" */
+    uint32_t       version;            /**< GRICRES_VERSION */
+    uint32_t       num_sections;       /**< Used entries of sections[] */
+    uint64_t       num_frames;         /**< Frames clustered (membership rows) */
+    uint64_t       num_clusters;       /**< Clusters */
+    uint64_t       frame_width;        /**< Anchor width */
+    uint64_t       frame_height;       /**< Anchor height */
+    double         rlim;               /**< Cluster radius */
+    double         deltaprob;          /**< Candidate probability threshold */
+    int64_t        maxcl;              /**< Cluster limit */
+    uint64_t       dists;              /**< Distance evaluations */
+    uint64_t       dists_sample;       /**< Frame-to-anchor evaluations */
+    uint64_t       dists_intercluster; /**< Anchor-to-anchor evaluations */
+    uint64_t       dists_abandoned;    /**< Early-abandoned evaluations */
+    uint64_t       pruned;             /**< Clusters pruned */
+    uint64_t       reserved[8];
+    GricResSection sections[GRICRES_MAX_SECTIONS];
+} GricResHeader;
+
+/** Read-only mapping of a bundle. */
+typedef struct
+{
+    const GricResHeader *hdr;  /**< Mapped header */
+    size_t               size; /**< Mapped bytes */
+} GricRes;
+
+/** Bundle being written (see gricres_writer_open()). */
+typedef struct GricResWriter
+{
+    FILE          *f;            /**< Temporary bundle file */
+    FILE          *spool;        /**< Distance column until the frames end */
+    char          *path;         /**< Final path */
+    char          *tmp;          /**< Temporary path */
+    uint64_t       num_frames;   /**< Frames recorded (last frame + 1) */
+    uint64_t       pos;          /**< Write position in f */
+    int            err;          /**< Set on any write error */
+    int            frames_done;  /**< Membership and distance sections written */
+    int            section_open; /**< Last entry of sections[] still growing */
+    int            num_sections; /**< Used entries of sections[] */
+    GricResSection sections[GRICRES_MAX_SECTIONS];
+} GricResWriter;
+
+/**
+ * @brief Map bundle @path; returns 0 on success, -1 if missing or invalid.
+ */
+int gricres_open(
+    GricRes    *res,
+    const char *path);
+
+/**
+ * @brief Unmap @res (safe on a zeroed or failed GricRes).
+ */
+void gricres_close(
+    GricRes *res);
+
+/**
+ * @brief Address of section @id in the mapping, or NULL if absent; its element count
+ *        goes to *@count unless @count is NULL.
+ */
+const void *gricres_section(
+    const GricRes *res,
+    uint32_t       id,
+    uint64_t      *count);
+
+/**
+ * @brief Start bundle @path (written to @path.tmp); returns 0 on success, -1 on failure.
+ *
+ * Frames are then appended with gricres_writer_frame(), sections with
+ * gricres_writer_begin()/gricres_writer_put(), and gricres_writer_finish()
+ * renames the file into place.
+ */
+int gricres_writer_open(
+    GricResWriter *w,
+    const char    *path);
+
+/**
+ * @brief Record cluster and distance of frame @frame (frames in increasing order;
+ *        skipped frames get cluster -1 and distance NaN).
+ */
+void gricres_writer_frame(
+    GricResWriter *w,
+    uint64_t       frame,
+    int32_t        cluster,
+    double         dist);
+
+/**
+ * @brief Start section @id of @elem_size-byte elements (ends the previous one).
+ */
+void gricres_writer_begin(
+    GricResWriter *w,
+    uint32_t       id,
+    uint32_t       elem_size);
+
+/**
+ * @brief Append @n elements to the current section.
+ */
+void gricres_writer_put(
+    GricResWriter *w,
+    const void    *data,
+    size_t         n);
+
+/**
+ * @brief Write the header (scalar fields from @info) and move the bundle into place.
+ *
+ * Returns 0 on success, -1 on failure (nothing left behind). The resources held
+ * by @w are released either way.
+ */
+int gricres_writer_finish(
+    GricResWriter       *w,
+    const GricResHeader *info);
+
+/**
+ * @brief Drop an unfinished bundle and release the resources held by @w.
+ */
+void gricres_writer_abort(
+    GricResWriter *w);
+
+#endif // GRICRES_H
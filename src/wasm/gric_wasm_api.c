@@ -19,9 +19,11 @@
 #include "cluster_defs.h"
 #include "cluster_step.h"
 #include "cluster_steps.h"
+#include "cluster_mgmt.h"
 #include "framedistance.h"
 #include "cluster_math.h"
 #include "cluster_bounds.h"
+#include "cluster_core.h"
 #include "../gric-cluster/trace/cluster_trace.h"
 
 #include <math.h>
@@ -114,6 +116,114 @@ double get_dist(
     return framedist(a, b);
 }
 
+/**
+ * get_dist_bounded() - get_dist() with early abandon beyond @limit.
+ * @a:             First frame (current sample).
+ * @b:             Second frame (cluster anchor).
+ * @cluster_idx:   Cluster index (>=0 for sample-cluster,
+ *                 <0 for inter-cluster).
+ * @cluster_prob:  Prior probability (unused in WASM).
+ * @current_gprob: Geometric probability (unused).
+ * @limit:         Abandon limit (<= 0 for exact).
+ * @exact:         Output; 0 if the result is a lower bound.
+ * @config:        Clustering configuration.
+ * @state:         Clustering state.
+ *
+ * Return: Distance or lower bound, or -1.0 on dimension mismatch.
+ */
+double get_dist_bounded(
+    Frame         *a,
+    Frame         *b,
+    int            cluster_idx,
+    double         cluster_prob,
+    double         current_gprob,
+    double         limit,
+    int           *exact,
+    ClusterConfig *config,
+    ClusterState  *state)
+{
+    double d = framedist_bounded(a, b, limit, exact);
+    account_dist(a, b, cluster_idx, cluster_prob, current_gprob, d, *exact, config, state);
+    return d;
+}
+
+/**
+ * account_dist() - Telemetry of one distance evaluation.
+ * @a:             First frame (unused in WASM).
+ * @b:             Second frame (unused in WASM).
+ * @cluster_idx:   Cluster index (>=0 for sample-cluster,
+ *                 <0 for inter-cluster).
+ * @cluster_prob:  Prior probability (unused in WASM).
+ * @current_gprob: Geometric probability (unused).
+ * @d:             Distance found (unused in WASM).
+ * @exact:         0 if the distance is a lower bound.
+ * @config:        Clustering configuration.
+ * @state:         Clustering state.
+ */
+void account_dist(
+    Frame         *a,
+    Frame         *b,
+    int            cluster_idx,
+    double         cluster_prob,
+    double         current_gprob,
+    double         d,
+    int            exact,
+    ClusterConfig *config,
+    ClusterState  *state)
+{
+    (void)a;
+    (void)b;
+    (void)cluster_prob;
+    (void)current_gprob;
+    (void)d;
+    (void)config;
+
+    state->telemetry.framedist_calls++;
+    if (cluster_idx >= 0)
+    {
+        state->telemetry.framedist_calls_sample++;
+    }
+    else
+    {
+        state->telemetry.framedist_calls_intercluster++;
+    }
+    if (!exact)
+    {
+        state->telemetry.framedist_abandoned++;
+    }
+}
+
+/**
+ * get_dist_batch() - Distances from one frame to several cluster anchors.
+ * @a:          Frame (current sample).
+ * @clusters:   Cluster indices.
+ * @n:          Number of clusters.
+ * @config:     Clustering configuration.
+ * @state:      Clustering state.
+ * @out:        Output distances.
+ */
+void get_dist_batch(
+    Frame         *a,
+    const int     *clusters,
+    int            n,
+    ClusterConfig *config,
+    ClusterState  *state,
+    double        *out)
+{
+    Frame  *anchors[n];
+    double  nsq[n];
+
+    for (int kk = 0; kk < n; kk++)
+    {
+        anchors[kk] = &state->clusters[clusters[kk]].anchor;
+        nsq[kk] = state->clusters[clusters[kk]].norm_sq;
+    }
+    state->telemetry.framedist_calls += n;
+    state->telemetry.framedist_calls_sample += n;
+
+    framedist_batch(a, anchors, nsq, n, config->algo.rlim, out);
+}
+
 /**
  * print_clustering_metrics() - Stub for WASM
  *    (referenced by some step files but not needed).
@@ -288,21 +398,16 @@ void *wasm_cluster_init(
         s->current_gprobs =
             (double *)calloc(N, sizeof(double));
 
-        s->dcc_min =
-            (double *)calloc((size_t)N * N,
-                             sizeof(double));
-        s->dcc_max =
-            (double *)calloc((size_t)N * N,
-                             sizeof(double));
-        s->dcc_measured =
-            (char *)calloc((size_t)N * N,
-                           sizeof(char));
-
-        size_t mask_words =
-            (size_t)N * N * ((N + 63) / 64);
-        s->consistency_mask =
-            (uint64_t *)calloc(mask_words,
-                               sizeof(uint64_t));
+        dcc_store_init(&s->dcc, N,
+                       h->config.optim.sparse_dcc_mode);
+        s->dist_lower_bound =
+            (char *)calloc(N, sizeof(char));
+        s->dfc_cache =
+            (double *)calloc(N, sizeof(double));
+        s->dfc_cache_stamp =
+            (long *)calloc(N, sizeof(long));
+
+        consistency_cache_init(&s->consistency, N);
 
         s->entropy_p_current =
             (double *)calloc(N, sizeof(double));
@@ -320,12 +425,7 @@ void *wasm_cluster_init(
             (double *)calloc(N, sizeof(double));
         s->entropy_visited =
             (uint8_t *)calloc(N, sizeof(uint8_t));
-        s->refine_queue =
-            (Candidate *)calloc(N, sizeof(Candidate));
-        s->refine_queue_size = 0;
-        s->refine_queue_idx = 0;
-        s->refine_queue_capacity = N;
-        s->refine_queue_last_num_clusters = 0;
+        refine_queue_init(&s->refine);
         s->tuple_pred_candidates =
             (int *)calloc(N, sizeof(int));
         s->tuple_pred_count = 0;
@@ -438,11 +538,11 @@ static int grow_capacity(WasmHandle *h)
     GROW_LINEAR(s->entropy_active_indices, int);
     GROW_LINEAR(s->entropy_plog2p, double);
     GROW_LINEAR(s->entropy_visited, uint8_t);
-    GROW_LINEAR(s->refine_queue, Candidate);
+    GROW_LINEAR(s->dist_lower_bound, char);
+    GROW_LINEAR(s->dfc_cache, double);
+    GROW_LINEAR(s->dfc_cache_stamp, long);
     GROW_LINEAR(s->tuple_pred_candidates, int);
 
-    s->refine_queue_capacity = new_N;
-
     ClusterTelemetry *t = &h->state.telemetry;
     GROW_LINEAR(t->pruned_fraction_sum, double);
     GROW_LINEAR(t->step_counts, long);
@@ -472,29 +572,11 @@ static int grow_capacity(WasmHandle *h)
     if (!new_tm) return -1;
     h->state.transition_matrix = new_tm;
 
-    double *new_dcc_min = (double *)grow_nxn_matrix(
-        s->dcc_min, old_N, new_N, sizeof(double)
-    );
-    if (!new_dcc_min) return -1;
-    s->dcc_min = new_dcc_min;
+    if (dcc_store_grow(&s->dcc, new_N) != 0) return -1;
 
-    double *new_dcc_max = (double *)grow_nxn_matrix(
-        s->dcc_max, old_N, new_N, sizeof(double)
-    );
-    if (!new_dcc_max) return -1;
-    s->dcc_max = new_dcc_max;
-
-    char *new_dcc_measured = (char *)grow_nxn_matrix(
-        s->dcc_measured, old_N, new_N, sizeof(char)
-    );
-    if (!new_dcc_measured) return -1;
-    s->dcc_measured = new_dcc_measured;
-
-    size_t new_mask_words = (size_t)new_N * new_N * ((new_N + 63) / 64);
-    uint64_t *new_mask = (uint64_t *)calloc(new_mask_words, sizeof(uint64_t));
-    if (!new_mask) return -1;
-    free(s->consistency_mask);
-    s->consistency_mask = new_mask;
+    /* Cached masks are sized for the old capacity; rebuild them on demand */
+    consistency_cache_free(&s->consistency);
+    if (consistency_cache_init(&s->consistency, new_N) != 0) return -1;
 
     h->config.algo.maxnbclust = new_N;
     t->max_steps_recorded = new_N;
@@ -703,8 +785,6 @@ void wasm_cluster_get_dcc(
 
     int nc = h->state.num_clusters;
     int lim = (K < nc) ? K : nc;
-    int stride = h->config.algo.maxnbclust;
-
     /* Zero the output */
     memset(out_dcc, 0,
            (size_t)K * K * sizeof(double));
@@ -714,8 +794,8 @@ void wasm_cluster_get_dcc(
         for (int j = 0; j < lim; j++)
         {
             out_dcc[i * K + j] =
-                h->state.scratch.dcc_min[
-                    i * stride + j];
+                dcc_get_min(&h->state.scratch.dcc,
+                            i, j);
         }
     }
 }
@@ -734,7 +814,6 @@ void wasm_cluster_get_transition_matrix(
 
     int nc = h->state.num_clusters;
     int lim = (K < nc) ? K : nc;
-    int stride = h->config.algo.maxnbclust;
 
     memset(out_tm, 0,
            (size_t)K * K * sizeof(long));
@@ -744,8 +823,7 @@ void wasm_cluster_get_transition_matrix(
         for (int j = 0; j < lim; j++)
         {
             out_tm[i * K + j] =
-                h->state.transition_matrix[
-                    i * stride + j];
+                *transition_cell(&h->state, i, j);
         }
     }
 }
@@ -930,14 +1008,16 @@ void wasm_cluster_reset(void *ptr)
 
     memset(h->state.clusters, 0,
            (size_t)N * sizeof(Cluster));
+    memset(h->state.scratch.dfc_cache_stamp, 0,
+           (size_t)N * sizeof(long));
 
     /* Free visitor list arrays */
     for (int i = 0; i < N; i++)
     {
-        if (h->state.cluster_visitors[i].frames)
+        if (h->state.cluster_visitors[i].entries)
         {
             free(
-                h->state.cluster_visitors[i].frames
+                h->state.cluster_visitors[i].entries
             );
         }
     }
@@ -949,6 +1029,9 @@ void wasm_cluster_reset(void *ptr)
     {
         h->state.assignments[i] = -1;
     }
+    assign_remap_free(&h->state.assign_remap);
+    occ_index_free(&h->state.occ_index);
+    frame_log_free(&h->state.frame_log);
 
     memset(h->state.frame_infos, 0,
            (size_t)maxnbfr * sizeof(FrameInfo));
@@ -959,21 +1042,11 @@ void wasm_cluster_reset(void *ptr)
     {
         ClusterScratch *s = &h->state.scratch;
 
-        memset(s->dcc_min, 0,
-               (size_t)N * N * sizeof(double));
-        memset(s->dcc_max, 0,
-               (size_t)N * N * sizeof(double));
-        memset(s->dcc_measured, 0,
-               (size_t)N * N * sizeof(char));
-
-        size_t mask_words =
-            (size_t)N * N * ((N + 63) / 64);
-        memset(s->consistency_mask, 0,
-               mask_words * sizeof(uint64_t));
-
-        s->refine_queue_size = 0;
-        s->refine_queue_idx = 0;
-        s->refine_queue_last_num_clusters = 0;
+        dcc_store_reset(&s->dcc);
+
+        invalidate_consistency_masks(&h->state);
+
+        refine_queue_reset(&s->refine);
         s->tuple_pred_count = 0;
     } // Reset scratch
 
@@ -1053,10 +1126,10 @@ void wasm_cluster_free(void *ptr)
     /* Free visitor list arrays */
     for (int i = 0; i < N; i++)
     {
-        if (h->state.cluster_visitors[i].frames)
+        if (h->state.cluster_visitors[i].entries)
         {
             free(
-                h->state.cluster_visitors[i].frames
+                h->state.cluster_visitors[i].entries
             );
         }
     }
@@ -1064,6 +1137,9 @@ void wasm_cluster_free(void *ptr)
     free(h->state.clusters);
     free(h->state.cluster_visitors);
     free(h->state.assignments);
+    assign_remap_free(&h->state.assign_remap);
+    occ_index_free(&h->state.occ_index);
+    frame_log_free(&h->state.frame_log);
     free(h->state.frame_infos);
     free(h->state.transition_matrix);
 
@@ -1074,10 +1150,11 @@ void wasm_cluster_free(void *ptr)
         free(s->clmembflag);
         free(s->probsortedclindex);
         free(s->current_gprobs);
-        free(s->dcc_min);
-        free(s->dcc_max);
-        free(s->dcc_measured);
-        free(s->consistency_mask);
+        dcc_store_free(&s->dcc);
+        free(s->dist_lower_bound);
+        free(s->dfc_cache);
+        free(s->dfc_cache_stamp);
+        consistency_cache_free(&s->consistency);
         free(s->entropy_p_current);
         free(s->entropy_candidates);
         free(s->entropy_prob_scores);
@@ -1085,7 +1162,7 @@ void wasm_cluster_free(void *ptr)
         free(s->entropy_active_indices);
         free(s->entropy_plog2p);
         free(s->entropy_visited);
-        free(s->refine_queue);
+        refine_queue_free(&s->refine);
         free(s->tuple_pred_candidates);
     } // Free scratch
 
@@ -1433,7 +1510,7 @@ void *wasm_multitile_init(
         free(h);
         return NULL;
     }
-    frame_scatter_alloc(h->tile_map, h->scatter_buf);
+    frame_scatter_alloc(h->tile_map, FRAME_DTYPE_F64, h->scatter_buf);
 
     /* Reusable source frame */
     h->src_frame.data = calloc(ndim, sizeof(double));
@@ -1489,10 +1566,7 @@ int wasm_multitile_process_frame(
         &h->src_frame, h->tile_map, h->scatter_buf);
 
     /* 2. Initialize cross-tile board */
-    for (int m = 0; m < M; m++)
-    {
-        h->mts->xtile_board[m] = -1;
-    }
+    xtile_board_reset(h->mts->xtile_board, M);
 
     /* 3. Predict joint tuples for Pass 1 priors */
     if (h->config.optim.pred_mode)
@@ -1515,6 +1589,7 @@ int wasm_multitile_process_frame(
         task_frame.cnt0 = h->scatter_buf[m].cnt0;
         task_frame.width = h->scatter_buf[m].width;
         task_frame.height = h->scatter_buf[m].height;
+        task_frame.borrowed = 0;
         task_frame.data = malloc(
             (size_t)(task_frame.width
                      * task_frame.height)
@@ -1531,6 +1606,7 @@ int wasm_multitile_process_frame(
             * sizeof(double));
 
         ts->pass1_old_ncl = ts->state.num_clusters;
+        ts->cur_frame = h->current_frame_id;
 
         /* Reset per-frame scratch */
         for (int i = 0;
@@ -1574,9 +1650,8 @@ int wasm_multitile_process_frame(
             ts->verbose_candidates);
 
         ts->pass1_assignment = (res >= 0) ? res : -1;
-        __atomic_store_n(
-            &ts->xtile_board[m], res,
-            __ATOMIC_RELEASE);
+        xtile_board_post(
+            &ts->xtile_board[m], h->current_frame_id, res);
     } // for each tile m (Pass 1)
 
     /* 5. Pass 2: Bayesian fusion */
@@ -1911,11 +1986,11 @@ void wasm_multitile_reset(void *ptr)
         /* Free visitor list arrays */
         for (int i = 0; i < N; i++)
         {
-            if (ts->state.cluster_visitors[i].frames)
+            if (ts->state.cluster_visitors[i].entries)
             {
                 free(
                     ts->state
-                        .cluster_visitors[i].frames);
+                        .cluster_visitors[i].entries);
             }
         }
         memset(ts->state.cluster_visitors, 0,
@@ -1928,6 +2003,9 @@ void wasm_multitile_reset(void *ptr)
         {
             ts->state.assignments[i] = -1;
         }
+        assign_remap_free(&ts->state.assign_remap);
+        occ_index_free(&ts->state.occ_index);
+        frame_log_free(&ts->state.frame_log);
         memset(ts->state.frame_infos, 0,
                (size_t)h->maxnbfr * sizeof(FrameInfo));
         memset(ts->state.transition_matrix, 0,
@@ -1936,19 +2014,9 @@ void wasm_multitile_reset(void *ptr)
         /* Reset scratch matrices */
         {
             ClusterScratch *s = &ts->state.scratch;
-            memset(s->dcc_min, 0,
-                   (size_t)N * N * sizeof(double));
-            memset(s->dcc_max, 0,
-                   (size_t)N * N * sizeof(double));
-            memset(s->dcc_measured, 0,
-                   (size_t)N * N * sizeof(char));
-            size_t mw =
-                (size_t)N * N * ((N + 63) / 64);
-            memset(s->consistency_mask, 0,
-                   mw * sizeof(uint64_t));
-            s->refine_queue_size = 0;
-            s->refine_queue_idx = 0;
-            s->refine_queue_last_num_clusters = 0;
+            dcc_store_reset(&s->dcc);
+            invalidate_consistency_masks(&ts->state);
+            refine_queue_reset(&s->refine);
             s->tuple_pred_count = 0;
         } // Reset scratch
 
@@ -2017,10 +2085,7 @@ void wasm_multitile_reset(void *ptr)
     }
 
     /* Reset xtile board */
-    for (int m = 0; m < M; m++)
-    {
-        h->mts->xtile_board[m] = -1;
-    }
+    xtile_board_reset(h->mts->xtile_board, M);
 }
 
 /**
@@ -0,0 +1,62 @@
+"""Write the same frames as a FITS cube and an ASCII file, for the -dtype reader tests.
+
+Pixels include negative, fractional and above-65535 values, so integer frame
+types have to round and clamp them. Reading both files with the same -dtype
+must give the same clustering. Only the standard library is used.
+
+Usage: generate_dtype_fits.py <out.fits> <out.txt>
+"""
+import random
+import struct
+import sys
+
+WIDTH = 4
+HEIGHT = 2
+NUM_FRAMES = 300
+CENTERS = [-40.0, 12.5, 300.25, 70000.0]
+
+
+def card(key, value):
+    return f"{key:<8}= {value:>20}".ljust(80)
+
+
+def write_fits(filename, frames):
+    cards = [
+        card("SIMPLE", "T"),
+        card("BITPIX", "-64"),
+        card("NAXIS", "3"),
+        card("NAXIS1", str(WIDTH)),
+        card("NAXIS2", str(HEIGHT)),
+        card("NAXIS3", str(len(frames))),
+        "END".ljust(80),
+    ]
+    header = "".join(cards)
+    header += " " * (-len(header) % 2880)
+    data = b"".join(struct.pack(">%dd" % len(f), *f) for f in frames)
+    data += b"\0" * (-len(data) % 2880)
+    with open(filename, "wb") as f:
+        f.write(header.encode("ascii"))
+        f.write(data)
+
+
+def write_ascii(filename, frames):
+    with open(filename, "w") as f:
+        for frame in frames:
+            f.write(" ".join(repr(v) for v in frame) + "\n")
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    rng = random.Random(7)
+    frames = []
+    for ii in range(NUM_FRAMES):
+        base = CENTERS[ii % len(CENTERS)]
+        frames.append([base + rng.uniform(-2.0, 2.0) for _ in range(WIDTH * HEIGHT)])
+    write_fits(sys.argv[1], frames)
+    write_ascii(sys.argv[2], frames)
+    print(f"Wrote {sys.argv[1]} and {sys.argv[2]} ({NUM_FRAMES} frames, {WIDTH}x{HEIGHT})")
+
+
+if __name__ == "__main__":
+    main()